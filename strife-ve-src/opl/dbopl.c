@@ -50,6 +50,18 @@
 
 #define GCC_UNLIKELY(x) x
 
+// Channel__BlockTemplate must be inlined into each of the per-mode
+// wrappers below, so that the mode checks are resolved at compile
+// time rather than once per sample.
+
+#if defined(__GNUC__)
+#define DB_FORCEINLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define DB_FORCEINLINE __forceinline
+#else
+#define DB_FORCEINLINE inline
+#endif
+
 #define TRUE 1
 #define FALSE 0
 
@@ -114,8 +126,8 @@ static inline Bit32u Chip__ForwardNoise(Chip *self);
 
 // C++'s template<> sure is useful sometimes.
 
-static Channel* Channel__BlockTemplate(Channel *self, Chip* chip,
-                                Bit32u samples, Bit32s* output,
+static DB_FORCEINLINE Channel* Channel__BlockTemplate(Channel *self,
+                                Chip* chip, Bit32u samples, Bit32s* output,
                                 SynthMode mode );
 #define BLOCK_TEMPLATE(mode) \
     static Channel* Channel__BlockTemplate_ ## mode(Channel *self, Chip* chip, \
@@ -908,8 +920,8 @@ static inline void Channel__GeneratePercussion(Channel *self, Chip* chip,
 	}
 }
 
-Channel* Channel__BlockTemplate(Channel *self, Chip* chip,
-                                Bit32u samples, Bit32s* output,
+static DB_FORCEINLINE Channel* Channel__BlockTemplate(Channel *self,
+                                Chip* chip, Bit32u samples, Bit32s* output,
                                 SynthMode mode ) {
         Bitu i;
 
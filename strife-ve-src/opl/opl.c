@@ -57,6 +57,7 @@ static opl_driver_t *driver = NULL;
 static int init_stage_reg_writes = 1;
 
 unsigned int opl_sample_rate = 22050;
+int opl_offline = 0;
 
 //
 // Init/shutdown code.
@@ -128,6 +129,13 @@ int OPL_Init(unsigned int port_base)
     char *driver_name;
     int i;
 
+    // Offline rendering is only possible with the software emulator.
+
+    if (opl_offline)
+    {
+        return InitDriver(&opl_sdl_driver, port_base);
+    }
+
     driver_name = getenv("OPL_DRIVER");
 
     if (driver_name != NULL)
@@ -179,6 +187,11 @@ void OPL_SetSampleRate(unsigned int rate)
     opl_sample_rate = rate;
 }
 
+void OPL_SetOffline(int offline)
+{
+    opl_offline = offline;
+}
+
 void OPL_WritePort(opl_port_t port, unsigned int value)
 {
     if (driver != NULL)
@@ -427,16 +440,31 @@ void OPL_Delay(uint64_t us)
 
     OPL_SetCallback(us, DelayCallback, &delay_data);
 
-    // Wait until the callback is invoked.
+    if (opl_offline)
+    {
+        int16_t buffer[64 * 2];
 
-    SDL_LockMutex(delay_data.mutex);
+        // There is no audio thread to invoke the callback, so generate
+        // output here until it has been invoked.
 
-    while (!delay_data.finished)
-    {
-        SDL_CondWait(delay_data.cond, delay_data.mutex);
+        while (!delay_data.finished)
+        {
+            OPL_RenderSamples(buffer, 64);
+        }
     }
+    else
+    {
+        // Wait until the callback is invoked.
+
+        SDL_LockMutex(delay_data.mutex);
 
-    SDL_UnlockMutex(delay_data.mutex);
+        while (!delay_data.finished)
+        {
+            SDL_CondWait(delay_data.cond, delay_data.mutex);
+        }
+
+        SDL_UnlockMutex(delay_data.mutex);
+    }
 
     // Clean up.
 
@@ -74,6 +74,18 @@ void OPL_Shutdown(void);
 
 void OPL_SetSampleRate(unsigned int rate);
 
+// Select offline mode.  When set before OPL_Init, the software
+// emulator is used without opening an audio device, and output is
+// only generated on demand by calling OPL_RenderSamples.
+
+void OPL_SetOffline(int offline);
+
+// Generate stereo 16-bit samples from the emulator in offline mode,
+// invoking any callbacks that fall due.  Returns non-zero if more
+// callbacks are still waiting to be invoked.
+
+int OPL_RenderSamples(int16_t *buffer, unsigned int nsamples);
+
 // Write to one of the OPL I/O ports:
 
 void OPL_WritePort(opl_port_t port, unsigned int value);
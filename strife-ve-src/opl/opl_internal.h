@@ -54,5 +54,9 @@ typedef struct
 
 extern unsigned int opl_sample_rate;
 
+// If non-zero, no audio device is used; see OPL_SetOffline.
+
+extern int opl_offline;
+
 #endif /* #ifndef OPL_INTERNAL_H */
 
@@ -42,6 +42,13 @@ typedef struct
     uint64_t expire_time;     // Calculated time that timer will expire.
 } opl_timer_t;
 
+typedef struct
+{
+    unsigned int offset;      // Sample position within the mix buffer.
+    unsigned int reg;
+    unsigned int value;
+} opl_queued_write_t;
+
 // When the callback mutex is locked using OPL_Lock, callback functions
 // are not invoked.
 
@@ -80,6 +87,35 @@ static int32_t *mix_buffer = NULL;
 
 static int register_num = 0;
 
+// Chip register writes waiting to be applied.  Rather than splitting
+// the output at every callback, all the callbacks that fall within a
+// mix buffer are invoked first, and their writes applied at the right
+// sample positions while the output is generated in as few blocks as
+// possible.  Writes from the control thread are queued the same way,
+// at the point callbacks have reached, so that only the mixing thread
+// touches the chip and the order of writes is kept.
+
+typedef struct
+{
+    opl_queued_write_t *writes;
+    unsigned int num_writes;
+    unsigned int alloced;
+} opl_write_queue_t;
+
+// Writes being queued, and the sample position within the next mix
+// buffer that they are made at.  Both are guarded by write_queue_mutex.
+
+static opl_write_queue_t write_queue;
+static unsigned int render_time;
+static SDL_mutex *write_queue_mutex = NULL;
+
+// Writes being applied to the mix buffer being filled, and how far
+// output has been generated.  Only used by the mixing thread.
+
+static opl_write_queue_t render_queue;
+static int16_t *render_buffer;
+static unsigned int render_pos;
+
 // Timers; DBOPL does not do timer stuff itself.
 
 static opl_timer_t timer1 = { 12500, 0, 0, 0 };
@@ -175,68 +211,161 @@ static void FillBuffer(int16_t *buffer, unsigned int nsamples)
     }
 }
 
-// Callback function to fill a new sound buffer:
+// Generate output up to the specified sample position, applying the
+// queued register writes as their positions are reached.
 
-static void OPL_Mix_Callback(void *udata,
-                             Uint8 *byte_buffer,
-                             int buffer_bytes)
+static void RenderQueuedWrites(unsigned int end)
 {
-    int16_t *buffer;
-    unsigned int buffer_len;
-    unsigned int filled = 0;
+    opl_queued_write_t *write;
+    unsigned int i;
 
-    // Buffer length in samples (quadrupled, because of 16-bit and stereo)
+    for (i=0; i<render_queue.num_writes; ++i)
+    {
+        write = &render_queue.writes[i];
 
-    buffer = (int16_t *) byte_buffer;
-    buffer_len = buffer_bytes / 4;
+        if (write->offset > render_pos)
+        {
+            FillBuffer(render_buffer + render_pos * 2,
+                       write->offset - render_pos);
+            render_pos = write->offset;
+        }
+
+        Chip__WriteReg(&opl_chip, write->reg, write->value);
+    }
 
-    // Repeatedly call the OPL emulator update function until the buffer is
-    // full.
+    render_queue.num_writes = 0;
 
-    while (filled < buffer_len)
+    if (end > render_pos)
     {
-        uint64_t next_callback_time;
-        uint64_t nsamples;
+        FillBuffer(render_buffer + render_pos * 2, end - render_pos);
+        render_pos = end;
+    }
+}
 
-        SDL_LockMutex(callback_queue_mutex);
+// Queue a write to a chip register, to be applied by the mixing thread.
+
+static void WriteChipRegister(unsigned int reg_num, unsigned int value)
+{
+    opl_queued_write_t *write;
+
+    SDL_LockMutex(write_queue_mutex);
+
+    if (write_queue.num_writes == write_queue.alloced)
+    {
+        write_queue.alloced = write_queue.alloced ? write_queue.alloced * 2
+                                                  : 512;
+        write_queue.writes = realloc(write_queue.writes,
+                                     write_queue.alloced
+                                   * sizeof(*write_queue.writes));
+        assert(write_queue.writes != NULL);
+    }
 
-        // Work out the time until the next callback waiting in
-        // the callback queue must be invoked.  We can then fill the
-        // buffer with this many samples.
+    write = &write_queue.writes[write_queue.num_writes];
+    write->offset = render_time;
+    write->reg = reg_num;
+    write->value = value;
+    ++write_queue.num_writes;
 
-        if (opl_sdl_paused || OPL_Queue_IsEmpty(callback_queue))
+    SDL_UnlockMutex(write_queue_mutex);
+}
+
+// Work out the number of samples until the next callback waiting in
+// the callback queue must be invoked, up to the specified limit.
+
+static unsigned int SamplesToNextCallback(unsigned int limit)
+{
+    uint64_t next_callback_time;
+    uint64_t nsamples;
+
+    SDL_LockMutex(callback_queue_mutex);
+
+    if (opl_sdl_paused || OPL_Queue_IsEmpty(callback_queue))
+    {
+        nsamples = limit;
+    }
+    else
+    {
+        next_callback_time = OPL_Queue_Peek(callback_queue) + pause_offset;
+
+        nsamples = (next_callback_time - current_time) * mixing_freq;
+        nsamples = (nsamples + OPL_SECOND - 1) / OPL_SECOND;
+
+        if (nsamples > limit)
         {
-            nsamples = buffer_len - filled;
+            nsamples = limit;
         }
-        else
-        {
-            next_callback_time = OPL_Queue_Peek(callback_queue) + pause_offset;
+    }
 
-            nsamples = (next_callback_time - current_time) * mixing_freq;
-            nsamples = (nsamples + OPL_SECOND - 1) / OPL_SECOND;
+    SDL_UnlockMutex(callback_queue_mutex);
 
-            if (nsamples > buffer_len - filled)
-            {
-                nsamples = buffer_len - filled;
-            }
-        }
+    return nsamples;
+}
 
-        SDL_UnlockMutex(callback_queue_mutex);
+// Callback function to fill a new sound buffer:
 
-        // Add emulator output to buffer.
+static void OPL_Mix_Callback(void *udata,
+                             Uint8 *byte_buffer,
+                             int buffer_bytes)
+{
+    opl_write_queue_t queue;
+    unsigned int buffer_len;
+    unsigned int nsamples;
+    unsigned int time;
+
+    // Buffer length in samples (quadrupled, because of 16-bit and stereo)
+
+    buffer_len = buffer_bytes / 4;
 
-        FillBuffer(buffer + filled * 2, nsamples);
-        filled += nsamples;
+    // Invoke all the callbacks that fall within this buffer, at the
+    // same points in time as if the output was generated in between.
+    // Writes made meanwhile, by callbacks or by the control thread,
+    // are queued at the point reached.
 
-        // Invoke callbacks for this point in time.
+    time = 0;
+
+    while (time < buffer_len)
+    {
+        nsamples = SamplesToNextCallback(buffer_len - time);
+        time += nsamples;
+
+        SDL_LockMutex(write_queue_mutex);
+        render_time = time;
+        SDL_UnlockMutex(write_queue_mutex);
 
         AdvanceTime(nsamples);
     }
+
+    // Take the writes queued for this buffer; any made from now on go
+    // at the start of the next one.
+
+    SDL_LockMutex(write_queue_mutex);
+    queue = render_queue;
+    render_queue = write_queue;
+    write_queue = queue;
+    write_queue.num_writes = 0;
+    render_time = 0;
+    SDL_UnlockMutex(write_queue_mutex);
+
+    // Now generate the whole buffer, without holding up the control
+    // thread.
+
+    render_buffer = (int16_t *) byte_buffer;
+    render_pos = 0;
+
+    RenderQueuedWrites(buffer_len);
 }
 
 static void OPL_SDL_Shutdown(void)
 {
-    Mix_HookMusic(NULL, NULL);
+    if (opl_offline)
+    {
+        OPL_Queue_Destroy(callback_queue);
+        free(mix_buffer);
+    }
+    else
+    {
+        Mix_HookMusic(NULL, NULL);
+    }
 
     if (sdl_was_initialized)
     {
@@ -266,6 +395,18 @@ static void OPL_SDL_Shutdown(void)
         SDL_DestroyMutex(callback_queue_mutex);
         callback_queue_mutex = NULL;
     }
+
+    if (write_queue_mutex != NULL)
+    {
+        SDL_DestroyMutex(write_queue_mutex);
+        write_queue_mutex = NULL;
+    }
+
+    free(write_queue.writes);
+    free(render_queue.writes);
+    memset(&write_queue, 0, sizeof(write_queue));
+    memset(&render_queue, 0, sizeof(render_queue));
+    render_time = 0;
 }
 
 static unsigned int GetSliceSize(void)
@@ -295,9 +436,14 @@ static unsigned int GetSliceSize(void)
 static int OPL_SDL_Init(unsigned int port_base)
 {
     // Check if SDL_mixer has been opened already
-    // If not, we must initialize it now
+    // If not, we must initialize it now.  In offline mode, no audio
+    // device is opened; samples are generated on demand instead.
 
-    if (!SDLIsInitialized())
+    if (opl_offline)
+    {
+        sdl_was_initialized = 0;
+    }
+    else if (!SDLIsInitialized())
     {
         if (SDL_Init(SDL_INIT_AUDIO) < 0)
         {
@@ -335,7 +481,16 @@ static int OPL_SDL_Init(unsigned int port_base)
 
     // Get the mixer frequency, format and number of channels.
 
-    Mix_QuerySpec(&mixing_freq, &mixing_format, &mixing_channels);
+    if (opl_offline)
+    {
+        mixing_freq = opl_sample_rate;
+        mixing_format = AUDIO_S16SYS;
+        mixing_channels = 2;
+    }
+    else
+    {
+        Mix_QuerySpec(&mixing_freq, &mixing_format, &mixing_channels);
+    }
 
     // Only supports AUDIO_S16SYS
 
@@ -361,13 +516,30 @@ static int OPL_SDL_Init(unsigned int port_base)
 
     callback_mutex = SDL_CreateMutex();
     callback_queue_mutex = SDL_CreateMutex();
+    write_queue_mutex = SDL_CreateMutex();
 
     // TODO: This should be music callback? or-?
-    Mix_HookMusic(OPL_Mix_Callback, NULL);
+    if (!opl_offline)
+    {
+        Mix_HookMusic(OPL_Mix_Callback, NULL);
+    }
 
     return 1;
 }
 
+int OPL_RenderSamples(int16_t *buffer, unsigned int nsamples)
+{
+    int pending;
+
+    OPL_Mix_Callback(NULL, (Uint8 *) buffer, nsamples * 4);
+
+    SDL_LockMutex(callback_queue_mutex);
+    pending = !OPL_Queue_IsEmpty(callback_queue);
+    SDL_UnlockMutex(callback_queue_mutex);
+
+    return pending;
+}
+
 static unsigned int OPL_SDL_PortRead(opl_port_t port)
 {
     unsigned int result = 0;
@@ -440,7 +612,7 @@ static void WriteRegister(unsigned int reg_num, unsigned int value)
             break;
 
         default:
-            Chip__WriteReg(&opl_chip, reg_num, value);
+            WriteChipRegister(reg_num, value);
             break;
     }
 }
@@ -0,0 +1,708 @@
+//
+// Copyright(C) 2020 Night Dive Studios, LLC
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     Offline audio render benchmark.
+//
+//     Renders every music lump in the IWAD through the OPL (DBOPL)
+//     and ymfm music backends, and every sound effect through the
+//     sound effect expansion code, without opening an audio device.
+//     Reports the real-time factor, the longest single callback and
+//     the heap growth for each backend.  Output can be written to
+//     WAV files and compared sample-for-sample against a reference
+//     set, to check optimizations for bit-exactness.
+//
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "SDL.h"
+
+#include "doomtype.h"
+#include "deh_str.h"
+#include "i_sound.h"
+#include "i_swap.h"
+#include "i_system.h"
+#include "i_ymfm.h"
+#include "m_argv.h"
+#include "m_misc.h"
+#include "opl.h"
+#include "sounds.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+#define WAV_HEADER_LEN 44
+
+typedef struct
+{
+    char *name;
+
+    // Number of songs or sounds rendered:
+    int items;
+
+    // Number of output frames generated:
+    uint64_t frames;
+
+    // Total and peak time spent in a single render call:
+    uint64_t render_us;
+    uint64_t peak_us;
+
+    // Heap growth while the item was loaded:
+    long alloc_bytes;
+
+    // Comparison against the reference WAV files:
+    int compared;
+    int mismatched;
+} bench_stats_t;
+
+typedef struct
+{
+    FILE *out;
+    FILE *ref;
+    uint32_t length;
+    boolean mismatch;
+    uint64_t mismatch_frame;
+} bench_output_t;
+
+extern music_module_t music_opl_module;
+extern int use_libsamplerate;
+
+static int bench_samplerate = 44100;
+static int bench_chunk = 512;
+static int bench_maxtime = 300;
+static char *bench_wavdir = NULL;
+static char *bench_refdir = NULL;
+
+static uint64_t perf_freq;
+
+static uint64_t TimeUS(void)
+{
+    uint64_t counter = SDL_GetPerformanceCounter();
+
+    return (counter / perf_freq) * 1000000
+         + ((counter % perf_freq) * 1000000) / perf_freq;
+}
+
+// Bytes currently allocated from the C heap, where the C library
+// can tell us.
+
+static long HeapInUse(void)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    struct mallinfo2 mi = mallinfo2();
+    return (long) mi.uordblks;
+#elif defined(__GLIBC__)
+    struct mallinfo mi = mallinfo();
+    return (long) mi.uordblks;
+#else
+    return 0;
+#endif
+}
+
+//
+// WAV output and comparison.
+//
+
+static void WriteWAVHeader(FILE *fs, uint32_t length)
+{
+    byte header[WAV_HEADER_LEN];
+    uint32_t i;
+
+    memcpy(header, "RIFF", 4);
+    i = LONG(36 + length);
+    memcpy(header + 4, &i, 4);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    i = LONG(16);
+    memcpy(header + 16, &i, 4);
+    header[20] = 1;                             // Format (PCM)
+    header[21] = 0;
+    header[22] = 2;                             // Channels (stereo)
+    header[23] = 0;
+    i = LONG(bench_samplerate);
+    memcpy(header + 24, &i, 4);
+    i = LONG(bench_samplerate * 4);             // Byte rate
+    memcpy(header + 28, &i, 4);
+    header[32] = 4;                             // Block align
+    header[33] = 0;
+    header[34] = 16;                            // Bits per sample
+    header[35] = 0;
+    memcpy(header + 36, "data", 4);
+    i = LONG(length);
+    memcpy(header + 40, &i, 4);
+
+    fwrite(header, 1, WAV_HEADER_LEN, fs);
+}
+
+static void OpenOutput(bench_output_t *output, char *backend, char *name)
+{
+    char filename[32];
+    char *path;
+
+    memset(output, 0, sizeof(*output));
+
+    M_snprintf(filename, sizeof(filename), "%s-%s.wav", backend, name);
+
+    if (bench_wavdir != NULL)
+    {
+        path = M_StringJoin(bench_wavdir, DIR_SEPARATOR_S, filename, NULL);
+        output->out = fopen(path, "wb");
+
+        if (output->out == NULL)
+        {
+            I_Error("OpenOutput: Failed to open %s", path);
+        }
+
+        // Placeholder, rewritten with the real length when closing.
+
+        WriteWAVHeader(output->out, 0);
+        free(path);
+    }
+
+    if (bench_refdir != NULL)
+    {
+        path = M_StringJoin(bench_refdir, DIR_SEPARATOR_S, filename, NULL);
+        output->ref = fopen(path, "rb");
+
+        if (output->ref != NULL)
+        {
+            fseek(output->ref, WAV_HEADER_LEN, SEEK_SET);
+        }
+        else
+        {
+            fprintf(stderr, "OpenOutput: No reference for %s\n", filename);
+        }
+
+        free(path);
+    }
+}
+
+static void WriteOutput(bench_output_t *output, int16_t *samples,
+                        unsigned int nframes)
+{
+    int16_t refbuf[1024 * 2];
+    unsigned int len = nframes * 4;
+    unsigned int done, n, i;
+
+    if (output->out != NULL)
+    {
+        fwrite(samples, 1, len, output->out);
+    }
+
+    if (output->ref != NULL && !output->mismatch)
+    {
+        for (done = 0; done < nframes && !output->mismatch; done += n)
+        {
+            n = nframes - done;
+
+            if (n > 1024)
+            {
+                n = 1024;
+            }
+
+            if (fread(refbuf, 4, n, output->ref) != n)
+            {
+                output->mismatch = true;
+                output->mismatch_frame = output->length / 4 + done;
+                break;
+            }
+
+            for (i = 0; i < n * 2; ++i)
+            {
+                if (refbuf[i] != samples[done * 2 + i])
+                {
+                    output->mismatch = true;
+                    output->mismatch_frame = output->length / 4 + done + i / 2;
+                    break;
+                }
+            }
+        }
+    }
+
+    output->length += len;
+}
+
+static void CloseOutput(bench_output_t *output, bench_stats_t *stats,
+                        char *name)
+{
+    if (output->out != NULL)
+    {
+        fseek(output->out, 0, SEEK_SET);
+        WriteWAVHeader(output->out, output->length);
+        fclose(output->out);
+    }
+
+    if (output->ref != NULL)
+    {
+        // The reference must not be longer than our output, either.
+
+        if (!output->mismatch && fgetc(output->ref) != EOF)
+        {
+            output->mismatch = true;
+            output->mismatch_frame = output->length / 4;
+        }
+
+        ++stats->compared;
+
+        if (output->mismatch)
+        {
+            ++stats->mismatched;
+            printf("  %s/%s: differs from reference at frame %llu\n",
+                   stats->name, name,
+                   (unsigned long long) output->mismatch_frame);
+        }
+
+        fclose(output->ref);
+    }
+}
+
+static void AddRenderTime(bench_stats_t *stats, uint64_t us)
+{
+    stats->render_us += us;
+
+    if (us > stats->peak_us)
+    {
+        stats->peak_us = us;
+    }
+}
+
+//
+// Music backends.
+//
+
+static boolean IsMusicLump(int lumpnum)
+{
+    byte *data;
+    boolean result;
+
+    if (toupper(lumpinfo[lumpnum].name[0]) != 'D'
+     || lumpinfo[lumpnum].name[1] != '_'
+     || W_LumpLength(lumpnum) < 4)
+    {
+        return false;
+    }
+
+    data = W_CacheLumpNum(lumpnum, PU_STATIC);
+    result = memcmp(data, "MUS\x1a", 4) == 0 || memcmp(data, "MThd", 4) == 0;
+    W_ReleaseLumpNum(lumpnum);
+
+    return result;
+}
+
+static void GetLumpName(int lumpnum, char *buf)
+{
+    int i;
+
+    M_StringCopy(buf, lumpinfo[lumpnum].name, 9);
+
+    for (i = 0; buf[i] != '\0'; ++i)
+    {
+        buf[i] = tolower(buf[i]);
+    }
+}
+
+// Render a song to completion, followed by one second of silence
+// to catch the release of the last notes.
+
+static void RenderOPLSong(bench_stats_t *stats, int lumpnum,
+                          int16_t *buffer)
+{
+    bench_output_t output;
+    char name[9];
+    void *handle;
+    uint64_t maxframes, frames, tail, start;
+    long heap_before;
+
+    GetLumpName(lumpnum, name);
+
+    heap_before = HeapInUse();
+
+    handle = music_opl_module.RegisterSong(W_CacheLumpNum(lumpnum, PU_STATIC),
+                                           W_LumpLength(lumpnum));
+
+    if (handle == NULL)
+    {
+        fprintf(stderr, "RenderOPLSong: Failed to load %s\n", name);
+        W_ReleaseLumpNum(lumpnum);
+        return;
+    }
+
+    OpenOutput(&output, stats->name, name);
+    music_opl_module.PlaySong(handle, false);
+
+    maxframes = (uint64_t) bench_maxtime * bench_samplerate;
+    tail = bench_samplerate;
+
+    for (frames = 0; frames < maxframes && tail > 0; frames += bench_chunk)
+    {
+        start = TimeUS();
+
+        if (!OPL_RenderSamples(buffer, bench_chunk))
+        {
+            tail = tail > bench_chunk ? tail - bench_chunk : 0;
+        }
+
+        AddRenderTime(stats, TimeUS() - start);
+        WriteOutput(&output, buffer, bench_chunk);
+    }
+
+    stats->alloc_bytes += HeapInUse() - heap_before;
+
+    music_opl_module.StopSong();
+    music_opl_module.UnRegisterSong(handle);
+    W_ReleaseLumpNum(lumpnum);
+
+    // Let the voices fall silent before the next song.
+
+    for (tail = 0; tail < bench_samplerate; tail += bench_chunk)
+    {
+        OPL_RenderSamples(buffer, bench_chunk);
+    }
+
+    CloseOutput(&output, stats, name);
+
+    stats->frames += frames;
+    ++stats->items;
+}
+
+static void RenderYMFMSong(bench_stats_t *stats, int lumpnum,
+                           int16_t *buffer, byte *patches, int patches_len)
+{
+    bench_output_t output;
+    char name[9];
+    uint64_t maxframes, frames, start;
+    long heap_before;
+
+    GetLumpName(lumpnum, name);
+
+    heap_before = HeapInUse();
+
+    if (!I_ymfmLoad(W_CacheLumpNum(lumpnum, PU_STATIC),
+                    W_LumpLength(lumpnum), patches, patches_len,
+                    bench_samplerate))
+    {
+        fprintf(stderr, "RenderYMFMSong: Failed to load %s\n", name);
+        I_ymfmUnload();
+        W_ReleaseLumpNum(lumpnum);
+        return;
+    }
+
+    OpenOutput(&output, stats->name, name);
+    I_ymfmSetLooping(0);
+
+    maxframes = (uint64_t) bench_maxtime * bench_samplerate;
+
+    for (frames = 0; frames < maxframes && I_ymfmIsPlaying();
+         frames += bench_chunk)
+    {
+        start = TimeUS();
+        I_ymfmGenerate(NULL, (unsigned char *) buffer, bench_chunk * 4);
+        AddRenderTime(stats, TimeUS() - start);
+        WriteOutput(&output, buffer, bench_chunk);
+    }
+
+    stats->alloc_bytes += HeapInUse() - heap_before;
+
+    I_ymfmUnload();
+    W_ReleaseLumpNum(lumpnum);
+
+    CloseOutput(&output, stats, name);
+
+    stats->frames += frames;
+    ++stats->items;
+}
+
+static void BenchOPL(bench_stats_t *stats, int16_t *buffer)
+{
+    unsigned int i;
+
+    snd_samplerate = bench_samplerate;
+
+    OPL_SetOffline(1);
+
+    if (!music_opl_module.Init())
+    {
+        fprintf(stderr, "BenchOPL: Failed to initialize OPL emulation\n");
+        return;
+    }
+
+    music_opl_module.SetMusicVolume(127);
+
+    for (i = 0; i < numlumps; ++i)
+    {
+        if (IsMusicLump(i))
+        {
+            RenderOPLSong(stats, i, buffer);
+        }
+    }
+
+    music_opl_module.Shutdown();
+}
+
+static void BenchYMFM(bench_stats_t *stats, int16_t *buffer)
+{
+    byte *patches;
+    int patches_lump;
+    unsigned int i;
+
+    patches_lump = W_GetNumForName(DEH_String("GENMIDI"));
+    patches = W_CacheLumpNum(patches_lump, PU_STATIC);
+
+    for (i = 0; i < numlumps; ++i)
+    {
+        if (IsMusicLump(i))
+        {
+            RenderYMFMSong(stats, i, buffer, patches,
+                           W_LumpLength(patches_lump));
+        }
+    }
+
+    W_ReleaseLumpNum(patches_lump);
+}
+
+//
+// Sound effect backends.
+//
+
+static void BenchSfx(bench_stats_t *stats)
+{
+    bench_output_t output;
+    sfxinfo_t *sfx;
+    char namebuf[9];
+    byte *data;
+    int len;
+    uint64_t start;
+    long heap_before;
+    int i;
+
+    for (i = 1; i < NUMSFX; ++i)
+    {
+        sfx = &S_sfx[i];
+
+        // Linked sounds share the data of the sound they refer to.
+
+        if (sfx->link != NULL)
+        {
+            continue;
+        }
+
+        M_snprintf(namebuf, sizeof(namebuf), "ds%s", DEH_String(sfx->name));
+        sfx->lumpnum = W_CheckNumForName(namebuf);
+
+        if (sfx->lumpnum < 0)
+        {
+            continue;
+        }
+
+        heap_before = HeapInUse();
+        start = TimeUS();
+
+        if (!I_SDL_ExpandSfxOffline(sfx, bench_samplerate, &data, &len))
+        {
+            continue;
+        }
+
+        AddRenderTime(stats, TimeUS() - start);
+        stats->alloc_bytes += HeapInUse() - heap_before;
+
+        OpenOutput(&output, stats->name, sfx->name);
+        WriteOutput(&output, (int16_t *) data, len / 4);
+        CloseOutput(&output, stats, sfx->name);
+
+        I_SDL_FreeSfxOffline(sfx);
+
+        stats->frames += len / 4;
+        ++stats->items;
+    }
+}
+
+//
+// Report.
+//
+
+static void PrintStats(bench_stats_t *stats)
+{
+    double audio_secs = (double) stats->frames / bench_samplerate;
+    double render_secs = stats->render_us / 1000000.0;
+    char refbuf[16];
+
+    if (stats->compared > 0)
+    {
+        M_snprintf(refbuf, sizeof(refbuf), "%i/%i",
+                   stats->compared - stats->mismatched, stats->compared);
+    }
+    else
+    {
+        M_StringCopy(refbuf, "-", sizeof(refbuf));
+    }
+
+    printf("%-10s %6i %10.1f %10.1f %10.1f %10llu %10li %8s\n",
+           stats->name, stats->items, audio_secs, render_secs * 1000.0,
+           render_secs > 0 ? audio_secs / render_secs : 0.0,
+           (unsigned long long) stats->peak_us,
+           stats->alloc_bytes / 1024, refbuf);
+}
+
+int main(int argc, char **argv)
+{
+    static bench_stats_t stats[] =
+    {
+        { "opl" },
+        { "ymfm" },
+        { "sfx-sdl" },
+#ifdef HAVE_LIBSAMPLERATE
+        { "sfx-src1" }, { "sfx-src2" }, { "sfx-src3" },
+        { "sfx-src4" }, { "sfx-src5" },
+#endif
+    };
+    int16_t *buffer;
+    char *iwadfile;
+    int p;
+    int i;
+
+    myargc = argc;
+    myargv = argv;
+
+    //!
+    // @arg <file>
+    //
+    // IWAD file to take the music and sound effects from.
+    //
+
+    p = M_CheckParmWithArgs("-iwad", 1);
+
+    if (p == 0)
+    {
+        printf("Usage: %s -iwad <file> [-samplerate <hz>] [-chunk <frames>]\n"
+               "       [-maxtime <secs>] [-wavdir <dir>] [-refdir <dir>]\n",
+               argv[0]);
+        return 1;
+    }
+
+    iwadfile = myargv[p + 1];
+
+    //!
+    // @arg <hz>
+    //
+    // Sample rate to render at (default 44100).
+    //
+
+    p = M_CheckParmWithArgs("-samplerate", 1);
+
+    if (p > 0)
+    {
+        bench_samplerate = atoi(myargv[p + 1]);
+    }
+
+    //!
+    // @arg <frames>
+    //
+    // Number of frames generated per simulated audio callback
+    // (default 512, at most 1024).
+    //
+
+    p = M_CheckParmWithArgs("-chunk", 1);
+
+    if (p > 0)
+    {
+        bench_chunk = atoi(myargv[p + 1]);
+
+        if (bench_chunk < 1 || bench_chunk > 1024)
+        {
+            I_Error("Invalid chunk size: %i", bench_chunk);
+        }
+    }
+
+    //!
+    // @arg <secs>
+    //
+    // Maximum length to render of each song (default 300).
+    //
+
+    p = M_CheckParmWithArgs("-maxtime", 1);
+
+    if (p > 0)
+    {
+        bench_maxtime = atoi(myargv[p + 1]);
+    }
+
+    //!
+    // @arg <dir>
+    //
+    // Write everything that is rendered to WAV files in this directory.
+    //
+
+    p = M_CheckParmWithArgs("-wavdir", 1);
+
+    if (p > 0)
+    {
+        bench_wavdir = myargv[p + 1];
+        M_MakeDirectory(bench_wavdir);
+    }
+
+    //!
+    // @arg <dir>
+    //
+    // Compare everything that is rendered against WAV files written
+    // to this directory by an earlier run with -wavdir.
+    //
+
+    p = M_CheckParmWithArgs("-refdir", 1);
+
+    if (p > 0)
+    {
+        bench_refdir = myargv[p + 1];
+    }
+
+    perf_freq = SDL_GetPerformanceFrequency();
+
+    Z_Init();
+
+    if (W_AddFile(iwadfile) == NULL)
+    {
+        I_Error("Failed to open %s", iwadfile);
+    }
+
+    W_GenerateHashTable();
+
+    buffer = malloc(bench_chunk * 4);
+
+    BenchOPL(&stats[0], buffer);
+    BenchYMFM(&stats[1], buffer);
+
+    for (i = 2; i < arrlen(stats); ++i)
+    {
+        use_libsamplerate = i - 2;
+        BenchSfx(&stats[i]);
+    }
+
+    free(buffer);
+
+    printf("\n%-10s %6s %10s %10s %10s %10s %10s %8s\n",
+           "backend", "items", "audio(s)", "render(ms)", "rtf",
+           "peak(us)", "alloc(KiB)", "ref");
+
+    for (i = 0; i < arrlen(stats); ++i)
+    {
+        PrintStats(&stats[i]);
+    }
+
+    return 0;
+}
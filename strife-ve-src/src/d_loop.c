@@ -41,6 +41,7 @@
 #include "net_server.h"
 #include "net_sdl.h"
 #include "net_loop.h"
+#include "net_sim.h"
 
 // [SVE]
 #include "i_social.h"
@@ -56,6 +57,10 @@ typedef struct
 {
     ticcmd_t cmds[NET_MAXPLAYERS];
     boolean ingame[NET_MAXPLAYERS];
+
+    // [SVE] ticdup from this set on, if changed by the server, or zero.
+
+    int ticdup;
 } ticcmd_set_t;
 
 //
@@ -81,6 +86,16 @@ static int recvtic;
 
 int gametic;
 
+// [SVE] The number of ticcmd sets that have been run so far.  Each set
+// runs ticdup tics, and ticdup can change during the game, so this is
+// no longer always gametic/ticdup.
+
+int runtic;
+
+// [SVE] True while running the first tic of a set.
+
+boolean firstduptic = true;
+
 // When set to true, a single tic is run each time TryRunTics() is called.
 // This is used for -timedemo mode.
 
@@ -123,6 +138,33 @@ static boolean local_playeringame[NET_MAXPLAYERS];
 
 static int player_class;
 
+// [SVE] Rollback: number of tics the game may run ahead of the server,
+// using predicted input for the other players. Zero disables it.
+
+static int rollbacktics = 0;
+
+// [SVE] Which tics have been run on predicted input, and the earliest
+// of them whose prediction has turned out wrong, or -1.
+
+static boolean predicted[BACKUPTICS];
+static int mispredictedtic = -1;
+
+boolean predictingtic = false;
+boolean resimulating = false;
+
+// [SVE] gametic at the start of each tic saved for rollback.
+
+static int rollbackgametic[MAXROLLBACK + 1];
+
+// [SVE] ticdup change received from the server for the next tic.
+
+static int pendingticdup = 0;
+
+// [SVE] Number of tics held back to absorb uneven arrival of tics from
+// the server.
+
+static int jitterlead = 0;
+
 
 // 35 fps clock adjusted by offsetms milliseconds
 
@@ -152,7 +194,7 @@ static boolean BuildNewTic(void)
     int	gameticdiv;
     ticcmd_t cmd;
 
-    gameticdiv = gametic/ticdup;
+    gameticdiv = runtic;
 
     I_StartTic ();
     loop_interface->ProcessEvents();
@@ -176,9 +218,10 @@ static boolean BuildNewTic(void)
        if (!net_client_connected && maketic - gameticdiv > 2)
            return false;
 
-       // Never go more than ~200ms ahead
+       // Never go more than ~200ms ahead, besides any tics held
+       // back by the jitter buffer
 
-       if (maketic - gameticdiv > 8)
+       if (maketic - gameticdiv > 8 + jitterlead)
            return false;
     }
     else
@@ -282,8 +325,56 @@ static void D_Disconnected(void)
 // available.
 //
 
+// [SVE] Returns true if the ticcmds received for a tic match the input
+// that was predicted for it.
+
+static boolean TicMatchesPrediction(ticcmd_set_t *set, ticcmd_t *ticcmds,
+                                    boolean *players_mask)
+{
+    ticcmd_t *a, *b;
+    int i;
+
+    for (i = 0; i < NET_MAXPLAYERS; ++i)
+    {
+        if (i == localplayer)
+        {
+            continue;
+        }
+
+        if (set->ingame[i] != players_mask[i])
+        {
+            return false;
+        }
+
+        if (!players_mask[i])
+        {
+            continue;
+        }
+
+        a = &set->cmds[i];
+        b = &ticcmds[i];
+
+        if (a->forwardmove != b->forwardmove
+         || a->sidemove != b->sidemove
+         || a->pitchmove != b->pitchmove
+         || a->angleturn != b->angleturn
+         || a->chatchar != b->chatchar
+         || a->buttons != b->buttons
+         || a->buttons2 != b->buttons2
+         || a->inventory != b->inventory
+         || a->lookfly != b->lookfly
+         || a->arti != b->arti)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 void D_ReceiveTic(ticcmd_t *ticcmds, boolean *players_mask)
 {
+    ticcmd_set_t *set;
     int i;
 
     // Disconnected from server?
@@ -294,6 +385,26 @@ void D_ReceiveTic(ticcmd_t *ticcmds, boolean *players_mask)
         return;
     }
 
+    set = &ticdata[recvtic % BACKUPTICS];
+
+    // [SVE] If the tic has already been run on predicted input, check
+    // the prediction; the game is rolled back if it was wrong.
+
+    if (predicted[recvtic % BACKUPTICS])
+    {
+        if (mispredictedtic < 0
+         && (pendingticdup != 0
+          || !TicMatchesPrediction(set, ticcmds, players_mask)))
+        {
+            mispredictedtic = recvtic;
+        }
+
+        predicted[recvtic % BACKUPTICS] = false;
+    }
+
+    set->ticdup = pendingticdup;
+    pendingticdup = 0;
+
     for (i = 0; i < NET_MAXPLAYERS; ++i)
     {
         if (!drone && i == localplayer)
@@ -302,14 +413,24 @@ void D_ReceiveTic(ticcmd_t *ticcmds, boolean *players_mask)
         }
         else
         {
-            ticdata[recvtic % BACKUPTICS].cmds[i] = ticcmds[i];
-            ticdata[recvtic % BACKUPTICS].ingame[i] = players_mask[i];
+            set->cmds[i] = ticcmds[i];
+            set->ingame[i] = players_mask[i];
         }
     }
 
     ++recvtic;
 }
 
+//
+// [SVE] Invoked by the network engine when the server changes ticdup,
+// before the first tic it applies to is received.
+//
+
+void D_ReceiveTicdup(int newticdup)
+{
+    pendingticdup = newticdup;
+}
+
 //
 // Start game loop
 //
@@ -364,6 +485,8 @@ void D_StartNetGame(net_gamesettings_t *settings,
 
     offsetms = 0;
     recvtic = 0;
+    mispredictedtic = -1;
+    memset(predicted, 0, sizeof(predicted));
 
     settings->consoleplayer = 0;
     settings->num_players = 1;
@@ -419,6 +542,27 @@ void D_StartNetGame(net_gamesettings_t *settings,
     else
         settings->ticdup = 1;
 
+    //!
+    // @category net
+    // @arg <n>
+    //
+    // Run up to n tics ahead of the server, predicting the input of
+    // the other players and rolling the game back when a prediction
+    // turns out wrong. Cuts input latency on slow connections.
+    //
+
+    i = M_CheckParmWithArgs("-rollback", 1);
+
+    if (i > 0)
+    {
+        rollbacktics = atoi(myargv[i+1]);
+
+        if (rollbacktics < 0)
+            rollbacktics = 0;
+        else if (rollbacktics > MAXROLLBACK)
+            rollbacktics = MAXROLLBACK;
+    }
+
     if (net_client_connected)
     {
         // Send our game settings and block until game start is received
@@ -451,6 +595,15 @@ void D_StartNetGame(net_gamesettings_t *settings,
     ticdup = settings->ticdup;
     new_sync = settings->new_sync;
 
+    // [SVE] Rollback works in whole tics, and needs the game to be able
+    // to save its state.
+
+    if (!net_client_connected || drone || ticdup != 1
+     || loop_interface->SaveState == NULL)
+    {
+        rollbacktics = 0;
+    }
+
     // TODO: Message disabled until we fix new_sync.
     //if (!new_sync)
     //{
@@ -462,6 +615,9 @@ boolean D_InitNetGame(net_connect_data_t *connect_data)
 {
     boolean result = false;
     net_addr_t *addr = NULL;
+#ifndef SVE_PLAT_SWITCH
+    net_module_t *module;
+#endif
     int i;
 
     // Call D_QuitNetGame on exit:
@@ -530,8 +686,12 @@ boolean D_InitNetGame(net_connect_data_t *connect_data)
         NET_SV_AddModule(&net_sdl_module);
         NET_SV_RegisterWithMaster();
 
-        net_loop_client_module.InitClient();
-        addr = net_loop_client_module.ResolveAddress(NULL);
+        // [SVE] With the network simulator on, the local player plays
+        // over the simulated link.
+
+        module = NET_SIM_Wrap(&net_loop_client_module);
+        module->InitClient();
+        addr = module->ResolveAddress(NULL);
     }
     else
     {
@@ -566,8 +726,9 @@ boolean D_InitNetGame(net_connect_data_t *connect_data)
 
         if (i > 0)
         {
-            net_sdl_module.InitClient();
-            addr = net_sdl_module.ResolveAddress(myargv[i+1]);
+            module = NET_SIM_Wrap(&net_sdl_module);
+            module->InitClient();
+            addr = module->ResolveAddress(myargv[i+1]);
 
             if (addr == NULL)
             {
@@ -630,6 +791,13 @@ static int GetLowTic(void)
         {
             lowtic = recvtic;
         }
+
+        // [SVE] Tics can be run ahead of the server on predicted input.
+
+        if (rollbacktics > 0 && !drone && ticdup == 1)
+        {
+            lowtic = MIN(maketic, recvtic + rollbacktics);
+        }
     }
 #endif
 
@@ -751,13 +919,154 @@ static void SinglePlayerClear(ticcmd_set_t *set)
     }
 }
 
+// Run the tic at gametic with the given input.
+
+static void RunTic(ticcmd_set_t *set)
+{
+    int i;
+
+    // [SVE] The server has changed ticdup from this set on.
+
+    if (set->ticdup > 0 && set->ticdup != ticdup)
+    {
+        ticdup = set->ticdup;
+        lasttime = GetAdjustedTime() / ticdup;
+    }
+
+    for (i=0 ; i<ticdup ; i++)
+    {
+        if (!resimulating)
+            I_TimerSaveMS(); // [SVE] interpolation
+
+        memcpy(local_playeringame, set->ingame, sizeof(local_playeringame));
+
+        predictingtic = predicted[runtic % BACKUPTICS];
+        firstduptic = (i == 0);
+        loop_interface->RunTic(set->cmds, set->ingame);
+        predictingtic = false;
+        gametic++;
+
+        // modify command for duplicated tics
+        // [SVE] only between duplicates, so the set can be run again
+        // in a rollback
+
+        if (i + 1 < ticdup)
+            TicdupSquash(set);
+    }
+
+    firstduptic = true;
+    ++runtic;
+}
+
+//
+// PredictTic
+//
+// [SVE] Fill in the input of the other players for a tic that has not
+// been received from the server, by repeating the last input received
+// from them, and save the game state so that the tic can be run again
+// if the guess was wrong.  Returns false if the game cannot be rolled
+// back from here, in which case the tic must wait for the server.
+//
+
+static boolean PredictTic(int tic)
+{
+    ticcmd_set_t *set;
+    ticcmd_set_t *last;
+    unsigned int i;
+
+    if (ticdup != 1 || !loop_interface->SaveState(tic % (MAXROLLBACK + 1)))
+    {
+        return false;
+    }
+
+    rollbackgametic[tic % (MAXROLLBACK + 1)] = gametic;
+
+    set = &ticdata[tic % BACKUPTICS];
+    last = recvtic > 0 ? &ticdata[(recvtic - 1) % BACKUPTICS] : NULL;
+
+    for (i = 0; i < NET_MAXPLAYERS; ++i)
+    {
+        if (i == localplayer)
+        {
+            continue;
+        }
+
+        if (last != NULL)
+        {
+            set->cmds[i] = last->cmds[i];
+            set->ingame[i] = last->ingame[i];
+        }
+        else
+        {
+            memset(&set->cmds[i], 0, sizeof(ticcmd_t));
+            set->ingame[i] = local_playeringame[i];
+        }
+
+        // Chat and special events only happen once.
+
+        set->cmds[i].chatchar = 0;
+        if (set->cmds[i].buttons & BT_SPECIAL)
+            set->cmds[i].buttons = 0;
+    }
+
+    set->ticdup = 0;
+    predicted[tic % BACKUPTICS] = true;
+
+    return true;
+}
+
+//
+// RollBack
+//
+// [SVE] Input has arrived that differs from what was predicted: go back
+// to the first mispredicted tic and run the game forward again.
+//
+
+static void RollBack(void)
+{
+    int endtic;
+    int tic;
+
+    endtic = runtic;
+
+    if (!loop_interface->LoadState(mispredictedtic % (MAXROLLBACK + 1)))
+    {
+        I_Error("RollBack: Failed to restore the game at tic %d",
+                mispredictedtic);
+    }
+
+    gametic = rollbackgametic[mispredictedtic % (MAXROLLBACK + 1)];
+    runtic = mispredictedtic;
+    mispredictedtic = -1;
+
+    resimulating = true;
+
+    while (runtic < endtic)
+    {
+        if (runtic >= recvtic && !PredictTic(runtic))
+        {
+            break;
+        }
+
+        RunTic(&ticdata[runtic % BACKUPTICS]);
+    }
+
+    resimulating = false;
+
+    // Any tics not reached again will be predicted afresh.
+
+    for (tic = runtic; tic < endtic; ++tic)
+    {
+        predicted[tic % BACKUPTICS] = false;
+    }
+}
+
 //
 // TryRunTics
 //
 
 void TryRunTics (void)
 {
-    int	i;
     int	lowtic;
     int	entertic;
     static int oldentertics;
@@ -786,13 +1095,37 @@ void TryRunTics (void)
 
     lowtic = GetLowTic();
 
-    availabletics = lowtic - gametic/ticdup;
+    availabletics = lowtic - runtic;
 
     // decide how many tics to run
 
     if (new_sync)
     {
 	counts = availabletics;
+
+        // [SVE] Jitter buffer: when tics from the server arrive
+        // unevenly, hold some back, and run the held tics at the
+        // normal rate while the next ones are late, rather than
+        // running everything at once and then stalling.
+
+        jitterlead = 0;
+
+#ifdef FEATURE_MULTIPLAYER
+        if (net_client_connected && !drone
+         && (rollbacktics == 0 || ticdup != 1))
+        {
+            jitterlead = NET_CL_JitterBufferTics();
+        }
+#endif
+
+        if (counts > jitterlead)
+        {
+            counts -= jitterlead;
+        }
+        else if (jitterlead > 0)
+        {
+            counts = MIN(counts, realtics);
+        }
     }
     else
     {
@@ -834,13 +1167,13 @@ void TryRunTics (void)
 
     // wait for new tics if needed
 
-    while (!PlayersInGame() || lowtic < gametic/ticdup + counts)
+    while (!PlayersInGame() || lowtic < runtic + counts)
     {
 	NetUpdate ();
 
         lowtic = GetLowTic();
 
-	if (lowtic < gametic/ticdup)
+	if (lowtic < runtic)
 	    I_Error ("TryRunTics: lowtic < gametic");
 
         // Don't stay in this loop forever.  The menu is still running,
@@ -866,28 +1199,29 @@ void TryRunTics (void)
             return;
         }
 
-        set = &ticdata[(gametic / ticdup) % BACKUPTICS];
+        // [SVE] correct mispredicted tics before running any more
 
-        if (!net_client_connected)
+        if (mispredictedtic >= 0)
         {
-            SinglePlayerClear(set);
+            RollBack();
         }
 
-	for (i=0 ; i<ticdup ; i++)
-	{
-            if (gametic/ticdup > lowtic)
-                I_Error ("gametic>lowtic");
-            I_TimerSaveMS(); // [SVE] interpolation
+        if (rollbacktics > 0 && runtic >= recvtic && !PredictTic(runtic))
+        {
+            return;
+        }
 
-            memcpy(local_playeringame, set->ingame, sizeof(local_playeringame));
+        set = &ticdata[runtic % BACKUPTICS];
 
-            loop_interface->RunTic(set->cmds, set->ingame);
-	    gametic++;
+        if (!net_client_connected)
+        {
+            SinglePlayerClear(set);
+        }
 
-	    // modify command for duplicated tics
+        if (runtic > lowtic)
+            I_Error ("gametic>lowtic");
 
-            TicdupSquash(set);
-	}
+        RunTic(set);
 
 	NetUpdate ();	// check for new console commands
     }
@@ -46,8 +46,22 @@ typedef struct
     // Run the menu (runs independently of the game).
 
     void (*RunMenu)();
+
+    // [SVE] Save the game state into the given rollback slot, or return
+    // false if the game cannot be rolled back past this point.  May be
+    // NULL if rollback is not supported.
+
+    boolean (*SaveState)(int slot);
+
+    // [SVE] Restore the game state from a rollback slot.
+
+    boolean (*LoadState)(int slot);
 } loop_interface_t;
 
+// [SVE] Maximum number of tics a netgame can run ahead of the server.
+
+#define MAXROLLBACK 32
+
 // Register callback functions for the main loop code to use.
 void D_RegisterLoopCallbacks(loop_interface_t *i);
 
@@ -77,5 +91,18 @@ void D_StartNetGame(net_gamesettings_t *settings,
 extern boolean singletics;
 extern int gametic, ticdup;
 
+// [SVE] Number of ticcmd sets run so far, and whether the tic being
+// run is the first of its set.  Use these rather than gametic/ticdup,
+// as ticdup can change during a netgame.
+
+extern int runtic;
+extern boolean firstduptic;
+
+// [SVE] Set while the tic being run uses predicted input for the other
+// players, and while tics are being run again after a misprediction.
+
+extern boolean predictingtic;
+extern boolean resimulating;
+
 #endif
 
@@ -63,6 +63,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "i_video.h"
 #include "m_argv.h"
@@ -71,6 +72,8 @@
 #include "rb_main.h"
 #include "rb_texture.h"
 #include "rb_fbo.h"
+#include "rb_gl.h"
+#include "rb_shader.h"
 
 // Maximum scale factor for the intermediate scaled texture. A value
 // of 4 is pretty much perfect; you can try larger values but it's
@@ -87,9 +90,48 @@ static int screen_w, screen_h;
 // at a 4:3 mode these are equal to screen_w, screen_h.
 static int window_w, window_h;
 
-// The texture that "receives" the original 320x200 screen contents:
+// The texture that "receives" the screen contents, which are 320x200
+// unless the software renderer draws at a higher resolution:
 static GLuint unscaled_texture;
 static unsigned int *unscaled_data = NULL;
+static int unscaled_w, unscaled_h;
+
+// [SVE] False until unscaled_texture holds a whole screen; until then,
+// any update replaces all of it.
+static boolean unscaled_valid;
+
+// [SVE] Paletted upload: the 8-bit screen is sent to the GPU as it is,
+// a quarter of the size of the RGBA expansion, and a shader looks each
+// pixel up in a 256-entry palette texture.  The palette already has
+// gamma applied, so a palette flash or gamma change costs one upload
+// of the palette.
+static boolean paletted_upload;
+static rbShader_t palette_shader;
+static GLuint palette_texture;
+static SDL_Color current_palette[256];
+static boolean palette_valid;
+
+// [SVE] Pixel buffer the screen is streamed through, if supported.
+static GLuint unpack_buffer;
+
+static const char *palette_vertex_program =
+    "void main()\n"
+    "{\n"
+    "    gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+    "    gl_Position = ftransform();\n"
+    "}\n";
+
+static const char *palette_fragment_program =
+    "uniform sampler2D screen;\n"
+    "uniform sampler2D palette;\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    float index = texture2D(screen, gl_TexCoord[0].st).r;\n"
+    "    vec2 entry = vec2(index * (255.0 / 256.0) + (0.5 / 256.0), 0.5);\n"
+    "\n"
+    "    gl_FragColor = vec4(texture2D(palette, entry).rgb, 1.0);\n"
+    "}\n";
 
 // The scaled framebuffer
 static rbfbo_t scaled_framebuffer;
@@ -203,20 +245,94 @@ static void CalculateWindowSize(void)
     // be an integer multiple of the original screen size.
     // Below ~480x360 the scaling doesn't look so great. Use this as
     // the limit, below which we (effectively) just use GL_LINEAR.
-    scaled_w = GetScaledSize(SCREENWIDTH, base_width * 1.5, window_w);
-    scaled_h = GetScaledSize(SCREENHEIGHT, base_height * 1.5, window_h);
+    // [SVE] A high resolution screen that already covers the window is
+    // not scaled up again.
+    scaled_w = GetScaledSize(renderwidth, base_width * 1.5, window_w);
+    scaled_h = GetScaledSize(renderheight, base_height * 1.5, window_h);
+}
+
+// [SVE] Set up the palette lookup shader and texture, if the driver
+// can run them.
+static void CreatePaletteShader(void)
+{
+    //!
+    // @category video
+    //
+    // Expand the 8-bit screen to RGBA on the CPU before uploading it,
+    // instead of looking up the palette in a shader.
+    //
+
+    if (!has_GL_ARB_shader_objects || !has_GL_ARB_multitexture
+     || M_ParmExists("-nopaletteshader"))
+    {
+        paletted_upload = false;
+        return;
+    }
+
+    if (!palette_shader.bLoaded)
+    {
+        SP_LoadProgramSource(&palette_shader, palette_vertex_program,
+                             palette_fragment_program);
+
+        if (palette_shader.bHasErrors)
+        {
+            SP_Delete(&palette_shader);
+        }
+        else
+        {
+            SP_Enable(&palette_shader);
+            SP_SetUniform1i(&palette_shader, "screen", 0);
+            SP_SetUniform1i(&palette_shader, "palette", 1);
+            RB_DisableShaders();
+        }
+    }
+
+    paletted_upload = palette_shader.bLoaded;
+
+    if (!paletted_upload)
+    {
+        return;
+    }
+
+    if (palette_texture == 0)
+    {
+        dglGenTextures(1, &palette_texture);
+    }
+
+    dglBindTexture(GL_TEXTURE_2D, palette_texture);
+    dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    dglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    dglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    dglTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 256, 1, 0,
+                  GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+    palette_valid = false;
 }
 
 // Create the OpenGL textures used for scaling.
 static boolean CreateTextures(void)
 {
-    // Unscaled texture for input:
+    // [SVE] The texture only needs to be allocated once; each frame
+    // replaces its contents.
+    if(glscale_pipeline == GLSCALE_PIPELINE_FBO)
+    {
+        unscaled_w = renderwidth;
+        unscaled_h = renderheight;
+    }
+    else
+    {
+        unscaled_w = RB_RoundPowerOfTwo(renderwidth);
+        unscaled_h = RB_RoundPowerOfTwo(renderheight);
+    }
+
+    CreatePaletteShader();
+
+    // Unscaled texture for input.  [SVE] Paletted uploads need it too,
+    // to pack part of the screen into.
     if (unscaled_data == NULL)
     {
-        if(glscale_pipeline == GLSCALE_PIPELINE_FBO)
-            unscaled_data = malloc(SCREENWIDTH * SCREENHEIGHT * sizeof(int));
-        else
-            unscaled_data = calloc(512 * 256, sizeof(int));
+        unscaled_data = malloc(renderwidth * renderheight * sizeof(int));
     }
     
     if (unscaled_texture == 0)
@@ -234,6 +350,27 @@ static boolean CreateTextures(void)
         dglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     }
 
+    if (paletted_upload)
+    {
+        dglTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE8, unscaled_w, unscaled_h,
+                      0, GL_LUMINANCE, GL_UNSIGNED_BYTE, NULL);
+    }
+    else
+    {
+        dglTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, unscaled_w, unscaled_h, 0,
+                      GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+
+    unscaled_valid = false;
+
+    // [SVE] Stream the screen through a pixel buffer, so the upload
+    // does not stall on the texture still being drawn from.
+    if (unpack_buffer == 0 && has_GL_ARB_vertex_buffer_object
+     && GL_CheckExtension("GL_ARB_pixel_buffer_object"))
+    {
+        dglGenBuffersARB(1, &unpack_buffer);
+    }
+
     return true;
 }
 
@@ -246,57 +383,194 @@ static boolean SetupFramebuffer(void)
     return scaled_framebuffer.bLoaded;
 }
 
-// Import screen data from the given pointer and palette and update
-// the unscaled_texture texture.
-static void SetInputData(byte *screen, SDL_Color *palette)
+// [SVE] Note a change of palette, uploading it if the shader looks
+// pixels up in it.  Returns true if it has changed since the last frame.
+static boolean SetPalette(SDL_Color *palette)
+{
+    if (palette_valid
+     && !memcmp(current_palette, palette, sizeof(current_palette)))
+    {
+        return false;
+    }
+
+    memcpy(current_palette, palette, sizeof(current_palette));
+    palette_valid = true;
+
+    if (paletted_upload)
+    {
+        // SDL_Color is laid out as RGBA; the shader ignores the alpha.
+        dglBindTexture(GL_TEXTURE_2D, palette_texture);
+        dglTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 256, 1,
+                         GL_RGBA, GL_UNSIGNED_BYTE, current_palette);
+    }
+
+    return true;
+}
+
+// Expand a rectangle of the screen to RGBA through the palette, packed
+// into rows of w pixels.
+static void ExpandScreen(byte *dest, byte *screen, SDL_Color *palette,
+                         int x, int y, int w, int h)
 {
     SDL_Color *c;
-    byte *s;
+    byte *src;
+    int i;
 
     // TODO: Maybe support GL_RGB as well as GL_RGBA?
-    if(glscale_pipeline == GLSCALE_PIPELINE_FBO)
+    for (; h > 0; --h, ++y)
     {
-        unsigned int i;
-        s = (byte *) unscaled_data;
-        for (i = 0; i < SCREENWIDTH * SCREENHEIGHT; ++i)
+        src = screen + y * renderwidth + x;
+
+        for (i = 0; i < w; ++i)
         {
-            c = &palette[screen[i]];
-            *s++ = c->r;
-            *s++ = c->g;
-            *s++ = c->b;
-            *s++ = 0xff;
+            c = &palette[src[i]];
+            *dest++ = c->r;
+            *dest++ = c->g;
+            *dest++ = c->b;
+            *dest++ = 0xff;
         }
     }
+}
+
+// [SVE] Copy a rectangle of the screen, packed into rows of w pixels.
+static void CopyScreen(byte *dest, byte *screen, int x, int y, int w, int h)
+{
+    for (; h > 0; --h, ++y)
+    {
+        memcpy(dest, screen + y * renderwidth + x, w);
+        dest += w;
+    }
+}
+
+// Import screen data from the given pointer and palette and update
+// the unscaled_texture texture.  [SVE] Only the rectangle at x, y of
+// w by h pixels has changed since the last call, unless the texture
+// must be filled in again.
+static void SetInputData(byte *screen, SDL_Color *palette,
+                         int x, int y, int w, int h)
+{
+    GLenum format;
+    size_t size;
+    byte *dest;
+    byte *pixels;
+
+    // Without the shader, a new palette changes every pixel.
+    if ((SetPalette(palette) && !paletted_upload) || !unscaled_valid)
+    {
+        x = 0;
+        y = 0;
+        w = renderwidth;
+        h = renderheight;
+        unscaled_valid = true;
+    }
+
+    if (w <= 0 || h <= 0)
+    {
+        return;
+    }
+
+    if (paletted_upload)
+    {
+        // Keep packed rows a multiple of four bytes long, to match the
+        // default unpack alignment.  renderwidth is a multiple of 320.
+        w += x & 3;
+        x &= ~3;
+        w = (w + 3) & ~3;
+
+        format = GL_LUMINANCE;
+        size = w * h;
+    }
     else
     {
-        int x, y;
-        for(y = 0; y < SCREENHEIGHT; y++)
+        format = GL_RGBA;
+        size = w * h * sizeof(int);
+    }
+
+    dest = NULL;
+
+    if (unpack_buffer != 0)
+    {
+        // [SVE] Orphan the buffer's storage first, so that mapping it
+        // need not wait for the last frame's upload to finish.
+        dglBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, unpack_buffer);
+        dglBufferDataARB(GL_PIXEL_UNPACK_BUFFER_ARB, size, NULL,
+                         GL_STREAM_DRAW_ARB);
+        dest = dglMapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB,
+                               GL_WRITE_ONLY_ARB);
+
+        if (dest == NULL)
         {
-            s = (byte *)(unscaled_data + y * 512);
-            for(x = 0; x < SCREENWIDTH; x++)
-            {
-                c = &palette[screen[y * SCREENWIDTH + x]];
-                *s++ = c->r;
-                *s++ = c->g;
-                *s++ = c->b;
-                *s++ = 0xff;
-            }
+            dglBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
         }
     }
-        
-    dglBindTexture(GL_TEXTURE_2D, unscaled_texture);
-    if(glscale_pipeline == GLSCALE_PIPELINE_FBO)
+
+    if (dest != NULL)
     {
-        dglTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SCREENWIDTH, SCREENHEIGHT, 0,
-                      GL_RGBA, GL_UNSIGNED_BYTE, unscaled_data);
+        if (paletted_upload)
+            CopyScreen(dest, screen, x, y, w, h);
+        else
+            ExpandScreen(dest, screen, palette, x, y, w, h);
+
+        dglUnmapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB);
+
+        // Pixels are now an offset into the bound buffer.
+        pixels = NULL;
+    }
+    else if (paletted_upload && w == renderwidth)
+    {
+        // Whole rows are already packed.
+        pixels = screen + y * renderwidth;
+    }
+    else if (paletted_upload)
+    {
+        CopyScreen((byte *) unscaled_data, screen, x, y, w, h);
+        pixels = (byte *) unscaled_data;
     }
     else
     {
-        dglTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 512, 256, 0,
-                      GL_RGBA, GL_UNSIGNED_BYTE, unscaled_data);
+        ExpandScreen((byte *) unscaled_data, screen, palette, x, y, w, h);
+        pixels = (byte *) unscaled_data;
+    }
+
+    dglBindTexture(GL_TEXTURE_2D, unscaled_texture);
+    dglTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h,
+                     format, GL_UNSIGNED_BYTE, pixels);
+
+    if (dest != NULL)
+    {
+        dglBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
     }
 }
 
+// [SVE] Draw unscaled_texture through the palette.
+static void EnablePaletteShader(void)
+{
+    if (!paletted_upload)
+    {
+        return;
+    }
+
+    SP_Enable(&palette_shader);
+
+    RB_SetTextureUnit(1);
+    dglBindTexture(GL_TEXTURE_2D, palette_texture);
+    RB_SetTextureUnit(0);
+}
+
+static void DisablePaletteShader(void)
+{
+    if (!paletted_upload)
+    {
+        return;
+    }
+
+    RB_DisableShaders();
+
+    RB_SetTextureUnit(1);
+    RB_UnbindTexture();
+    RB_SetTextureUnit(0);
+}
+
 // Draw fake scanlines.
 static void DrawScanlines(void)
 {
@@ -337,6 +611,7 @@ static void DrawUnscaledToScaled(void)
     dglViewport(0, 0, scaled_w, scaled_h);
 
     dglBindTexture(GL_TEXTURE_2D, unscaled_texture);
+    EnablePaletteShader();
 
     dglBegin(GL_QUADS);
     dglTexCoord2f(0, 1); dglVertex2f(-1, 1);
@@ -345,6 +620,8 @@ static void DrawUnscaledToScaled(void)
     dglTexCoord2f(0, 0); dglVertex2f(-1, -1);
     dglEnd();
 
+    DisablePaletteShader();
+
     // Scanline hack.
     if (scanline_mode)
     {
@@ -385,10 +662,11 @@ static void DrawScreen(void)
     }
     else
     {
-        float smax = (320.f / 512.0f);
-        float tmax = (200.f / 256.0f);
+        float smax = ((float) renderwidth / unscaled_w);
+        float tmax = ((float) renderheight / unscaled_h);
         
         dglBindTexture(GL_TEXTURE_2D, unscaled_texture);
+        EnablePaletteShader();
 
         dglBegin(GL_QUADS);
         dglTexCoord2f(0,    0   ); dglVertex2f(-w,  h);
@@ -397,6 +675,8 @@ static void DrawScreen(void)
         dglTexCoord2f(0,    tmax); dglVertex2f(-w, -h);
         dglEnd();
 
+        DisablePaletteShader();
+
         RB_UnbindTexture();
     }
 }
@@ -431,13 +711,14 @@ boolean I_GL_InitScale(int w, int h)
     return true;
 }
 
-void I_GL_UpdateScreen(byte *screendata, SDL_Color *palette)
+void I_GL_UpdateScreen(byte *screendata, SDL_Color *palette,
+                       int x, int y, int w, int h)
 {
     // disable culling
     RB_SetState(GLSTATE_CULL, false);
     RB_SetCull(GLCULL_BACK);
 
-    SetInputData(screendata, palette);
+    SetInputData(screendata, palette, x, y, w, h);
     DrawUnscaledToScaled();
     DrawScreen();
 }
@@ -25,7 +25,14 @@
 #define I_GLSCALE_H
 
 boolean I_GL_InitScale(int w, int h);
-void I_GL_UpdateScreen(byte *screendata, SDL_Color *palette);
+
+// Draw the screen.  Only the rectangle at x, y of w by h pixels has
+// changed since the last call; the rest of the screen is not uploaded
+// again.
+
+void I_GL_UpdateScreen(byte *screendata, SDL_Color *palette,
+                       int x, int y, int w, int h);
+
 
 extern int gl_max_scale;
 
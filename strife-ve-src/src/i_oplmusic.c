@@ -22,9 +22,9 @@
 #include <string.h>
 
 #include "memio.h"
-#include "mus2mid.h"
 
 #include "deh_main.h"
+#include "i_songcache.h"
 #include "i_sound.h"
 #include "i_swap.h"
 #include "m_misc.h"
@@ -36,7 +36,6 @@
 
 // #define OPL_MIDI_DEBUG
 
-#define MAXMIDLENGTH (96 * 1024)
 #define GENMIDI_NUM_INSTRS  128
 #define GENMIDI_NUM_PERCUSSION 47
 
@@ -1338,82 +1337,88 @@ static void I_OPL_UnRegisterSong(void *handle)
         return;
     }
 
-    if (handle != NULL)
+    // Songs registered from a lump stay in the song cache.
+
+    if (handle != NULL && !I_SongIsCached(handle))
     {
         MIDI_FreeFile(handle);
     }
 }
 
-// Determine whether memory block is a .mid file 
-
-static boolean IsMid(byte *mem, int len)
+static void *I_OPL_RegisterSong(void *data, int len)
 {
-    return len > 4 && !memcmp(mem, "MThd", 4);
-}
+    midi_file_t *result;
+    MEMFILE *stream;
 
-static boolean ConvertMus(byte *musdata, int len, char *filename)
-{
-    MEMFILE *instream;
-    MEMFILE *outstream;
-    void *outbuf;
-    size_t outbuf_len;
-    int result;
+    if (!music_initialized)
+    {
+        return NULL;
+    }
 
-    instream = mem_fopen_read(musdata, len);
-    outstream = mem_fopen_write();
+    // The MIDI is parsed straight from the conversion's buffer.
 
-    result = mus2mid(instream, outstream);
+    stream = I_ConvertToMidi(data, len);
+    result = NULL;
 
-    if (result == 0)
+    if (stream != NULL)
     {
-        mem_get_buf(outstream, &outbuf, &outbuf_len);
-
-        M_WriteFile(filename, outbuf, outbuf_len);
+        mem_fseek(stream, 0, MEM_SEEK_SET);
+        result = MIDI_LoadFile(stream);
+        mem_fclose(stream);
     }
 
-    mem_fclose(instream);
-    mem_fclose(outstream);
+    if (result == NULL)
+    {
+        fprintf(stderr, "I_OPL_RegisterSong: Failed to load MID.\n");
+    }
 
     return result;
 }
 
-static void *I_OPL_RegisterSong(void *data, int len)
+static void FreeSong(void *song)
+{
+    MIDI_FreeFile(song);
+}
+
+// Register a song from a music lump, reusing the song parsed the last
+// time the lump was registered.
+
+static void *I_OPL_RegisterSongLump(int lumpnum, void *data, int len)
 {
     midi_file_t *result;
-    char *filename;
+    MEMFILE *stream;
+    byte *midi;
+    size_t midi_len;
 
     if (!music_initialized)
     {
         return NULL;
     }
 
-    // MUS files begin with "MUS"
-    // Reject anything which doesnt have this signature
-
-    filename = M_TempFile("doom.mid");
+    result = I_GetCachedSong(lumpnum, FreeSong);
 
-    if (IsMid(data, len) && len < MAXMIDLENGTH)
+    if (result != NULL)
     {
-        M_WriteFile(filename, data, len);
+        return result;
     }
-    else
-    {
-	// Assume a MUS file and try to convert
 
-        ConvertMus(data, len, filename);
+    if (!I_GetSongMidi(lumpnum, data, len, &midi, &midi_len))
+    {
+        fprintf(stderr, "I_OPL_RegisterSong: Failed to load MID.\n");
+        return NULL;
     }
 
-    result = MIDI_LoadFile(filename);
+    stream = mem_fopen_read(midi, midi_len);
+    result = MIDI_LoadFile(stream);
+    mem_fclose(stream);
 
     if (result == NULL)
     {
         fprintf(stderr, "I_OPL_RegisterSong: Failed to load MID.\n");
+        return NULL;
     }
 
-    // remove file now
-
-    remove(filename);
-    free(filename);
+    I_CacheSong(lumpnum, result, FreeSong);
 
     return result;
 }
@@ -1500,6 +1505,7 @@ music_module_t music_opl_module =
     I_OPL_StopSong,
     I_OPL_MusicIsPlaying,
     NULL,  // Poll
+    I_OPL_RegisterSongLump,
 };
 
 //----------------------------------------------------------------------
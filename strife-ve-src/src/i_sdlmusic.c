@@ -29,10 +29,10 @@
 #include "config.h"
 #include "doomtype.h"
 #include "memio.h"
-#include "mus2mid.h"
 
 #include "deh_str.h"
 #include "gusconf.h"
+#include "i_songcache.h"
 #include "i_sound.h"
 #include "i_system.h"
 #include "i_swap.h"
@@ -45,7 +45,6 @@
 
 #include "i_ymfm.h"
 
-#define MAXMIDLENGTH (96 * 1024)
 #define MID_HEADER_MAGIC "MThd"
 #define MUS_HEADER_MAGIC "MUS\x1a"
 
@@ -1133,7 +1132,13 @@ static void I_SDL_UnRegisterSong(void *handle)
     Mix_FreeMusic(music);
 
 #if defined(SVE_USE_RWOPS_MUSIC)
-    rw_music_cache = NULL;
+    // Mix_LoadMUS_RW was told not to free the RWops, so close it here,
+    // now the music no longer reads from it
+    if(rw_music_cache)
+    {
+        SDL_RWclose(rw_music_cache);
+        rw_music_cache = NULL;
+    }
     if(rw_music_data)
     {
         Z_Free(rw_music_data);
@@ -1142,43 +1147,16 @@ static void I_SDL_UnRegisterSong(void *handle)
 #endif
 }
 
-// Determine whether memory block is a .mid file 
-
-static boolean IsMid(byte *mem, int len)
-{
-    return len > 4 && !memcmp(mem, "MThd", 4);
-}
-
-static boolean ConvertMus(byte *musdata, int len, char *filename)
-{
-    MEMFILE *instream;
-    MEMFILE *outstream;
-    void *outbuf;
-    size_t outbuf_len;
-    int result;
-
-    instream = mem_fopen_read(musdata, len);
-    outstream = mem_fopen_write();
-
-    result = mus2mid(instream, outstream);
-
-    if (result == 0)
-    {
-        mem_get_buf(outstream, &outbuf, &outbuf_len);
-
-        M_WriteFile(filename, outbuf, outbuf_len);
-    }
-
-    mem_fclose(instream);
-    mem_fclose(outstream);
-
-    return result;
-}
+// Register a song; if lumpnum is valid, the MIDI conversion of the lump
+// is taken from the song cache.
 
-static void *I_SDL_RegisterSong(void *data, int len)
+static void *RegisterSong(int lumpnum, void *data, int len)
 {
     char *filename;
     Mix_Music *music;
+    MEMFILE *midistream;
+    void *midibuf;
+    size_t midibuf_len;
 
     if (!music_initialized)
     {
@@ -1219,6 +1197,17 @@ static void *I_SDL_RegisterSong(void *data, int len)
             // message.
             fprintf(stderr, "Failed to load substitute music file: %s: %s\n",
                     filename, Mix_GetError());
+
+#if defined(SVE_USE_RWOPS_MUSIC)
+            SDL_RWclose(rw_music_cache);
+            rw_music_cache = NULL;
+
+            if (rw_music_data)
+            {
+                Z_Free(rw_music_data);
+                rw_music_data = NULL;
+            }
+#endif
         }
         else
         {
@@ -1235,22 +1224,81 @@ static void *I_SDL_RegisterSong(void *data, int len)
     // MUS files begin with "MUS"
     // Reject anything which doesnt have this signature
 
-    filename = M_TempFile("doom.mid");
+    midistream = NULL;
 
-    if (IsMid(data, len) && len < MAXMIDLENGTH)
+    if (lumpnum >= 0)
     {
-        M_WriteFile(filename, data, len);
+        if (!I_GetSongMidi(lumpnum, data, len,
+                           (byte **) &midibuf, &midibuf_len))
+        {
+            fprintf(stderr, "Error loading midi: Failed to convert MUS\n");
+            return NULL;
+        }
     }
     else
     {
-	// Assume a MUS file and try to convert
+        midistream = I_ConvertToMidi(data, len);
+
+        if (midistream == NULL)
+        {
+            fprintf(stderr, "Error loading midi: Failed to convert MUS\n");
+            return NULL;
+        }
+
+        mem_get_buf(midistream, &midibuf, &midibuf_len);
+    }
+
+#if defined(SVE_USE_RWOPS_MUSIC)
+    // Load the MIDI straight from memory. Mix_SetMusicCMD() only works
+    // with Mix_LoadMUS(), so this is only possible without an external
+    // MIDI program. SDL_mixer may read from the stream after loading,
+    // so the data is kept until the song is unregistered.
+
+    if (strlen(snd_musiccmd) == 0)
+    {
+        // Data from the song cache outlives the song, so it can be
+        // read directly.
 
-        ConvertMus(data, len, filename);
+        if (midistream != NULL)
+        {
+            rw_music_data = Z_Malloc(midibuf_len, PU_STATIC, NULL);
+            memcpy(rw_music_data, midibuf, midibuf_len);
+            mem_fclose(midistream);
+            midibuf = rw_music_data;
+        }
+
+        rw_music_cache = SDL_RWFromConstMem(midibuf, midibuf_len);
+        music = Mix_LoadMUS_RW(rw_music_cache, 0);
+
+        if (music == NULL)
+        {
+            fprintf(stderr, "Error loading midi: %s\n", Mix_GetError());
+
+            SDL_RWclose(rw_music_cache);
+            rw_music_cache = NULL;
+
+            if (rw_music_data)
+            {
+                Z_Free(rw_music_data);
+                rw_music_data = NULL;
+            }
+        }
+
+        return music;
     }
+#endif
 
-    // Load the MIDI. In an ideal world we'd be using Mix_LoadMUS_RW()
-    // by now, but Mix_SetMusicCMD() only works with Mix_LoadMUS(), so
-    // we have to generate a temporary file.
+    // Load the MIDI through a temporary file for the external MIDI
+    // program to play. We can't delete the file, otherwise the program
+    // won't find it. This means we leave a mess on disk :(
+
+    filename = M_TempFile("doom.mid");
+    M_WriteFile(filename, midibuf, midibuf_len);
+
+    if (midistream != NULL)
+    {
+        mem_fclose(midistream);
+    }
 
     music = Mix_LoadMUS(filename);
 
@@ -1261,21 +1309,21 @@ static void *I_SDL_RegisterSong(void *data, int len)
         fprintf(stderr, "Error loading midi: %s\n", Mix_GetError());
     }
 
-    // Remove the temporary MIDI file; however, when using an external
-    // MIDI program we can't delete the file. Otherwise, the program
-    // won't find the file to play. This means we leave a mess on
-    // disk :(
-
-    if (strlen(snd_musiccmd) == 0)
-    {
-        remove(filename);
-    }
-
     free(filename);
 
     return music;
 }
 
+static void *I_SDL_RegisterSong(void *data, int len)
+{
+    return RegisterSong(-1, data, len);
+}
+
+static void *I_SDL_RegisterSongLump(int lumpnum, void *data, int len)
+{
+    return RegisterSong(lumpnum, data, len);
+}
+
 // Is the song playing?
 static boolean I_SDL_MusicIsPlaying(void)
 {
@@ -1385,5 +1433,6 @@ music_module_t music_sdl_module =
     I_SDL_StopSong,
     I_SDL_MusicIsPlaying,
     I_SDL_PollMusic,
+    I_SDL_RegisterSongLump,
 };
 
@@ -944,6 +944,53 @@ static void I_SDL_UpdateSound(void)
     }
 }
 
+// Expand a sound effect without an audio device, for the offline
+// audio benchmark.  The sound is converted to 16-bit stereo at the
+// given rate with the expansion function that the current value of
+// use_libsamplerate selects.  The result stays valid until
+// I_SDL_FreeSfxOffline is called.
+
+boolean I_SDL_ExpandSfxOffline(sfxinfo_t *sfxinfo, int freq,
+                               byte **data, int *len)
+{
+    allocated_sound_t *snd;
+
+    mixer_freq = freq;
+    mixer_format = AUDIO_S16SYS;
+    mixer_channels = 2;
+
+    ExpandSoundData = ExpandSoundData_SDL;
+
+#ifdef HAVE_LIBSAMPLERATE
+    if (use_libsamplerate != 0)
+    {
+        ExpandSoundData = ExpandSoundData_SRC;
+    }
+#endif
+
+    I_SDL_FreeSfxOffline(sfxinfo);
+
+    if (!CacheSFX(sfxinfo))
+    {
+        return false;
+    }
+
+    snd = sfxinfo->driver_data;
+
+    *data = snd->chunk.abuf;
+    *len = snd->chunk.alen;
+
+    return true;
+}
+
+void I_SDL_FreeSfxOffline(sfxinfo_t *sfxinfo)
+{
+    if (sfxinfo->driver_data != NULL)
+    {
+        FreeAllocatedSound(sfxinfo->driver_data);
+    }
+}
+
 static void I_SDL_ShutdownSound(void)
 {    
     if (!sound_initialized)
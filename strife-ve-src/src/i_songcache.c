@@ -0,0 +1,234 @@
+//
+// Copyright(C) 2020 Night Dive Studios, LLC
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//    Cache of music lumps converted to MIDI, and of the songs the
+//    music modules parse from them, keyed by lump number.
+//
+//    Strife's hub maps are revisited constantly, and every visit
+//    re-registers the map's song.  Conversion and parsing are done
+//    once per lump instead.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "i_songcache.h"
+#include "i_system.h"
+#include "mus2mid.h"
+#include "z_zone.h"
+
+#define MAXMIDLENGTH (96 * 1024)
+
+typedef struct
+{
+    // Converted MIDI data, or NULL if not converted yet.
+    byte *midi;
+    size_t midi_len;
+
+    // Song parsed by a music module, and the function to free it with.
+    void *song;
+    songfree_t freefunc;
+} cachedsong_t;
+
+// Entries indexed by lump number; grown on demand.
+
+static cachedsong_t *songs = NULL;
+static int num_songs = 0;
+
+static cachedsong_t *GetEntry(int lumpnum)
+{
+    int newsize;
+
+    if (lumpnum < 0)
+    {
+        return NULL;
+    }
+
+    if (lumpnum >= num_songs)
+    {
+        newsize = num_songs ? num_songs : 64;
+
+        while (newsize <= lumpnum)
+        {
+            newsize *= 2;
+        }
+
+        songs = realloc(songs, newsize * sizeof(*songs));
+
+        if (songs == NULL)
+        {
+            I_Error("GetEntry: Failed to grow song cache to %d entries",
+                    newsize);
+        }
+
+        memset(songs + num_songs, 0, (newsize - num_songs) * sizeof(*songs));
+        num_songs = newsize;
+    }
+
+    return &songs[lumpnum];
+}
+
+// Determine whether memory block is a .mid file
+
+static boolean IsMid(byte *mem, int len)
+{
+    return len > 4 && !memcmp(mem, "MThd", 4);
+}
+
+MEMFILE *I_ConvertToMidi(void *data, int len)
+{
+    MEMFILE *instream;
+    MEMFILE *outstream;
+    int result;
+
+    outstream = mem_fopen_write();
+
+    if (IsMid(data, len) && len < MAXMIDLENGTH)
+    {
+        mem_fwrite(data, 1, len, outstream);
+        return outstream;
+    }
+
+    // Assume a MUS file and try to convert
+
+    instream = mem_fopen_read(data, len);
+    result = mus2mid(instream, outstream);
+    mem_fclose(instream);
+
+    if (result != 0)
+    {
+        mem_fclose(outstream);
+        return NULL;
+    }
+
+    return outstream;
+}
+
+boolean I_GetSongMidi(int lumpnum, void *data, int len,
+                      byte **midi, size_t *midi_len)
+{
+    cachedsong_t *entry;
+    MEMFILE *stream;
+    void *buf;
+    size_t buflen;
+
+    entry = GetEntry(lumpnum);
+
+    if (entry == NULL)
+    {
+        return false;
+    }
+
+    if (entry->midi == NULL)
+    {
+        stream = I_ConvertToMidi(data, len);
+
+        if (stream == NULL)
+        {
+            return false;
+        }
+
+        mem_get_buf(stream, &buf, &buflen);
+
+        entry->midi = Z_Malloc(buflen, PU_STATIC, NULL);
+        entry->midi_len = buflen;
+        memcpy(entry->midi, buf, buflen);
+
+        mem_fclose(stream);
+    }
+
+    *midi = entry->midi;
+    *midi_len = entry->midi_len;
+
+    return true;
+}
+
+void *I_GetCachedSong(int lumpnum, songfree_t freefunc)
+{
+    if (lumpnum < 0 || lumpnum >= num_songs)
+    {
+        return NULL;
+    }
+
+    if (songs[lumpnum].freefunc != freefunc)
+    {
+        return NULL;
+    }
+
+    return songs[lumpnum].song;
+}
+
+void I_CacheSong(int lumpnum, void *song, songfree_t freefunc)
+{
+    cachedsong_t *entry;
+
+    entry = GetEntry(lumpnum);
+
+    if (entry == NULL)
+    {
+        return;
+    }
+
+    // A different music module may have left its own song here.
+
+    if (entry->song != NULL && entry->song != song)
+    {
+        entry->freefunc(entry->song);
+    }
+
+    entry->song = song;
+    entry->freefunc = freefunc;
+}
+
+boolean I_SongIsCached(void *song)
+{
+    int i;
+
+    if (song == NULL)
+    {
+        return false;
+    }
+
+    for (i=0; i<num_songs; ++i)
+    {
+        if (songs[i].song == song)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void I_ClearSongCache(void)
+{
+    int i;
+
+    for (i=0; i<num_songs; ++i)
+    {
+        if (songs[i].song != NULL)
+        {
+            songs[i].freefunc(songs[i].song);
+        }
+
+        if (songs[i].midi != NULL)
+        {
+            Z_Free(songs[i].midi);
+        }
+    }
+
+    free(songs);
+    songs = NULL;
+    num_songs = 0;
+}
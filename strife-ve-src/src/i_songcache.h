@@ -0,0 +1,59 @@
+//
+// Copyright(C) 2020 Night Dive Studios, LLC
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//    Cache of music lumps converted to MIDI, and of the songs the
+//    music modules parse from them, keyed by lump number.
+//
+
+#ifndef __I_SONGCACHE__
+#define __I_SONGCACHE__
+
+#include "doomtype.h"
+#include "memio.h"
+
+// Function used to free a song parsed by a music module.
+
+typedef void (*songfree_t)(void *song);
+
+// Convert a MIDI or MUS song in memory to MIDI, in a new memory stream
+// the caller closes.  Returns NULL if the data cannot be converted.
+
+MEMFILE *I_ConvertToMidi(void *data, int len);
+
+// Get the MIDI form of a music lump, converting it from MUS the first
+// time it is requested.  The data stays owned by the cache.  Returns
+// false if the lump cannot be converted.
+
+boolean I_GetSongMidi(int lumpnum, void *data, int len,
+                      byte **midi, size_t *midi_len);
+
+// Get a song previously parsed from the lump by the music module that
+// frees songs with the given function, or NULL if there is none.
+
+void *I_GetCachedSong(int lumpnum, songfree_t freefunc);
+
+// Hand a parsed song over to the cache.
+
+void I_CacheSong(int lumpnum, void *song, songfree_t freefunc);
+
+// Returns true if the song belongs to the cache, in which case the
+// music module must not free it when it is unregistered.
+
+boolean I_SongIsCached(void *song);
+
+// Free everything in the cache.
+
+void I_ClearSongCache(void);
+
+#endif
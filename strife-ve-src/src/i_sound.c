@@ -26,6 +26,7 @@
 #include "doomtype.h"
 
 #include "gusconf.h"
+#include "i_songcache.h"
 #include "i_sound.h"
 #include "i_video.h"
 #include "m_argv.h"
@@ -258,6 +259,8 @@ void I_ShutdownSound(void)
     {
         music_module->Shutdown();
     }
+
+    I_ClearSongCache();
 }
 
 int I_GetSfxLumpNum(sfxinfo_t *sfxinfo)
@@ -401,6 +404,21 @@ void *I_RegisterSong(void *data, int len)
     }
 }
 
+void *I_RegisterSongLump(int lumpnum, void *data, int len)
+{
+    if (music_module == NULL)
+    {
+        return NULL;
+    }
+
+    if (music_module->RegisterSongLump != NULL)
+    {
+        return music_module->RegisterSongLump(lumpnum, data, len);
+    }
+
+    return music_module->RegisterSong(data, len);
+}
+
 void I_UnRegisterSong(void *handle)
 {
     if (music_module != NULL)
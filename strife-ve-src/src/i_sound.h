@@ -163,6 +163,12 @@ void I_StopSound(int channel);
 boolean I_SoundIsPlaying(int channel);
 void I_PrecacheSounds(sfxinfo_t *sounds, int num_sounds);
 
+// Offline sound effect expansion, used by the audio benchmark.
+
+boolean I_SDL_ExpandSfxOffline(sfxinfo_t *sfxinfo, int freq,
+                               byte **data, int *len);
+void I_SDL_FreeSfxOffline(sfxinfo_t *sfxinfo);
+
 // Interface for music modules
 
 typedef struct
@@ -216,6 +222,12 @@ typedef struct
     // Invoked periodically to poll.
 
     void (*Poll)(void);
+
+    // [SVE] Register a song handle from a music lump. The module may
+    // reuse the conversion and parsing done the last time the lump
+    // was registered. Optional; RegisterSong is used if NULL.
+
+    void *(*RegisterSongLump)(int lumpnum, void *data, int len);
 } music_module_t;
 
 void I_InitMusic(void);
@@ -224,6 +236,7 @@ void I_SetMusicVolume(int volume);
 void I_PauseSong(void);
 void I_ResumeSong(void);
 void *I_RegisterSong(void *data, int len);
+void *I_RegisterSongLump(int lumpnum, void *data, int len);
 void I_UnRegisterSong(void *handle);
 void I_PlaySong(void *handle, boolean looping);
 void I_StopSong(void);
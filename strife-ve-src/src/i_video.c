@@ -45,6 +45,7 @@
 #include "i_video.h"
 #include "i_scale.h"
 #include "m_argv.h"
+#include "m_bbox.h"
 #include "m_config.h"
 #include "m_misc.h"
 #include "tables.h"
@@ -198,6 +199,14 @@ static int grabmouse = true;
 
 byte *I_VideoBuffer = NULL;
 
+// [SVE] Multiple of the screen size the software renderer draws at, as
+// configured and as in effect, and the size of I_VideoBuffer.
+
+int software_hires = 1;
+int hires = 1;
+int renderwidth = SCREENWIDTH;
+int renderheight = SCREENHEIGHT;
+
 // If true, game is running as a screensaver
 
 boolean screensaver_mode = false;
@@ -224,6 +233,16 @@ static boolean display_fps_dots;
 
 static boolean noblit;
 
+// [SVE] If true, the whole screen is uploaded every frame, rather than
+// only the area drawn to.
+
+static boolean full_update;
+
+// [SVE] The screen as last uploaded, to find rows drawn over with the
+// same pixels.
+
+static byte *last_frame = NULL;
+
 // Callback function to invoke to determine whether to grab the 
 // mouse pointer.
 
@@ -436,6 +455,11 @@ void I_EnableLoadingDisk(void)
     int y;
     char buf[20];
 
+    // [SVE] The disk is drawn through the software scalers, which only
+    // take a 320x200 screen.
+    if (hires > 1)
+        return;
+
     //SDL_VideoDriverName(buf, 15);
 
     if (!strcmp(buf, "Quartz"))
@@ -1199,6 +1223,77 @@ static void FinishUpdateSoftware(void)
     SDL_RenderPresent(renderer);
 }
 
+//
+// GetDirtyRect
+//
+// [SVE] Find the part of the screen buffer drawn to since the last
+// frame, from the box V_MarkRect has built up, and start a new box.
+// Rows at its top and bottom that hold the same pixels as before are
+// left out, so that a frame drawn the same as the last (such as the
+// view while paused) uploads nothing.
+//
+
+static void GetDirtyRect(int *x, int *y, int *w, int *h)
+{
+    int x1, y1, x2, y2;
+    int ofs;
+
+    if (full_update || last_frame == NULL)
+    {
+        *x = 0;
+        *y = 0;
+        *w = renderwidth;
+        *h = renderheight;
+        M_ClearBox(dirtybox);
+        return;
+    }
+
+    if (dirtybox[BOXLEFT] > dirtybox[BOXRIGHT]
+     || dirtybox[BOXBOTTOM] > dirtybox[BOXTOP])
+    {
+        *x = *y = *w = *h = 0;
+        return;
+    }
+
+    x1 = dirtybox[BOXLEFT] * hires;
+    x2 = (dirtybox[BOXRIGHT] + 1) * hires;
+    y1 = dirtybox[BOXBOTTOM] * hires;
+    y2 = (dirtybox[BOXTOP] + 1) * hires;
+
+    M_ClearBox(dirtybox);
+
+    while (y1 < y2)
+    {
+        ofs = y1 * renderwidth + x1;
+
+        if (memcmp(I_VideoBuffer + ofs, last_frame + ofs, x2 - x1))
+            break;
+
+        ++y1;
+    }
+
+    while (y2 > y1)
+    {
+        ofs = (y2 - 1) * renderwidth + x1;
+
+        if (memcmp(I_VideoBuffer + ofs, last_frame + ofs, x2 - x1))
+            break;
+
+        --y2;
+    }
+
+    for (ofs = y1 * renderwidth + x1; ofs < y2 * renderwidth;
+         ofs += renderwidth)
+    {
+        memcpy(last_frame + ofs, I_VideoBuffer + ofs, x2 - x1);
+    }
+
+    *x = x1;
+    *y = y1;
+    *w = x2 - x1;
+    *h = y2 - y1;
+}
+
 //
 // I_FinishUpdate
 //
@@ -1240,9 +1335,11 @@ void I_FinishUpdate (void)
 	    if (tics > 20) tics = 20;
 
 	    for (i=0 ; i<tics*4 ; i+=4)
-	        I_VideoBuffer[ (SCREENHEIGHT-1)*SCREENWIDTH + i] = 0xff;
+	        I_VideoBuffer[ (renderheight-1)*renderwidth + i] = 0xff;
 	    for ( ; i<20*4 ; i+=4)
-	        I_VideoBuffer[ (SCREENHEIGHT-1)*SCREENWIDTH + i] = 0x0;
+	        I_VideoBuffer[ (renderheight-1)*renderwidth + i] = 0x0;
+
+	    V_MarkRect(0, SCREENHEIGHT-1, 80 / hires + 1, 1); // [SVE]
     }
 
     // draw to screen
@@ -1253,7 +1350,10 @@ void I_FinishUpdate (void)
 
         if(!use3drenderer)
         {
-            I_GL_UpdateScreen(I_VideoBuffer, palette);
+            int x, y, w, h;
+
+            GetDirtyRect(&x, &y, &w, &h);
+            I_GL_UpdateScreen(I_VideoBuffer, palette, x, y, w, h);
         }
         else
         {
@@ -1286,7 +1386,7 @@ void I_FinishUpdate (void)
 //
 void I_ReadScreen (byte* scr)
 {
-    memcpy(scr, I_VideoBuffer, SCREENWIDTH*SCREENHEIGHT);
+    memcpy(scr, I_VideoBuffer, renderwidth*renderheight);
 }
 
 
@@ -1704,6 +1804,15 @@ void I_GraphicsCheckCommandLine(void)
 
     noblit = M_CheckParm ("-noblit"); 
 
+    //!
+    // @category video
+    //
+    // Upload the whole screen every frame, rather than only the parts
+    // of it that were drawn to.
+    //
+
+    full_update = M_ParmExists("-fullupdate");
+
     //!
     // @category video 
     //
@@ -1867,6 +1976,26 @@ void I_GraphicsCheckCommandLine(void)
     {
         novert = false;
     }
+
+    //!
+    // @category video
+    // @arg <n>
+    //
+    // Draw the software renderer at n times the 320x200 screen size,
+    // from 1 to 4.
+    //
+
+    i = M_CheckParmWithArgs("-hires", 1);
+
+    if (i > 0)
+    {
+        software_hires = atoi(myargv[i + 1]);
+    }
+
+    // [SVE] The OpenGL renderer draws at the window size already.
+    hires = use3drenderer ? 1 : BETWEEN(1, MAXHIRES, software_hires);
+    renderwidth = SCREENWIDTH * hires;
+    renderheight = SCREENHEIGHT * hires;
 }
 
 // Check if we have been invoked as a screensaver by xscreensaver.
@@ -2334,13 +2463,23 @@ void I_InitGraphics(void)
         SDL_Delay(startup_delay);
     }
 
-	I_VideoBuffer = (unsigned char *) Z_Malloc(SCREENWIDTH * SCREENHEIGHT, PU_STATIC, NULL);
+	I_VideoBuffer = (unsigned char *) Z_Malloc(renderwidth * renderheight, PU_STATIC, NULL);
 
     V_RestoreBuffer();
 
     // Clear the screen to black.
 
-    memset(I_VideoBuffer, 0, SCREENWIDTH * SCREENHEIGHT);
+    memset(I_VideoBuffer, 0, renderwidth * renderheight);
+
+    // [SVE] The first frame uploads the whole screen regardless.
+
+    if (!full_update)
+    {
+        last_frame = Z_Malloc(renderwidth * renderheight, PU_STATIC, NULL);
+        memset(last_frame, 0, renderwidth * renderheight);
+    }
+
+    M_ClearBox(dirtybox);
 
     // We need SDL to give us translated versions of keys as well
 
@@ -2388,6 +2527,7 @@ void I_BindVideoVariables(void)
     M_BindVariable("novert",                    &novert);
     M_BindVariable("gl_max_scale",              &gl_max_scale);
     M_BindVariable("png_screenshots",           &png_screenshots);
+    M_BindVariable("software_hires",            &software_hires);
 
     // [SVE]
     M_BindVariableWithDefault("fullscreen",      &fullscreen,      &default_fullscreen);
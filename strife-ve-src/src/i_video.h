@@ -36,6 +36,14 @@
 
 #define SCREENHEIGHT_4_3 240
 
+// [SVE] The software renderer can draw at a whole multiple of the
+// screen size.  SCREENWIDTH x SCREENHEIGHT stays the coordinate space of
+// the V_ routines; I_VideoBuffer is renderwidth x renderheight.
+
+#define MAXHIRES        4
+#define MAXRENDERWIDTH  (SCREENWIDTH * MAXHIRES)
+#define MAXRENDERHEIGHT (SCREENHEIGHT * MAXHIRES)
+
 #define MAX_MOUSE_BUTTONS 8
 
 typedef struct
@@ -157,6 +165,9 @@ extern int vanilla_keyboard_mapping;
 extern boolean screensaver_mode;
 extern int usegamma;
 extern byte *I_VideoBuffer;
+extern int hires;               // [SVE]
+extern int renderwidth;
+extern int renderheight;
 
 extern int screen_width;
 extern int screen_height;
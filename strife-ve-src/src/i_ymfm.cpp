@@ -30,6 +30,17 @@ int I_ymfmLoad(const unsigned char* fileData, const unsigned int fileSize, const
     return 0;
 }
 
+void I_ymfmUnload(void)
+{
+    delete pOPLPlayer;
+    pOPLPlayer = nullptr;
+}
+
+int I_ymfmIsPlaying(void)
+{
+    return pOPLPlayer != nullptr && !pOPLPlayer->atEnd();
+}
+
 void I_ymfmSetLooping(int looping)
 {
     if (pOPLPlayer != nullptr)
@@ -9,6 +9,8 @@
 extern "C" {
 #endif
     int I_ymfmLoad(const unsigned char* fileData, const unsigned int fileSize, const unsigned char* patchData, const unsigned int patchSize, int sampleRate);
+    void I_ymfmUnload(void);
+    int I_ymfmIsPlaying(void);
     void I_ymfmSetLooping(int looping);
     void I_ymfmSetGain(float gain);
     void I_ymfmGenerate(void *udata, unsigned char *stream, int len);
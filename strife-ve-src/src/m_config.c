@@ -945,6 +945,14 @@ static default_t extra_defaults_list[] =
 
     CONFIG_VARIABLE_INT(gl_max_scale),
 
+    //!
+    // [SVE] Multiple of the 320x200 screen size that the software
+    // renderer draws at, from 1 to 4.  Has no effect on the OpenGL
+    // renderer.
+    //
+
+    CONFIG_VARIABLE_INT(software_hires),
+
     //!
     // If this is non-zero, the mouse will be "grabbed" when running
     // in windowed mode so that it can be used as an input device.
@@ -1047,6 +1055,15 @@ static default_t extra_defaults_list[] =
 
     CONFIG_VARIABLE_INT(vanilla_savegame_limit),
 
+    //!
+    // @game strife
+    //
+    // If non-zero, savegames are compressed before they are written
+    // to disk.  Uncompressed savegames can always be loaded.
+    //
+
+    CONFIG_VARIABLE_INT(compress_savegames),
+
     //!
     // @game doom strife
     //
@@ -1832,6 +1849,30 @@ static default_t extra_defaults_list[] =
 
     CONFIG_VARIABLE_KEY(key_demo_quit),
 
+    //!
+    // Key to step back one tic when playing a demo.
+    //
+
+    CONFIG_VARIABLE_KEY(key_demo_stepback),
+
+    //!
+    // Key to step forward one tic when playing a demo.
+    //
+
+    CONFIG_VARIABLE_KEY(key_demo_stepforward),
+
+    //!
+    // Key to skip back ten seconds when playing a demo.
+    //
+
+    CONFIG_VARIABLE_KEY(key_demo_rewind),
+
+    //!
+    // Key to skip forward ten seconds when playing a demo.
+    //
+
+    CONFIG_VARIABLE_KEY(key_demo_ffwd),
+
     //!
     // Key to send a message during multiplayer games.
     //
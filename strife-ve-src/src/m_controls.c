@@ -115,6 +115,12 @@ int mousebinvnext = -1;
 int key_message_refresh = KEY_ENTER;
 int key_pause = KEY_PAUSE;
 int key_demo_quit = 'p';
+
+// [SVE] Demo playback seeking
+int key_demo_stepback = ',';
+int key_demo_stepforward = '.';
+int key_demo_rewind = '[';
+int key_demo_ffwd = ']';
 int key_spy = KEY_F12;
 
 // Multiplayer chat keys:
@@ -468,6 +474,10 @@ void M_BindMenuControls(void)
     M_BindVariable("key_menu_decscreen", &key_menu_decscreen);
     M_BindVariable("key_menu_screenshot",&key_menu_screenshot);
     M_BindVariable("key_demo_quit",      &key_demo_quit);
+    M_BindVariable("key_demo_stepback",  &key_demo_stepback);
+    M_BindVariable("key_demo_stepforward", &key_demo_stepforward);
+    M_BindVariable("key_demo_rewind",    &key_demo_rewind);
+    M_BindVariable("key_demo_ffwd",      &key_demo_ffwd);
     M_BindVariable("key_spy",            &key_spy);
 }
 
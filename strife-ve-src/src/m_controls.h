@@ -78,6 +78,10 @@ extern int key_arti_egg;
 extern int key_arti_invulnerability;
 
 extern int key_demo_quit;
+extern int key_demo_stepback;
+extern int key_demo_stepforward;
+extern int key_demo_rewind;
+extern int key_demo_ffwd;
 extern int key_spy;
 extern int key_prevweapon;
 extern int key_nextweapon;
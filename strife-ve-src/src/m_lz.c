@@ -0,0 +1,246 @@
+//
+// Copyright(C) 2020 Night Dive Studios, LLC
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     Fast LZ77 compression, using the LZ4 block format.  Each sequence
+//     is a token byte (literal count in the high nibble, match length
+//     minus four in the low nibble), optional extra length bytes, the
+//     literals, and a 16-bit little-endian match offset.  The final
+//     sequence has literals only.
+//
+
+#include <string.h>
+
+#include "m_lz.h"
+
+#define MINMATCH     4
+#define HASH_BITS    14
+#define MAX_OFFSET   65535
+
+// The last match must start at least MFLIMIT bytes before the end of
+// the input, and the last LASTLITERALS bytes are always literals.
+
+#define MFLIMIT      12
+#define LASTLITERALS 5
+
+static int hash_table[1 << HASH_BITS];
+
+static unsigned int HashPosition(const byte *p)
+{
+    uint32_t v;
+
+    v = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static byte *WriteLength(byte *out, size_t len)
+{
+    while (len >= 255)
+    {
+        *out++ = 255;
+        len -= 255;
+    }
+
+    *out++ = (byte) len;
+
+    return out;
+}
+
+static byte *WriteLiterals(byte *out, byte *token,
+                           const byte *literals, size_t len)
+{
+    *token = (byte) ((len >= 15 ? 15 : len) << 4);
+
+    if (len >= 15)
+    {
+        out = WriteLength(out, len - 15);
+    }
+
+    memcpy(out, literals, len);
+
+    return out + len;
+}
+
+size_t M_LZCompressBound(size_t len)
+{
+    return len + len / 255 + 16;
+}
+
+size_t M_LZCompress(const byte *src, size_t srclen, byte *dest)
+{
+    const byte *in = src;
+    const byte *anchor = src;
+    const byte *end = src + srclen;
+    const byte *match;
+    byte *out = dest;
+    byte *token;
+    size_t len, matchlen, offset;
+    unsigned int h;
+    int ref;
+    int i;
+
+    for (i = 0; i < (1 << HASH_BITS); ++i)
+    {
+        hash_table[i] = -1;
+    }
+
+    if (srclen > MFLIMIT)
+    {
+        while (in < end - MFLIMIT)
+        {
+            h = HashPosition(in);
+            ref = hash_table[h];
+            hash_table[h] = in - src;
+
+            if (ref < 0 || (in - src) - ref > MAX_OFFSET
+             || memcmp(src + ref, in, MINMATCH) != 0)
+            {
+                ++in;
+                continue;
+            }
+
+            match = src + ref;
+            matchlen = MINMATCH;
+
+            while (in + matchlen < end - LASTLITERALS
+                && match[matchlen] == in[matchlen])
+            {
+                ++matchlen;
+            }
+
+            // Literals since the last match, then the match itself.
+
+            token = out++;
+            out = WriteLiterals(out, token, anchor, in - anchor);
+
+            offset = in - match;
+            *out++ = (byte) (offset & 0xff);
+            *out++ = (byte) (offset >> 8);
+
+            len = matchlen - MINMATCH;
+            *token |= (byte) (len >= 15 ? 15 : len);
+
+            if (len >= 15)
+            {
+                out = WriteLength(out, len - 15);
+            }
+
+            in += matchlen;
+            anchor = in;
+        }
+    }
+
+    token = out++;
+    out = WriteLiterals(out, token, anchor, end - anchor);
+
+    return out - dest;
+}
+
+static boolean ReadLength(const byte **in, const byte *end, size_t *len)
+{
+    byte b;
+
+    do
+    {
+        if (*in >= end)
+        {
+            return false;
+        }
+
+        b = *(*in)++;
+        *len += b;
+    } while (b == 255);
+
+    return true;
+}
+
+boolean M_LZDecompress(const byte *src, size_t srclen,
+                       byte *dest, size_t destlen)
+{
+    const byte *in = src;
+    const byte *end = src + srclen;
+    const byte *match;
+    byte *out = dest;
+    byte *out_end = dest + destlen;
+    size_t len, offset;
+    byte token;
+
+    while (in < end)
+    {
+        token = *in++;
+
+        // Literals
+
+        len = token >> 4;
+
+        if (len == 15 && !ReadLength(&in, end, &len))
+        {
+            return false;
+        }
+
+        if (len > (size_t) (end - in) || len > (size_t) (out_end - out))
+        {
+            return false;
+        }
+
+        memcpy(out, in, len);
+        out += len;
+        in += len;
+
+        // The last sequence has no match.
+
+        if (in == end)
+        {
+            break;
+        }
+
+        if (end - in < 2)
+        {
+            return false;
+        }
+
+        offset = in[0] | (in[1] << 8);
+        in += 2;
+
+        if (offset == 0 || offset > (size_t) (out - dest))
+        {
+            return false;
+        }
+
+        len = token & 15;
+
+        if (len == 15 && !ReadLength(&in, end, &len))
+        {
+            return false;
+        }
+
+        len += MINMATCH;
+
+        if (len > (size_t) (out_end - out))
+        {
+            return false;
+        }
+
+        // Matches may overlap their own output.
+
+        match = out - offset;
+
+        while (len-- > 0)
+        {
+            *out++ = *match++;
+        }
+    }
+
+    return out == out_end;
+}
@@ -0,0 +1,38 @@
+//
+// Copyright(C) 2020 Night Dive Studios, LLC
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     Fast LZ77 compression, using the LZ4 block format.
+//
+
+#ifndef __M_LZ__
+#define __M_LZ__
+
+#include "doomtype.h"
+
+// Largest size the compressed form of len bytes can take.
+
+size_t M_LZCompressBound(size_t len);
+
+// Compress src into dest, which must hold M_LZCompressBound(srclen)
+// bytes.  Returns the compressed length.
+
+size_t M_LZCompress(const byte *src, size_t srclen, byte *dest);
+
+// Decompress src into dest, which must be exactly destlen bytes long.
+// Returns false if the data is corrupt.
+
+boolean M_LZDecompress(const byte *src, size_t srclen,
+                       byte *dest, size_t destlen);
+
+#endif /* #ifndef __M_LZ__ */
@@ -22,6 +22,7 @@
 
 #include "doomtype.h"
 #include "i_swap.h"
+#include "memio.h"
 #include "midifile.h"
 
 #define HEADER_CHUNK_ID "MThd"
@@ -62,6 +63,11 @@ typedef struct
 
     midi_event_t *events;
     int num_events;
+
+    // Block holding the SysEx and meta event data for this track:
+
+    byte *data;
+    unsigned int data_used;
 } midi_track_t;
 
 struct midi_track_iter_s
@@ -104,30 +110,35 @@ static boolean CheckChunkHeader(chunk_header_t *chunk,
     return result;
 }
 
-// Read a single byte.  Returns false on error.
+// Cursor over an in-memory MIDI file.  The whole file is parsed
+// straight out of the buffer held by the MEMFILE, so there is no
+// per-byte I/O.
 
-static boolean ReadByte(byte *result, FILE *stream)
+typedef struct
 {
-    int c;
+    byte *data;
+    unsigned int len;
+    unsigned int pos;
+} midi_stream_t;
 
-    c = fgetc(stream);
+// Read a single byte.  Returns false on error.
 
-    if (c == EOF)
+static boolean ReadByte(byte *result, midi_stream_t *stream)
+{
+    if (stream->pos >= stream->len)
     {
         fprintf(stderr, "ReadByte: Unexpected end of file\n");
         return false;
     }
-    else
-    {
-        *result = (byte) c;
 
-        return true;
-    }
+    *result = stream->data[stream->pos++];
+
+    return true;
 }
 
 // Read a variable-length value.
 
-static boolean ReadVariableLength(unsigned int *result, FILE *stream)
+static boolean ReadVariableLength(unsigned int *result, midi_stream_t *stream)
 {
     int i;
     byte b;
@@ -161,36 +172,28 @@ static boolean ReadVariableLength(unsigned int *result, FILE *stream)
     return false;
 }
 
-// Read a byte sequence into the data buffer.
+// Read a byte sequence into the track's data block.
 
-static void *ReadByteSequence(unsigned int num_bytes, FILE *stream)
+static byte *ReadByteSequence(unsigned int num_bytes, midi_track_t *track,
+                              midi_stream_t *stream)
 {
-    unsigned int i;
     byte *result;
 
-    // Allocate a buffer. Allocate one extra byte, as malloc(0) is
-    // non-portable.
-
-    result = malloc(num_bytes + 1);
-
-    if (result == NULL)
+    if (num_bytes > stream->len - stream->pos
+     || num_bytes > track->data_len - track->data_used)
     {
-        fprintf(stderr, "ReadByteSequence: Failed to allocate buffer\n");
+        fprintf(stderr, "ReadByteSequence: Unexpected end of file\n");
         return NULL;
     }
 
-    // Read the data:
+    // Event payloads can never add up to more than the size of the
+    // track itself, so they are packed into one block per track.
 
-    for (i=0; i<num_bytes; ++i)
-    {
-        if (!ReadByte(&result[i], stream))
-        {
-            fprintf(stderr, "ReadByteSequence: Error while reading byte %u\n",
-                            i);
-            free(result);
-            return NULL;
-        }
-    }
+    result = track->data + track->data_used;
+    memcpy(result, stream->data + stream->pos, num_bytes);
+
+    stream->pos += num_bytes;
+    track->data_used += num_bytes;
 
     return result;
 }
@@ -201,7 +204,7 @@ static void *ReadByteSequence(unsigned int num_bytes, FILE *stream)
 
 static boolean ReadChannelEvent(midi_event_t *event,
                                 byte event_type, boolean two_param,
-                                FILE *stream)
+                                midi_stream_t *stream)
 {
     byte b;
 
@@ -241,7 +244,7 @@ static boolean ReadChannelEvent(midi_event_t *event,
 // Read sysex event:
 
 static boolean ReadSysExEvent(midi_event_t *event, int event_type,
-                              FILE *stream)
+                              midi_track_t *track, midi_stream_t *stream)
 {
     event->event_type = event_type;
 
@@ -254,7 +257,8 @@ static boolean ReadSysExEvent(midi_event_t *event, int event_type,
 
     // Read the byte sequence:
 
-    event->data.sysex.data = ReadByteSequence(event->data.sysex.length, stream);
+    event->data.sysex.data = ReadByteSequence(event->data.sysex.length,
+                                              track, stream);
 
     if (event->data.sysex.data == NULL)
     {
@@ -267,7 +271,8 @@ static boolean ReadSysExEvent(midi_event_t *event, int event_type,
 
 // Read meta event:
 
-static boolean ReadMetaEvent(midi_event_t *event, FILE *stream)
+static boolean ReadMetaEvent(midi_event_t *event, midi_track_t *track,
+                             midi_stream_t *stream)
 {
     byte b;
 
@@ -294,7 +299,8 @@ static boolean ReadMetaEvent(midi_event_t *event, FILE *stream)
 
     // Read the byte sequence:
 
-    event->data.meta.data = ReadByteSequence(event->data.meta.length, stream);
+    event->data.meta.data = ReadByteSequence(event->data.meta.length,
+                                             track, stream);
 
     if (event->data.meta.data == NULL)
     {
@@ -306,7 +312,7 @@ static boolean ReadMetaEvent(midi_event_t *event, FILE *stream)
 }
 
 static boolean ReadEvent(midi_event_t *event, unsigned int *last_event_type,
-                         FILE *stream)
+                         midi_track_t *track, midi_stream_t *stream)
 {
     byte event_type;
 
@@ -330,12 +336,7 @@ static boolean ReadEvent(midi_event_t *event, unsigned int *last_event_type,
     if ((event_type & 0x80) == 0)
     {
         event_type = *last_event_type;
-
-        if (fseek(stream, -1, SEEK_CUR) < 0)
-        {
-            fprintf(stderr, "ReadEvent: Unable to seek in stream\n");
-            return false;
-        }
+        --stream->pos;
     }
     else
     {
@@ -371,10 +372,10 @@ static boolean ReadEvent(midi_event_t *event, unsigned int *last_event_type,
     {
         case MIDI_EVENT_SYSEX:
         case MIDI_EVENT_SYSEX_SPLIT:
-            return ReadSysExEvent(event, event_type, stream);
+            return ReadSysExEvent(event, event_type, track, stream);
 
         case MIDI_EVENT_META:
-            return ReadMetaEvent(event, stream);
+            return ReadMetaEvent(event, track, stream);
 
         default:
             break;
@@ -384,44 +385,20 @@ static boolean ReadEvent(midi_event_t *event, unsigned int *last_event_type,
     return false;
 }
 
-// Free an event:
-
-static void FreeEvent(midi_event_t *event)
-{
-    // Some event types have dynamically allocated buffers assigned
-    // to them that must be freed.
-
-    switch (event->event_type)
-    {
-        case MIDI_EVENT_SYSEX:
-        case MIDI_EVENT_SYSEX_SPLIT:
-            free(event->data.sysex.data);
-            break;
-
-        case MIDI_EVENT_META:
-            free(event->data.meta.data);
-            break;
-
-        default:
-            // Nothing to do.
-            break;
-    }
-}
-
 // Read and check the track chunk header
 
-static boolean ReadTrackHeader(midi_track_t *track, FILE *stream)
+static boolean ReadTrackHeader(midi_track_t *track, midi_stream_t *stream)
 {
-    size_t records_read;
     chunk_header_t chunk_header;
 
-    records_read = fread(&chunk_header, sizeof(chunk_header_t), 1, stream);
-
-    if (records_read < 1)
+    if (stream->len - stream->pos < sizeof(chunk_header_t))
     {
         return false;
     }
 
+    memcpy(&chunk_header, stream->data + stream->pos, sizeof(chunk_header_t));
+    stream->pos += sizeof(chunk_header_t);
+
     if (!CheckChunkHeader(&chunk_header, TRACK_CHUNK_ID))
     {
         return false;
@@ -432,14 +409,17 @@ static boolean ReadTrackHeader(midi_track_t *track, FILE *stream)
     return true;
 }
 
-static boolean ReadTrack(midi_track_t *track, FILE *stream)
+static boolean ReadTrack(midi_track_t *track, midi_stream_t *stream)
 {
     midi_event_t *new_events;
     midi_event_t *event;
     unsigned int last_event_type;
+    unsigned int max_events;
 
     track->num_events = 0;
     track->events = NULL;
+    track->data = NULL;
+    track->data_used = 0;
 
     // Read the header:
 
@@ -448,28 +428,43 @@ static boolean ReadTrack(midi_track_t *track, FILE *stream)
         return false;
     }
 
+    // The smallest possible event is two bytes long (a one byte delta
+    // time followed by a running status parameter), so the track
+    // length gives an upper bound on the number of events.  Allocate
+    // for that up front and trim the array once the track is read.
+
+    if (track->data_len > stream->len - stream->pos)
+    {
+        fprintf(stderr, "ReadTrack: Track length exceeds file size\n");
+        return false;
+    }
+
+    max_events = track->data_len / 2 + 1;
+
+    track->events = malloc(sizeof(midi_event_t) * max_events);
+    track->data = malloc(track->data_len + 1);
+
+    if (track->events == NULL || track->data == NULL)
+    {
+        return false;
+    }
+
     // Then the events:
 
     last_event_type = 0;
 
     for (;;)
     {
-        // Resize the track slightly larger to hold another event:
-
-        new_events = realloc(track->events, 
-                             sizeof(midi_event_t) * (track->num_events + 1));
-
-        if (new_events == NULL)
+        if ((unsigned int) track->num_events >= max_events)
         {
+            fprintf(stderr, "ReadTrack: Too many events in track\n");
             return false;
         }
 
-        track->events = new_events;
-
         // Read the next event:
 
         event = &track->events[track->num_events];
-        if (!ReadEvent(event, &last_event_type, stream))
+        if (!ReadEvent(event, &last_event_type, track, stream))
         {
             return false;
         }
@@ -485,6 +480,14 @@ static boolean ReadTrack(midi_track_t *track, FILE *stream)
         }
     }
 
+    new_events = realloc(track->events,
+                         sizeof(midi_event_t) * track->num_events);
+
+    if (new_events != NULL)
+    {
+        track->events = new_events;
+    }
+
     return true;
 }
 
@@ -492,17 +495,14 @@ static boolean ReadTrack(midi_track_t *track, FILE *stream)
 
 static void FreeTrack(midi_track_t *track)
 {
-    unsigned int i;
-
-    for (i=0; i<track->num_events; ++i)
-    {
-        FreeEvent(&track->events[i]);
-    }
+    // Event payloads live in the track's data block, so there is
+    // nothing to free per event.
 
     free(track->events);
+    free(track->data);
 }
 
-static boolean ReadAllTracks(midi_file_t *file, FILE *stream)
+static boolean ReadAllTracks(midi_file_t *file, midi_stream_t *stream)
 {
     unsigned int i;
 
@@ -532,18 +532,18 @@ static boolean ReadAllTracks(midi_file_t *file, FILE *stream)
 
 // Read and check the header chunk.
 
-static boolean ReadFileHeader(midi_file_t *file, FILE *stream)
+static boolean ReadFileHeader(midi_file_t *file, midi_stream_t *stream)
 {
-    size_t records_read;
     unsigned int format_type;
 
-    records_read = fread(&file->header, sizeof(midi_header_t), 1, stream);
-
-    if (records_read < 1)
+    if (stream->len - stream->pos < sizeof(midi_header_t))
     {
         return false;
     }
 
+    memcpy(&file->header, stream->data + stream->pos, sizeof(midi_header_t));
+    stream->pos += sizeof(midi_header_t);
+
     if (!CheckChunkHeader(&file->header.chunk_header, HEADER_CHUNK_ID)
      || SDL_SwapBE32(file->header.chunk_header.chunk_size) != 6)
     {
@@ -584,10 +584,12 @@ void MIDI_FreeFile(midi_file_t *file)
     free(file);
 }
 
-midi_file_t *MIDI_LoadFile(char *filename)
+midi_file_t *MIDI_LoadFile(MEMFILE *stream)
 {
     midi_file_t *file;
-    FILE *stream;
+    midi_stream_t mstream;
+    void *buf;
+    size_t buflen;
 
     file = malloc(sizeof(midi_file_t));
 
@@ -601,37 +603,31 @@ midi_file_t *MIDI_LoadFile(char *filename)
     file->buffer = NULL;
     file->buffer_size = 0;
 
-    // Open file
+    // Parse directly out of the stream's buffer, starting from the
+    // current position.
 
-    stream = fopen(filename, "rb");
+    mem_get_buf(stream, &buf, &buflen);
 
-    if (stream == NULL)
-    {
-        fprintf(stderr, "MIDI_LoadFile: Failed to open '%s'\n", filename);
-        MIDI_FreeFile(file);
-        return NULL;
-    }
+    mstream.data = buf;
+    mstream.len = buflen;
+    mstream.pos = mem_ftell(stream);
 
     // Read MIDI file header
 
-    if (!ReadFileHeader(file, stream))
+    if (!ReadFileHeader(file, &mstream))
     {
-        fclose(stream);
         MIDI_FreeFile(file);
         return NULL;
     }
 
     // Read all tracks:
 
-    if (!ReadAllTracks(file, stream))
+    if (!ReadAllTracks(file, &mstream))
     {
-        fclose(stream);
         MIDI_FreeFile(file);
         return NULL;
     }
 
-    fclose(stream);
-
     return file;
 }
 
@@ -721,6 +717,8 @@ void MIDI_RestartIterator(midi_track_iter_t *iter)
 
 #ifdef TEST
 
+#include "z_zone.h"
+
 static char *MIDI_EventTypeToString(midi_event_type_t event_type)
 {
     switch (event_type)
@@ -799,6 +797,10 @@ void PrintTrack(midi_track_t *track)
 int main(int argc, char *argv[])
 {
     midi_file_t *file;
+    MEMFILE *stream;
+    FILE *fs;
+    byte *buf;
+    long len;
     unsigned int i;
 
     if (argc < 2)
@@ -807,7 +809,33 @@ int main(int argc, char *argv[])
         exit(1);
     }
 
-    file = MIDI_LoadFile(argv[1]);
+    Z_Init();
+
+    fs = fopen(argv[1], "rb");
+
+    if (fs == NULL)
+    {
+        fprintf(stderr, "Failed to open %s\n", argv[1]);
+        exit(1);
+    }
+
+    fseek(fs, 0, SEEK_END);
+    len = ftell(fs);
+    fseek(fs, 0, SEEK_SET);
+
+    buf = malloc(len);
+
+    if (fread(buf, 1, len, fs) != len)
+    {
+        fprintf(stderr, "Failed to read %s\n", argv[1]);
+        exit(1);
+    }
+
+    fclose(fs);
+
+    stream = mem_fopen_read(buf, len);
+    file = MIDI_LoadFile(stream);
+    mem_fclose(stream);
 
     if (file == NULL)
     {
@@ -18,6 +18,8 @@
 #ifndef MIDIFILE_H
 #define MIDIFILE_H
 
+#include "memio.h"
+
 typedef struct midi_file_s midi_file_t;
 typedef struct midi_track_iter_s midi_track_iter_t;
 
@@ -127,9 +129,10 @@ typedef struct
     } data;
 } midi_event_t;
 
-// Load a MIDI file.
+// Load a MIDI file from a memory stream, starting at the current
+// position.  The stream may be closed once this returns.
 
-midi_file_t *MIDI_LoadFile(char *filename);
+midi_file_t *MIDI_LoadFile(MEMFILE *stream);
 
 // Free a MIDI file.
 
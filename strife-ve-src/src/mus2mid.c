@@ -103,7 +103,8 @@ static int channel_map[NUM_CHANNELS];
 static boolean WriteTime(unsigned int time, MEMFILE *midioutput)
 {
     unsigned int buffer = time & 0x7F;
-    byte writeval;
+    byte writebuf[4];
+    int len;
 
     while ((time >>= 7) != 0)
     {
@@ -111,16 +112,9 @@ static boolean WriteTime(unsigned int time, MEMFILE *midioutput)
         buffer |= ((time & 0x7F) | 0x80);
     }
 
-    for (;;)
+    for (len = 0; ; )
     {
-        writeval = (byte)(buffer & 0xFF);
-
-        if (mem_fwrite(&writeval, 1, 1, midioutput) != 1)
-        {
-            return true;
-        }
-
-        ++tracksize;
+        writebuf[len++] = (byte)(buffer & 0xFF);
 
         if ((buffer & 0x80) != 0)
         {
@@ -128,162 +122,95 @@ static boolean WriteTime(unsigned int time, MEMFILE *midioutput)
         }
         else
         {
-            queuedtime = 0;
-            return false;
+            break;
         }
     }
-}
-
-
-// Write the end of track marker
-static boolean WriteEndTrack(MEMFILE *midioutput)
-{
-    byte endtrack[] = {0xFF, 0x2F, 0x00};
-
-    if (WriteTime(queuedtime, midioutput))
-    {
-        return true;
-    }
 
-    if (mem_fwrite(endtrack, 1, 3, midioutput) != 3)
+    if (mem_fwrite(writebuf, 1, len, midioutput) != len)
     {
         return true;
     }
 
-    tracksize += 3;
+    tracksize += len;
+    queuedtime = 0;
     return false;
 }
 
-// Write a key press event
-static boolean WritePressKey(byte channel, byte key,
-                             byte velocity, MEMFILE *midioutput)
-{
-    byte working = midi_presskey | channel;
+// Write an event, preceded by the queued delay, to a MIDI file.
 
+static boolean WriteEvent(const byte *event, int len, MEMFILE *midioutput)
+{
     if (WriteTime(queuedtime, midioutput))
     {
         return true;
     }
 
-    if (mem_fwrite(&working, 1, 1, midioutput) != 1)
+    if (mem_fwrite(event, 1, len, midioutput) != len)
     {
         return true;
     }
 
-    working = key & 0x7F;
+    tracksize += len;
+    return false;
+}
 
-    if (mem_fwrite(&working, 1, 1, midioutput) != 1)
-    {
-        return true;
-    }
+// Write the end of track marker
+static boolean WriteEndTrack(MEMFILE *midioutput)
+{
+    byte endtrack[] = {0xFF, 0x2F, 0x00};
 
-    working = velocity & 0x7F;
+    return WriteEvent(endtrack, 3, midioutput);
+}
 
-    if (mem_fwrite(&working, 1, 1, midioutput) != 1)
-    {
-        return true;
-    }
+// Write a key press event
+static boolean WritePressKey(byte channel, byte key,
+                             byte velocity, MEMFILE *midioutput)
+{
+    byte working[3];
 
-    tracksize += 3;
+    working[0] = midi_presskey | channel;
+    working[1] = key & 0x7F;
+    working[2] = velocity & 0x7F;
 
-    return false;
+    return WriteEvent(working, 3, midioutput);
 }
 
 // Write a key release event
 static boolean WriteReleaseKey(byte channel, byte key,
                                MEMFILE *midioutput)
 {
-    byte working = midi_releasekey | channel;
-
-    if (WriteTime(queuedtime, midioutput))
-    {
-        return true;
-    }
-
-    if (mem_fwrite(&working, 1, 1, midioutput) != 1)
-    {
-        return true;
-    }
-
-    working = key & 0x7F;
-
-    if (mem_fwrite(&working, 1, 1, midioutput) != 1)
-    {
-        return true;
-    }
-
-    working = 0;
-
-    if (mem_fwrite(&working, 1, 1, midioutput) != 1)
-    {
-        return true;
-    }
+    byte working[3];
 
-    tracksize += 3;
+    working[0] = midi_releasekey | channel;
+    working[1] = key & 0x7F;
+    working[2] = 0;
 
-    return false;
+    return WriteEvent(working, 3, midioutput);
 }
 
 // Write a pitch wheel/bend event
 static boolean WritePitchWheel(byte channel, short wheel,
                                MEMFILE *midioutput)
 {
-    byte working = midi_pitchwheel | channel;
-
-    if (WriteTime(queuedtime, midioutput))
-    {
-        return true;
-    }
-
-    if (mem_fwrite(&working, 1, 1, midioutput) != 1)
-    {
-        return true;
-    }
-
-    working = wheel & 0x7F;
-
-    if (mem_fwrite(&working, 1, 1, midioutput) != 1)
-    {
-        return true;
-    }
-
-    working = (wheel >> 7) & 0x7F;
+    byte working[3];
 
-    if (mem_fwrite(&working, 1, 1, midioutput) != 1)
-    {
-        return true;
-    }
+    working[0] = midi_pitchwheel | channel;
+    working[1] = wheel & 0x7F;
+    working[2] = (wheel >> 7) & 0x7F;
 
-    tracksize += 3;
-    return false;
+    return WriteEvent(working, 3, midioutput);
 }
 
 // Write a patch change event
 static boolean WriteChangePatch(byte channel, byte patch,
                                 MEMFILE *midioutput)
 {
-    byte working = midi_changepatch | channel;
-
-    if (WriteTime(queuedtime, midioutput))
-    {
-        return true;
-    }
-
-    if (mem_fwrite(&working, 1, 1, midioutput) != 1)
-    {
-        return true;
-    }
-
-    working = patch & 0x7F;
-
-    if (mem_fwrite(&working, 1, 1, midioutput) != 1)
-    {
-        return true;
-    }
+    byte working[2];
 
-    tracksize += 2;
+    working[0] = midi_changepatch | channel;
+    working[1] = patch & 0x7F;
 
-    return false;
+    return WriteEvent(working, 2, midioutput);
 }
 
 // Write a valued controller change event
@@ -293,46 +220,25 @@ static boolean WriteChangeController_Valued(byte channel,
                                             byte value,
                                             MEMFILE *midioutput)
 {
-    byte working = midi_changecontroller | channel;
-
-    if (WriteTime(queuedtime, midioutput))
-    {
-        return true;
-    }
+    byte working[3];
 
-    if (mem_fwrite(&working, 1, 1, midioutput) != 1)
-    {
-        return true;
-    }
-
-    working = control & 0x7F;
-
-    if (mem_fwrite(&working, 1, 1, midioutput) != 1)
-    {
-        return true;
-    }
+    working[0] = midi_changecontroller | channel;
+    working[1] = control & 0x7F;
 
     // Quirk in vanilla DOOM? MUS controller values should be
     // 7-bit, not 8-bit.
 
-    working = value;// & 0x7F;
+    working[2] = value;// & 0x7F;
 
     // Fix on said quirk to stop MIDI players from complaining that
     // the value is out of range:
 
-    if (working & 0x80)
+    if (working[2] & 0x80)
     {
-        working = 0x7F;
+        working[2] = 0x7F;
     }
 
-    if (mem_fwrite(&working, 1, 1, midioutput) != 1)
-    {
-        return true;
-    }
-
-    tracksize += 3;
-
-    return false;
+    return WriteEvent(working, 3, midioutput);
 }
 
 // Write a valueless controller change event
@@ -0,0 +1,978 @@
+//
+// Copyright(C) 2020 Night Dive Studios, LLC
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//    Headless bot clients for load testing a server.
+//
+//    The bots run inside the server process and speak the normal
+//    client protocol to it over an in-memory link, which is subject
+//    to the same conditions as the network simulator (see net_sim.c).
+//    They play a script of ticcmds rather than running the game, so
+//    they must only be put in games with other bots: a real player's
+//    consistency checks would fail against them.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "doomtype.h"
+#include "d_event.h"
+#include "d_mode.h"
+#include "i_system.h"
+#include "i_timer.h"
+#include "m_argv.h"
+#include "m_misc.h"
+#include "net_bot.h"
+#include "net_common.h"
+#include "net_defs.h"
+#include "net_io.h"
+#include "net_packet.h"
+#include "net_server.h"
+#include "net_sim.h"
+#include "net_structrw.h"
+#include "z_zone.h"
+
+// How often to print statistics, in milliseconds.
+
+#define STATS_INTERVAL 10000
+
+typedef enum
+{
+    BOT_CONNECTING,
+    BOT_WAITING_LAUNCH,
+    BOT_WAITING_START,
+    BOT_IN_GAME,
+    BOT_DISCONNECTED,
+} botstate_t;
+
+// One step of the script the bots play.
+
+typedef struct
+{
+    int tics;
+    int forwardmove;
+    int sidemove;
+    int angleturn;
+    int buttons;
+} botstep_t;
+
+typedef struct
+{
+    boolean active;
+    int seq;
+    unsigned int time;
+    net_ticdiff_t cmd;
+} botsend_t;
+
+typedef struct
+{
+    boolean active;
+    unsigned int resend_time;
+
+    // Change of settings made by the server from this tic on.
+
+    int ticdup;
+    int extratics;
+} botrecv_t;
+
+typedef struct
+{
+    int number;
+    botstate_t state;
+
+    // The bot as the server sees it, and the server as the bot sees it.
+
+    net_addr_t addr;
+    net_addr_t server_addr;
+
+    // Packets on their way from the server to the bot.
+
+    net_delayline_t inbox;
+
+    net_connection_t connection;
+    unsigned int syn_time;
+    boolean launched;
+
+    // Players in the game while waiting for launch, and when that
+    // last changed.
+
+    int wait_players;
+    unsigned int wait_time;
+
+    net_gamesettings_t settings;
+
+    // Tics are made at the ticdup rate from tic_base, made at
+    // start_time.
+
+    unsigned int start_time;
+    int tic_base;
+
+    // Position in the script.
+
+    int step;
+    int step_tics;
+
+    ticcmd_t last_ticcmd;
+    int maketic;
+    botsend_t send_queue[BACKUPTICS];
+
+    botrecv_t recvwindow[BACKUPTICS];
+    int recvwindow_start;
+    boolean need_to_acknowledge;
+    unsigned int gamedata_recv_time;
+    int last_latency;
+} bot_t;
+
+// Walk, turn, strafe while firing, back off, and try to use something.
+
+static botstep_t default_script[] =
+{
+    { 35,  25,   0,    0, 0 },
+    { 20,   0,   0,  640, 0 },
+    { 35,   0,  24,    0, BT_ATTACK },
+    { 20, -25,   0, -640, 0 },
+    { 10,   0,   0,    0, BT_USE },
+};
+
+static botstep_t *script = default_script;
+static int script_len = arrlen(default_script);
+
+static bot_t *bots = NULL;
+static int num_bots = 0;
+
+// Packets on their way from the bots to the server.
+
+static net_delayline_t server_inbox;
+
+// Counters for the statistics.
+
+static unsigned int stats_time;
+static unsigned int tics_sent;
+static unsigned int resends_sent;
+static unsigned int resends_received;
+
+//
+// Module used by the server to talk to the bots.
+//
+
+static boolean NET_BOT_InitClient(void)
+{
+    return true;
+}
+
+static boolean NET_BOT_InitServer(void)
+{
+    return true;
+}
+
+static void NET_BOT_SendPacket(net_addr_t *addr, net_packet_t *packet)
+{
+    bot_t *bot;
+
+    if (addr == &net_broadcast_addr)
+    {
+        return;
+    }
+
+    bot = addr->handle;
+
+    NET_SIM_Push(&bot->inbox, &bot->server_addr, packet);
+}
+
+static boolean NET_BOT_RecvPacket(net_addr_t **addr, net_packet_t **packet)
+{
+    return NET_SIM_Pop(&server_inbox, addr, packet);
+}
+
+static void NET_BOT_AddrToString(net_addr_t *addr, char *buffer,
+                                 int buffer_len)
+{
+    bot_t *bot;
+
+    bot = addr->handle;
+
+    M_snprintf(buffer, buffer_len, "bot %i", bot->number);
+}
+
+static void NET_BOT_FreeAddress(net_addr_t *addr)
+{
+    // Bot addresses live as long as the bots do.
+}
+
+static net_addr_t *NET_BOT_ResolveAddress(char *address)
+{
+    return NULL;
+}
+
+net_module_t net_bot_module =
+{
+    NET_BOT_InitClient,
+    NET_BOT_InitServer,
+    NET_BOT_SendPacket,
+    NET_BOT_RecvPacket,
+    NET_BOT_AddrToString,
+    NET_BOT_FreeAddress,
+    NET_BOT_ResolveAddress,
+};
+
+//
+// Module used by the bots to talk to the server.  The bots read their
+// inboxes directly, so this only sends.
+//
+
+static void BotLinkSendPacket(net_addr_t *addr, net_packet_t *packet)
+{
+    bot_t *bot;
+
+    bot = addr->handle;
+
+    NET_SIM_Push(&server_inbox, &bot->addr, packet);
+}
+
+static boolean BotLinkRecvPacket(net_addr_t **addr, net_packet_t **packet)
+{
+    return false;
+}
+
+static net_module_t bot_link_module =
+{
+    NET_BOT_InitClient,
+    NET_BOT_InitServer,
+    BotLinkSendPacket,
+    BotLinkRecvPacket,
+    NET_BOT_AddrToString,
+    NET_BOT_FreeAddress,
+    NET_BOT_ResolveAddress,
+};
+
+//
+// Bot client.
+//
+
+static void BotSendSYN(bot_t *bot)
+{
+    net_connect_data_t data;
+    net_packet_t *packet;
+    char name[MAXPLAYERNAME];
+
+    memset(&data, 0, sizeof(data));
+    data.gamemode = commercial;
+    data.gamemission = strife;
+    data.max_players = NET_MAXPLAYERS;
+
+    M_snprintf(name, sizeof(name), "bot%i", bot->number);
+
+    packet = NET_NewPacket(10);
+    NET_WriteInt16(packet, NET_PACKET_TYPE_SYN);
+    NET_WriteInt32(packet, NET_MAGIC_NUMBER);
+    NET_WriteString(packet, PACKAGE_STRING);
+    NET_WriteConnectData(packet, &data);
+    NET_WriteString(packet, name);
+    NET_Conn_SendPacket(&bot->connection, packet);
+    NET_FreePacket(packet);
+
+    bot->syn_time = I_GetTimeMS();
+}
+
+// True if no bot is still waiting to connect, so that the game can be
+// launched with all of them in it.
+
+static boolean AllBotsConnected(void)
+{
+    int i;
+
+    for (i=0; i<num_bots; ++i)
+    {
+        if (bots[i].state == BOT_CONNECTING)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void BotParseWaitingData(bot_t *bot, net_packet_t *packet)
+{
+    net_waitdata_t wait_data;
+
+    if (!NET_ReadWaitData(packet, &wait_data))
+    {
+        return;
+    }
+
+    if (wait_data.num_players != bot->wait_players)
+    {
+        bot->wait_players = wait_data.num_players;
+        bot->wait_time = I_GetTimeMS();
+    }
+
+    // The first bot into a game launches it, once the game is full or
+    // all the bots have connected and settled into their games.
+
+    if (bot->state == BOT_WAITING_LAUNCH && wait_data.is_controller
+     && !bot->launched
+     && (wait_data.num_players >= wait_data.max_players
+      || (AllBotsConnected() && I_GetTimeMS() - bot->wait_time > 2000)))
+    {
+        NET_Conn_NewReliable(&bot->connection, NET_PACKET_TYPE_LAUNCH);
+        bot->launched = true;
+    }
+}
+
+static void BotParseLaunch(bot_t *bot, net_packet_t *packet)
+{
+    net_gamesettings_t settings;
+    net_packet_t *reply;
+
+    if (bot->state != BOT_WAITING_LAUNCH)
+    {
+        return;
+    }
+
+    // Only the controller's settings are used.
+
+    memset(&settings, 0, sizeof(settings));
+    settings.ticdup = 1;
+    settings.extratics = 1;
+    settings.episode = 1;
+    settings.map = 2;
+    settings.skill = sk_medium;
+    settings.gameversion = exe_strife_1_31;
+    settings.new_sync = 1;
+    settings.deathmatch = 1;
+
+    reply = NET_Conn_NewReliable(&bot->connection, NET_PACKET_TYPE_GAMESTART);
+    NET_WriteSettings(reply, &settings);
+
+    bot->state = BOT_WAITING_START;
+}
+
+static void BotParseGameStart(bot_t *bot, net_packet_t *packet)
+{
+    if (!NET_ReadSettings(packet, &bot->settings))
+    {
+        return;
+    }
+
+    if (bot->state != BOT_WAITING_START || bot->settings.consoleplayer < 0)
+    {
+        return;
+    }
+
+    bot->state = BOT_IN_GAME;
+    bot->start_time = I_GetTimeMS();
+    bot->tic_base = 0;
+    bot->maketic = 0;
+    bot->recvwindow_start = 0;
+    bot->need_to_acknowledge = false;
+    bot->step = bot->number % script_len;
+    bot->step_tics = 0;
+    memset(&bot->last_ticcmd, 0, sizeof(ticcmd_t));
+    memset(bot->send_queue, 0, sizeof(bot->send_queue));
+    memset(bot->recvwindow, 0, sizeof(bot->recvwindow));
+}
+
+static void BotSendTics(bot_t *bot, int start, int end)
+{
+    net_packet_t *packet;
+    int i;
+
+    if (start < 0)
+    {
+        start = 0;
+    }
+
+    packet = NET_NewPacket(512);
+    NET_WriteInt16(packet, NET_PACKET_TYPE_GAMEDATA);
+    NET_WriteInt8(packet, bot->recvwindow_start & 0xff);
+    NET_WriteInt8(packet, start & 0xff);
+    NET_WriteInt8(packet, end - start + 1);
+    NET_WriteSVarInt(packet, bot->last_latency);
+
+    for (i=start; i<=end; ++i)
+    {
+        NET_WriteTiccmdDiff(packet, &bot->send_queue[i % BACKUPTICS].cmd,
+                            i > start
+                                ? &bot->send_queue[(i - 1) % BACKUPTICS].cmd
+                                : NULL,
+                            bot->settings.lowres_turn);
+    }
+
+    NET_Conn_QueuePacket(&bot->connection, packet);
+    NET_FreePacket(packet);
+
+    bot->need_to_acknowledge = false;
+}
+
+static void BotBuildTiccmd(bot_t *bot, ticcmd_t *cmd)
+{
+    botstep_t *step;
+
+    step = &script[bot->step];
+
+    memset(cmd, 0, sizeof(ticcmd_t));
+    cmd->forwardmove = step->forwardmove;
+    cmd->sidemove = step->sidemove;
+    cmd->angleturn = step->angleturn;
+    cmd->buttons = step->buttons;
+
+    ++bot->step_tics;
+
+    if (bot->step_tics >= step->tics)
+    {
+        bot->step = (bot->step + 1) % script_len;
+        bot->step_tics = 0;
+    }
+}
+
+static void BotSendTiccmd(bot_t *bot)
+{
+    ticcmd_t cmd;
+    botsend_t *sendobj;
+
+    BotBuildTiccmd(bot, &cmd);
+
+    sendobj = &bot->send_queue[bot->maketic % BACKUPTICS];
+    sendobj->active = true;
+    sendobj->seq = bot->maketic;
+    sendobj->time = I_GetTimeMS();
+    NET_TiccmdDiff(&bot->last_ticcmd, &cmd, &sendobj->cmd);
+
+    bot->last_ticcmd = cmd;
+
+    BotSendTics(bot, bot->maketic - bot->settings.extratics, bot->maketic);
+
+    ++bot->maketic;
+    ++tics_sent;
+}
+
+static void BotSendResendRequest(bot_t *bot, int start, int end)
+{
+    net_packet_t *packet;
+    unsigned int nowtime;
+    int index;
+    int i;
+
+    packet = NET_NewPacket(64);
+    NET_WriteInt16(packet, NET_PACKET_TYPE_GAMEDATA_RESEND);
+    NET_WriteInt32(packet, start);
+    NET_WriteInt8(packet, end - start + 1);
+    NET_Conn_QueuePacket(&bot->connection, packet);
+    NET_FreePacket(packet);
+
+    nowtime = I_GetTimeMS();
+
+    for (i=start; i<=end; ++i)
+    {
+        index = i - bot->recvwindow_start;
+
+        if (index >= 0 && index < BACKUPTICS)
+        {
+            bot->recvwindow[index].resend_time = nowtime;
+        }
+    }
+
+    ++resends_sent;
+}
+
+static void BotParseGameData(bot_t *bot, net_packet_t *packet)
+{
+    net_full_ticcmd_t cmd, prevcmd;
+    unsigned int seq, num_tics;
+    unsigned int nowtime;
+    botsend_t *sendobj;
+    int resend_start, resend_end;
+    int index;
+    unsigned int i;
+
+    if (bot->state != BOT_IN_GAME
+     || !NET_ReadInt8(packet, &seq)
+     || !NET_ReadInt8(packet, &num_tics))
+    {
+        return;
+    }
+
+    nowtime = I_GetTimeMS();
+
+    if (!bot->need_to_acknowledge)
+    {
+        bot->need_to_acknowledge = true;
+        bot->gamedata_recv_time = nowtime;
+    }
+
+    seq = NET_ExpandTicNum(bot->recvwindow_start, seq);
+
+    for (i=0; i<num_tics; ++i)
+    {
+        if (!NET_ReadFullTiccmd(packet, &cmd, i > 0 ? &prevcmd : NULL,
+                                bot->settings.lowres_turn))
+        {
+            return;
+        }
+
+        prevcmd = cmd;
+
+        index = seq - bot->recvwindow_start + i;
+
+        if (index >= 0 && index < BACKUPTICS)
+        {
+            bot->recvwindow[index].active = true;
+            bot->recvwindow[index].ticdup = cmd.ticdup;
+            bot->recvwindow[index].extratics = cmd.extratics;
+        }
+    }
+
+    // Latency of the last tic in the packet, as the real client
+    // measures it.
+
+    sendobj = &bot->send_queue[(seq + num_tics - 1) % BACKUPTICS];
+
+    if (num_tics > 0 && sendobj->active
+     && sendobj->seq == seq + num_tics - 1)
+    {
+        bot->last_latency = nowtime - sendobj->time;
+    }
+
+    // Ask for anything missing before this packet.
+
+    resend_end = seq - bot->recvwindow_start;
+
+    if (resend_end >= BACKUPTICS)
+    {
+        resend_end = BACKUPTICS - 1;
+    }
+
+    resend_start = resend_end;
+
+    for (index = resend_end - 1; index >= 0; --index)
+    {
+        if (bot->recvwindow[index].active
+         || bot->recvwindow[index].resend_time != 0)
+        {
+            break;
+        }
+
+        resend_start = index;
+    }
+
+    if (resend_start < resend_end)
+    {
+        BotSendResendRequest(bot, bot->recvwindow_start + resend_start,
+                             bot->recvwindow_start + resend_end - 1);
+    }
+
+    // Advance the window.
+
+    while (bot->recvwindow[0].active)
+    {
+        if (bot->recvwindow[0].extratics > 0)
+        {
+            bot->settings.extratics = bot->recvwindow[0].extratics;
+        }
+
+        if (bot->recvwindow[0].ticdup > 0
+         && bot->recvwindow[0].ticdup != bot->settings.ticdup)
+        {
+            bot->settings.ticdup = bot->recvwindow[0].ticdup;
+            bot->start_time = nowtime;
+            bot->tic_base = bot->maketic;
+        }
+
+        memmove(bot->recvwindow, bot->recvwindow + 1,
+                sizeof(botrecv_t) * (BACKUPTICS - 1));
+        memset(&bot->recvwindow[BACKUPTICS - 1], 0, sizeof(botrecv_t));
+        ++bot->recvwindow_start;
+    }
+}
+
+static void BotParseResendRequest(bot_t *bot, net_packet_t *packet)
+{
+    unsigned int start, end, num_tics;
+
+    if (!NET_ReadInt32(packet, &start)
+     || !NET_ReadInt8(packet, &num_tics))
+    {
+        return;
+    }
+
+    ++resends_received;
+
+    end = start + num_tics - 1;
+
+    while (start <= end
+        && (!bot->send_queue[start % BACKUPTICS].active
+         || bot->send_queue[start % BACKUPTICS].seq != start))
+    {
+        ++start;
+    }
+
+    while (start <= end
+        && (!bot->send_queue[end % BACKUPTICS].active
+         || bot->send_queue[end % BACKUPTICS].seq != end))
+    {
+        --end;
+    }
+
+    if (start <= end)
+    {
+        BotSendTics(bot, start, end);
+    }
+}
+
+static void BotParsePacket(bot_t *bot, net_packet_t *packet)
+{
+    net_packet_t *sub;
+    unsigned int packet_type;
+
+    if (!NET_ReadInt16(packet, &packet_type))
+    {
+        return;
+    }
+
+    if (packet_type == NET_PACKET_TYPE_BUNDLE)
+    {
+        while ((sub = NET_ReadSubPacket(packet)) != NULL)
+        {
+            BotParsePacket(bot, sub);
+            NET_FreePacket(sub);
+        }
+    }
+    else if (NET_Conn_Packet(&bot->connection, packet, &packet_type))
+    {
+        // Packet eaten by the common connection code
+    }
+    else
+    {
+        switch (packet_type)
+        {
+            case NET_PACKET_TYPE_WAITING_DATA:
+                BotParseWaitingData(bot, packet);
+                break;
+
+            case NET_PACKET_TYPE_LAUNCH:
+                BotParseLaunch(bot, packet);
+                break;
+
+            case NET_PACKET_TYPE_GAMESTART:
+                BotParseGameStart(bot, packet);
+                break;
+
+            case NET_PACKET_TYPE_GAMEDATA:
+                BotParseGameData(bot, packet);
+                break;
+
+            case NET_PACKET_TYPE_GAMEDATA_RESEND:
+                BotParseResendRequest(bot, packet);
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+// Check for expired resend requests, and acknowledge data if we have
+// not sent any of our own for a while.
+
+static void BotCheckResends(bot_t *bot)
+{
+    unsigned int nowtime;
+    int resend_start;
+    int i;
+
+    nowtime = I_GetTimeMS();
+    resend_start = -1;
+
+    for (i=0; i<=BACKUPTICS; ++i)
+    {
+        if (i < BACKUPTICS
+         && !bot->recvwindow[i].active
+         && bot->recvwindow[i].resend_time != 0
+         && nowtime > bot->recvwindow[i].resend_time + 300)
+        {
+            if (resend_start < 0)
+            {
+                resend_start = i;
+            }
+        }
+        else if (resend_start >= 0)
+        {
+            BotSendResendRequest(bot, bot->recvwindow_start + resend_start,
+                                 bot->recvwindow_start + i - 1);
+            resend_start = -1;
+        }
+    }
+
+    if (bot->need_to_acknowledge
+     && nowtime - bot->gamedata_recv_time > 200)
+    {
+        net_packet_t *packet;
+
+        packet = NET_NewPacket(10);
+        NET_WriteInt16(packet, NET_PACKET_TYPE_GAMEDATA_ACK);
+        NET_WriteInt8(packet, bot->recvwindow_start & 0xff);
+        NET_Conn_QueuePacket(&bot->connection, packet);
+        NET_FreePacket(packet);
+
+        bot->need_to_acknowledge = false;
+    }
+}
+
+static void BotRunTics(bot_t *bot)
+{
+    int ticdup;
+    int target;
+
+    ticdup = bot->settings.ticdup > 0 ? bot->settings.ticdup : 1;
+    target = bot->tic_base
+           + ((I_GetTimeMS() - bot->start_time) * TICRATE) / (1000 * ticdup);
+
+    // Don't run further ahead of the server than a real client would.
+
+    while (bot->maketic < target
+        && bot->maketic - bot->recvwindow_start < BACKUPTICS / 2 - 1)
+    {
+        BotSendTiccmd(bot);
+    }
+
+    BotCheckResends(bot);
+}
+
+static void RunBot(bot_t *bot)
+{
+    net_addr_t *addr;
+    net_packet_t *packet;
+
+    while (NET_SIM_Pop(&bot->inbox, &addr, &packet))
+    {
+        BotParsePacket(bot, packet);
+        NET_FreePacket(packet);
+    }
+
+    switch (bot->state)
+    {
+        case BOT_CONNECTING:
+            if (bot->connection.state == NET_CONN_STATE_CONNECTED)
+            {
+                bot->state = BOT_WAITING_LAUNCH;
+            }
+            else if (I_GetTimeMS() - bot->syn_time > 1000)
+            {
+                BotSendSYN(bot);
+            }
+            break;
+
+        case BOT_IN_GAME:
+            BotRunTics(bot);
+            break;
+
+        default:
+            break;
+    }
+
+    if (bot->state != BOT_CONNECTING && bot->state != BOT_DISCONNECTED
+     && bot->connection.state != NET_CONN_STATE_CONNECTED)
+    {
+        printf("bot%i: disconnected from server\n", bot->number);
+        bot->state = BOT_DISCONNECTED;
+    }
+
+    NET_Conn_Run(&bot->connection);
+    NET_Conn_Flush(&bot->connection);
+}
+
+static void PrintStats(void)
+{
+    static net_simstats_t last;
+    static unsigned int last_tics, last_sent, last_received;
+    unsigned int nowtime;
+    int in_game;
+    int i;
+
+    nowtime = I_GetTimeMS();
+
+    if (nowtime - stats_time < STATS_INTERVAL)
+    {
+        return;
+    }
+
+    in_game = 0;
+
+    for (i=0; i<num_bots; ++i)
+    {
+        if (bots[i].state == BOT_IN_GAME)
+        {
+            ++in_game;
+        }
+    }
+
+    printf("bots: %i/%i in game; %u tics sent, resend requests "
+           "%u sent, %u received; link: %u packets, %u bytes, "
+           "%u dropped, %u duplicated, %u reordered\n",
+           in_game, num_bots,
+           tics_sent - last_tics,
+           resends_sent - last_sent,
+           resends_received - last_received,
+           net_sim_stats.packets - last.packets,
+           net_sim_stats.bytes - last.bytes,
+           net_sim_stats.dropped - last.dropped,
+           net_sim_stats.duplicated - last.duplicated,
+           net_sim_stats.reordered - last.reordered);
+
+    last = net_sim_stats;
+    last_tics = tics_sent;
+    last_sent = resends_sent;
+    last_received = resends_received;
+    stats_time = nowtime;
+}
+
+// Load a script: one step per line, giving the number of tics, then
+// the forward, side, turn and button values of the ticcmd.
+
+static void LoadScript(char *filename)
+{
+    FILE *fstream;
+    botstep_t step;
+    int alloced;
+
+    fstream = fopen(filename, "r");
+
+    if (fstream == NULL)
+    {
+        I_Error("NET_BOT_Init: Unable to open bot script '%s'", filename);
+    }
+
+    script = NULL;
+    script_len = 0;
+    alloced = 0;
+
+    while (fscanf(fstream, "%i %i %i %i %i", &step.tics, &step.forwardmove,
+                  &step.sidemove, &step.angleturn, &step.buttons) == 5)
+    {
+        if (script_len >= alloced)
+        {
+            alloced = alloced ? alloced * 2 : 16;
+            script = realloc(script, alloced * sizeof(botstep_t));
+
+            if (script == NULL)
+            {
+                I_Error("NET_BOT_Init: Failed to allocate bot script");
+            }
+        }
+
+        script[script_len++] = step;
+    }
+
+    fclose(fstream);
+
+    if (script_len == 0)
+    {
+        I_Error("NET_BOT_Init: Bot script '%s' has no steps", filename);
+    }
+}
+
+void NET_BOT_Init(void)
+{
+    bot_t *bot;
+    int p;
+    int i;
+
+    //!
+    // @category net
+    // @arg <n>
+    //
+    // When running a dedicated server, start <n> headless bot clients
+    // inside the server that join and play scripted games, for load
+    // testing.  Combine with -netlatency and friends to test under
+    // poor network conditions.
+    //
+
+    p = M_CheckParmWithArgs("-bots", 1);
+
+    if (p <= 0)
+    {
+        return;
+    }
+
+    num_bots = atoi(myargv[p + 1]);
+
+    if (num_bots <= 0)
+    {
+        num_bots = 0;
+        return;
+    }
+
+    //!
+    // @category net
+    // @arg <file>
+    //
+    // Script for the bots started with -bots to play.  Each line
+    // gives a number of tics followed by the forward, side, turn and
+    // button values to use for them.
+    //
+
+    p = M_CheckParmWithArgs("-botscript", 1);
+
+    if (p > 0)
+    {
+        LoadScript(myargv[p + 1]);
+    }
+
+    bots = Z_Malloc(num_bots * sizeof(bot_t), PU_STATIC, 0);
+    memset(bots, 0, num_bots * sizeof(bot_t));
+
+    for (i=0; i<num_bots; ++i)
+    {
+        bot = &bots[i];
+
+        bot->number = i;
+        bot->state = BOT_CONNECTING;
+        bot->addr.module = &net_bot_module;
+        bot->addr.handle = bot;
+        bot->server_addr.module = &bot_link_module;
+        bot->server_addr.handle = bot;
+        bot->syn_time = I_GetTimeMS() - 1000 - 1;
+
+        NET_Conn_InitClient(&bot->connection, &bot->server_addr);
+    }
+
+    NET_SV_AddModule(&net_bot_module);
+
+    stats_time = I_GetTimeMS();
+
+    printf("NET_BOT_Init: started %i bots\n", num_bots);
+}
+
+void NET_BOT_Run(void)
+{
+    int i;
+
+    for (i=0; i<num_bots; ++i)
+    {
+        RunBot(&bots[i]);
+    }
+
+    if (num_bots > 0)
+    {
+        PrintStats();
+    }
+}
+
+int NET_BOT_NumBots(void)
+{
+    return num_bots;
+}
+
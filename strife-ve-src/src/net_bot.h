@@ -0,0 +1,42 @@
+//
+// Copyright(C) 2020 Night Dive Studios, LLC
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//    Headless bot clients for load testing a server.
+//
+
+#ifndef NET_BOT_H
+#define NET_BOT_H
+
+#include "net_defs.h"
+
+// Module the server uses to talk to the bots.
+
+extern net_module_t net_bot_module;
+
+// Start the bots requested on the command line, if any, and add
+// their module to the server.  Call after NET_SV_Init.
+
+void NET_BOT_Init(void);
+
+// Run the bots: read what the server has sent them, and send their
+// ticcmds.
+
+void NET_BOT_Run(void);
+
+// Number of bots running.
+
+int NET_BOT_NumBots(void);
+
+#endif /* #ifndef NET_BOT_H */
+
@@ -50,6 +50,7 @@ char player_names[NET_MAXPLAYERS][MAXPLAYERNAME];
 #include "net_steamworks.h"
 
 extern void D_ReceiveTic(ticcmd_t *ticcmds, boolean *playeringame);
+extern void D_ReceiveTicdup(int ticdup);
 
 typedef enum
 {
@@ -165,6 +166,13 @@ static unsigned int gamedata_recv_time;
 // that they can adjust to us.
 static int last_latency;
 
+// [SVE] Arrival of new tics from the server: the last one and when it
+// came, and the smoothed jitter in 1/16 ms.
+
+static int arrival_tic;
+static unsigned int arrival_time;
+static int arrival_jitter;
+
 // Hash checksums of our wad directory and dehacked data.
 
 sha1_digest_t net_local_wad_sha1sum;
@@ -272,6 +280,20 @@ static void NET_CL_AdvanceWindow(void)
 
     while (recvwindow[0].active)
     {
+        // [SVE] Apply any change of settings made by the server from
+        // this tic on.
+
+        if (recvwindow[0].cmd.extratics > 0)
+        {
+            settings.extratics = recvwindow[0].cmd.extratics;
+        }
+
+        if (recvwindow[0].cmd.ticdup > 0)
+        {
+            settings.ticdup = recvwindow[0].cmd.ticdup;
+            D_ReceiveTicdup(settings.ticdup);
+        }
+
         // Expand tic diff data into d_net.c structures
 
         NET_CL_ExpandFullTiccmd(&recvwindow[0].cmd, recvwindow_start,
@@ -280,7 +302,7 @@ static void NET_CL_AdvanceWindow(void)
 
         // Advance the window
 
-        memcpy(recvwindow, recvwindow + 1, 
+        memmove(recvwindow, recvwindow + 1, 
                sizeof(net_server_recv_t) * (BACKUPTICS - 1));
         memset(&recvwindow[BACKUPTICS-1], 0, sizeof(net_server_recv_t));
 
@@ -300,6 +322,16 @@ static void NET_CL_Shutdown(void)
 
         NET_FreeAddress(server_addr);
 
+        // [SVE] Drop anything still queued, so that it is neither leaked
+        // nor sent on the next connection.
+
+        if (client_connection.bundle != NULL)
+        {
+            NET_FreePacket(client_connection.bundle);
+            client_connection.bundle = NULL;
+            client_connection.bundle_count = 0;
+        }
+
         // Shut down network module, etc.  To do.
     }
 }
@@ -334,7 +366,7 @@ static void NET_CL_SendGameDataACK(void)
     NET_WriteInt16(packet, NET_PACKET_TYPE_GAMEDATA_ACK);
     NET_WriteInt8(packet, recvwindow_start & 0xff);
 
-    NET_Conn_SendPacket(&client_connection, packet);
+    NET_Conn_QueuePacket(&client_connection, packet);
 
     NET_FreePacket(packet);
 
@@ -368,7 +400,11 @@ static void NET_CL_SendTics(int start, int end)
     NET_WriteInt8(packet, start & 0xff);
     NET_WriteInt8(packet, end - start + 1);
 
-    // Add the tics.
+    // [SVE] The latency is the same for all the tics, so is sent once.
+
+    NET_WriteSVarInt(packet, last_latency);
+
+    // Add the tics, each relative to the one before.
 
     for (i=start; i<=end; ++i)
     {
@@ -376,14 +412,15 @@ static void NET_CL_SendTics(int start, int end)
 
         sendobj = &send_queue[i % BACKUPTICS];
 
-        NET_WriteInt16(packet, last_latency);
-
-        NET_WriteTiccmdDiff(packet, &sendobj->cmd, settings.lowres_turn);
+        NET_WriteTiccmdDiff(packet, &sendobj->cmd,
+                            i > start ? &send_queue[(i - 1) % BACKUPTICS].cmd
+                                      : NULL,
+                            settings.lowres_turn);
     }
     
-    // Send the packet
+    // Queue the packet
 
-    NET_Conn_SendPacket(&client_connection, packet);
+    NET_Conn_QueuePacket(&client_connection, packet);
     
     // All done!
 
@@ -425,6 +462,10 @@ void NET_CL_SendTiccmd(ticcmd_t *ticcmd, int maketic)
         starttic = 0;
     
     NET_CL_SendTics(starttic, endtic);
+
+    // [SVE] Send it now, along with anything else waiting to go.
+
+    NET_Conn_Flush(&client_connection);
 }
 
 // data received while we are waiting for the game to start
@@ -528,6 +569,9 @@ static void NET_CL_ParseGameStart(net_packet_t *packet)
     recvwindow_start = 0;
     memset(&recvwindow_cmd_base, 0, sizeof(recvwindow_cmd_base));
 
+    arrival_tic = -1;
+    arrival_jitter = 0;
+
     // Clear the send queue
 
     memset(&send_queue, 0x00, sizeof(send_queue));
@@ -545,7 +589,7 @@ static void NET_CL_SendResendRequest(int start, int end)
     NET_WriteInt16(packet, NET_PACKET_TYPE_GAMEDATA_RESEND);
     NET_WriteInt32(packet, start);
     NET_WriteInt8(packet, end - start + 1);
-    NET_Conn_SendPacket(&client_connection, packet);
+    NET_Conn_QueuePacket(&client_connection, packet);
     NET_FreePacket(packet);
 
     nowtime = I_GetTimeMS();
@@ -636,11 +680,59 @@ static void NET_CL_CheckResends(void)
 }
 
 
+// [SVE] Update the estimate of how unevenly tics are arriving from the
+// server, as in NET_SV_TimeArrival.
+
+static void NET_CL_TimeArrival(int tic, unsigned int nowtime)
+{
+    int expected;
+    int d;
+
+    if (arrival_tic >= 0)
+    {
+        expected = ((tic - arrival_tic) * settings.ticdup * 1000) / TICRATE;
+        d = (int) (nowtime - arrival_time) - expected;
+
+        if (d < 0)
+        {
+            d = -d;
+        }
+
+        arrival_jitter += d - arrival_jitter / 16;
+    }
+
+    arrival_tic = tic;
+    arrival_time = nowtime;
+}
+
+// [SVE] Number of tics the game should hold back to ride out the
+// jitter: enough to cover a tic arriving two and a half times the
+// average deviation late.  Zero on a steady link.
+
+#define MAX_JITTER_BUFFER 8
+
+int NET_CL_JitterBufferTics(void)
+{
+    int period;
+    int tics;
+
+    if (client_state != CLIENT_STATE_IN_GAME)
+    {
+        return 0;
+    }
+
+    period = (settings.ticdup * 1000) / TICRATE;
+    tics = (arrival_jitter * 5) / (16 * 2 * period);
+
+    return MIN(tics, MAX_JITTER_BUFFER);
+}
+
 // Parsing of NET_PACKET_TYPE_GAMEDATA packets
 // (packets containing the actual ticcmd data)
 
 static void NET_CL_ParseGameData(net_packet_t *packet)
 {
+    net_full_ticcmd_t cmd, prevcmd;
     net_server_recv_t *recvobj;
     unsigned int seq, num_tics;
     unsigned int nowtime;
@@ -673,15 +765,16 @@ static void NET_CL_ParseGameData(net_packet_t *packet)
 
     for (i=0; i<num_tics; ++i)
     {
-        net_full_ticcmd_t cmd;
-
         index = seq - recvwindow_start + i;
 
-        if (!NET_ReadFullTiccmd(packet, &cmd, settings.lowres_turn))
+        if (!NET_ReadFullTiccmd(packet, &cmd, i > 0 ? &prevcmd : NULL,
+                                settings.lowres_turn))
         {
             return;
         }
 
+        prevcmd = cmd;
+
         if (index < 0 || index >= BACKUPTICS)
         {
             // Out of range of the recv window
@@ -704,6 +797,13 @@ static void NET_CL_ParseGameData(net_packet_t *packet)
         if (i == num_tics - 1)
         {
             UpdateClockSync(seq + i, cmd.latency);
+
+            // [SVE] likewise for the jitter estimate
+
+            if ((int) (seq + i) > arrival_tic)
+            {
+                NET_CL_TimeArrival(seq + i, nowtime);
+            }
         }
     }
 
@@ -831,6 +931,7 @@ static void NET_CL_ParseConsoleMessage(net_packet_t *packet)
 
 static void NET_CL_ParsePacket(net_packet_t *packet)
 {
+    net_packet_t *sub;
     unsigned int packet_type;
 
     if (!NET_ReadInt16(packet, &packet_type))
@@ -838,7 +939,17 @@ static void NET_CL_ParsePacket(net_packet_t *packet)
         return;
     }
 
-    if (NET_Conn_Packet(&client_connection, packet, &packet_type))
+    if (packet_type == NET_PACKET_TYPE_BUNDLE)
+    {
+        // [SVE] Several packets sent together
+
+        while ((sub = NET_ReadSubPacket(packet)) != NULL)
+        {
+            NET_CL_ParsePacket(sub);
+            NET_FreePacket(sub);
+        }
+    }
+    else if (NET_Conn_Packet(&client_connection, packet, &packet_type))
     {
         // Packet eaten by the common connection code
     }
@@ -931,6 +1042,13 @@ void NET_CL_Run(void)
 
         NET_CL_CheckResends();
     }
+
+    // [SVE] Send whatever was queued this frame in one datagram
+
+    if (net_client_connected)
+    {
+        NET_Conn_Flush(&client_connection);
+    }
 }
 
 static void NET_CL_SendSYN(net_connect_data_t *data)
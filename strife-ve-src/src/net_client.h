@@ -32,6 +32,11 @@ void NET_CL_LaunchGame(void);
 void NET_CL_StartGame(net_gamesettings_t *settings);
 void NET_CL_SendTiccmd(ticcmd_t *ticcmd, int maketic);
 boolean NET_CL_GetSettings(net_gamesettings_t *_settings);
+
+// [SVE] Number of tics to hold back to absorb uneven arrival of tics
+// from the server.
+
+int NET_CL_JitterBufferTics(void);
 void NET_Init(void);
 
 void NET_BindVariables(void);
@@ -34,6 +34,11 @@
 
 #define KEEPALIVE_PERIOD 1
 
+// [SVE] largest datagram to build from queued packets, to stay clear of
+// fragmentation
+
+#define MAX_BUNDLE_SIZE 1200
+
 // reliable packet that is guaranteed to reach its destination
 
 struct net_reliable_packet_s 
@@ -52,6 +57,8 @@ static void NET_Conn_Init(net_connection_t *conn, net_addr_t *addr)
     conn->reliable_packets = NULL;
     conn->reliable_send_seq = 0;
     conn->reliable_recv_seq = 0;
+    conn->bundle = NULL;
+    conn->bundle_count = 0;
 }
 
 // Initialize as a client connection
@@ -239,16 +246,15 @@ static boolean NET_Conn_ReliablePacket(net_connection_t *conn,
 
     // Send an acknowledgement
 
-    // Note: this is braindead.  It would be much more sensible to 
-    // include this in the next packet, rather than the overhead of
-    // sending a complete packet just for one byte of information.
+    // [SVE] This goes out with whatever else is sent to the other end
+    // this frame, rather than costing a datagram of its own.
 
     reply = NET_NewPacket(10);
 
     NET_WriteInt16(reply, NET_PACKET_TYPE_RELIABLE_ACK);
     NET_WriteInt8(reply, conn->reliable_recv_seq & 0xff);
 
-    NET_Conn_SendPacket(conn, reply);
+    NET_Conn_QueuePacket(conn, reply);
 
     NET_FreePacket(reply);
 
@@ -446,6 +452,62 @@ void NET_Conn_Run(net_connection_t *conn)
     }
 }
 
+// [SVE] Queue a packet to go out with any others for the same connection
+// on the next call to NET_Conn_Flush, in a single datagram.  The caller
+// keeps ownership of the packet.
+
+void NET_Conn_QueuePacket(net_connection_t *conn, net_packet_t *packet)
+{
+    if (conn->bundle != NULL
+     && conn->bundle->len + packet->len + 5 > MAX_BUNDLE_SIZE)
+    {
+        NET_Conn_Flush(conn);
+    }
+
+    if (conn->bundle == NULL)
+    {
+        conn->bundle = NET_NewPacket(MAX_BUNDLE_SIZE);
+        conn->bundle_count = 0;
+        NET_WriteInt16(conn->bundle, NET_PACKET_TYPE_BUNDLE);
+    }
+
+    NET_WriteSubPacket(conn->bundle, packet);
+    ++conn->bundle_count;
+}
+
+// [SVE] Send the packets queued for a connection
+
+void NET_Conn_Flush(net_connection_t *conn)
+{
+    net_packet_t *bundle;
+    net_packet_t *packet;
+
+    bundle = conn->bundle;
+
+    if (bundle == NULL)
+    {
+        return;
+    }
+
+    conn->bundle = NULL;
+
+    if (conn->bundle_count == 1)
+    {
+        // Nothing to go with it: send the packet as it is.
+
+        bundle->pos = 2;
+        packet = NET_ReadSubPacket(bundle);
+        NET_Conn_SendPacket(conn, packet);
+        NET_FreePacket(packet);
+    }
+    else
+    {
+        NET_Conn_SendPacket(conn, bundle);
+    }
+
+    NET_FreePacket(bundle);
+}
+
 net_packet_t *NET_Conn_NewReliable(net_connection_t *conn, int packet_type)
 {
     net_packet_t *packet;
@@ -89,6 +89,10 @@ typedef struct
     net_reliable_packet_t *reliable_packets;
     int reliable_send_seq;
     int reliable_recv_seq;
+
+    // [SVE] Packets queued to go out together in one datagram
+    net_packet_t *bundle;
+    int bundle_count;
 } net_connection_t;
 
 
@@ -100,6 +104,8 @@ boolean NET_Conn_Packet(net_connection_t *conn, net_packet_t *packet,
 void NET_Conn_Disconnect(net_connection_t *conn);
 void NET_Conn_Run(net_connection_t *conn);
 net_packet_t *NET_Conn_NewReliable(net_connection_t *conn, int packet_type);
+void NET_Conn_QueuePacket(net_connection_t *conn, net_packet_t *packet);
+void NET_Conn_Flush(net_connection_t *conn);
 
 // Other miscellaneous common functions
 
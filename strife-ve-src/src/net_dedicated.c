@@ -25,9 +25,11 @@
 
 #include "m_argv.h"
 
+#include "net_bot.h"
 #include "net_defs.h"
 #include "net_sdl.h"
 #include "net_server.h"
+#include "net_sim.h"
 
 // 
 // People can become confused about how dedicated servers work.  Game
@@ -61,20 +63,69 @@ static void CheckForClientOptions(void)
     }
 }
 
+//
+// Event loop.  The server sleeps on its socket and runs as soon as a
+// packet arrives, rather than polling; with many games hosted at once,
+// every millisecond a packet sits unread adds to somebody's latency.
+//
+
+static void WaitForPackets(int ms)
+{
+#ifndef SVE_PLAT_SWITCH
+    if (NET_SDL_WaitForPackets(ms))
+    {
+        return;
+    }
+#endif
+
+    I_Sleep(ms);
+}
+
 void NET_DedicatedServer(void)
 {
+    int p;
+
     CheckForClientOptions();
 
+    //!
+    // @category net
+    // @arg <n>
+    //
+    // When running a dedicated server, host up to <n> games at once.
+    // A new game is opened for players arriving when all the others
+    // are full or have started.  The default is 1.
+    //
+
+    p = M_CheckParmWithArgs("-sessions", 1);
+
+    if (p > 0)
+    {
+        NET_SV_SetMaxSessions(atoi(myargv[p + 1]));
+    }
+
     NET_SV_Init();
 #ifndef SVE_PLAT_SWITCH
-    NET_SV_AddModule(&net_sdl_module);
+    NET_SV_AddModule(NET_SIM_Wrap(&net_sdl_module));
 #endif
+    NET_BOT_Init();
     NET_SV_RegisterWithMaster();
 
     while (true)
     {
         NET_SV_Run();
-        I_Sleep(10);
+        NET_BOT_Run();
+
+        // Packets held back by the simulator, and the bots, do not
+        // wake the event loop.
+
+        if (NET_SIM_Enabled() || NET_BOT_NumBots() > 0)
+        {
+            WaitForPackets(1);
+        }
+        else
+        {
+            WaitForPackets(NET_SV_IdleTime());
+        }
     }
 }
 
@@ -102,7 +102,8 @@ struct _net_addr_s
 // magic number sent when connecting to check this is a valid client
 // [SVE]: modified to prevent accidental UDP comm w/normal Choco clients
 //  (netplay protocol is not otherwise compatible due to needed changes)
-#define NET_MAGIC_NUMBER 3436039889U
+// [SVE]: changed again for bundled packets and variable-length tics
+#define NET_MAGIC_NUMBER 3436039891U
 
 // header field value indicating that the packet is a reliable packet
 
@@ -128,6 +129,7 @@ typedef enum
     NET_PACKET_TYPE_QUERY,
     NET_PACKET_TYPE_QUERY_RESPONSE,
     NET_PACKET_TYPE_LAUNCH,
+    NET_PACKET_TYPE_BUNDLE,     // [SVE] several packets in one datagram
 } net_packet_type_t;
 
 typedef enum
@@ -221,6 +223,12 @@ typedef struct
     unsigned int seq;
     boolean playeringame[NET_MAXPLAYERS];
     net_ticdiff_t cmds[NET_MAXPLAYERS];
+
+    // [SVE] New ticdup and extratics set by the server from this tic
+    // on, or zero if unchanged.
+
+    int ticdup;
+    int extratics;
 } net_full_ticcmd_t;
 
 // Data sent in response to server queries
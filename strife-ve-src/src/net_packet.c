@@ -202,6 +202,65 @@ char *NET_ReadString(net_packet_t *packet)
     return start;
 }
 
+// [SVE] Read an unsigned integer written by NET_WriteVarInt
+
+boolean NET_ReadVarInt(net_packet_t *packet, unsigned int *data)
+{
+    unsigned int b;
+    int shift;
+
+    *data = 0;
+    shift = 0;
+
+    do
+    {
+        if (shift > 28 || !NET_ReadInt8(packet, &b))
+            return false;
+
+        *data |= (b & 0x7f) << shift;
+        shift += 7;
+    } while (b & 0x80);
+
+    return true;
+}
+
+// [SVE] Read a signed integer written by NET_WriteSVarInt
+
+boolean NET_ReadSVarInt(net_packet_t *packet, signed int *data)
+{
+    unsigned int u;
+
+    if (!NET_ReadVarInt(packet, &u))
+        return false;
+
+    *data = (signed int) (u >> 1) ^ -(signed int) (u & 1);
+
+    return true;
+}
+
+// [SVE] Read a packet embedded in another by NET_WriteSubPacket.
+// Returns NULL at the end of the packet, or if the data is malformed.
+
+net_packet_t *NET_ReadSubPacket(net_packet_t *packet)
+{
+    net_packet_t *result;
+    unsigned int len;
+
+    if (!NET_ReadVarInt(packet, &len)
+     || len == 0 || packet->pos + len > packet->len)
+    {
+        return NULL;
+    }
+
+    result = NET_NewPacket(len);
+    memcpy(result->data, packet->data + packet->pos, len);
+    result->len = len;
+
+    packet->pos += len;
+
+    return result;
+}
+
 // Dynamically increases the size of a packet
 
 static void NET_IncreasePacket(net_packet_t *packet)
@@ -291,6 +350,40 @@ void NET_WriteString(net_packet_t *packet, char *string)
     packet->len += string_size;
 }
 
+// [SVE] Write an unsigned integer in as few bytes as it needs: seven
+// bits to a byte, with the top bit set on all but the last.
+
+void NET_WriteVarInt(net_packet_t *packet, unsigned int i)
+{
+    while (i >= 0x80)
+    {
+        NET_WriteInt8(packet, (i & 0x7f) | 0x80);
+        i >>= 7;
+    }
+
+    NET_WriteInt8(packet, i);
+}
 
+// [SVE] Write a signed integer as a variable length value.  The sign is
+// moved to the bottom bit so that small negative numbers are short too.
 
+void NET_WriteSVarInt(net_packet_t *packet, signed int i)
+{
+    NET_WriteVarInt(packet, ((unsigned int) i << 1) ^ (unsigned int) (i >> 31));
+}
+
+// [SVE] Embed a complete packet within another, prefixed by its length
+
+void NET_WriteSubPacket(net_packet_t *packet, net_packet_t *sub)
+{
+    NET_WriteVarInt(packet, sub->len);
+
+    while (packet->len + sub->len > packet->alloced)
+    {
+        NET_IncreasePacket(packet);
+    }
+
+    memcpy(packet->data + packet->len, sub->data, sub->len);
+    packet->len += sub->len;
+}
 
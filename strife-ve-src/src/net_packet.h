@@ -34,11 +34,19 @@ boolean NET_ReadSInt32(net_packet_t *packet, signed int *data);
 
 char *NET_ReadString(net_packet_t *packet);
 
+boolean NET_ReadVarInt(net_packet_t *packet, unsigned int *data);
+boolean NET_ReadSVarInt(net_packet_t *packet, signed int *data);
+net_packet_t *NET_ReadSubPacket(net_packet_t *packet);
+
 void NET_WriteInt8(net_packet_t *packet, unsigned int i);
 void NET_WriteInt16(net_packet_t *packet, unsigned int i);
 void NET_WriteInt32(net_packet_t *packet, unsigned int i);
 
 void NET_WriteString(net_packet_t *packet, char *string);
 
+void NET_WriteVarInt(net_packet_t *packet, unsigned int i);
+void NET_WriteSVarInt(net_packet_t *packet, signed int i);
+void NET_WriteSubPacket(net_packet_t *packet, net_packet_t *sub);
+
 #endif /* #ifndef NET_PACKET_H */
 
@@ -356,6 +356,35 @@ net_addr_t *NET_SDL_ResolveAddress(char *address)
     }
 }
 
+// Wait up to ms milliseconds for a packet to arrive, so a server can
+// sleep until it has something to do.  Returns false if there is no
+// socket to wait on.
+
+boolean NET_SDL_WaitForPackets(int ms)
+{
+    static SDLNet_SocketSet socketset = NULL;
+
+    if (!initted || udpsocket == NULL)
+    {
+        return false;
+    }
+
+    if (socketset == NULL)
+    {
+        socketset = SDLNet_AllocSocketSet(1);
+
+        if (socketset == NULL
+         || SDLNet_UDP_AddSocket(socketset, udpsocket) < 0)
+        {
+            return false;
+        }
+    }
+
+    SDLNet_CheckSockets(socketset, ms);
+
+    return true;
+}
+
 // Complete module
 
 net_module_t net_sdl_module =
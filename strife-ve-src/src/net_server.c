@@ -38,6 +38,7 @@
 #include "net_server.h"
 #include "net_sdl.h"
 #include "net_structrw.h"
+#include "z_zone.h"
 
 // How often to refresh our registration with the master server.
 
@@ -123,6 +124,25 @@ typedef struct
 
     int player_class;
 
+    // [SVE] Tics sent with each new one, in both directions, and
+    // whether the client still needs to be told of a change.
+
+    int extratics;
+    boolean extratics_changed;
+
+    // [SVE] Arrival of new tics from the client: the last one and
+    // when it came, and the smoothed jitter in 1/16 ms.
+
+    int arrival_tic;
+    unsigned int arrival_time;
+    int jitter;
+
+    // [SVE] New tics received, and tics that had to be asked for
+    // again, since the settings were last adjusted.
+
+    int tics_received;
+    int tics_resent;
+
 } net_client_t;
 
 // structure used for the recv window
@@ -146,14 +166,61 @@ typedef struct
     net_ticdiff_t diff;
 } net_client_recv_t;
 
-static net_server_state_t server_state;
+// A game hosted by the server, with its own clients and receive
+// window.  A dedicated server can run many of these at once over the
+// same socket.
+
+typedef struct net_session_s net_session_t;
+
+struct net_session_s
+{
+    net_server_state_t state;
+    net_client_t clients[MAXNETNODES];
+    net_client_t *players[NET_MAXPLAYERS];
+    unsigned int gamemode;
+    unsigned int gamemission;
+    net_gamesettings_t settings;
+
+    // receive window
+
+    unsigned int recvwindow_start;
+    net_client_recv_t recvwindow[BACKUPTICS][NET_MAXPLAYERS];
+
+    // [SVE] ticdup in effect, and a change to it taking effect from
+    // ticdup_tic on, if ticdup_tic is not -1.
+
+    int ticdup;
+    int next_ticdup;
+    int ticdup_tic;
+
+    // [SVE] When the settings were last adjusted, and for how many
+    // adjustments in a row the jitter has been asking for a change
+    // of ticdup (positive for up, negative for down).
+
+    unsigned int adjust_time;
+    int ticdup_trend;
+
+    net_session_t *next;
+};
+
 static boolean server_initialized = false;
-static net_client_t clients[MAXNETNODES];
-static net_client_t *sv_players[NET_MAXPLAYERS];
 static net_context_t *server_context;
-static unsigned int sv_gamemode;
-static unsigned int sv_gamemission;
-static net_gamesettings_t sv_settings;
+
+// All sessions, and the one currently being serviced.
+
+static net_session_t *sessions = NULL;
+static int num_sessions = 0;
+static net_session_t *session = NULL;
+
+// Maximum number of sessions to host at once.
+
+static int max_sessions = 1;
+
+// [SVE] Highest ticdup the server may switch a game to when players'
+// tics arrive unevenly.  If no higher than the ticdup the game was
+// started with, ticdup is never changed.
+
+static int max_ticdup = 0;
 
 // For registration with master server:
 
@@ -161,12 +228,8 @@ static net_addr_t *master_server = NULL;
 static unsigned int master_refresh_time;
 static unsigned int master_resolve_time;
 
-// receive window
-
-static unsigned int recvwindow_start;
-static net_client_recv_t recvwindow[BACKUPTICS][NET_MAXPLAYERS];
 
-#define NET_SV_ExpandTicNum(b) NET_ExpandTicNum(recvwindow_start, (b))
+#define NET_SV_ExpandTicNum(b) NET_ExpandTicNum(session->recvwindow_start, (b))
 
 static void NET_SV_DisconnectClient(net_client_t *client)
 {
@@ -217,9 +280,9 @@ static void NET_SV_BroadcastMessage(char *s, ...)
     
     for (i=0; i<MAXNETNODES; ++i)
     {
-        if (ClientConnected(&clients[i]))
+        if (ClientConnected(&session->clients[i]))
         {
-            NET_SV_SendConsoleMessage(&clients[i], buf);
+            NET_SV_SendConsoleMessage(&session->clients[i], buf);
         }
     }
 
@@ -238,24 +301,24 @@ static void NET_SV_AssignPlayers(void)
 
     for (i=0; i<MAXNETNODES; ++i)
     {
-        if (ClientConnected(&clients[i]))
+        if (ClientConnected(&session->clients[i]))
         {
-            if (!clients[i].drone)
+            if (!session->clients[i].drone && pl < NET_MAXPLAYERS)
             {
-                sv_players[pl] = &clients[i];
-                sv_players[pl]->player_number = pl;
+                session->players[pl] = &session->clients[i];
+                session->players[pl]->player_number = pl;
                 ++pl;
             }
             else
             {
-                clients[i].player_number = -1;
+                session->clients[i].player_number = -1;
             }
         }
     }
 
     for (; pl<NET_MAXPLAYERS; ++pl)
     {
-        sv_players[pl] = NULL;
+        session->players[pl] = NULL;
     }
 }
 
@@ -270,7 +333,7 @@ static int NET_SV_NumPlayers(void)
 
     for (i=0; i<NET_MAXPLAYERS; ++i)
     {
-        if (sv_players[i] != NULL && ClientConnected(sv_players[i]))
+        if (session->players[i] != NULL && ClientConnected(session->players[i]))
         {
             result += 1;
         }
@@ -288,8 +351,8 @@ static int NET_SV_NumReadyPlayers(void)
 
     for (i = 0; i < MAXNETNODES; ++i)
     {
-        if (ClientConnected(&clients[i])
-         && !clients[i].drone && clients[i].ready)
+        if (ClientConnected(&session->clients[i])
+         && !session->clients[i].drone && session->clients[i].ready)
         {
             ++result;
         }
@@ -306,9 +369,9 @@ static int NET_SV_MaxPlayers(void)
 
     for (i = 0; i < MAXNETNODES; ++i)
     {
-        if (ClientConnected(&clients[i]))
+        if (ClientConnected(&session->clients[i]))
         {
-            return clients[i].max_players;
+            return session->clients[i].max_players;
         }
     }
 
@@ -326,7 +389,7 @@ static int NET_SV_NumDrones(void)
 
     for (i=0; i<MAXNETNODES; ++i)
     {
-        if (ClientConnected(&clients[i]) && clients[i].drone)
+        if (ClientConnected(&session->clients[i]) && session->clients[i].drone)
         {
             result += 1;
         }
@@ -335,6 +398,30 @@ static int NET_SV_NumDrones(void)
     return result;
 }
 
+// [SVE] Returns the number of players connected or still completing
+// the connection handshake, so that a burst of clients connecting at
+// once cannot overfill the game.
+
+static int NET_SV_NumJoiningPlayers(void)
+{
+    int i;
+    int result;
+
+    result = 0;
+
+    for (i=0; i<MAXNETNODES; ++i)
+    {
+        if (session->clients[i].active && !session->clients[i].drone
+         && (session->clients[i].connection.state == NET_CONN_STATE_CONNECTED
+          || session->clients[i].connection.state == NET_CONN_STATE_WAITING_ACK))
+        {
+            ++result;
+        }
+    }
+
+    return result;
+}
+
 // returns the number of clients connected
 
 static int NET_SV_NumClients(void)
@@ -346,7 +433,7 @@ static int NET_SV_NumClients(void)
 
     for (i=0; i<MAXNETNODES; ++i)
     {
-        if (ClientConnected(&clients[i]))
+        if (ClientConnected(&session->clients[i]))
         {
             ++count;
         }
@@ -370,14 +457,14 @@ static net_client_t *NET_SV_Controller(void)
     {
         // Can't be controller?
 
-        if (!ClientConnected(&clients[i]) || clients[i].drone)
+        if (!ClientConnected(&session->clients[i]) || session->clients[i].drone)
         {
             continue;
         }
 
-        if (best == NULL || clients[i].connect_time < best->connect_time)
+        if (best == NULL || session->clients[i].connect_time < best->connect_time)
         {
-            best = &clients[i];
+            best = &session->clients[i];
         }
     }
 
@@ -422,10 +509,10 @@ static void NET_SV_SendWaitingData(net_client_t *client)
     for (i = 0; i < wait_data.num_players; ++i)
     {
         M_StringCopy(wait_data.player_names[i],
-                     sv_players[i]->name,
+                     session->players[i]->name,
                      MAXPLAYERNAME);
         M_StringCopy(wait_data.player_addrs[i],
-                     NET_AddrToString(sv_players[i]->addr),
+                     NET_AddrToString(session->players[i]->addr),
                      MAXPLAYERNAME);
     }
 
@@ -451,11 +538,11 @@ static unsigned int NET_SV_LatestAcknowledged(void)
 
     for (i=0; i<MAXNETNODES; ++i) 
     {
-        if (ClientConnected(&clients[i]))
+        if (ClientConnected(&session->clients[i]))
         {
-            if (clients[i].acknowledged < lowtic)
+            if (session->clients[i].acknowledged < lowtic)
             {
-                lowtic = clients[i].acknowledged;
+                lowtic = session->clients[i].acknowledged;
             }
         }
     }
@@ -481,7 +568,7 @@ static void NET_SV_AdvanceWindow(void)
 
     // Advance the recv window until it catches up with lowtic
 
-    while (recvwindow_start < lowtic)
+    while (session->recvwindow_start < lowtic)
     {    
         boolean should_advance;
 
@@ -492,12 +579,12 @@ static void NET_SV_AdvanceWindow(void)
 
         for (i=0; i<NET_MAXPLAYERS; ++i)
         {
-            if (sv_players[i] == NULL || !ClientConnected(sv_players[i]))
+            if (session->players[i] == NULL || !ClientConnected(session->players[i]))
             {
                 continue;
             }
 
-            if (!recvwindow[0][i].active)
+            if (!session->recvwindow[0][i].active)
             {
                 should_advance = false;
                 break;
@@ -515,33 +602,138 @@ static void NET_SV_AdvanceWindow(void)
         
         // Advance the window
 
-        memcpy(recvwindow, recvwindow + 1, sizeof(*recvwindow) * (BACKUPTICS - 1));
-        memset(&recvwindow[BACKUPTICS-1], 0, sizeof(*recvwindow));
-        ++recvwindow_start;
+        memmove(session->recvwindow, session->recvwindow + 1, sizeof(*session->recvwindow) * (BACKUPTICS - 1));
+        memset(&session->recvwindow[BACKUPTICS-1], 0, sizeof(*session->recvwindow));
+        ++session->recvwindow_start;
 
-        //printf("SV: advanced to %i\n", recvwindow_start);
+        //printf("SV: advanced to %i\n", session->recvwindow_start);
     }
 }
 
-// Given an address, find the corresponding client
+// Given an address, find the corresponding client, and the session
+// it belongs to
 
-static net_client_t *NET_SV_FindClient(net_addr_t *addr)
+static net_client_t *NET_SV_FindClient(net_addr_t *addr,
+                                       net_session_t **client_session)
 {
+    net_session_t *s;
     int i;
 
-    for (i=0; i<MAXNETNODES; ++i) 
+    for (s = sessions; s != NULL; s = s->next)
     {
-        if (clients[i].active && clients[i].addr == addr)
+        for (i=0; i<MAXNETNODES; ++i)
         {
-            // found the client
+            if (s->clients[i].active && s->clients[i].addr == addr)
+            {
+                // found the client
 
-            return &clients[i];
+                if (client_session != NULL)
+                {
+                    *client_session = s;
+                }
+
+                return &s->clients[i];
+            }
         }
     }
 
     return NULL;
 }
 
+// Add a new, empty session to the end of the list
+
+static net_session_t *NET_SV_NewSession(void)
+{
+    net_session_t *s;
+    net_session_t **link;
+
+    s = Z_Malloc(sizeof(net_session_t), PU_STATIC, 0);
+    memset(s, 0, sizeof(net_session_t));
+
+    s->state = SERVER_WAITING_LAUNCH;
+    s->gamemode = indetermined;
+    s->next = NULL;
+
+    for (link = &sessions; *link != NULL; link = &(*link)->next);
+
+    *link = s;
+    ++num_sessions;
+
+    return s;
+}
+
+// Find the session a new client should join: the oldest one still
+// waiting for players that has room.  If there is none, a new session
+// is started if allowed.  Returns the first session if nothing better
+// is found, which will turn the client away.
+
+static net_session_t *NET_SV_LobbySession(boolean create)
+{
+    net_session_t *s;
+
+    for (s = sessions; s != NULL; s = s->next)
+    {
+        if (s->state != SERVER_WAITING_LAUNCH)
+        {
+            continue;
+        }
+
+        // Player numbers only change before the game starts; doing it
+        // in a running game would hand ticcmds to the wrong players.
+
+        session = s;
+        NET_SV_AssignPlayers();
+
+        if (NET_SV_NumJoiningPlayers() < NET_SV_MaxPlayers()
+         && NET_SV_NumClients() < MAXNETNODES)
+        {
+            return s;
+        }
+    }
+
+    if (create && num_sessions < max_sessions)
+    {
+        return NET_SV_NewSession();
+    }
+
+    return sessions;
+}
+
+// Free sessions nobody is connected to any more, keeping at least one
+// so that there is always somewhere to join.
+
+static void NET_SV_FreeIdleSessions(void)
+{
+    net_session_t **link;
+    net_session_t *s;
+    int i;
+
+    link = &sessions;
+
+    while (*link != NULL && num_sessions > 1)
+    {
+        s = *link;
+
+        for (i=0; i<MAXNETNODES; ++i)
+        {
+            if (s->clients[i].active)
+            {
+                break;
+            }
+        }
+
+        if (i < MAXNETNODES)
+        {
+            link = &s->next;
+            continue;
+        }
+
+        *link = s->next;
+        --num_sessions;
+        Z_Free(s);
+    }
+}
+
 // send a rejection packet to a client
 
 static void NET_SV_SendReject(net_addr_t *addr, char *msg)
@@ -665,7 +857,7 @@ static void NET_SV_ParseSYN(net_packet_t *packet,
 
     // not accepting new connections?
 
-    if (server_state != SERVER_WAITING_LAUNCH)
+    if (session->state != SERVER_WAITING_LAUNCH)
     {
         NET_SV_SendReject(addr, "Server is not currently accepting connections");
         return;
@@ -679,9 +871,9 @@ static void NET_SV_ParseSYN(net_packet_t *packet,
 
         for (i=0; i<MAXNETNODES; ++i)
         {
-            if (!clients[i].active)
+            if (!session->clients[i].active)
             {
-                client = &clients[i];
+                client = &session->clients[i];
                 break;
             }
         }
@@ -714,7 +906,7 @@ static void NET_SV_ParseSYN(net_packet_t *packet,
         NET_SV_AssignPlayers();
         num_players = NET_SV_NumPlayers();
 
-        if ((!data.drone && num_players >= NET_SV_MaxPlayers())
+        if ((!data.drone && NET_SV_NumJoiningPlayers() >= NET_SV_MaxPlayers())
          || NET_SV_NumClients() >= MAXNETNODES)
         {
             NET_SV_SendReject(addr, "Server is full!");
@@ -729,8 +921,8 @@ static void NET_SV_ParseSYN(net_packet_t *packet,
 
         if (num_players == 0 && !data.drone)
         {
-            sv_gamemode = data.gamemode;
-            sv_gamemission = data.gamemission;
+            session->gamemode = data.gamemode;
+            session->gamemission = data.gamemission;
         }
 
         // Save the SHA1 checksums
@@ -743,7 +935,7 @@ static void NET_SV_ParseSYN(net_packet_t *packet,
         // Check the connecting client is playing the same game as all
         // the other clients
 
-        if (data.gamemode != sv_gamemode || data.gamemission != sv_gamemission)
+        if (data.gamemode != session->gamemode || data.gamemission != session->gamemission)
         {
             NET_SV_SendReject(addr, "You are playing the wrong game!");
             return;
@@ -783,7 +975,7 @@ static void NET_SV_ParseLaunch(net_packet_t *packet, net_client_t *client)
 
     // Can only launch when we are in the waiting state.
 
-    if (server_state != SERVER_WAITING_LAUNCH)
+    if (session->state != SERVER_WAITING_LAUNCH)
     {
         return;
     }
@@ -795,17 +987,17 @@ static void NET_SV_ParseLaunch(net_packet_t *packet, net_client_t *client)
 
     for (i=0; i<MAXNETNODES; ++i)
     {
-        if (!ClientConnected(&clients[i]))
+        if (!ClientConnected(&session->clients[i]))
             continue;
 
-        launchpacket = NET_Conn_NewReliable(&clients[i].connection,
+        launchpacket = NET_Conn_NewReliable(&session->clients[i].connection,
                                             NET_PACKET_TYPE_LAUNCH);
         NET_WriteInt8(launchpacket, num_players);
     }
 
     // Now in launch state.
 
-    server_state = SERVER_WAITING_START;
+    session->state = SERVER_WAITING_START;
 }
 
 // Transition to the in-game state and send all players the start game
@@ -824,29 +1016,29 @@ static void StartGame(void)
 
     // Check if anyone is recording a demo and set lowres_turn if so.
 
-    sv_settings.lowres_turn = false;
+    session->settings.lowres_turn = false;
 
     for (i = 0; i < NET_MAXPLAYERS; ++i)
     {
-        if (sv_players[i] != NULL && sv_players[i]->recording_lowres)
+        if (session->players[i] != NULL && session->players[i]->recording_lowres)
         {
-            sv_settings.lowres_turn = true;
+            session->settings.lowres_turn = true;
         }
     }
 
-    sv_settings.num_players = NET_SV_NumPlayers();
+    session->settings.num_players = NET_SV_NumPlayers();
 
     // Copy player classes:
 
     for (i = 0; i < NET_MAXPLAYERS; ++i)
     {
-        if (sv_players[i] != NULL)
+        if (session->players[i] != NULL)
         {
-            sv_settings.player_classes[i] = sv_players[i]->player_class;
+            session->settings.player_classes[i] = session->players[i]->player_class;
         }
         else
         {
-            sv_settings.player_classes[i] = 0;
+            session->settings.player_classes[i] = 0;
         }
     }
 
@@ -856,25 +1048,36 @@ static void StartGame(void)
 
     for (i = 0; i < MAXNETNODES; ++i)
     {
-        if (!ClientConnected(&clients[i]))
+        if (!ClientConnected(&session->clients[i]))
             continue;
 
-        clients[i].last_gamedata_time = nowtime;
+        session->clients[i].last_gamedata_time = nowtime;
+        session->clients[i].extratics = session->settings.extratics;
+        session->clients[i].extratics_changed = false;
+        session->clients[i].arrival_tic = -1;
+        session->clients[i].jitter = 0;
+        session->clients[i].tics_received = 0;
+        session->clients[i].tics_resent = 0;
 
-        startpacket = NET_Conn_NewReliable(&clients[i].connection,
+        startpacket = NET_Conn_NewReliable(&session->clients[i].connection,
                                            NET_PACKET_TYPE_GAMESTART);
 
-        sv_settings.consoleplayer = clients[i].player_number;
+        session->settings.consoleplayer = session->clients[i].player_number;
 
-        NET_WriteSettings(startpacket, &sv_settings);
+        NET_WriteSettings(startpacket, &session->settings);
     }
 
     // Change server state
 
-    server_state = SERVER_IN_GAME;
+    session->state = SERVER_IN_GAME;
 
-    memset(recvwindow, 0, sizeof(recvwindow));
-    recvwindow_start = 0;
+    memset(session->recvwindow, 0, sizeof(session->recvwindow));
+    session->recvwindow_start = 0;
+
+    session->ticdup = session->settings.ticdup;
+    session->ticdup_tic = -1;
+    session->adjust_time = nowtime;
+    session->ticdup_trend = 0;
 }
 
 // Returns true when all nodes have indicated readiness to start the game.
@@ -885,7 +1088,7 @@ static boolean AllNodesReady(void)
 
     for (i = 0; i < MAXNETNODES; ++i)
     {
-        if (ClientConnected(&clients[i]) && !clients[i].ready)
+        if (ClientConnected(&session->clients[i]) && !session->clients[i].ready)
         {
             return false;
         }
@@ -913,9 +1116,9 @@ static void SendAllWaitingData(void)
 
     for (i = 0; i < MAXNETNODES; ++i)
     {
-        if (ClientConnected(&clients[i]) && clients[i].ready)
+        if (ClientConnected(&session->clients[i]) && session->clients[i].ready)
         {
-            NET_SV_SendWaitingData(&clients[i]);
+            NET_SV_SendWaitingData(&session->clients[i]);
         }
     }
 }
@@ -928,7 +1131,7 @@ static void NET_SV_ParseGameStart(net_packet_t *packet, net_client_t *client)
 
     // Can only start a game if we are in the waiting start state.
 
-    if (server_state != SERVER_WAITING_START)
+    if (session->state != SERVER_WAITING_START)
     {
         return;
     }
@@ -944,12 +1147,12 @@ static void NET_SV_ParseGameStart(net_packet_t *packet, net_client_t *client)
 
         // Check the game settings are valid
 
-        if (!NET_ValidGameSettings(sv_gamemode, sv_gamemission, &settings))
+        if (!NET_ValidGameSettings(session->gamemode, session->gamemission, &settings))
         {
             return;
         }
 
-        sv_settings = settings;
+        session->settings = settings;
     }
 
     client->ready = true;
@@ -975,13 +1178,15 @@ static void NET_SV_SendResendRequest(net_client_t *client, int start, int end)
 
     //printf("SV: send resend for %i-%i\n", start, end);
 
+    client->tics_resent += end - start + 1;
+
     packet = NET_NewPacket(20);
 
     NET_WriteInt16(packet, NET_PACKET_TYPE_GAMEDATA_RESEND);
     NET_WriteInt32(packet, start);
     NET_WriteInt8(packet, end - start + 1);
 
-    NET_Conn_SendPacket(&client->connection, packet);
+    NET_Conn_QueuePacket(&client->connection, packet);
     NET_FreePacket(packet);
 
     // Store the time we send the resend request
@@ -990,7 +1195,7 @@ static void NET_SV_SendResendRequest(net_client_t *client, int start, int end)
 
     for (i=start; i<=end; ++i)
     {
-        index = i - recvwindow_start;
+        index = i - session->recvwindow_start;
 
         if (index >= BACKUPTICS)
         {
@@ -999,7 +1204,7 @@ static void NET_SV_SendResendRequest(net_client_t *client, int start, int end)
             continue;
         }
         
-        recvobj = &recvwindow[index][client->player_number];
+        recvobj = &session->recvwindow[index][client->player_number];
 
         recvobj->resend_time = nowtime;
     }
@@ -1025,7 +1230,7 @@ static void NET_SV_CheckResends(net_client_t *client)
         net_client_recv_t *recvobj;
         boolean need_resend;
 
-        recvobj = &recvwindow[i][player];
+        recvobj = &session->recvwindow[i][player];
 
         // if need_resend is true, this tic needs another retransmit
         // request (300ms timeout)
@@ -1053,8 +1258,8 @@ static void NET_SV_CheckResends(net_client_t *client)
 
                 //printf("SV: resend request timed out: %i-%i\n", resend_start, resend_end);
                 NET_SV_SendResendRequest(client, 
-                                         recvwindow_start + resend_start,
-                                         recvwindow_start + resend_end);
+                                         session->recvwindow_start + resend_start,
+                                         session->recvwindow_start + resend_end);
 
                 resend_start = -1;
             }
@@ -1064,13 +1269,42 @@ static void NET_SV_CheckResends(net_client_t *client)
     if (resend_start >= 0)
     {
         NET_SV_SendResendRequest(client, 
-                                 recvwindow_start + resend_start,
-                                 recvwindow_start + resend_end);
+                                 session->recvwindow_start + resend_start,
+                                 session->recvwindow_start + resend_end);
     }
 }
 
 // Process game data from a client
 
+// [SVE] Update the estimate of how unevenly tics are arriving from a
+// client: the smoothed difference between the time between new tics
+// and the time the game takes to run them, as in RFC 3550.
+
+static void NET_SV_TimeArrival(net_client_t *client, int tic,
+                               unsigned int nowtime)
+{
+    int expected;
+    int d;
+
+    if (client->arrival_tic >= 0)
+    {
+        expected = ((tic - client->arrival_tic) * session->ticdup * 1000)
+                 / TICRATE;
+        d = (int) (nowtime - client->arrival_time) - expected;
+
+        if (d < 0)
+        {
+            d = -d;
+        }
+
+        client->jitter += d - client->jitter / 16;
+        client->tics_received += tic - client->arrival_tic;
+    }
+
+    client->arrival_tic = tic;
+    client->arrival_time = nowtime;
+}
+
 static void NET_SV_ParseGameData(net_packet_t *packet, net_client_t *client)
 {
     net_client_recv_t *recvobj;
@@ -1078,12 +1312,14 @@ static void NET_SV_ParseGameData(net_packet_t *packet, net_client_t *client)
     unsigned int ackseq;
     unsigned int num_tics;
     unsigned int nowtime;
+    net_ticdiff_t diff, prevdiff;
+    signed int latency;
     size_t i;
     int player;
     int resend_start, resend_end;
     int index;
 
-    if (server_state != SERVER_IN_GAME)
+    if (session->state != SERVER_IN_GAME)
     {
         return;
     }
@@ -1100,7 +1336,8 @@ static void NET_SV_ParseGameData(net_packet_t *packet, net_client_t *client)
 
     if (!NET_ReadInt8(packet, &ackseq)
      || !NET_ReadInt8(packet, &seq)
-     || !NET_ReadInt8(packet, &num_tics))
+     || !NET_ReadInt8(packet, &num_tics)
+     || !NET_ReadSVarInt(packet, &latency))
     {
         return;
     }
@@ -1118,16 +1355,15 @@ static void NET_SV_ParseGameData(net_packet_t *packet, net_client_t *client)
 
     for (i=0; i<num_tics; ++i)
     {
-        net_ticdiff_t diff;
-        signed int latency;
-
-        if (!NET_ReadSInt16(packet, &latency)
-         || !NET_ReadTiccmdDiff(packet, &diff, sv_settings.lowres_turn))
+        if (!NET_ReadTiccmdDiff(packet, &diff, i > 0 ? &prevdiff : NULL,
+                                session->settings.lowres_turn))
         {
             return;
         }
 
-        index = seq + i - recvwindow_start;
+        prevdiff = diff;
+
+        index = seq + i - session->recvwindow_start;
 
         if (index < 0 || index >= BACKUPTICS)
         {
@@ -1136,7 +1372,7 @@ static void NET_SV_ParseGameData(net_packet_t *packet, net_client_t *client)
             continue;
         }
 
-        recvobj = &recvwindow[index][player];
+        recvobj = &session->recvwindow[index][player];
         recvobj->active = true;
         recvobj->diff = diff;
         recvobj->latency = latency;
@@ -1144,6 +1380,14 @@ static void NET_SV_ParseGameData(net_packet_t *packet, net_client_t *client)
         client->last_gamedata_time = nowtime;
     }
 
+    // [SVE] Time the arrival of the newest tic, if it is new.  Older
+    // tics in the packet are repeats or stragglers.
+
+    if (num_tics > 0 && (int) (seq + num_tics - 1) > client->arrival_tic)
+    {
+        NET_SV_TimeArrival(client, seq + num_tics - 1, nowtime);
+    }
+
     // Higher acknowledgement point?
 
     if (ackseq > client->acknowledged)
@@ -1157,7 +1401,7 @@ static void NET_SV_ParseGameData(net_packet_t *packet, net_client_t *client)
 
     //printf("SV: %p: %i\n", client, seq);
 
-    resend_end = seq - recvwindow_start;
+    resend_end = seq - session->recvwindow_start;
 
     if (resend_end <= 0)
         return;
@@ -1170,7 +1414,7 @@ static void NET_SV_ParseGameData(net_packet_t *packet, net_client_t *client)
     
     while (index >= 0)
     {
-        recvobj = &recvwindow[index][player];
+        recvobj = &session->recvwindow[index][player];
 
         if (recvobj->active)
         {
@@ -1196,13 +1440,13 @@ static void NET_SV_ParseGameData(net_packet_t *packet, net_client_t *client)
     {
             /*
         printf("missed %i-%i before %i, send resend\n",
-                        recvwindow_start + resend_start,
-                        recvwindow_start + resend_end - 1,
+                        session->recvwindow_start + resend_start,
+                        session->recvwindow_start + resend_end - 1,
                         seq);
                         */
         NET_SV_SendResendRequest(client, 
-                                 recvwindow_start + resend_start, 
-                                 recvwindow_start + resend_end - 1);
+                                 session->recvwindow_start + resend_start, 
+                                 session->recvwindow_start + resend_end - 1);
     }
 }
 
@@ -1210,7 +1454,7 @@ static void NET_SV_ParseGameDataACK(net_packet_t *packet, net_client_t *client)
 {
     unsigned int ackseq;
 
-    if (server_state != SERVER_IN_GAME)
+    if (session->state != SERVER_IN_GAME)
     {
         return;
     }
@@ -1262,14 +1506,17 @@ static void NET_SV_SendTics(net_client_t *client,
             I_Error("Wanted to send %i, but %i is in its place", i, cmd->seq);
         }
 
-        // Add command
-       
-        NET_WriteFullTiccmd(packet, cmd, sv_settings.lowres_turn);
+        // Add command, relative to the one before it
+
+        NET_WriteFullTiccmd(packet, cmd,
+                            i > start ? &client->sendqueue[(i - 1) % BACKUPTICS]
+                                      : NULL,
+                            session->settings.lowres_turn);
     }
     
-    // Send packet
+    // Queue packet
 
-    NET_Conn_SendPacket(&client->connection, packet);
+    NET_Conn_QueuePacket(&client->connection, packet);
     
     NET_FreePacket(packet);
 }
@@ -1332,7 +1579,7 @@ void NET_SV_SendQueryResponse(net_addr_t *addr)
 
     // Server state
 
-    querydata.server_state = server_state;
+    querydata.server_state = session->state;
 
     // Number of players/maximum players
 
@@ -1341,8 +1588,8 @@ void NET_SV_SendQueryResponse(net_addr_t *addr)
 
     // Game mode/mission
 
-    querydata.gamemode = sv_gamemode;
-    querydata.gamemission = sv_gamemission;
+    querydata.gamemode = session->gamemode;
+    querydata.gamemission = session->gamemission;
 
     //!
     // @arg <name>
@@ -1370,6 +1617,60 @@ void NET_SV_SendQueryResponse(net_addr_t *addr)
     NET_FreePacket(reply);
 }
 
+// Process a packet from a connected client
+
+static void NET_SV_ClientPacket(net_packet_t *packet, unsigned int packet_type,
+                                net_client_t *client)
+{
+    net_packet_t *sub;
+    unsigned int sub_type;
+
+    if (packet_type == NET_PACKET_TYPE_BUNDLE)
+    {
+        // [SVE] Several packets sent together
+
+        while ((sub = NET_ReadSubPacket(packet)) != NULL)
+        {
+            if (NET_ReadInt16(sub, &sub_type)
+             && sub_type != NET_PACKET_TYPE_BUNDLE)
+            {
+                NET_SV_ClientPacket(sub, sub_type, client);
+            }
+
+            NET_FreePacket(sub);
+        }
+    }
+    else if (NET_Conn_Packet(&client->connection, packet, &packet_type))
+    {
+        // Packet was eaten by the common connection code
+    }
+    else
+    {
+        switch (packet_type)
+        {
+            case NET_PACKET_TYPE_GAMESTART:
+                NET_SV_ParseGameStart(packet, client);
+                break;
+            case NET_PACKET_TYPE_LAUNCH:
+                NET_SV_ParseLaunch(packet, client);
+                break;
+            case NET_PACKET_TYPE_GAMEDATA:
+                NET_SV_ParseGameData(packet, client);
+                break;
+            case NET_PACKET_TYPE_GAMEDATA_ACK:
+                NET_SV_ParseGameDataACK(packet, client);
+                break;
+            case NET_PACKET_TYPE_GAMEDATA_RESEND:
+                NET_SV_ParseResendRequest(packet, client);
+                break;
+            default:
+                // unknown packet type
+
+                break;
+        }
+    }
+}
+
 // Process a packet received by the server
 
 static void NET_SV_Packet(net_packet_t *packet, net_addr_t *addr)
@@ -1385,9 +1686,10 @@ static void NET_SV_Packet(net_packet_t *packet, net_addr_t *addr)
         return;
     }
 
-    // Find which client this packet came from
+    // Find which client this packet came from.  Anyone else is
+    // dealt with by the session that new clients would join.
 
-    client = NET_SV_FindClient(addr);
+    client = NET_SV_FindClient(addr, &session);
 
     // Read the packet type
 
@@ -1398,6 +1700,11 @@ static void NET_SV_Packet(net_packet_t *packet, net_addr_t *addr)
         return;
     }
 
+    if (client == NULL)
+    {
+        session = NET_SV_LobbySession(packet_type == NET_PACKET_TYPE_SYN);
+    }
+
     if (packet_type == NET_PACKET_TYPE_SYN)
     {
         NET_SV_ParseSYN(packet, client, addr);
@@ -1410,42 +1717,17 @@ static void NET_SV_Packet(net_packet_t *packet, net_addr_t *addr)
     {
         // Must come from a valid client; ignore otherwise
     }
-    else if (NET_Conn_Packet(&client->connection, packet, &packet_type))
-    {
-        // Packet was eaten by the common connection code
-    }
     else
     {
         //printf("SV: %s: %i\n", NET_AddrToString(addr), packet_type);
 
-        switch (packet_type)
-        {
-            case NET_PACKET_TYPE_GAMESTART:
-                NET_SV_ParseGameStart(packet, client);
-                break;
-            case NET_PACKET_TYPE_LAUNCH:
-                NET_SV_ParseLaunch(packet, client);
-                break;
-            case NET_PACKET_TYPE_GAMEDATA:
-                NET_SV_ParseGameData(packet, client);
-                break;
-            case NET_PACKET_TYPE_GAMEDATA_ACK:
-                NET_SV_ParseGameDataACK(packet, client);
-                break;
-            case NET_PACKET_TYPE_GAMEDATA_RESEND:
-                NET_SV_ParseResendRequest(packet, client);
-                break;
-            default:
-                // unknown packet type
-
-                break;
-        }
+        NET_SV_ClientPacket(packet, packet_type, client);
     }
 
     // If this address is not in the list of clients, be sure to
     // free it back.
 
-    if (NET_SV_FindClient(addr) == NULL)
+    if (NET_SV_FindClient(addr, NULL) == NULL)
     {
         NET_FreeAddress(addr);
     }
@@ -1470,7 +1752,7 @@ static void NET_SV_PumpSendQueue(net_client_t *client)
     
     // Work out the index into the receive window
    
-    recv_index = client->sendseq - recvwindow_start;
+    recv_index = client->sendseq - session->recvwindow_start;
 
     if (recv_index < 0 || recv_index >= BACKUPTICS)
     {
@@ -1478,25 +1760,25 @@ static void NET_SV_PumpSendQueue(net_client_t *client)
     }
 
     // Check if we can generate a new entry for the send queue
-    // using the data in recvwindow.
+    // using the data in session->recvwindow.
 
     num_players = 0;
 
     for (i=0; i<NET_MAXPLAYERS; ++i)
     {
-        if (sv_players[i] == client)
+        if (session->players[i] == client)
         {
             // Client does not rely on itself for data
 
             continue;
         }
 
-        if (sv_players[i] == NULL || !ClientConnected(sv_players[i]))
+        if (session->players[i] == NULL || !ClientConnected(session->players[i]))
         {
             continue;
         }
 
-        if (!recvwindow[recv_index][i].active)
+        if (!session->recvwindow[recv_index][i].active)
         {
             // We do not have this player's ticcmd, so we cannot
             // generate a complete command yet.
@@ -1513,7 +1795,7 @@ static void NET_SV_PumpSendQueue(net_client_t *client)
     // and never stopping. Don't let the server get too far ahead
     // of the client.
 
-    if (num_players == 0 && client->sendseq > recvwindow_start + 10)
+    if (num_players == 0 && client->sendseq > session->recvwindow_start + 10)
     {
         return;
     }
@@ -1524,6 +1806,23 @@ static void NET_SV_PumpSendQueue(net_client_t *client)
     
     cmd.seq = client->sendseq;
 
+    // [SVE] Pass on any change of settings.  A change of ticdup must
+    // reach every client at the same tic.
+
+    cmd.ticdup = 0;
+    cmd.extratics = 0;
+
+    if (session->ticdup_tic >= 0 && client->sendseq == session->ticdup_tic)
+    {
+        cmd.ticdup = session->next_ticdup;
+    }
+
+    if (client->extratics_changed)
+    {
+        cmd.extratics = client->extratics;
+        client->extratics_changed = false;
+    }
+
     // Add ticcmds from all players
 
     cmd.latency = 0;
@@ -1532,7 +1831,7 @@ static void NET_SV_PumpSendQueue(net_client_t *client)
     {
         net_client_recv_t *recvobj;
 
-        if (sv_players[i] == client)
+        if (session->players[i] == client)
         {
             // Not the player we are sending to
 
@@ -1540,7 +1839,7 @@ static void NET_SV_PumpSendQueue(net_client_t *client)
             continue;
         }
         
-        if (sv_players[i] == NULL || !recvwindow[recv_index][i].active)
+        if (session->players[i] == NULL || !session->recvwindow[recv_index][i].active)
         {
             cmd.playeringame[i] = false;
             continue;
@@ -1548,7 +1847,7 @@ static void NET_SV_PumpSendQueue(net_client_t *client)
 
         cmd.playeringame[i] = true;
 
-        recvobj = &recvwindow[recv_index][i];
+        recvobj = &session->recvwindow[recv_index][i];
 
         cmd.cmds[i] = recvobj->diff;
 
@@ -1564,7 +1863,7 @@ static void NET_SV_PumpSendQueue(net_client_t *client)
 
     // Transmit the new tic to the client
 
-    starttic = client->sendseq - sv_settings.extratics;
+    starttic = client->sendseq - client->extratics;
     endtic = client->sendseq;
 
     if (starttic < 0)
@@ -1605,15 +1904,15 @@ void NET_SV_CheckDeadlock(net_client_t *client)
 
         for (i=0; i<BACKUPTICS; ++i)
         {
-            if (!recvwindow[client->player_number][i].active)
+            if (!session->recvwindow[client->player_number][i].active)
             {
                 //printf("Possible deadlock: Sending resend request\n");
 
                 // Found a tic we haven't received.  Send a resend request.
 
                 NET_SV_SendResendRequest(client,
-                                         recvwindow_start + i,
-                                         recvwindow_start + i + 5);
+                                         session->recvwindow_start + i,
+                                         session->recvwindow_start + i + 5);
 
                 client->last_gamedata_time = nowtime;
                 break;
@@ -1629,14 +1928,14 @@ static void NET_SV_GameEnded(void)
 {
     int i;
 
-    server_state = SERVER_WAITING_LAUNCH;
-    sv_gamemode = indetermined;
+    session->state = SERVER_WAITING_LAUNCH;
+    session->gamemode = indetermined;
 
     for (i=0; i<MAXNETNODES; ++i)
     {
-        if (clients[i].active)
+        if (session->clients[i].active)
         {
-            NET_SV_DisconnectClient(&clients[i]);
+            NET_SV_DisconnectClient(&session->clients[i]);
         }
     }
 }
@@ -1665,7 +1964,7 @@ static void NET_SV_RunClient(net_client_t *client)
         // If we were about to start a game, any player disconnecting
         // should cause an abort.
 
-        if (server_state == SERVER_WAITING_START && !client->drone)
+        if (session->state == SERVER_WAITING_START && !client->drone)
         {
             NET_SV_BroadcastMessage("Game startup aborted because "
                                     "player '%s' disconnected.",
@@ -1676,6 +1975,12 @@ static void NET_SV_RunClient(net_client_t *client)
         free(client->name);
         NET_FreeAddress(client->addr);
 
+        if (client->connection.bundle != NULL)
+        {
+            NET_FreePacket(client->connection.bundle);
+            client->connection.bundle = NULL;
+        }
+
         // Are there any clients left connected?  If not, return the
         // server to the waiting-for-players state.
         //
@@ -1694,7 +1999,7 @@ static void NET_SV_RunClient(net_client_t *client)
         return;
     }
 
-    if (server_state == SERVER_WAITING_LAUNCH)
+    if (session->state == SERVER_WAITING_LAUNCH)
     {
         // Waiting for the game to start
 
@@ -1708,7 +2013,7 @@ static void NET_SV_RunClient(net_client_t *client)
         }
     }
 
-    if (server_state == SERVER_IN_GAME)
+    if (session->state == SERVER_IN_GAME)
     {
         NET_SV_PumpSendQueue(client);
         NET_SV_CheckDeadlock(client);
@@ -1727,26 +2032,43 @@ void NET_SV_AddModule(net_module_t *module)
 
 void NET_SV_Init(void)
 {
-    int i;
+    int p;
 
     // initialize send/receive context
 
     server_context = NET_NewContext();
 
-    // no clients yet
-   
-    for (i=0; i<MAXNETNODES; ++i) 
+    //!
+    // @category net
+    // @arg <n>
+    //
+    // Allow the server to raise ticdup as high as <n> during a game
+    // when players' tics are arriving too unevenly, lowering it again
+    // when they settle.  By default ticdup is never changed.
+    //
+
+    p = M_CheckParmWithArgs("-maxticdup", 1);
+
+    if (p > 0)
     {
-        clients[i].active = false;
+        max_ticdup = atoi(myargv[p + 1]);
     }
 
+    // no clients yet
+
+    session = NET_SV_NewSession();
     NET_SV_AssignPlayers();
 
-    server_state = SERVER_WAITING_LAUNCH;
-    sv_gamemode = indetermined;
     server_initialized = true;
 }
 
+// Set the number of sessions the server may host at once
+
+void NET_SV_SetMaxSessions(int n)
+{
+    max_sessions = n < 1 ? 1 : n;
+}
+
 static void UpdateMasterServer(void)
 {
     unsigned int now;
@@ -1810,43 +2132,169 @@ void NET_SV_RegisterWithMaster(void)
     }
 }
 
-// Run server code to check for new packets/send packets as the server
-// requires
+// Run a session: "run" any clients that may have things to do,
+// independent of responses to received packets
 
-void NET_SV_Run(void)
+// [SVE] Adapt the game to the players' connections.  Players who have
+// been losing tics send and receive more copies of each one, so that a
+// lost packet is made up by the next instead of waiting on a resend;
+// and if allowed, ticdup is raised while any player's tics arrive too
+// unevenly for the clients' jitter buffers, and lowered again once
+// things settle.
+
+#define ADJUST_INTERVAL 2000
+#define MAX_EXTRATICS 3
+
+static void NET_SV_AdjustSettings(void)
 {
-    net_addr_t *addr;
-    net_packet_t *packet;
+    net_client_t *client;
+    unsigned int nowtime;
+    int extratics;
+    int worst_jitter;
+    int period, lower_period;
+    int loss;
     int i;
 
-    if (!server_initialized)
+    nowtime = I_GetTimeMS();
+
+    if (nowtime - session->adjust_time < ADJUST_INTERVAL)
     {
         return;
     }
 
-    while (NET_RecvPacket(server_context, &addr, &packet))
+    session->adjust_time = nowtime;
+
+    // A pending change of ticdup is complete once every client,
+    // drones included, has been sent the tic it happens at.
+
+    if (session->ticdup_tic >= 0)
     {
-        NET_SV_Packet(packet, addr);
-        NET_FreePacket(packet);
+        for (i = 0; i < MAXNETNODES; ++i)
+        {
+            client = &session->clients[i];
+
+            if (ClientConnected(client)
+             && client->sendseq <= session->ticdup_tic)
+            {
+                return;
+            }
+        }
+
+        session->ticdup = session->next_ticdup;
+        session->ticdup_tic = -1;
     }
 
-    if (master_server != NULL)
+    worst_jitter = 0;
+
+    for (i = 0; i < NET_MAXPLAYERS; ++i)
     {
-        UpdateMasterServer();
+        client = session->players[i];
+
+        if (client == NULL || !ClientConnected(client))
+        {
+            continue;
+        }
+
+        if (client->tics_received + client->tics_resent > 0)
+        {
+            loss = (client->tics_resent * 100)
+                 / (client->tics_received + client->tics_resent);
+
+            extratics = session->settings.extratics;
+
+            if (loss >= 2)
+            {
+                ++extratics;
+            }
+
+            if (loss >= 10)
+            {
+                ++extratics;
+            }
+
+            extratics = MIN(extratics, MAX(MAX_EXTRATICS,
+                                           session->settings.extratics));
+
+            if (extratics != client->extratics)
+            {
+                client->extratics = extratics;
+                client->extratics_changed = true;
+            }
+        }
+
+        client->tics_received = 0;
+        client->tics_resent = 0;
+
+        worst_jitter = MAX(worst_jitter, client->jitter / 16);
+    }
+
+    if (max_ticdup <= session->settings.ticdup)
+    {
+        return;
     }
 
-    // "Run" any clients that may have things to do, independent of responses
-    // to received packets
+    // Raise ticdup when the jitter exceeds the time between tics, and
+    // lower it when it would be comfortably within the time between
+    // tics at the lower ticdup.  Only change when the jitter has been
+    // out of line for a few intervals in a row.
+
+    period = (session->ticdup * 1000) / TICRATE;
+    lower_period = ((session->ticdup - 1) * 1000) / TICRATE;
+
+    if (worst_jitter > period && session->ticdup < max_ticdup)
+    {
+        session->ticdup_trend = MAX(session->ticdup_trend, 0) + 1;
+    }
+    else if (worst_jitter < lower_period / 2
+          && session->ticdup > session->settings.ticdup)
+    {
+        session->ticdup_trend = MIN(session->ticdup_trend, 0) - 1;
+    }
+    else
+    {
+        session->ticdup_trend = 0;
+    }
+
+    if (session->ticdup_trend >= 3 || session->ticdup_trend <= -5)
+    {
+        // Switch at the first tic not yet sent to anyone, drones
+        // included, since they are sent the same tics.
+
+        session->next_ticdup = session->ticdup
+                             + (session->ticdup_trend > 0 ? 1 : -1);
+        session->ticdup_tic = 0;
+
+        for (i = 0; i < MAXNETNODES; ++i)
+        {
+            client = &session->clients[i];
+
+            if (ClientConnected(client))
+            {
+                session->ticdup_tic = MAX(session->ticdup_tic,
+                                          client->sendseq);
+            }
+        }
+
+        session->ticdup_trend = 0;
+
+        NET_SV_BroadcastMessage("Server changed ticdup to %i",
+                                session->next_ticdup);
+    }
+}
+
+static void NET_SV_RunSession(void)
+{
+    int i;
 
     for (i=0; i<MAXNETNODES; ++i)
     {
-        if (clients[i].active)
+        if (session->clients[i].active)
         {
-            NET_SV_RunClient(&clients[i]);
+            NET_SV_RunClient(&session->clients[i]);
         }
     }
 
-    switch (server_state)
+    switch (session->state)
     {
         case SERVER_WAITING_LAUNCH:
             break;
@@ -1857,20 +2305,89 @@ void NET_SV_Run(void)
 
         case SERVER_IN_GAME:
             NET_SV_AdvanceWindow();
+            NET_SV_AdjustSettings();
 
             for (i = 0; i < NET_MAXPLAYERS; ++i)
             {
-                if (sv_players[i] != NULL && ClientConnected(sv_players[i]))
+                if (session->players[i] != NULL
+                 && ClientConnected(session->players[i]))
                 {
-                    NET_SV_CheckResends(sv_players[i]);
+                    NET_SV_CheckResends(session->players[i]);
                 }
             }
             break;
     }
+
+    // [SVE] Everything queued for a client this frame goes out to it
+    // in one datagram.
+
+    for (i=0; i<MAXNETNODES; ++i)
+    {
+        if (session->clients[i].active)
+        {
+            NET_Conn_Flush(&session->clients[i].connection);
+        }
+    }
+}
+
+// Run server code to check for new packets/send packets as the server
+// requires
+
+void NET_SV_Run(void)
+{
+    net_addr_t *addr;
+    net_packet_t *packet;
+
+    if (!server_initialized)
+    {
+        return;
+    }
+
+    while (NET_RecvPacket(server_context, &addr, &packet))
+    {
+        NET_SV_Packet(packet, addr);
+        NET_FreePacket(packet);
+    }
+
+    if (master_server != NULL)
+    {
+        UpdateMasterServer();
+    }
+
+    for (session = sessions; session != NULL; session = session->next)
+    {
+        NET_SV_RunSession();
+    }
+
+    NET_SV_FreeIdleSessions();
+}
+
+// Returns how long the server can wait for packets before it next
+// needs to run: connections time out, and the waiting screen and
+// resend requests are refreshed, even when nothing arrives.
+
+int NET_SV_IdleTime(void)
+{
+    net_session_t *s;
+    int i;
+
+    for (s = sessions; s != NULL; s = s->next)
+    {
+        for (i=0; i<MAXNETNODES; ++i)
+        {
+            if (s->clients[i].active)
+            {
+                return 10;
+            }
+        }
+    }
+
+    return 1000;
 }
 
 void NET_SV_Shutdown(void)
 {
+    net_session_t *s;
     int i;
     boolean running;
     int start_time;
@@ -1883,12 +2400,15 @@ void NET_SV_Shutdown(void)
     fprintf(stderr, "SV: Shutting down server...\n");
 
     // Disconnect all clients
-    
-    for (i=0; i<MAXNETNODES; ++i)
+
+    for (s = sessions; s != NULL; s = s->next)
     {
-        if (clients[i].active)
+        for (i=0; i<MAXNETNODES; ++i)
         {
-            NET_SV_DisconnectClient(&clients[i]);
+            if (s->clients[i].active)
+            {
+                NET_SV_DisconnectClient(&s->clients[i]);
+            }
         }
     }
 
@@ -1903,11 +2423,14 @@ void NET_SV_Shutdown(void)
 
         running = false;
 
-        for (i=0; i<MAXNETNODES; ++i)
+        for (s = sessions; s != NULL; s = s->next)
         {
-            if (clients[i].active)
+            for (i=0; i<MAXNETNODES; ++i)
             {
-                running = true;
+                if (s->clients[i].active)
+                {
+                    running = true;
+                }
             }
         }
 
@@ -21,10 +21,20 @@
 
 void NET_SV_Init(void);
 
+// Set the number of games the server may host at once.  New games
+// are started as players arrive and the existing ones fill up.
+
+void NET_SV_SetMaxSessions(int n);
+
 // run server: check for new packets received etc.
 
 void NET_SV_Run(void);
 
+// Returns the number of milliseconds the server can wait for packets
+// before NET_SV_Run must be called again.
+
+int NET_SV_IdleTime(void);
+
 // Shut down the server
 // Blocks until all clients disconnect, or until a 5 second timeout
 
@@ -0,0 +1,501 @@
+//
+// Copyright(C) 2020 Night Dive Studios, LLC
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//    Network condition simulator: delay, jitter, reordering,
+//    duplication and loss injected into a network module.
+//
+//    The conditions apply to each direction separately, so a
+//    -netlatency of 50 gives a round trip of 100ms.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "doomtype.h"
+#include "i_timer.h"
+#include "m_argv.h"
+#include "net_defs.h"
+#include "net_io.h"
+#include "net_packet.h"
+#include "net_sim.h"
+#include "z_zone.h"
+
+struct net_simpacket_s
+{
+    net_packet_t *packet;
+    net_addr_t *addr;
+
+    // Time the packet arrives at the other end.
+
+    unsigned int time;
+
+    net_simpacket_t *next;
+};
+
+net_simstats_t net_sim_stats;
+
+static boolean sim_initialized = false;
+static boolean sim_enabled = false;
+
+// Link conditions.  Times are in milliseconds, chances in percent.
+
+static int sim_latency = 0;
+static int sim_jitter = 0;
+static int sim_loss = 0;
+static int sim_duplicate = 0;
+static int sim_reorder = 0;
+
+// The simulator has its own random number generator, with a fixed
+// seed so that runs can be repeated.
+
+static unsigned int sim_seed = 1;
+
+static int SimRandom(int range)
+{
+    sim_seed = sim_seed * 1103515245 + 12345;
+
+    return (int) ((sim_seed >> 16) % (unsigned int) range);
+}
+
+static boolean SimChance(int percent)
+{
+    return percent > 0 && SimRandom(100) < percent;
+}
+
+static int GetSimParm(char *name, int maxvalue)
+{
+    int p;
+    int value;
+
+    p = M_CheckParmWithArgs(name, 1);
+
+    if (p <= 0)
+    {
+        return 0;
+    }
+
+    value = atoi(myargv[p + 1]);
+
+    if (value < 0)
+    {
+        value = 0;
+    }
+    else if (value > maxvalue)
+    {
+        value = maxvalue;
+    }
+
+    sim_enabled = true;
+
+    return value;
+}
+
+static void NET_SIM_Init(void)
+{
+    if (sim_initialized)
+    {
+        return;
+    }
+
+    sim_initialized = true;
+
+    //!
+    // @category net
+    // @arg <ms>
+    //
+    // Simulate a network link by delaying every packet by <ms>
+    // milliseconds in each direction.
+    //
+
+    sim_latency = GetSimParm("-netlatency", 10000);
+
+    //!
+    // @category net
+    // @arg <ms>
+    //
+    // Simulate a network link by adding up to <ms> milliseconds of
+    // random delay to every packet.
+    //
+
+    sim_jitter = GetSimParm("-netjitter", 10000);
+
+    //!
+    // @category net
+    // @arg <percent>
+    //
+    // Simulate a network link by dropping the given percentage of
+    // packets.
+    //
+
+    sim_loss = GetSimParm("-netloss", 100);
+
+    //!
+    // @category net
+    // @arg <percent>
+    //
+    // Simulate a network link by delivering the given percentage of
+    // packets twice.
+    //
+
+    sim_duplicate = GetSimParm("-netdup", 100);
+
+    //!
+    // @category net
+    // @arg <percent>
+    //
+    // Simulate a network link by holding back the given percentage of
+    // packets, so that the packets behind them arrive first.
+    //
+
+    sim_reorder = GetSimParm("-netreorder", 100);
+
+    if (sim_enabled)
+    {
+        printf("NET_SIM_Init: simulating %ims latency, %ims jitter, "
+               "%i%% loss, %i%% duplication, %i%% reordering\n",
+               sim_latency, sim_jitter, sim_loss, sim_duplicate,
+               sim_reorder);
+    }
+}
+
+boolean NET_SIM_Enabled(void)
+{
+    NET_SIM_Init();
+
+    return sim_enabled;
+}
+
+static void InsertPacket(net_delayline_t *line, net_simpacket_t *simpacket)
+{
+    net_simpacket_t **rover;
+
+    // Packets due at the same time keep the order they were sent in.
+
+    rover = &line->head;
+
+    while (*rover != NULL && (int) ((*rover)->time - simpacket->time) <= 0)
+    {
+        rover = &(*rover)->next;
+    }
+
+    simpacket->next = *rover;
+    *rover = simpacket;
+}
+
+void NET_SIM_Push(net_delayline_t *line, net_addr_t *addr,
+                  net_packet_t *packet)
+{
+    net_simpacket_t *simpacket;
+    unsigned int nowtime;
+    int copies;
+    int delay;
+    int i;
+
+    NET_SIM_Init();
+
+    ++net_sim_stats.packets;
+    net_sim_stats.bytes += packet->len;
+
+    if (SimChance(sim_loss))
+    {
+        ++net_sim_stats.dropped;
+        return;
+    }
+
+    copies = 1;
+
+    if (SimChance(sim_duplicate))
+    {
+        ++net_sim_stats.duplicated;
+        copies = 2;
+    }
+
+    nowtime = I_GetTimeMS();
+
+    for (i=0; i<copies; ++i)
+    {
+        delay = sim_latency;
+
+        if (sim_jitter > 0)
+        {
+            delay += SimRandom(sim_jitter + 1);
+        }
+
+        if (SimChance(sim_reorder))
+        {
+            ++net_sim_stats.reordered;
+            delay += 1 + SimRandom(sim_latency + sim_jitter + 50);
+        }
+
+        simpacket = Z_Malloc(sizeof(net_simpacket_t), PU_STATIC, 0);
+        simpacket->packet = NET_PacketDup(packet);
+        simpacket->addr = addr;
+        simpacket->time = nowtime + delay;
+
+        InsertPacket(line, simpacket);
+    }
+}
+
+boolean NET_SIM_Pop(net_delayline_t *line, net_addr_t **addr,
+                    net_packet_t **packet)
+{
+    net_simpacket_t *simpacket;
+
+    simpacket = line->head;
+
+    if (simpacket == NULL
+     || (int) (simpacket->time - I_GetTimeMS()) > 0)
+    {
+        return false;
+    }
+
+    line->head = simpacket->next;
+
+    *addr = simpacket->addr;
+    *packet = simpacket->packet;
+
+    Z_Free(simpacket);
+
+    return true;
+}
+
+void NET_SIM_Clear(net_delayline_t *line)
+{
+    net_simpacket_t *simpacket;
+
+    while (line->head != NULL)
+    {
+        simpacket = line->head;
+        line->head = simpacket->next;
+
+        NET_FreePacket(simpacket->packet);
+        Z_Free(simpacket);
+    }
+}
+
+//
+// Wrapper module.  Addresses handed out by the wrapper point back to
+// the wrapped module's addresses, and stay alive while packets to or
+// from them are in flight.
+//
+
+typedef struct simaddr_s simaddr_t;
+
+struct simaddr_s
+{
+    // Must come first, so that a net_addr_t * is also a simaddr_t *.
+
+    net_addr_t addr;
+
+    // Freed by the caller while packets were still in flight.
+
+    boolean freed;
+
+    simaddr_t *next;
+};
+
+static net_module_t net_sim_module;
+
+static net_module_t *inner_module = NULL;
+static simaddr_t *addresses = NULL;
+static net_delayline_t outgoing;
+static net_delayline_t incoming;
+
+static simaddr_t *FindAddress(net_addr_t *inner)
+{
+    simaddr_t *simaddr;
+
+    for (simaddr = addresses; simaddr != NULL; simaddr = simaddr->next)
+    {
+        if (simaddr->addr.handle == inner)
+        {
+            return simaddr;
+        }
+    }
+
+    simaddr = Z_Malloc(sizeof(simaddr_t), PU_STATIC, 0);
+    simaddr->addr.module = &net_sim_module;
+    simaddr->addr.handle = inner;
+    simaddr->freed = false;
+    simaddr->next = addresses;
+    addresses = simaddr;
+
+    return simaddr;
+}
+
+static boolean InFlight(net_delayline_t *line, net_addr_t *addr)
+{
+    net_simpacket_t *simpacket;
+
+    for (simpacket = line->head; simpacket != NULL;
+         simpacket = simpacket->next)
+    {
+        if (simpacket->addr == addr)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Free an address if the caller is done with it and no packets to or
+// from it are still in flight.
+
+static void CheckFreeAddress(simaddr_t *simaddr)
+{
+    simaddr_t **rover;
+
+    if (!simaddr->freed
+     || InFlight(&outgoing, &simaddr->addr)
+     || InFlight(&incoming, &simaddr->addr))
+    {
+        return;
+    }
+
+    for (rover = &addresses; *rover != NULL; rover = &(*rover)->next)
+    {
+        if (*rover == simaddr)
+        {
+            *rover = simaddr->next;
+            break;
+        }
+    }
+
+    inner_module->FreeAddress(simaddr->addr.handle);
+    Z_Free(simaddr);
+}
+
+// Hand on any outgoing packets that have reached the other end.
+
+static void PumpOutgoing(void)
+{
+    net_addr_t *addr;
+    net_packet_t *packet;
+
+    while (NET_SIM_Pop(&outgoing, &addr, &packet))
+    {
+        inner_module->SendPacket(addr->handle, packet);
+        NET_FreePacket(packet);
+        CheckFreeAddress((simaddr_t *) addr);
+    }
+}
+
+static boolean NET_SIM_InitClient(void)
+{
+    return inner_module->InitClient();
+}
+
+static boolean NET_SIM_InitServer(void)
+{
+    return inner_module->InitServer();
+}
+
+static void NET_SIM_SendPacket(net_addr_t *addr, net_packet_t *packet)
+{
+    // Broadcasts are only used to find servers; send them straight on.
+
+    if (addr == &net_broadcast_addr)
+    {
+        inner_module->SendPacket(addr, packet);
+        return;
+    }
+
+    NET_SIM_Push(&outgoing, addr, packet);
+    PumpOutgoing();
+}
+
+static boolean NET_SIM_RecvPacket(net_addr_t **addr, net_packet_t **packet)
+{
+    net_addr_t *inner_addr;
+    net_packet_t *inner_packet;
+    simaddr_t *simaddr;
+
+    PumpOutgoing();
+
+    // Everything the wrapped module has received goes onto the
+    // incoming delay line first.
+
+    while (inner_module->RecvPacket(&inner_addr, &inner_packet))
+    {
+        simaddr = FindAddress(inner_addr);
+        NET_SIM_Push(&incoming, &simaddr->addr, inner_packet);
+        NET_FreePacket(inner_packet);
+    }
+
+    if (!NET_SIM_Pop(&incoming, addr, packet))
+    {
+        return false;
+    }
+
+    // The caller holds the address again.
+
+    ((simaddr_t *) *addr)->freed = false;
+
+    return true;
+}
+
+static void NET_SIM_AddrToString(net_addr_t *addr, char *buffer,
+                                 int buffer_len)
+{
+    inner_module->AddrToString(addr->handle, buffer, buffer_len);
+}
+
+static void NET_SIM_FreeAddress(net_addr_t *addr)
+{
+    simaddr_t *simaddr;
+
+    simaddr = (simaddr_t *) addr;
+    simaddr->freed = true;
+
+    CheckFreeAddress(simaddr);
+}
+
+static net_addr_t *NET_SIM_ResolveAddress(char *address)
+{
+    net_addr_t *inner;
+
+    inner = inner_module->ResolveAddress(address);
+
+    if (inner == NULL)
+    {
+        return NULL;
+    }
+
+    return &FindAddress(inner)->addr;
+}
+
+static net_module_t net_sim_module =
+{
+    NET_SIM_InitClient,
+    NET_SIM_InitServer,
+    NET_SIM_SendPacket,
+    NET_SIM_RecvPacket,
+    NET_SIM_AddrToString,
+    NET_SIM_FreeAddress,
+    NET_SIM_ResolveAddress,
+};
+
+net_module_t *NET_SIM_Wrap(net_module_t *module)
+{
+    if (!NET_SIM_Enabled() || inner_module != NULL)
+    {
+        return module;
+    }
+
+    inner_module = module;
+
+    return &net_sim_module;
+}
+
@@ -0,0 +1,73 @@
+//
+// Copyright(C) 2020 Night Dive Studios, LLC
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//    Network condition simulator: delay, jitter, reordering,
+//    duplication and loss injected into a network module.
+//
+
+#ifndef NET_SIM_H
+#define NET_SIM_H
+
+#include "net_defs.h"
+
+typedef struct net_simpacket_s net_simpacket_t;
+
+// Queue of packets in flight, ordered by the time they arrive.
+
+typedef struct
+{
+    net_simpacket_t *head;
+} net_delayline_t;
+
+// Counters for the packets that have passed through the simulator.
+
+typedef struct
+{
+    unsigned int packets;
+    unsigned int bytes;
+    unsigned int dropped;
+    unsigned int duplicated;
+    unsigned int reordered;
+} net_simstats_t;
+
+extern net_simstats_t net_sim_stats;
+
+// True if any link conditions were given on the command line.
+
+boolean NET_SIM_Enabled(void);
+
+// Put a copy of a packet on a delay line, subject to the simulated
+// link conditions.  The caller keeps ownership of the packet.
+
+void NET_SIM_Push(net_delayline_t *line, net_addr_t *addr,
+                  net_packet_t *packet);
+
+// Take the next packet that has arrived off a delay line.  The caller
+// takes ownership of the packet.
+
+boolean NET_SIM_Pop(net_delayline_t *line, net_addr_t **addr,
+                    net_packet_t **packet);
+
+// Free everything still in flight on a delay line.
+
+void NET_SIM_Clear(net_delayline_t *line);
+
+// Returns a module that passes all traffic through the simulator on
+// its way to and from the given module, or the module itself if the
+// simulator is not enabled.  Only one module can be wrapped at a time.
+
+net_module_t *NET_SIM_Wrap(net_module_t *module);
+
+#endif /* #ifndef NET_SIM_H */
+
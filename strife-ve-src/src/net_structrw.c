@@ -158,12 +158,75 @@ void NET_WriteQueryData(net_packet_t *packet, net_querydata_t *query)
     NET_WriteString(packet, query->description);
 }
 
-void NET_WriteTiccmdDiff(net_packet_t *packet, net_ticdiff_t *diff, 
-                         boolean lowres_turn)
+// [SVE] Ticcmd diffs are sent in runs of consecutive tics, and each one
+// is written relative to the one before it in the run, if given: a
+// diff the same as the previous one takes a single byte, and turning
+// and pitch are sent as the change from the previous values.  Only
+// the fields present in a diff can be relied on at the other end.
+
+static boolean TiccmdDiffsEqual(net_ticdiff_t *a, net_ticdiff_t *b)
+{
+    unsigned int diff = a->diff;
+
+    if (diff != b->diff)
+        return false;
+
+    if ((diff & NET_TICDIFF_FORWARD)
+     && a->cmd.forwardmove != b->cmd.forwardmove)
+        return false;
+    if ((diff & NET_TICDIFF_SIDE) && a->cmd.sidemove != b->cmd.sidemove)
+        return false;
+    if ((diff & NET_TICDIFF_TURN) && a->cmd.angleturn != b->cmd.angleturn)
+        return false;
+    if ((diff & NET_TICDIFF_PITCH) && a->cmd.pitchmove != b->cmd.pitchmove)
+        return false;
+    if ((diff & NET_TICDIFF_BUTTONS) && a->cmd.buttons != b->cmd.buttons)
+        return false;
+    if ((diff & NET_TICDIFF_CONSISTANCY)
+     && a->cmd.consistancy != b->cmd.consistancy)
+        return false;
+    if ((diff & NET_TICDIFF_CHATCHAR) && a->cmd.chatchar != b->cmd.chatchar)
+        return false;
+    if ((diff & NET_TICDIFF_RAVEN)
+     && (a->cmd.lookfly != b->cmd.lookfly || a->cmd.arti != b->cmd.arti))
+        return false;
+    if ((diff & NET_TICDIFF_STRIFE1) && a->cmd.buttons2 != b->cmd.buttons2)
+        return false;
+    if ((diff & NET_TICDIFF_STRIFE2)
+     && (a->cmd.inventory & 0xffff) != (b->cmd.inventory & 0xffff))
+        return false;
+
+    return true;
+}
+
+static int PrevTurn(net_ticdiff_t *prev)
+{
+    if (prev != NULL && (prev->diff & NET_TICDIFF_TURN))
+        return prev->cmd.angleturn;
+
+    return 0;
+}
+
+static int PrevPitch(net_ticdiff_t *prev)
+{
+    if (prev != NULL && (prev->diff & NET_TICDIFF_PITCH))
+        return prev->cmd.pitchmove;
+
+    return 0;
+}
+
+void NET_WriteTiccmdDiff(net_packet_t *packet, net_ticdiff_t *diff,
+                         net_ticdiff_t *prev, boolean lowres_turn)
 {
-    // Header
+    // Header: the low bit marks a repeat of the previous diff
+
+    if (prev != NULL && TiccmdDiffsEqual(diff, prev))
+    {
+        NET_WriteVarInt(packet, 1);
+        return;
+    }
 
-    NET_WriteInt16(packet, diff->diff); // [SVE]: need larger range
+    NET_WriteVarInt(packet, diff->diff << 1);
 
     // Write the fields which are enabled:
 
@@ -179,12 +242,12 @@ void NET_WriteTiccmdDiff(net_packet_t *packet, net_ticdiff_t *diff,
         }
         else
         {
-            NET_WriteInt16(packet, diff->cmd.angleturn);
+            NET_WriteSVarInt(packet, diff->cmd.angleturn - PrevTurn(prev));
         }
     }
     // [SVE] svillarreal
     if (diff->diff & NET_TICDIFF_PITCH)
-        NET_WriteInt16(packet, diff->cmd.pitchmove);
+        NET_WriteSVarInt(packet, diff->cmd.pitchmove - PrevPitch(prev));
 
     if (diff->diff & NET_TICDIFF_BUTTONS)
         NET_WriteInt8(packet, diff->cmd.buttons);
@@ -200,20 +263,33 @@ void NET_WriteTiccmdDiff(net_packet_t *packet, net_ticdiff_t *diff,
     if (diff->diff & NET_TICDIFF_STRIFE1)
         NET_WriteInt8(packet, diff->cmd.buttons2);
     if (diff->diff & NET_TICDIFF_STRIFE2)
-        NET_WriteInt16(packet, diff->cmd.inventory); // [SVE]: must be 16-bit
+        NET_WriteVarInt(packet, diff->cmd.inventory & 0xffff); // [SVE]: 16-bit
 }
 
 boolean NET_ReadTiccmdDiff(net_packet_t *packet, net_ticdiff_t *diff,
-                           boolean lowres_turn)
+                           net_ticdiff_t *prev, boolean lowres_turn)
 {
     unsigned int val;
     signed int sval;
 
     // Read header
 
-    if (!NET_ReadInt16(packet, &diff->diff)) // [SVE]: larger diff
+    if (!NET_ReadVarInt(packet, &val))
         return false;
-    
+
+    if (val & 1)
+    {
+        // Same as the previous diff in the run
+
+        if (prev == NULL)
+            return false;
+
+        *diff = *prev;
+        return true;
+    }
+
+    diff->diff = val >> 1;
+
     // Read fields
 
     if (diff->diff & NET_TICDIFF_FORWARD)
@@ -240,19 +316,19 @@ boolean NET_ReadTiccmdDiff(net_packet_t *packet, net_ticdiff_t *diff,
         }
         else
         {
-            if (!NET_ReadSInt16(packet, &sval))
+            if (!NET_ReadSVarInt(packet, &sval))
                 return false;
-            diff->cmd.angleturn = sval;
+            diff->cmd.angleturn = PrevTurn(prev) + sval;
         }
     }
 
     // [SVE] svillarreal
     if (diff->diff & NET_TICDIFF_PITCH)
     {
-        if (!NET_ReadSInt16(packet, &sval))
+        if (!NET_ReadSVarInt(packet, &sval))
             return false;
 
-        diff->cmd.pitchmove = sval;
+        diff->cmd.pitchmove = PrevPitch(prev) + sval;
     }
 
     if (diff->diff & NET_TICDIFF_BUTTONS)
@@ -296,9 +372,9 @@ boolean NET_ReadTiccmdDiff(net_packet_t *packet, net_ticdiff_t *diff,
 
     if (diff->diff & NET_TICDIFF_STRIFE2)
     {
-        if (!NET_ReadInt16(packet, &val)) // [SVE]: must be 16-bit
+        if (!NET_ReadVarInt(packet, &val)) // [SVE]: 16-bit
             return false;
-        diff->cmd.inventory = val;
+        diff->cmd.inventory = val & 0xffff;
     }
 
     return true;
@@ -395,18 +471,50 @@ void NET_TiccmdPatch(ticcmd_t *src, net_ticdiff_t *diff, ticcmd_t *dest)
 // net_full_ticcmd_t
 // 
 
-boolean NET_ReadFullTiccmd(net_packet_t *packet, net_full_ticcmd_t *cmd, boolean lowres_turn)
+// [SVE] As with diffs, a full ticcmd is written relative to the one
+// before it in the run, if given.
+
+boolean NET_ReadFullTiccmd(net_packet_t *packet, net_full_ticcmd_t *cmd,
+                           net_full_ticcmd_t *prev, boolean lowres_turn)
 {
     unsigned int bitfield;
+    unsigned int value;
+    signed int latency;
+    int changed;
     int i;
 
-    // Latency
+    // Latency.  [SVE] The low bit flags a change of settings.
 
-    if (!NET_ReadSInt16(packet, &cmd->latency))
+    if (!NET_ReadSVarInt(packet, &latency))
     {
         return false;
     }
 
+    changed = latency & 1;
+    latency = (latency - changed) / 2;
+
+    cmd->latency = latency + (prev != NULL ? prev->latency : 0);
+
+    cmd->ticdup = 0;
+    cmd->extratics = 0;
+
+    if (changed)
+    {
+        if (!NET_ReadVarInt(packet, &value) || value > 255)
+        {
+            return false;
+        }
+
+        cmd->ticdup = value;
+
+        if (!NET_ReadVarInt(packet, &value) || value > 255)
+        {
+            return false;
+        }
+
+        cmd->extratics = value;
+    }
+
     // Regenerate playeringame from the "header" bitfield
 
     if (!NET_ReadInt8(packet, &bitfield))
@@ -425,7 +533,13 @@ boolean NET_ReadFullTiccmd(net_packet_t *packet, net_full_ticcmd_t *cmd, boolean
     {
         if (cmd->playeringame[i])
         {
-            if (!NET_ReadTiccmdDiff(packet, &cmd->cmds[i], lowres_turn))
+            net_ticdiff_t *prevdiff;
+
+            prevdiff = prev != NULL && prev->playeringame[i] ?
+                       &prev->cmds[i] : NULL;
+
+            if (!NET_ReadTiccmdDiff(packet, &cmd->cmds[i], prevdiff,
+                                    lowres_turn))
             {
                 return false;
             }
@@ -435,14 +549,27 @@ boolean NET_ReadFullTiccmd(net_packet_t *packet, net_full_ticcmd_t *cmd, boolean
     return true;
 }
 
-void NET_WriteFullTiccmd(net_packet_t *packet, net_full_ticcmd_t *cmd, boolean lowres_turn)
+void NET_WriteFullTiccmd(net_packet_t *packet, net_full_ticcmd_t *cmd,
+                         net_full_ticcmd_t *prev, boolean lowres_turn)
 {
     unsigned int bitfield;
+    int changed;
     int i;
 
-    // Write the latency
+    // Write the latency.  [SVE] The low bit flags a change of settings,
+    // which follows.
+
+    changed = cmd->ticdup != 0 || cmd->extratics != 0;
 
-    NET_WriteInt16(packet, cmd->latency);
+    NET_WriteSVarInt(packet,
+                     (cmd->latency - (prev != NULL ? prev->latency : 0)) * 2
+                   + changed);
+
+    if (changed)
+    {
+        NET_WriteVarInt(packet, cmd->ticdup);
+        NET_WriteVarInt(packet, cmd->extratics);
+    }
 
     // Write "header" byte indicating which players are active
     // in this ticcmd
@@ -465,7 +592,12 @@ void NET_WriteFullTiccmd(net_packet_t *packet, net_full_ticcmd_t *cmd, boolean l
     {
         if (cmd->playeringame[i])
         {
-            NET_WriteTiccmdDiff(packet, &cmd->cmds[i], lowres_turn);
+            net_ticdiff_t *prevdiff;
+
+            prevdiff = prev != NULL && prev->playeringame[i] ?
+                       &prev->cmds[i] : NULL;
+
+            NET_WriteTiccmdDiff(packet, &cmd->cmds[i], prevdiff, lowres_turn);
         }
     }
 }
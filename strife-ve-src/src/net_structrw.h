@@ -28,13 +28,17 @@ extern boolean NET_ReadSettings(net_packet_t *packet, net_gamesettings_t *settin
 extern void NET_WriteQueryData(net_packet_t *packet, net_querydata_t *querydata);
 extern boolean NET_ReadQueryData(net_packet_t *packet, net_querydata_t *querydata);
 
-extern void NET_WriteTiccmdDiff(net_packet_t *packet, net_ticdiff_t *diff, boolean lowres_turn);
-extern boolean NET_ReadTiccmdDiff(net_packet_t *packet, net_ticdiff_t *diff, boolean lowres_turn);
+extern void NET_WriteTiccmdDiff(net_packet_t *packet, net_ticdiff_t *diff,
+                                net_ticdiff_t *prev, boolean lowres_turn);
+extern boolean NET_ReadTiccmdDiff(net_packet_t *packet, net_ticdiff_t *diff,
+                                  net_ticdiff_t *prev, boolean lowres_turn);
 extern void NET_TiccmdDiff(ticcmd_t *tic1, ticcmd_t *tic2, net_ticdiff_t *diff);
 extern void NET_TiccmdPatch(ticcmd_t *src, net_ticdiff_t *diff, ticcmd_t *dest);
 
-boolean NET_ReadFullTiccmd(net_packet_t *packet, net_full_ticcmd_t *cmd, boolean lowres_turn);
-void NET_WriteFullTiccmd(net_packet_t *packet, net_full_ticcmd_t *cmd, boolean lowres_turn);
+boolean NET_ReadFullTiccmd(net_packet_t *packet, net_full_ticcmd_t *cmd,
+                           net_full_ticcmd_t *prev, boolean lowres_turn);
+void NET_WriteFullTiccmd(net_packet_t *packet, net_full_ticcmd_t *cmd,
+                         net_full_ticcmd_t *prev, boolean lowres_turn);
 
 boolean NET_ReadSHA1Sum(net_packet_t *packet, sha1_digest_t digest);
 void NET_WriteSHA1Sum(net_packet_t *packet, sha1_digest_t digest);
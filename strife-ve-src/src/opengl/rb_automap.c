@@ -17,10 +17,12 @@
 //
 
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "doomstat.h"
+#include "rb_config.h"
 #include "rb_draw.h"
-#include "rb_drawlist.h"
 #include "rb_geom.h"
 #include "rb_view.h"
 #include "rb_data.h"
@@ -28,10 +30,10 @@
 #include "rb_automap.h"
 #include "deh_str.h"
 #include "i_video.h"
-#include "m_bbox.h"
 #include "w_wad.h"
 #include "r_defs.h"
 #include "r_state.h"
+#include "z_zone.h"
 
 static rbView_t rbAutomapView;
 
@@ -43,6 +45,37 @@ static rbTexture_t *markTextures[10];
 static rbTexture_t *objMarkIcon;
 
 extern SDL_Window *windowscreen;
+
+//
+// Automap geometry
+//
+// Linedefs and subsectors never move once a level is loaded, so their
+// vertices are built once by RB_InitAutomap and drawn straight out of
+// these arrays, with the automap view loaded into the modelview matrix.
+// Each frame only writes the line colors and the index lists of what is
+// visible, and everything goes out in one call for the walls, one for the
+// other lines and one per flat for the sector fills.
+//
+
+#define MAXAMLINES      1024
+
+static vtx_t        *amWallVertex;      // two per linedef
+static unsigned int *amWallIndices;
+static int          amNumWallIndices;
+
+static vtx_t        amLineVertex[MAXAMLINES * 2];   // players, things
+static int          amNumLineVertex;
+
+static vtx_t        *amLeafVertex;      // numleafs per subsector
+static unsigned int *amLeafIndices;
+static int          *amLeafFirst;       // first vertex of each subsector
+static short        *amLeafLight;       // light level in the vertex colors
+static int          *amSubOrder;        // subsectors sorted by floor flat
+
+static int          *amSubMapped;       // mapped lines around each subsector
+static byte         *amLineMapped;      // ML_MAPPED as last seen
+static int          *amLineSubs;        // subsectors touched by each line
+static int          *amLineFirstSub;    // numlines + 1 offsets into amLineSubs
 //
 // RB_SetupAutomapView
 //
@@ -100,6 +133,40 @@ static void RB_SetupAutomapView(rbView_t *view)
     RB_SetupFrameForView(view, 45.0f);
 }
 
+//
+// RB_FlushAutomapLines
+//
+// Draws the walls and lines added since the last flush.
+//
+
+static void RB_FlushAutomapLines(void)
+{
+    if(amNumWallIndices == 0 && amNumLineVertex == 0)
+    {
+        return;
+    }
+
+    RB_BindTexture(&whiteTexture);
+
+    if(amNumWallIndices > 0)
+    {
+        RB_BindDrawPointers(amWallVertex);
+        dglDrawElements(GL_LINES, amNumWallIndices, GL_UNSIGNED_INT, amWallIndices);
+
+        rbState.numDrawnVertices += amNumWallIndices;
+        amNumWallIndices = 0;
+    }
+
+    if(amNumLineVertex > 0)
+    {
+        RB_BindDrawPointers(amLineVertex);
+        dglDrawArrays(GL_LINES, 0, amNumLineVertex);
+
+        rbState.numDrawnVertices += amNumLineVertex;
+        amNumLineVertex = 0;
+    }
+}
+
 //
 // RB_DrawAutomapLine
 //
@@ -107,38 +174,56 @@ static void RB_SetupAutomapView(rbView_t *view)
 void RB_DrawAutomapLine(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2, int color)
 {
     byte rgb[3];
-    fixed_t bbox[4];
-    float fx1, fy1;
-    float fx2, fy2;
-    
-    M_ClearBox(bbox);
-    M_AddToBox(bbox, x1, y1);
-    M_AddToBox(bbox, x2, y2);
-    M_AddToBox(bbox, x2, y1);
-    M_AddToBox(bbox, x1, y2);
-    
-    if(!RB_CheckBoxInView(&rbAutomapView, bbox, -1, 1))
+    vtx_t *v;
+    int i;
+
+    if(amNumLineVertex >= MAXAMLINES * 2)
     {
-        return;
+        RB_FlushAutomapLines();
     }
 
-    fx1 = FIXED2FLOAT(x1);
-    fy1 = FIXED2FLOAT(y1);
-    fx2 = FIXED2FLOAT(x2);
-    fy2 = FIXED2FLOAT(y2);
+    I_GetPaletteColor(rgb, color);
 
-    RB_BindTexture(&whiteTexture);
+    v = &amLineVertex[amNumLineVertex];
+    amNumLineVertex += 2;
+
+    v[0].x = FIXED2FLOAT(x1);
+    v[0].y = FIXED2FLOAT(y1);
+    v[1].x = FIXED2FLOAT(x2);
+    v[1].y = FIXED2FLOAT(y2);
+
+    for(i = 0; i < 2; ++i)
+    {
+        v[i].z = 0;
+        v[i].tu = v[i].tv = 0;
+        v[i].r = rgb[0];
+        v[i].g = rgb[1];
+        v[i].b = rgb[2];
+        v[i].a = 0xff;
+    }
+}
+
+//
+// RB_DrawAutomapWall
+//
+// Queues a linedef, whose vertices are already in place.
+//
+
+void RB_DrawAutomapWall(int linenum, int color)
+{
+    byte rgb[3];
+    vtx_t *v;
+
+    // the palette can change under us, so the color is always written
     I_GetPaletteColor(rgb, color);
 
-    //
-    // I despise opengl immediate mode but I just can't be arsed
-    // to do anything fancy here
-    //
-    dglBegin(GL_LINES);
-    dglColor4ub(rgb[0], rgb[1], rgb[2], 0xff);
-    dglVertex3f(fx1, fy1, 0);
-    dglVertex3f(fx2, fy2, 0);
-    dglEnd();
+    v = &amWallVertex[linenum * 2];
+    v[0].r = v[1].r = rgb[0];
+    v[0].g = v[1].g = rgb[1];
+    v[0].b = v[1].b = rgb[2];
+
+    amWallIndices[amNumWallIndices++] = linenum * 2;
+    amWallIndices[amNumWallIndices++] = linenum * 2 + 1;
 }
 
 //
@@ -156,6 +241,8 @@ void RB_DrawObjectiveMarker(fixed_t x, fixed_t y)
     float fscale;
     int alpha;
 
+    RB_FlushAutomapLines();
+
     // if not loaded, then do it now
     if(!objMarkIcon)
     {
@@ -227,6 +314,8 @@ void RB_DrawMark(fixed_t x, fixed_t y, int marknum)
     float fscale;
     rbTexture_t *texture;
 
+    RB_FlushAutomapLines();
+
     if(marknum < 0 || marknum >= 10)
     {
         return;
@@ -290,83 +379,234 @@ void RB_DrawMark(fixed_t x, fixed_t y, int marknum)
 }
 
 //
-// RB_GenerateAutomapSectors
+// RB_SortSubsectorsByFlat
+//
+
+static int RB_SortSubsectorsByFlat(const void *a, const void *b)
+{
+    return subsectors[*(const int*)a].sector->floorpic -
+           subsectors[*(const int*)b].sector->floorpic;
+}
+
+//
+// RB_SetLeafLight
 //
 
-boolean RB_GenerateAutomapSectors(vtxlist_t *vl, int *drawcount)
+static void RB_SetLeafLight(int ssnum)
 {
+    subsector_t *ss = &subsectors[ssnum];
+    vtx_t *v = &amLeafVertex[amLeafFirst[ssnum]];
+    byte light = rbSectorLightTable[ss->sector->lightlevel];
     int j;
+
+    for(j = 0; j < ss->numleafs; ++j)
+    {
+        v[j].r = v[j].g = v[j].b = light;
+    }
+
+    amLeafLight[ssnum] = ss->sector->lightlevel;
+}
+
+//
+// RB_InitAutomap
+//
+// Builds the automap geometry for a freshly loaded level.
+//
+
+void RB_InitAutomap(void)
+{
+    int i;
+    int j;
+    int numverts;
+    int numindices;
     int count;
-    fixed_t tx;
-    fixed_t ty;
-    leaf_t *leaf;
-    subsector_t *ss;
-    sector_t *sector;
-    
-    ss      = (subsector_t*)vl->data;
-    leaf    = &leafs[ss->leaf];
-    sector  = ss->sector;
-    count   = *drawcount;
-    
-    for(j = 0; j < ss->numleafs - 2; ++j)
+
+    // walls
+    amWallVertex = Z_Malloc(numlines * 2 * sizeof(vtx_t), PU_LEVEL, 0);
+    amWallIndices = Z_Malloc(numlines * 2 * sizeof(unsigned int), PU_LEVEL, 0);
+    amNumWallIndices = 0;
+    amNumLineVertex = 0;
+
+    for(i = 0; i < numlines; ++i)
     {
-        RB_AddTriangle(count, count + 1 + j, count + 2 + j);
+        vtx_t *v = &amWallVertex[i * 2];
+
+        memset(v, 0, 2 * sizeof(vtx_t));
+
+        v[0].x = FIXED2FLOAT(lines[i].v1->x);
+        v[0].y = FIXED2FLOAT(lines[i].v1->y);
+        v[1].x = FIXED2FLOAT(lines[i].v2->x);
+        v[1].y = FIXED2FLOAT(lines[i].v2->y);
+        v[0].a = v[1].a = 0xff;
     }
-    
-    // need to keep texture coords small to avoid
-    // floor 'wobble' due to rounding errors on some cards
-    // make relative to first vertex, not (0,0)
-    // which is arbitary anyway
-    
-    tx = (leaf->vertex->x >> 6) & ~(FRACUNIT - 1);
-    ty = (leaf->vertex->y >> 6) & ~(FRACUNIT - 1);
-    
-    for(j = 0; j < ss->numleafs; ++j)
+
+    // sector fills
+    numverts = 0;
+    numindices = 0;
+
+    for(i = 0; i < numsubsectors; ++i)
     {
-        vtx_t *v = &drawVertex[count];
-        
-        if(vl->flags & DLF_CEILING)
+        numverts += subsectors[i].numleafs;
+
+        if(subsectors[i].numleafs > 2)
         {
-            leaf = &leafs[(ss->leaf + (ss->numleafs - 1)) - j];
+            numindices += (subsectors[i].numleafs - 2) * 3;
         }
-        else
+    }
+
+    amLeafVertex = Z_Malloc(numverts * sizeof(vtx_t), PU_LEVEL, 0);
+    amLeafIndices = Z_Malloc(numindices * sizeof(unsigned int), PU_LEVEL, 0);
+    amLeafFirst = Z_Malloc(numsubsectors * sizeof(int), PU_LEVEL, 0);
+    amLeafLight = Z_Malloc(numsubsectors * sizeof(short), PU_LEVEL, 0);
+    amSubOrder = Z_Malloc(numsubsectors * sizeof(int), PU_LEVEL, 0);
+
+    count = 0;
+
+    for(i = 0; i < numsubsectors; ++i)
+    {
+        subsector_t *ss = &subsectors[i];
+        leaf_t *leaf = &leafs[ss->leaf];
+        fixed_t tx;
+        fixed_t ty;
+
+        // need to keep texture coords small to avoid
+        // floor 'wobble' due to rounding errors on some cards
+        // make relative to first vertex, not (0,0)
+        // which is arbitary anyway
+
+        tx = (leaf->vertex->x >> 6) & ~(FRACUNIT - 1);
+        ty = (leaf->vertex->y >> 6) & ~(FRACUNIT - 1);
+
+        amLeafFirst[i] = count;
+        amSubOrder[i] = i;
+
+        for(j = 0; j < ss->numleafs; ++j)
         {
+            vtx_t *v = &amLeafVertex[count++];
+
             leaf = &leafs[ss->leaf + j];
+
+            v->x = leaf->vertex->fx;
+            v->y = leaf->vertex->fy;
+            v->z = 0;
+
+            v->tu = FIXED2FLOAT((leaf->vertex->x >> 6) - tx);
+            v->tv = -FIXED2FLOAT((leaf->vertex->y >> 6) - ty);
+            v->a = 0xff;
         }
-        
-        v->x = leaf->vertex->fx;
-        v->y = leaf->vertex->fy;
-        v->z = 0;
-        
-        v->tu = FIXED2FLOAT((leaf->vertex->x >> 6) - tx);
-        v->tv = -FIXED2FLOAT((leaf->vertex->y >> 6) - ty);
-        
-        v->r = v->g = v->b = rbSectorLightTable[sector->lightlevel];
-        v->a = 0xff;
-        
-        count++;
+
+        RB_SetLeafLight(i);
     }
-    
-    *drawcount = count;
-    return true;
+
+    // fewer texture changes; flats that change later cost an extra call
+    qsort(amSubOrder, numsubsectors, sizeof(int), RB_SortSubsectorsByFlat);
+
+    // which subsectors each line borders, to keep the mapped counts
+    amSubMapped = Z_Malloc(numsubsectors * sizeof(int), PU_LEVEL, 0);
+    amLineMapped = Z_Malloc(numlines, PU_LEVEL, 0);
+    amLineFirstSub = Z_Malloc((numlines + 1) * sizeof(int), PU_LEVEL, 0);
+
+    memset(amSubMapped, 0, numsubsectors * sizeof(int));
+    memset(amLineMapped, 0, numlines);
+    memset(amLineFirstSub, 0, (numlines + 1) * sizeof(int));
+
+    for(i = 0; i < numsubsectors; ++i)
+    {
+        for(j = 0; j < subsectors[i].numlines; ++j)
+        {
+            line_t *line = segs[subsectors[i].firstline + j].linedef;
+
+            if(line)
+            {
+                amLineFirstSub[line - lines + 1]++;
+            }
+        }
+    }
+
+    for(i = 0; i < numlines; ++i)
+    {
+        amLineFirstSub[i + 1] += amLineFirstSub[i];
+    }
+
+    amLineSubs = Z_Malloc((amLineFirstSub[numlines] + 1) * sizeof(int), PU_LEVEL, 0);
+
+    for(i = 0; i < numsubsectors; ++i)
+    {
+        for(j = 0; j < subsectors[i].numlines; ++j)
+        {
+            line_t *line = segs[subsectors[i].firstline + j].linedef;
+
+            if(line)
+            {
+                amLineSubs[amLineFirstSub[line - lines]++] = i;
+            }
+        }
+    }
+
+    // filling moved each offset on to the start of the next line
+    for(i = numlines; i > 0; --i)
+    {
+        amLineFirstSub[i] = amLineFirstSub[i - 1];
+    }
+
+    amLineFirstSub[0] = 0;
 }
 
 //
-// RB_AddLeafToDrawlist
+// RB_UpdateMappedSubsectors
+//
+// Catches up with lines that got ML_MAPPED, or lost it to a loaded game,
+// since the last frame.
 //
 
-static void RB_AddLeafToDrawlist(subsector_t *sub, int texid)
+static void RB_UpdateMappedSubsectors(void)
 {
-    vtxlist_t *list;
-    
-    list = DL_AddVertexList(&drawlist[DLT_AMAP]);
-    list->data = (subsector_t*)sub;
-    list->procfunc = RB_GenerateAutomapSectors;
-    list->preprocess = NULL;
-    list->postprocess = NULL;
-    list->params = sub->sector->lightlevel;
-    list->texid = texid;
-    list->flags = 0;
+    int i;
+    int j;
+
+    for(i = 0; i < numlines; ++i)
+    {
+        byte mapped = (lines[i].flags & ML_MAPPED) != 0;
+        int delta;
+
+        if(mapped == amLineMapped[i])
+        {
+            continue;
+        }
+
+        amLineMapped[i] = mapped;
+        delta = mapped ? 1 : -1;
+
+        for(j = amLineFirstSub[i]; j < amLineFirstSub[i + 1]; ++j)
+        {
+            amSubMapped[amLineSubs[j]] += delta;
+        }
+    }
+}
+
+//
+// RB_DrawAutomapLeafs
+//
+
+static void RB_DrawAutomapLeafs(int pic, int count)
+{
+    rbTexture_t *texture;
+
+    if(count == 0)
+    {
+        return;
+    }
+
+    texture = RB_GetTexture(RDT_FLAT, pic, 0);
+
+    if(texture)
+    {
+        RB_BindTexture(texture);
+        RB_ChangeTexParameters(texture, TC_REPEAT, TEXFILTER);
+    }
+
+    dglDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, amLeafIndices);
+    rbState.numDrawnVertices += count;
 }
 
 //
@@ -375,14 +615,26 @@ static void RB_AddLeafToDrawlist(subsector_t *sub, int texid)
 
 void RB_DrawAutomapSectors(boolean cheating)
 {
+    boolean showall;
+    int pic;
+    int count;
     int i;
     int j;
-    vtx_t *v = &drawVertex[0];
-    subsector_t *sub;
+
+    showall = cheating || players[consoleplayer].powers[pw_allmap];
+    pic = -1;
+    count = 0;
+
+    RB_UpdateMappedSubsectors();
+
+    RB_SetDepthMask(0);
+    RB_BindDrawPointers(amLeafVertex);
 
     for(i = 0; i < numsubsectors; ++i)
     {
-        sub = &subsectors[i];
+        int ssnum = amSubOrder[i];
+        subsector_t *sub = &subsectors[ssnum];
+        int first;
 
         if(sub->sector->floorpic == skyflatnum)
         {
@@ -390,51 +642,35 @@ void RB_DrawAutomapSectors(boolean cheating)
             continue;
         }
 
-        for(j = 0; j < sub->numlines; ++j)
-        {
-            line_t *line;
-
-            line = segs[sub->firstline + j].linedef;
-
-            if(line == NULL)
-            {
-                // skip minisegs
-                continue;
-            }
-
-            if(line->flags & ML_MAPPED)
-            {
-                break;
-            }
-        }
-
-        if(j >= sub->numlines && !cheating && !players[consoleplayer].powers[pw_allmap])
+        if(!amSubMapped[ssnum] && !showall)
         {
             // must be mapped
             continue;
         }
 
-        for(j = 0; j < sub->numleafs; ++j)
+        if(sub->sector->floorpic != pic)
         {
-            vertex_t *vertex = leafs[sub->leaf + j].vertex;
-
-            v[j].x = vertex->fx;
-            v[j].y = vertex->fy;
-            v[j].z = 0;
+            RB_DrawAutomapLeafs(pic, count);
+            pic = sub->sector->floorpic;
+            count = 0;
         }
 
-        if(!RB_CheckPointsInView(&rbAutomapView, v, sub->numleafs))
+        if(sub->sector->lightlevel != amLeafLight[ssnum])
         {
-            continue;
+            RB_SetLeafLight(ssnum);
         }
 
-        RB_AddLeafToDrawlist(sub, sub->sector->floorpic);
-    }
+        first = amLeafFirst[ssnum];
 
-    RB_SetDepthMask(0);
+        for(j = 0; j < sub->numleafs - 2; ++j)
+        {
+            amLeafIndices[count++] = first;
+            amLeafIndices[count++] = first + 1 + j;
+            amLeafIndices[count++] = first + 2 + j;
+        }
+    }
 
-    DL_ProcessDrawList(DLT_AMAP);
-    DL_Reset(DLT_AMAP);
+    RB_DrawAutomapLeafs(pic, count);
 
     RB_SetDepthMask(1);
 }
@@ -457,8 +693,6 @@ void RB_BeginAutomapDraw(void)
     // load modelview
     dglMatrixMode(GL_MODELVIEW);
     dglLoadMatrixf(rbAutomapView.modelview);
-
-    DL_BeginDrawList();
 }
 
 //
@@ -467,6 +701,7 @@ void RB_BeginAutomapDraw(void)
 
 void RB_EndAutomapDraw(void)
 {
+     RB_FlushAutomapLines();
      RB_ResetViewPort();
      RB_DrawExtraHudPics();
 }
@@ -16,11 +16,13 @@
 #ifndef __RB_AUTOMAP_H__
 #define __RB_AUTOMAP_H__
 
+void RB_InitAutomap(void);
 void RB_BeginAutomapDraw(void);
 void RB_DrawAutomapSectors(boolean cheating);
 void RB_EndAutomapDraw(void);
 void RB_DrawObjectiveMarker(fixed_t x, fixed_t y);
 void RB_DrawMark(fixed_t x, fixed_t y, int marknum);
 void RB_DrawAutomapLine(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2, int color);
+void RB_DrawAutomapWall(int linenum, int color);
 
 #endif
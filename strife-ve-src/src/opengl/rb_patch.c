@@ -33,9 +33,143 @@
 static unsigned int rbPalette[256];
 static int playpallump;
 
+//
+// Patches from lumps are kept in an atlas texture and drawn as one
+// batch of quads.  Anything else, such as raw blocks, is drawn into
+// the patch canvas on the CPU, and only the rows that changed are
+// uploaded.  Each time drawing goes back to the canvas after quads
+// were queued, it starts a new layer of the canvas, so that the layers
+// and the quads between them are drawn in the order they came.
+//
+
+#define ATLAS_SIZE          1024
+#define MAXPATCHENTRIES     2048
+#define MAXPATCHQUADS       4096
+#define PATCHHASHSIZE       512
+#define MAXCANVASLAYERS     8
+
+// Rows [top, bottom) of a texture.
+typedef struct
+{
+    int top;
+    int bottom;
+} rowband_t;
+
+typedef struct patchentry_s
+{
+    patch_t *patch;
+    int lump;                   // lump the patch is the data of
+    int x;                      // position in the atlas
+    int y;
+    struct patchentry_s *next;
+} patchentry_t;
+
+typedef struct
+{
+    byte *buffer;
+    rowband_t drawn;            // rows drawn into this frame
+    int quad;                   // quads queued before it
+} canvaslayer_t;
+
 // patch canvas
 static rbTexture_t patchTexture;
-static byte *patchBuffer;
+static byte *patchBuffer;       // layer being drawn into
+static canvaslayer_t canvasLayers[MAXCANVASLAYERS];
+static int numCanvasLayers;     // layers drawn into this frame
+static rowband_t canvasUploaded; // rows of the texture not clear
+
+// patch atlas
+static rbTexture_t atlasTexture;
+static byte *atlasBuffer;
+static rowband_t atlasDirty;
+static int shelfX;
+static int shelfY;
+static int shelfHeight;
+static boolean atlasFull;
+
+static patchentry_t patchEntries[MAXPATCHENTRIES];
+static int numPatchEntries;
+static patchentry_t *patchHash[PATCHHASHSIZE];
+
+// quads queued this frame
+static vtx_t patchVertex[MAXPATCHQUADS * 4];
+static int numPatchQuads;
+
+// Solid white texels at the corner of the atlas, for filled boxes.
+#define WHITE_SIZE  4
+
+//
+// RB_AddRows
+//
+
+static void RB_AddRows(rowband_t *band, int top, int bottom)
+{
+    if(top >= bottom)
+    {
+        return;
+    }
+
+    if(band->top >= band->bottom)
+    {
+        band->top = top;
+        band->bottom = bottom;
+        return;
+    }
+
+    band->top = MIN(band->top, top);
+    band->bottom = MAX(band->bottom, bottom);
+}
+
+//
+// RB_UploadRows
+//
+
+static void RB_UploadRows(rbTexture_t *rbTexture, byte *data, rowband_t *band)
+{
+    if(band->top >= band->bottom)
+    {
+        return;
+    }
+
+    RB_BindTexture(rbTexture);
+
+    dglTexSubImage2D(GL_TEXTURE_2D, 0, 0, band->top, rbTexture->width,
+                     band->bottom - band->top, GL_RGBA, GL_UNSIGNED_BYTE,
+                     data + band->top * rbTexture->width * 4);
+
+    band->top = band->bottom = 0;
+}
+
+//
+// RB_ResetPatchAtlas
+//
+// Forget every patch in the atlas.
+//
+
+static void RB_ResetPatchAtlas(void)
+{
+    int x, y;
+
+    numPatchEntries = 0;
+    memset(patchHash, 0, sizeof(patchHash));
+    memset(atlasBuffer, 0, ATLAS_SIZE * ATLAS_SIZE * 4);
+
+    for(y = 0; y < WHITE_SIZE; y++)
+    {
+        for(x = 0; x < WHITE_SIZE; x++)
+        {
+            ((unsigned int*)atlasBuffer)[y * ATLAS_SIZE + x] = 0xffffffff;
+        }
+    }
+
+    shelfX = WHITE_SIZE + 1;
+    shelfY = 0;
+    shelfHeight = WHITE_SIZE + 1;
+    atlasFull = false;
+
+    atlasDirty.top = 0;
+    atlasDirty.bottom = ATLAS_SIZE;
+}
 
 //
 // RB_SetPatchBufferPalette
@@ -56,6 +190,12 @@ void RB_SetPatchBufferPalette(void)
                               gammatable[usegamma][tempcol[1]],
                               gammatable[usegamma][tempcol[2]], 0);
     }
+
+    // the atlas holds converted colors
+    if(atlasBuffer)
+    {
+        RB_ResetPatchAtlas();
+    }
 }
 
 //
@@ -72,7 +212,16 @@ void RB_PatchBufferInit(void)
     patchTexture.height = patchTexture.origheight;
     
     patchBuffer = (byte*)Z_Calloc(1, (patchTexture.width * patchTexture.height) * 4, PU_STATIC, 0);
+    canvasLayers[0].buffer = patchBuffer;
     RB_UploadTexture(&patchTexture, patchBuffer, TC_CLAMP_BORDER, TF_NEAREST);
+
+    atlasTexture.colorMode = TCR_RGBA;
+    atlasTexture.origwidth = atlasTexture.width = ATLAS_SIZE;
+    atlasTexture.origheight = atlasTexture.height = ATLAS_SIZE;
+
+    atlasBuffer = (byte*)Z_Malloc(ATLAS_SIZE * ATLAS_SIZE * 4, PU_STATIC, 0);
+    RB_ResetPatchAtlas();
+    RB_UploadTexture(&atlasTexture, atlasBuffer, TC_CLAMP, TF_NEAREST);
     
     playpallump = W_GetNumForName(DEH_String("PLAYPAL"));
     RB_SetPatchBufferPalette();
@@ -85,13 +234,287 @@ void RB_PatchBufferInit(void)
 void RB_PatchBufferShutdown(void)
 {
     RB_DeleteTexture(&patchTexture);
+    RB_DeleteTexture(&atlasTexture);
 }
 
 //
-// RB_BlitPatch
+// RB_LumpData
+//
+// Where the lump's data is, if it is loaded.
 //
 
-void RB_BlitPatch(int x, int y, patch_t *patch, byte alpha)
+static void *RB_LumpData(int lump)
+{
+    if(lumpinfo[lump].wad_file->mapped != NULL)
+    {
+        return lumpinfo[lump].wad_file->mapped + lumpinfo[lump].position;
+    }
+
+    return lumpinfo[lump].cache;
+}
+
+//
+// RB_DrawPatchToAtlas
+//
+// Convert a patch into the atlas, with its top left at x, y.
+//
+
+static void RB_DrawPatchToAtlas(patch_t *patch, int x, int y)
+{
+    unsigned int *dest;
+    int width = SHORT(patch->width);
+    int height = SHORT(patch->height);
+    int w, h;
+    byte *colData, ctd;
+    column_t *column;
+
+    dest = (unsigned int*)atlasBuffer + y * ATLAS_SIZE + x;
+
+    for(w = 0; w < width; ++w)
+    {
+        column = (column_t*)((byte*)patch + LONG(patch->columnofs[w]));
+        while((ctd = column->topdelta) != 0xff)
+        {
+            colData = (byte*)column + 3;
+
+            for(h = 0; h < column->length && ctd + h < height; ++h)
+            {
+                dest[ATLAS_SIZE * (ctd + h) + w] = rbPalette[colData[h]] | (0xff << 24);
+            }
+
+            column = (column_t*)((byte*)column + column->length + 4);
+        }
+    }
+
+    RB_AddRows(&atlasDirty, y, y + height);
+}
+
+//
+// RB_AtlasPatch
+//
+// Find the patch in the atlas, adding it if need be. Returns NULL if it
+// cannot be drawn from the atlas.
+//
+
+static patchentry_t *RB_AtlasPatch(patch_t *patch)
+{
+    patchentry_t *entry;
+    int hash;
+    int lump;
+    int width, height;
+
+    hash = (int)(((size_t)patch >> 4) & (PATCHHASHSIZE - 1));
+
+    for(entry = patchHash[hash]; entry != NULL; entry = entry->next)
+    {
+        if(entry->patch != patch)
+        {
+            continue;
+        }
+
+        if(RB_LumpData(entry->lump) == patch)
+        {
+            return entry;
+        }
+
+        // Freed since, and the memory reused.
+        entry->patch = NULL;
+    }
+
+    if(atlasFull || numPatchEntries == MAXPATCHENTRIES)
+    {
+        atlasFull = true;
+        return NULL;
+    }
+
+    // Patches that are not lumps are drawn into the canvas, and take no
+    // entry, so that they cannot fill the atlas.
+    lump = W_LumpNumForData(patch);
+
+    if(lump < 0)
+    {
+        return NULL;
+    }
+
+    entry = &patchEntries[numPatchEntries++];
+    entry->patch = patch;
+    entry->lump = lump;
+    entry->next = patchHash[hash];
+    patchHash[hash] = entry;
+
+    // Leave a clear texel around each patch, so that filtering does not
+    // pick up its neighbours.
+    width = SHORT(patch->width) + 1;
+    height = SHORT(patch->height) + 1;
+
+    if(shelfX + width > ATLAS_SIZE)
+    {
+        shelfX = 0;
+        shelfY += shelfHeight;
+        shelfHeight = 0;
+    }
+
+    if(width > ATLAS_SIZE || shelfY + height > ATLAS_SIZE)
+    {
+        entry->patch = NULL;
+        atlasFull = true;
+        return NULL;
+    }
+
+    entry->x = shelfX;
+    entry->y = shelfY;
+    shelfX += width;
+    shelfHeight = MAX(shelfHeight, height);
+
+    RB_DrawPatchToAtlas(patch, entry->x, entry->y);
+
+    return entry;
+}
+
+//
+// RB_QueueQuad
+//
+// Queue a quad covering width x height screen pixels at x, y, drawn
+// from the given atlas texels.
+//
+
+static boolean RB_QueueQuad(int x, int y, int width, int height,
+                            float s0, float t0, float s1, float t1,
+                            unsigned int color, byte alpha)
+{
+    vtx_t *v;
+    float ds, dt;
+
+    // With no layers left, the rest of the frame goes into the last.
+    if(numPatchQuads == MAXPATCHQUADS || numCanvasLayers == MAXCANVASLAYERS)
+    {
+        return false;
+    }
+
+    // clip to the screen, as the canvas does
+    ds = (s1 - s0) / width;
+    dt = (t1 - t0) / height;
+
+    if(x < 0)
+    {
+        s0 -= x * ds;
+        width += x;
+        x = 0;
+    }
+
+    if(y < 0)
+    {
+        t0 -= y * dt;
+        height += y;
+        y = 0;
+    }
+
+    if(x + width > SCREENWIDTH)
+    {
+        s1 -= (x + width - SCREENWIDTH) * ds;
+        width = SCREENWIDTH - x;
+    }
+
+    if(y + height > SCREENHEIGHT)
+    {
+        t1 -= (y + height - SCREENHEIGHT) * dt;
+        height = SCREENHEIGHT - y;
+    }
+
+    if(width <= 0 || height <= 0)
+    {
+        return true;
+    }
+
+    v = &patchVertex[numPatchQuads++ * 4];
+
+    RB_SetVertexColor(v, color & 0xff, (color >> 8) & 0xff,
+                      (color >> 16) & 0xff, alpha, 4);
+    v[0].z = v[1].z = v[2].z = v[3].z = 0;
+
+    RB_SetQuadAspectDimentions(v, x, y, width, height);
+
+    v[0].tu = v[2].tu = s0;
+    v[0].tv = v[1].tv = t0;
+    v[1].tu = v[3].tu = s1;
+    v[2].tv = v[3].tv = t1;
+
+    return true;
+}
+
+//
+// RB_OpenCanvas
+//
+// Point patchBuffer at the canvas layer to draw into, starting a new
+// layer if quads were queued since the last was drawn into.
+//
+
+static void RB_OpenCanvas(void)
+{
+    canvaslayer_t *layer;
+
+    if(numCanvasLayers > 0
+    && canvasLayers[numCanvasLayers - 1].quad == numPatchQuads)
+    {
+        return;
+    }
+
+    layer = &canvasLayers[numCanvasLayers++];
+
+    if(layer->buffer == NULL)
+    {
+        layer->buffer = (byte*)Z_Calloc(1, (patchTexture.width * patchTexture.height) * 4,
+                                        PU_STATIC, 0);
+    }
+
+    layer->quad = numPatchQuads;
+    layer->drawn.top = layer->drawn.bottom = 0;
+    patchBuffer = layer->buffer;
+}
+
+//
+// RB_UseCanvas
+//
+// Note rows of the open canvas layer are drawn into.
+//
+
+static void RB_UseCanvas(int top, int bottom)
+{
+    RB_AddRows(&canvasLayers[numCanvasLayers - 1].drawn,
+               MAX(top, 0), MIN(bottom, patchTexture.height));
+}
+
+//
+// RB_ClipToCanvas
+//
+// Clip a block to the canvas. Returns false if none of it is left.
+//
+
+static boolean RB_ClipToCanvas(int *x, int *y, int *width, int *height)
+{
+    if(*x < 0)
+    {
+        *width += *x;
+        *x = 0;
+    }
+
+    if(*y < 0)
+    {
+        *height += *y;
+        *y = 0;
+    }
+
+    *width = MIN(*width, SCREENWIDTH - *x);
+    *height = MIN(*height, patchTexture.height - *y);
+
+    return *width > 0 && *height > 0;
+}
+
+//
+// RB_BlitPatchToCanvas
+//
+
+static void RB_BlitPatchToCanvas(int x, int y, patch_t *patch, byte alpha)
 {
     int col;
     unsigned int *desttop;
@@ -100,6 +523,8 @@ void RB_BlitPatch(int x, int y, patch_t *patch, byte alpha)
     byte *colData, ctd;
     column_t *column;
     
+    RB_OpenCanvas();
+
     col = 0;
     desttop = (unsigned int*)&patchBuffer[((patchTexture.width * y) + x) * 4];
     
@@ -121,12 +546,44 @@ void RB_BlitPatch(int x, int y, patch_t *patch, byte alpha)
 				else if(desttop + index >= (unsigned int*)patchBuffer)
 					desttop[index] = rbPalette[colData[h]] | (alpha << 24);
             }
+
+            RB_UseCanvas(y + ctd, y + ctd + column->length);
             
             column = (column_t*)((byte*)column + column->length + 4);
         }
     }
 }
 
+//
+// RB_BlitPatch
+//
+
+void RB_BlitPatch(int x, int y, patch_t *patch, byte alpha)
+{
+    patchentry_t *entry;
+    int width, height;
+
+    entry = RB_AtlasPatch(patch);
+
+    if(entry != NULL)
+    {
+        width = SHORT(patch->width);
+        height = SHORT(patch->height);
+
+        if(RB_QueueQuad(x, y, width, height,
+                        (float)entry->x / ATLAS_SIZE,
+                        (float)entry->y / ATLAS_SIZE,
+                        (float)(entry->x + width) / ATLAS_SIZE,
+                        (float)(entry->y + height) / ATLAS_SIZE,
+                        0xffffff, alpha))
+        {
+            return;
+        }
+    }
+
+    RB_BlitPatchToCanvas(x, y, patch, alpha);
+}
+
 //
 // RB_BlitBlock
 //
@@ -136,39 +593,111 @@ void RB_BlitBlock(int x, int y, int width, int height, byte *data, byte alpha)
     unsigned int *desttop;
     int w;
     int h;
+    int pitch;
     byte *dp;
     
+    pitch = width;
+    dp = data + (y < 0 ? -y * pitch : 0) + (x < 0 ? -x : 0);
+
+    if(!RB_ClipToCanvas(&x, &y, &width, &height))
+    {
+        return;
+    }
+
+    RB_OpenCanvas();
+
     desttop = (unsigned int*)&patchBuffer[((patchTexture.width * y) + x) * 4];
-    dp = data;
     
     for(h = 0; h < height; ++h)
     {
         for(w = 0; w < width; ++w)
         {
-            desttop[patchTexture.width * h + w] = rbPalette[*dp] | (alpha << 24);
-            dp++;
+            desttop[patchTexture.width * h + w] = rbPalette[dp[w]] | (alpha << 24);
         }
+
+        dp += pitch;
     }
+
+    RB_UseCanvas(y, y + height);
 }
 
 //
-// RB_DrawPatchBuffer
+// RB_BlitFill
 //
 
-void RB_DrawPatchBuffer(void)
+void RB_BlitFill(int x, int y, int width, int height, int color, byte alpha)
 {
-    vtx_t v[4];
-    float tx;
+    unsigned int *desttop;
+    int w;
+    int h;
+    const float texel = 0.5f / ATLAS_SIZE;
 
-    if (patchTexture.texid == 0)
+    if(RB_QueueQuad(x, y, width, height, texel, texel,
+                    (WHITE_SIZE / (float)ATLAS_SIZE) - texel,
+                    (WHITE_SIZE / (float)ATLAS_SIZE) - texel,
+                    rbPalette[color], alpha))
     {
-        RB_UploadTexture(&patchTexture, patchBuffer, TC_CLAMP_BORDER, TF_NEAREST);
+        return;
     }
-    
-    RB_SetOrtho();
-    
+
+    if(!RB_ClipToCanvas(&x, &y, &width, &height))
+    {
+        return;
+    }
+
+    RB_OpenCanvas();
+
+    desttop = (unsigned int*)&patchBuffer[((patchTexture.width * y) + x) * 4];
+
+    for(h = 0; h < height; ++h)
+    {
+        for(w = 0; w < width; ++w)
+        {
+            desttop[patchTexture.width * h + w] = rbPalette[color] | (alpha << 24);
+        }
+    }
+
+    RB_UseCanvas(y, y + height);
+}
+
+//
+// RB_DrawPatchQuads
+//
+
+static void RB_DrawPatchQuads(int start, int end)
+{
+    int i;
+
+    if(start >= end)
+    {
+        return;
+    }
+
+    RB_BindTexture(&atlasTexture);
+    RB_ChangeTexParameters(&atlasTexture, TC_CLAMP, TEXFILTER);
+
+    RB_BindDrawPointers(patchVertex);
+
+    for(i = start; i < end; i++)
+    {
+        RB_AddTriangle(i * 4 + 0, i * 4 + 1, i * 4 + 2);
+        RB_AddTriangle(i * 4 + 3, i * 4 + 2, i * 4 + 1);
+    }
+
+    RB_DrawElements();
+    RB_ResetElements();
+}
+
+//
+// RB_DrawPatchCanvas
+//
+
+static void RB_DrawPatchCanvas(void)
+{
+    static vtx_t v[4];
+    float tx;
+
     RB_BindTexture(&patchTexture);
-    RB_UpdateTexture(&patchTexture, patchBuffer);
     RB_ChangeTexParameters(&patchTexture, TC_REPEAT, TEXFILTER);
     
     tx = (float)patchTexture.origwidth / (float)patchTexture.width;
@@ -184,19 +713,87 @@ void RB_DrawPatchBuffer(void)
     v[1].tu = v[3].tu = tx;
     v[2].tv = v[3].tv = 1;
     
-    RB_SetState(GLSTATE_CULL, true);
-    RB_SetCull(GLCULL_FRONT);
-    RB_SetState(GLSTATE_DEPTHTEST, false);
-    RB_SetState(GLSTATE_BLEND, true);
-    RB_SetState(GLSTATE_ALPHATEST, true);
-    RB_SetBlend(GLSRC_SRC_ALPHA, GLDST_ONE_MINUS_SRC_ALPHA);
-    
     // render
     RB_BindDrawPointers(v);
     RB_AddTriangle(0, 1, 2);
     RB_AddTriangle(3, 2, 1);
     RB_DrawElements();
     RB_ResetElements();
+}
+
+//
+// RB_DrawPatchBuffer
+//
+
+void RB_DrawPatchBuffer(void)
+{
+    canvaslayer_t *layer;
+    rowband_t upload;
+    int start;
+    int i;
+
+    if (patchTexture.texid == 0)
+    {
+        RB_UploadTexture(&patchTexture, canvasLayers[0].buffer, TC_CLAMP_BORDER, TF_NEAREST);
+        canvasUploaded.top = canvasUploaded.bottom = 0;
+    }
+
+    if (atlasTexture.texid == 0)
+    {
+        RB_UploadTexture(&atlasTexture, atlasBuffer, TC_CLAMP, TF_NEAREST);
+        atlasDirty.top = atlasDirty.bottom = 0;
+    }
     
-    memset(patchBuffer, 0, (patchTexture.width * patchTexture.height) * 4);
+    RB_SetOrtho();
+
+    // Upload new patches in the atlas.
+    RB_UploadRows(&atlasTexture, atlasBuffer, &atlasDirty);
+
+    RB_SetState(GLSTATE_CULL, true);
+    RB_SetCull(GLCULL_FRONT);
+    RB_SetState(GLSTATE_DEPTHTEST, false);
+    RB_SetState(GLSTATE_BLEND, true);
+    RB_SetState(GLSTATE_ALPHATEST, true);
+    RB_SetBlend(GLSRC_SRC_ALPHA, GLDST_ONE_MINUS_SRC_ALPHA);
+    
+    // render, with each canvas layer in order among the quads
+    start = 0;
+
+    for(i = 0; i < numCanvasLayers; i++)
+    {
+        layer = &canvasLayers[i];
+
+        RB_DrawPatchQuads(start, layer->quad);
+        start = layer->quad;
+
+        if(layer->drawn.top >= layer->drawn.bottom)
+        {
+            continue;
+        }
+
+        // Upload the rows drawn into this layer, and clear those left
+        // over in the texture from the last one.
+        upload = layer->drawn;
+        RB_AddRows(&upload, canvasUploaded.top, canvasUploaded.bottom);
+        RB_UploadRows(&patchTexture, layer->buffer, &upload);
+        canvasUploaded = layer->drawn;
+
+        RB_DrawPatchCanvas();
+
+        memset(layer->buffer + layer->drawn.top * patchTexture.width * 4, 0,
+               (layer->drawn.bottom - layer->drawn.top) * patchTexture.width * 4);
+        layer->drawn.top = layer->drawn.bottom = 0;
+    }
+
+    RB_DrawPatchQuads(start, numPatchQuads);
+
+    numCanvasLayers = 0;
+    numPatchQuads = 0;
+
+    // Start again once the atlas fills; until then, what did not fit
+    // was drawn into the canvas.
+    if(atlasFull)
+    {
+        RB_ResetPatchAtlas();
+    }
 }
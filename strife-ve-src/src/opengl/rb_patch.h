@@ -23,6 +23,7 @@ void RB_SetPatchBufferPalette(void);
 void RB_PatchBufferShutdown(void);
 void RB_BlitPatch(int x, int y, patch_t *patch, byte alpha);
 void RB_BlitBlock(int x, int y, int width, int height, byte *data, byte alpha);
+void RB_BlitFill(int x, int y, int width, int height, int color, byte alpha);
 void RB_DrawPatchBuffer(void);
 
 #endif
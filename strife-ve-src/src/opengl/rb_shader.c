@@ -129,22 +129,13 @@ void SP_SetUniformMat4(rbShader_t *shader, const char *name, matrix val, boolean
 }
 
 //
-// SP_Compile
+// SP_CompileSource
 //
 
-static void SP_Compile(rbShader_t *shader, const char *name, rShaderType_t type)
+static void SP_CompileSource(rbShader_t *shader, const char *source, rShaderType_t type)
 {
-    byte *data;
-    int length;
-    int lump;
     rhandle *handle;
 
-    lump = W_GetNumForName((char*)name);
-    length = W_LumpLength(lump);
-
-    data = (byte*)Z_Calloc(length+1, sizeof(char), PU_STATIC, NULL);
-    W_ReadLump(lump, data);
-    
     if(type == RST_VERTEX)
     {
         shader->vertexProgram = dglCreateShaderObjectARB(GL_VERTEX_SHADER_ARB);
@@ -157,14 +148,32 @@ static void SP_Compile(rbShader_t *shader, const char *name, rShaderType_t type)
     }
     else
     {
-        Z_Free(data);
         return;
     }
     
-    dglShaderSourceARB(*handle, 1, (const GLcharARB**)&data, NULL);
+    dglShaderSourceARB(*handle, 1, (const GLcharARB**)&source, NULL);
     dglCompileShaderARB(*handle);
     dglAttachObjectARB(shader->programObj, *handle);
-    
+}
+
+//
+// SP_Compile
+//
+
+static void SP_Compile(rbShader_t *shader, const char *name, rShaderType_t type)
+{
+    byte *data;
+    int length;
+    int lump;
+
+    lump = W_GetNumForName((char*)name);
+    length = W_LumpLength(lump);
+
+    data = (byte*)Z_Calloc(length+1, sizeof(char), PU_STATIC, NULL);
+    W_ReadLump(lump, data);
+
+    SP_CompileSource(shader, (const char*)data, type);
+
     Z_Free(data);
 }
 
@@ -243,3 +252,28 @@ void SP_LoadProgram(rbShader_t *shader, const char *program)
 
     SP_Link(shader);
 }
+
+//
+// SP_LoadProgramSource
+//
+// For programs built into the executable rather than read from
+// lumps.
+//
+
+void SP_LoadProgramSource(rbShader_t *shader, const char *vertex, const char *fragment)
+{
+    shader->bHasErrors = false;
+    shader->bLoaded = false;
+
+    if(!has_GL_ARB_shader_objects)
+    {
+        return;
+    }
+
+    shader->programObj = dglCreateProgramObjectARB();
+
+    SP_CompileSource(shader, vertex, RST_VERTEX);
+    SP_CompileSource(shader, fragment, RST_FRAGMENT);
+
+    SP_Link(shader);
+}
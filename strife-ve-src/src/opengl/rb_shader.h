@@ -40,5 +40,6 @@ void SP_SetUniform1i(rbShader_t *shader, const char *name, const int val);
 void SP_SetUniform1f(rbShader_t *shader, const char *name, const float val);
 void SP_SetUniformMat4(rbShader_t *shader, const char *name, matrix val, boolean bTranspose);
 void SP_LoadProgram(rbShader_t *shader, const char *program);
+void SP_LoadProgramSource(rbShader_t *shader, const char *vertex, const char *fragment);
 
 #endif
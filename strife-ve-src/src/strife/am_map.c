@@ -555,9 +555,10 @@ void AM_LevelInit(void)
 {
     leveljuststarted = 0;
 
+    // [SVE] the automap draws at the render resolution
     f_x = f_y = 0;
-    f_w = finit_width;
-    f_h = finit_height;
+    f_w = finit_width * hires;
+    f_h = finit_height * hires;
 
     AM_clearMarks();
 
@@ -1216,6 +1217,21 @@ AM_drawMline
 
 }*/
 
+//
+// [SVE] the OpenGL renderer already has the vertices of
+// every linedef, and only needs to know which to draw and how
+//
+static void AM_drawWall(int linenum, mline_t *ml, int color)
+{
+    if(use3drenderer)
+    {
+        RB_DrawAutomapWall(linenum, color);
+        return;
+    }
+
+    AM_drawMline(ml, color);
+}
+
 //
 // Determines visible lines, draws them.
 // This is LineDef based, not LineSeg based.
@@ -1243,35 +1259,35 @@ void AM_drawWalls(void)
             // villsa [STRIFE]
             if(line->special == 145 || line->special == 186)
             {
-                AM_drawMline(&l, SPWALLCOLORS);
+                AM_drawWall(i, &l, SPWALLCOLORS);
             }
             // villsa [STRIFE] lightlev is unused here
             else if(!line->backsector)
             {
-                AM_drawMline(&l, WALLCOLORS);
+                AM_drawWall(i, &l, WALLCOLORS);
             }
             else
             {
                 if(line->special == 39)
                 { // teleporters
-                    AM_drawMline(&l, WALLCOLORS+WALLRANGE/2);
+                    AM_drawWall(i, &l, WALLCOLORS+WALLRANGE/2);
                 }
                 else if (line->flags & ML_SECRET) // secret door
                 {
                     // villsa [STRIFE] just draw the wall as is!
-                    AM_drawMline(&l, WALLCOLORS);
+                    AM_drawWall(i, &l, WALLCOLORS);
                 }
                 else if(line->backsector->floorheight != line->frontsector->floorheight)
                 {
-                    AM_drawMline(&l, FDWALLCOLORS); // floor level change
+                    AM_drawWall(i, &l, FDWALLCOLORS); // floor level change
                 }
                 else if(line->backsector->ceilingheight != line->frontsector->ceilingheight)
                 {
-                    AM_drawMline(&l, CDWALLCOLORS); // ceiling level change
+                    AM_drawWall(i, &l, CDWALLCOLORS); // ceiling level change
                 }
                 else if (cheating)
                 {
-                    AM_drawMline(&l, TSWALLCOLORS);
+                    AM_drawWall(i, &l, TSWALLCOLORS);
                 }
             }
         }
@@ -1279,7 +1295,7 @@ void AM_drawWalls(void)
         else if(plr->powers[pw_allmap] || gamemap == 15)
         {
             if(!(line->flags & LINE_NEVERSEE))
-                AM_drawMline(&l, CTWALLCOLORS);
+                AM_drawWall(i, &l, CTWALLCOLORS);
         }
     }
 }
@@ -1436,7 +1452,7 @@ void AM_drawMarks(void)
             h = 6; // because something's wrong with the wad, i guess
             fx = CXMTOF(markpoints[i].x);
             fy = CYMTOF(markpoints[i].y);
-            if(fx >= f_x && fx <= f_w - w && fy >= f_y && fy <= f_h - h)
+            if(fx >= f_x && fx <= f_w - w*hires && fy >= f_y && fy <= f_h - h*hires)
             {
                 // villsa [STRIFE]
                 if(i >= mapmarknum)
@@ -1448,7 +1464,7 @@ void AM_drawMarks(void)
                     }
                     else
                     {
-                        V_DrawPatch(fx, fy, marknums[i]);
+                        V_DrawPatch(fx/hires, fy/hires, marknums[i]);
                     }
                 }
             }
@@ -1537,7 +1553,7 @@ void AM_Drawer (void)
     // [SVE] svillarreal
     if(!use3drenderer)
     {
-        V_MarkRect(f_x, f_y, f_w, f_h);
+        V_MarkRect(f_x / hires, f_y / hires, f_w / hires, f_h / hires); // [SVE]
     }
     else
     {
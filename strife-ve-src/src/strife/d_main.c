@@ -67,6 +67,7 @@
 #include "i_swap.h"
 
 #include "g_game.h"
+#include "g_regress.h" // [SVE]
 
 #include "hu_stuff.h"
 #include "wi_stuff.h"
@@ -339,8 +340,14 @@ void D_Display (void)
 
     // draw the view directly
     if (gamestate == GS_LEVEL && !automapactive && gametic)
+    {
         R_RenderPlayerView (&players[displayplayer]);
 
+        // [SVE] the view is drawn straight into the screen buffer
+        V_MarkRect(viewwindowx / hires, viewwindowy / hires,
+                   scaledviewwidth / hires, viewheight / hires);
+    }
+
     // clean up border stuff
     if (gamestate != oldgamestate && gamestate != GS_LEVEL)
         I_SetPalette (W_CacheLumpName (DEH_String("PLAYPAL"),PU_CACHE));
@@ -353,7 +360,7 @@ void D_Display (void)
     }
 
     // see if the border needs to be updated to the screen
-    if (gamestate == GS_LEVEL && !automapactive && scaledviewwidth != 320)
+    if (gamestate == GS_LEVEL && !automapactive && scaledviewwidth != renderwidth) // [SVE]
     {
         if (menuactive || menuactivestate || !viewactivestate)
         {
@@ -399,8 +406,8 @@ void D_Display (void)
         if (automapactive)
             y = 4;
         else
-            y = viewwindowy+4;
-        V_DrawPatchDirect(viewwindowx + (scaledviewwidth - 68) / 2, y,
+            y = viewwindowy/hires+4; // [SVE]
+        V_DrawPatchDirect((viewwindowx + (scaledviewwidth - 68*hires) / 2) / hires, y,
                           W_CacheLumpName (DEH_String("M_PAUSE"), PU_CACHE));
     }
 
@@ -501,6 +508,7 @@ void D_BindVariables(void)
     M_BindVariable("screensize",             &screenblocks);
     M_BindVariable("snd_channels",           &snd_channels);
     M_BindVariable("vanilla_savegame_limit", &vanilla_savegame_limit);
+    M_BindVariable("compress_savegames",     &compress_savegames);
     M_BindVariable("vanilla_demo_limit",     &vanilla_demo_limit);
     M_BindVariable("show_endoom",            &show_endoom);
     M_BindVariable("back_flat",              &back_flat);
@@ -671,6 +679,21 @@ void D_DoomLoop (void)
         // process one or more tics
         TryRunTics(); // will run at least one tic
 
+        // [SVE] run on towards the target of a demo seek, a tic at a
+        // time and without drawing, showing a frame now and then
+        if (G_DemoSeeking())
+        {
+            boolean oldsingletics = singletics;
+            int seekstart = I_GetTimeMS();
+
+            singletics = true;
+
+            while (G_DemoSeeking() && I_GetTimeMS() - seekstart < 100)
+                TryRunTics();
+
+            singletics = oldsingletics;
+        }
+
         S_UpdateSounds(players[consoleplayer].mo);// move positional sounds
 
         // Update display, next frame, with current state.
@@ -1681,6 +1704,9 @@ void D_DoomMain (void)
     //DEH_printf("Z_Init: Init zone memory allocation daemon. \n"); [STRIFE] removed
     Z_Init ();
 
+    // [SVE] demo regression runner; never returns if started
+    G_RunRegression();
+
 #ifdef FEATURE_MULTIPLAYER
     //!
     // @category net
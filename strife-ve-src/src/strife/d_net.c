@@ -36,6 +36,7 @@
 #include "deh_main.h"
 
 #include "d_loop.h"
+#include "p_snapshot.h"
 
 #include "i_social.h"
 
@@ -101,11 +102,92 @@ static void NullMenuTicker()
     // no-op.
 }
 
+// [SVE] Rollback snapshots.  Each tic's snapshot is a delta against a
+// full snapshot taken at the start of its run of ROLLBACKBASETICS tics.
+// The full snapshots are kept in turn, so that one is only retaken once
+// every delta against it is further back than a rollback can go.
+
+#define ROLLBACKBASETICS 16
+#define NUMROLLBACKBASES 3
+
+#if (NUMROLLBACKBASES - 1) * ROLLBACKBASETICS < MAXROLLBACK
+#error Rollback bases are retaken too soon
+#endif
+
+static snapshot_t *rollbacksnaps[MAXROLLBACK + 1];
+
+static struct rollbackbase_s
+{
+    snapshot_t *snap;
+    int period;                 // gametic / ROLLBACKBASETICS when taken
+    int map;
+    int starttic;
+} rollbackbases[NUMROLLBACKBASES];
+
+static boolean SaveState(int slot)
+{
+    int period;
+    struct rollbackbase_s *base;
+
+    // Only the level itself can be rolled back; anything else waits
+    // for the server.
+
+    if (gamestate != GS_LEVEL || gameaction != ga_nothing
+     || demorecording || demoplayback)
+    {
+        return false;
+    }
+
+    period = gametic / ROLLBACKBASETICS;
+    base = &rollbackbases[period % NUMROLLBACKBASES];
+
+    if (base->snap == NULL)
+    {
+        base->snap = P_NewSnapshot();
+        base->period = -1;
+    }
+
+    if (base->period != period || base->map != gamemap
+     || base->starttic != levelstarttic)
+    {
+        P_SnapshotState(base->snap);
+        base->period = period;
+        base->map = gamemap;
+        base->starttic = levelstarttic;
+    }
+
+    if (rollbacksnaps[slot] == NULL)
+    {
+        rollbacksnaps[slot] = P_NewSnapshot();
+    }
+
+    P_SnapshotDelta(rollbacksnaps[slot], base->snap);
+
+    return true;
+}
+
+static boolean LoadState(int slot)
+{
+    if (rollbacksnaps[slot] == NULL || !P_RestoreState(rollbacksnaps[slot]))
+    {
+        return false;
+    }
+
+    // A snapshot is only taken with no action pending, so any action
+    // now pending (a level exit, say) came from a mispredicted tic.
+
+    gameaction = ga_nothing;
+
+    return true;
+}
+
 static loop_interface_t strife_loop_interface = {
     D_ProcessEvents,
     G_BuildTiccmd,
     RunTic,
-    NullMenuTicker
+    NullMenuTicker,
+    SaveState,
+    LoadState
 };
 
 
@@ -45,6 +45,30 @@ static byte*	wipe_scr_start;
 static byte*	wipe_scr_end;
 static byte*	wipe_scr;
 
+//
+// wipe_DrawScreen
+//
+// [SVE] Copy a block of the render resolution to the screen; wipes work
+// on the screen buffer as it is, not on the 320x200 screen.
+//
+static void
+wipe_DrawScreen
+( int	x,
+  int	y,
+  int	width,
+  int	height,
+  byte*	src )
+{
+    byte*	dest = I_VideoBuffer + y*renderwidth + x;
+
+    for ( ; height > 0 ; height--)
+    {
+	memcpy(dest, src, width);
+	src += width;
+	dest += renderwidth;
+    }
+}
+
 
 void
 wipe_shittyColMajorXform
@@ -280,7 +304,7 @@ wipe_StartScreen
         return 0;
     }
 
-    wipe_scr_start = Z_Malloc(SCREENWIDTH * SCREENHEIGHT, PU_STATIC, NULL);
+    wipe_scr_start = Z_Malloc(renderwidth * renderheight, PU_STATIC, NULL);
     I_ReadScreen(wipe_scr_start);
     return 0;
 }
@@ -299,9 +323,10 @@ wipe_EndScreen
         return 0;
     }
 
-    wipe_scr_end = Z_Malloc(SCREENWIDTH * SCREENHEIGHT, PU_STATIC, NULL);
+    wipe_scr_end = Z_Malloc(renderwidth * renderheight, PU_STATIC, NULL);
     I_ReadScreen(wipe_scr_end);
-    V_DrawBlock(x, y, width, height, wipe_scr_start); // restore start scr.
+    wipe_DrawScreen(x*hires, y*hires, width*hires, height*hires,
+                    wipe_scr_start); // restore start scr.
     return 0;
 }
 
@@ -322,6 +347,13 @@ wipe_ScreenWipe
 	    wipe_initMelt, wipe_doMelt, wipe_exitMelt
     };
 
+    // [SVE] work in pixels of the render resolution
+    V_MarkRect(x, y, width, height);
+    x *= hires;
+    y *= hires;
+    width *= hires;
+    height *= hires;
+
     // initial stuff
     if(!go)
     {
@@ -333,14 +365,13 @@ wipe_ScreenWipe
     }
 
     // do a piece of wipe-in
-    V_MarkRect(0, 0, width, height);
     rc = (*wipes[wipeno*3+1])(width, height, ticks);
 
     // [SVE] svillarreal
     if(!use3drenderer)
     {
         // haleyjd 20110629 [STRIFE]: Copy temp buffer to the real screen.
-        V_DrawBlock(x, y, width, height, wipe_scr);
+        wipe_DrawScreen(x, y, width, height, wipe_scr);
     }
 
     // final stuff
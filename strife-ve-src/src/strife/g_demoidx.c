@@ -0,0 +1,448 @@
+//
+// Copyright(C) 2020 Night Dive Studios, LLC
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//    Demo index: keyframes of the play simulation taken while a demo
+//    is recorded or played, so that playback can seek.
+//
+//    A recorded demo keeps its keyframes after the end marker, where
+//    older versions of the game never look, so it still plays in them:
+//
+//      'S' 'V' 'E' 'I'  magic
+//      version          1 byte
+//      numtics          total length of the demo, in tics
+//      interval         tics between keyframes
+//      numkeyframes
+//      for each keyframe:
+//        tic            demo tic it was taken before
+//        offset         of that tic's ticcmds, from the start of the demo
+//        gamemap
+//        levelstart     demo tic the level was entered at
+//        base           keyframe it is a delta against, or -1
+//        length         of its image
+//      the keyframe images, in order
+//
+//    All numbers are 32-bit little-endian.  The images are portable
+//    snapshots (see p_snapshot.c); the first keyframe on each level is a
+//    full image and the rest are deltas against it.
+//
+//    A keyframe holds one level only, not the hub levels saved on the
+//    way to it, so it is only ever restored on the level it was taken
+//    on.  A seek is quick within a level; reaching another level still
+//    means running every tic in between, and going back to an earlier
+//    one means playing the demo again from the start.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomdef.h"
+#include "doomstat.h"
+#include "g_demoidx.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "p_snapshot.h"
+#include "z_zone.h"
+
+#define DEMOINDEX_VERSION 1
+
+typedef struct
+{
+    int   tic;
+    int   offset;
+    int   gamemap;
+    int   levelstart;
+    int   base;
+    byte *data;
+    int   length;
+} keyframe_t;
+
+static keyframe_t *keyframes = NULL;
+static int numkeyframes = 0;
+static int numkeyframesalloc = 0;
+
+// Tics between keyframes.
+
+static int interval = -1;
+
+static void G_initInterval(void)
+{
+    int p;
+
+    if (interval >= 0)
+    {
+        return;
+    }
+
+    interval = 10 * TICRATE;
+
+    //!
+    // @arg <seconds>
+    // @category demo
+    //
+    // Take a keyframe every <seconds> seconds when recording or playing
+    // a demo, for seeking.  0 turns keyframes off; recorded demos then
+    // have no index.  The default is 10.
+    //
+
+    p = M_CheckParmWithArgs("-demokeyframes", 1);
+
+    if (p > 0)
+    {
+        interval = atoi(myargv[p + 1]) * TICRATE;
+
+        if (interval < 0)
+        {
+            interval = 0;
+        }
+    }
+}
+
+//
+// G_ClearDemoIndex
+//
+void G_ClearDemoIndex(void)
+{
+    int i;
+
+    for (i = 0; i < numkeyframes; i++)
+    {
+        Z_Free(keyframes[i].data);
+    }
+
+    numkeyframes = 0;
+}
+
+//
+// G_insertKeyframe
+//
+// Adds a keyframe, keeping them in order of tic. Returns its index.
+//
+static int G_insertKeyframe(const keyframe_t *keyframe)
+{
+    int i;
+
+    if (numkeyframes == numkeyframesalloc)
+    {
+        numkeyframesalloc = numkeyframesalloc ? numkeyframesalloc * 2 : 64;
+        keyframes = realloc(keyframes, numkeyframesalloc * sizeof(*keyframes));
+
+        if (keyframes == NULL)
+        {
+            I_Error("G_insertKeyframe: Failed to allocate %d keyframes",
+                    numkeyframesalloc);
+        }
+    }
+
+    i = numkeyframes;
+
+    while (i > 0 && keyframes[i - 1].tic > keyframe->tic)
+    {
+        keyframes[i] = keyframes[i - 1];
+        --i;
+    }
+
+    keyframes[i] = *keyframe;
+    ++numkeyframes;
+
+    // Bases are referred to by index.
+
+    if (i < numkeyframes - 1)
+    {
+        int j;
+
+        for (j = 0; j < numkeyframes; j++)
+        {
+            if (j != i && keyframes[j].base >= i)
+            {
+                ++keyframes[j].base;
+            }
+        }
+    }
+
+    return i;
+}
+
+// Last keyframe at or before tic, or -1.
+
+static int G_keyframeAtOrBefore(int tic)
+{
+    int lo, hi, mid;
+
+    lo = 0;
+    hi = numkeyframes;
+
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+
+        if (keyframes[mid].tic <= tic)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return lo - 1;
+}
+
+//
+// Reading and writing
+//
+
+static int G_getInt(const byte *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+static byte *G_putInt(byte *p, int value)
+{
+    *p++ = value & 0xff;
+    *p++ = (value >> 8) & 0xff;
+    *p++ = (value >> 16) & 0xff;
+    *p++ = ((unsigned int) value >> 24) & 0xff;
+
+    return p;
+}
+
+#define INDEXHEADERSIZE  17
+#define KEYFRAMEINFOSIZE 24
+
+//
+// G_ReadDemoIndex
+//
+boolean G_ReadDemoIndex(const byte *demo, int length, int markeroffset)
+{
+    const byte *p;
+    const byte *end;
+    const byte *data;
+    keyframe_t keyframe;
+    int count;
+    int i;
+
+    G_ClearDemoIndex();
+
+    p = demo + markeroffset + 1;
+    end = demo + length;
+
+    if (end - p < INDEXHEADERSIZE || memcmp(p, "SVEI", 4)
+     || p[4] != DEMOINDEX_VERSION)
+    {
+        return false;
+    }
+
+    count = G_getInt(p + 13);
+    p += INDEXHEADERSIZE;
+
+    if (count < 0 || (end - p) / KEYFRAMEINFOSIZE < count)
+    {
+        return false;
+    }
+
+    data = p + count * KEYFRAMEINFOSIZE;
+
+    for (i = 0; i < count; i++, p += KEYFRAMEINFOSIZE)
+    {
+        keyframe.tic        = G_getInt(p);
+        keyframe.offset     = G_getInt(p + 4);
+        keyframe.gamemap    = G_getInt(p + 8);
+        keyframe.levelstart = G_getInt(p + 12);
+        keyframe.base       = G_getInt(p + 16);
+        keyframe.length     = G_getInt(p + 20);
+
+        if (keyframe.offset < 0 || keyframe.offset >= markeroffset
+         || keyframe.base >= i || keyframe.length <= 0
+         || (keyframe.base >= 0 && keyframes[keyframe.base].base >= 0)
+         || end - data < keyframe.length
+         || (i > 0 && keyframe.tic < keyframes[i - 1].tic))
+        {
+            G_ClearDemoIndex();
+            return false;
+        }
+
+        // Keep an aligned copy, as images are read in place.
+
+        keyframe.data = Z_Malloc(keyframe.length, PU_STATIC, NULL);
+        memcpy(keyframe.data, data, keyframe.length);
+        data += keyframe.length;
+
+        G_insertKeyframe(&keyframe);
+    }
+
+    return true;
+}
+
+//
+// G_DemoIndexLength
+//
+int G_DemoIndexLength(void)
+{
+    int length;
+    int i;
+
+    G_initInterval();
+
+    if (interval == 0 || numkeyframes == 0)
+    {
+        return 0;
+    }
+
+    length = INDEXHEADERSIZE + numkeyframes * KEYFRAMEINFOSIZE;
+
+    for (i = 0; i < numkeyframes; i++)
+    {
+        length += keyframes[i].length;
+    }
+
+    return length;
+}
+
+//
+// G_WriteDemoIndex
+//
+void G_WriteDemoIndex(byte *dest, int numtics)
+{
+    byte *p;
+    int i;
+
+    if (G_DemoIndexLength() == 0)
+    {
+        return;
+    }
+
+    p = dest;
+    memcpy(p, "SVEI", 4);
+    p += 4;
+    *p++ = DEMOINDEX_VERSION;
+    p = G_putInt(p, numtics);
+    p = G_putInt(p, interval);
+    p = G_putInt(p, numkeyframes);
+
+    for (i = 0; i < numkeyframes; i++)
+    {
+        p = G_putInt(p, keyframes[i].tic);
+        p = G_putInt(p, keyframes[i].offset);
+        p = G_putInt(p, keyframes[i].gamemap);
+        p = G_putInt(p, keyframes[i].levelstart);
+        p = G_putInt(p, keyframes[i].base);
+        p = G_putInt(p, keyframes[i].length);
+    }
+
+    for (i = 0; i < numkeyframes; i++)
+    {
+        memcpy(p, keyframes[i].data, keyframes[i].length);
+        p += keyframes[i].length;
+    }
+}
+
+//
+// Keyframes
+//
+
+//
+// G_DemoKeyframe
+//
+void G_DemoKeyframe(int tic, int offset, int levelstart)
+{
+    keyframe_t keyframe;
+    keyframe_t *base;
+    size_t length;
+    int last;
+
+    G_initInterval();
+
+    if (interval == 0)
+    {
+        return;
+    }
+
+    // One on entering each level, and then every interval.
+
+    last = G_keyframeAtOrBefore(tic);
+
+    if (last >= 0 && keyframes[last].levelstart == levelstart
+     && tic - keyframes[last].tic < interval)
+    {
+        return;
+    }
+
+    keyframe.base = -1;
+
+    if (last >= 0 && keyframes[last].levelstart == levelstart)
+    {
+        keyframe.base = keyframes[last].base >= 0 ? keyframes[last].base
+                                                  : last;
+    }
+
+    base = keyframe.base >= 0 ? &keyframes[keyframe.base] : NULL;
+
+    keyframe.tic = tic;
+    keyframe.offset = offset;
+    keyframe.gamemap = gamemap;
+    keyframe.levelstart = levelstart;
+    keyframe.data = P_ExportState(base ? base->data : NULL,
+                                  base ? base->length : 0, &length);
+    keyframe.length = (int) length;
+
+    G_insertKeyframe(&keyframe);
+}
+
+//
+// G_FindDemoKeyframe
+//
+int G_FindDemoKeyframe(int tic, int levelstart)
+{
+    int i;
+
+    i = G_keyframeAtOrBefore(tic);
+
+    if (i >= 0 && keyframes[i].levelstart == levelstart)
+    {
+        return i;
+    }
+
+    return -1;
+}
+
+//
+// G_RestoreDemoKeyframe
+//
+boolean G_RestoreDemoKeyframe(int keyframe, int *tic, int *offset)
+{
+    keyframe_t *k;
+    keyframe_t *base;
+
+    if (keyframe < 0 || keyframe >= numkeyframes)
+    {
+        return false;
+    }
+
+    k = &keyframes[keyframe];
+    base = k->base >= 0 ? &keyframes[k->base] : NULL;
+
+    if (k->gamemap != gamemap
+     || !P_ImportState(k->data, k->length, base ? base->data : NULL,
+                       base ? base->length : 0))
+    {
+        return false;
+    }
+
+    *tic = k->tic;
+    *offset = k->offset;
+
+    return true;
+}
+
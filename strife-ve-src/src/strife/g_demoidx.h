@@ -0,0 +1,58 @@
+//
+// Copyright(C) 2020 Night Dive Studios, LLC
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//    Demo index: keyframes of the play simulation taken while a demo
+//    is recorded or played, so that playback can seek.
+//
+
+#ifndef __G_DEMOIDX__
+#define __G_DEMOIDX__
+
+#include "doomtype.h"
+
+// Forget all keyframes.
+
+void G_ClearDemoIndex(void);
+
+// Read the index stored after the end marker of a demo, if it has one.
+// Returns false if it has none, or it cannot be used.
+
+boolean G_ReadDemoIndex(const byte *demo, int length, int markeroffset);
+
+// Length of the index when written after the end marker of a demo, and
+// writing it.  numtics is the length of the demo in tics.
+
+int G_DemoIndexLength(void);
+void G_WriteDemoIndex(byte *dest, int numtics);
+
+// Take a keyframe of the current level, if one is due.  tic is the demo
+// tic about to be run, offset where its ticcmds are in the demo, and
+// levelstart the demo tic the current level was entered at.
+
+void G_DemoKeyframe(int tic, int offset, int levelstart);
+
+// Find the last keyframe taken on the level entered at levelstart, at
+// or before tic.  Returns -1 if there is none.  Keyframes of other levels
+// are never used, as they lack the hub state.
+
+int G_FindDemoKeyframe(int tic, int levelstart);
+
+// Put the level back into the state held by a keyframe, and return the
+// tic and demo offset it was taken at.  Returns false if it cannot be
+// restored.
+
+boolean G_RestoreDemoKeyframe(int keyframe, int *tic, int *offset);
+
+#endif
+
@@ -69,6 +69,8 @@
 #include "p_dialog.h"   // villsa [STRIFE]
 
 #include "g_game.h"
+#include "g_demoidx.h" // [SVE]
+#include "g_regress.h" // [SVE]
 
 // [SVE] svillarreal
 #include "i_joystick.h"
@@ -90,7 +92,10 @@ void	G_DoPlayDemo (void);
 void	G_DoCompleted (void); 
 void	G_DoVictory (void); 
 void	G_DoWorldDone (void); 
-void	G_DoSaveGame (char *path, char *tempPath);
+void	G_DoSaveGame (char *path);
+
+static boolean G_DemoTicStart(void);   // [SVE]
+static boolean G_DemoResponder(int key);
  
 // Gamestate the last time G_Ticker was called.
 
@@ -145,6 +150,18 @@ byte*		demobuffer;
 byte*		demo_p;
 byte*		demoend; 
 boolean         singledemo;             // quit after playing a demo from cmdline 
+
+// [SVE] Demo seeking: the demo tic about to be run, the demo tic the
+// current level was entered at, the tic being sought or -1, and whether
+// playback is paused.
+int             demotic;
+static int      demolevelstart;
+static int      demoseektic = -1;
+static int      demonumtics;
+static boolean  demopaused;
+
+// [SVE] Set while the demo is restarted to seek back past the level.
+static boolean  demorestarting;
  
 boolean         precache = true;        // if true, load all graphics at start 
 
@@ -266,6 +283,10 @@ mobj_t*		bodyque[BODYQUESIZE];
  
 // haleyjd 20140831: [SVE] changed defaults
 int             vanilla_savegame_limit = 0;
+
+// [SVE] compress savegames written to disk; off by default, as older
+// builds cannot load compressed saves
+int             compress_savegames = 0;
 int             vanilla_demo_limit = 0;
 
 // edward: [SVE] New weapon cycling behaviour;
@@ -879,6 +900,7 @@ void G_DoLoadLevel(void)
     i_weaponCycleTics = 0;
 
     levelstarttic = gametic;        // for time calculation
+    demolevelstart = demotic;       // [SVE] for demo keyframes
 
     if (wipegamestate == GS_LEVEL) 
         wipegamestate = -1;             // force a wipe 
@@ -1013,6 +1035,13 @@ boolean G_Responder (event_t* ev)
         return true; 
     }
 
+    // [SVE] seek in demos played from the command line
+    if (demoplayback && singledemo && ev->type == ev_keydown
+        && G_DemoResponder(ev->data1))
+    {
+        return true;
+    }
+
     // any other key pops up menu if in demos
     if (gameaction == ga_nothing && !singledemo && 
         (demoplayback || gamestate == GS_DEMOSCREEN) 
@@ -1196,7 +1225,8 @@ void G_Ticker (void)
             M_SaveMoveMapToHere(); // [STRIFE]
             M_SaveMisObj(savepath);
             P_WriteActiveLocations(savepath);
-            G_DoSaveGame(savepath, savegamedir); 
+            G_DoSaveGame(savepath); 
+            M_FlushSlot(); // [SVE]
 
             // dimitrisg 20200629 : commit save data to NX
             I_FlushSaves();
@@ -1225,9 +1255,13 @@ void G_Ticker (void)
         } 
     }
     
+    // [SVE] demo keyframes and seeking
+    if ((demoplayback || demorecording) && !G_DemoTicStart())
+        return;
+
     // get commands, check consistancy,
     // and build new consistancy check
-    buf = (gametic/ticdup)%BACKUPTICS; 
+    buf = runtic%BACKUPTICS; // [SVE] ticdup may change
 
     // STRIFE-TODO: pnameprefixes bullcrap
 
@@ -1298,9 +1332,10 @@ void G_Ticker (void)
                 Z_Free(prettyName);
             }
 
-            if (netgame && !netdemo && !(gametic%ticdup) ) 
+            if (netgame && !netdemo && firstduptic) // [SVE]
             { 
-                if (gametic > BACKUPTICS 
+                // [SVE] predicted input carries no valid consistancy
+                if (gametic > BACKUPTICS && !predictingtic
                     && consistancy[i][buf] != cmd->consistancy) 
                 { 
                     I_Error ("Consistency failure (%i should be %i)",
@@ -1313,6 +1348,9 @@ void G_Ticker (void)
             } 
         }
     }
+
+    if (demoplayback || demorecording)
+        ++demotic; // [SVE]
     
     // check for special buttons
     for (i=0 ; i<MAXPLAYERS ; i++)
@@ -1353,6 +1391,8 @@ void G_Ticker (void)
     { 
     case GS_LEVEL: 
         P_Ticker (); 
+        if (demoplayback || demorecording)
+            G_StateHashTic(demotic); // [SVE] regression checkpoints
         ST_Ticker (); 
         AM_Ticker (); 
         HU_Ticker ();
@@ -1615,6 +1655,7 @@ void G_DeathMatchSpawnPlayer (int playernum)
 //
 // haleyjd 20101003: [STRIFE] New function
 // Sets loadpath based on the map and "savepathtemp"
+// [SVE] loadpath is the name of the map's file within savepathtemp.
 //
 void G_LoadPath(int map)
 {
@@ -1623,10 +1664,11 @@ void G_LoadPath(int map)
     memset(mapbuf, 0, sizeof(mapbuf));
     M_snprintf(mapbuf, sizeof(mapbuf), "%d", map);
 
-    // haleyjd: free if already set, and use M_SafeFilePath
+    // haleyjd: free if already set
     if(loadpath)
         Z_Free(loadpath);
-    loadpath = M_SafeFilePath(savepathtemp, mapbuf);
+    loadpath = Z_Malloc(strlen(mapbuf) + 1, PU_STATIC, NULL);
+    M_StringCopy(loadpath, mapbuf, strlen(mapbuf) + 1);
 }
 
 //
@@ -1888,7 +1930,7 @@ void G_DoCompleted(void)
 
     // [STRIFE] HUB SAVE
     if(!deathmatch)
-        G_DoSaveGame(savepathtemp, tmpsavegamedir);
+        G_DoSaveGame(savepathtemp);
     
     // [SVE]: Capture the Chalice intermission
     if(capturethechalice)
@@ -2004,7 +2046,7 @@ void G_DoWorldDone (void)
 
         // [STRIFE] HUB SAVE
         G_RiftPlayer();
-        G_DoSaveGame(savepathtemp, tmpsavegamedir);
+        G_DoSaveGame(savepathtemp);
         M_SaveMisObj(savepathtemp);
         P_WriteActiveLocations(savepathtemp);
     }
@@ -2034,13 +2076,15 @@ void G_DoWorldDone2(void)
 //
 void G_ReadCurrent(const char *path)
 {
-    char *temppath = NULL;
     byte *buffer = NULL;
 
-    temppath = M_SafeFilePath(path, "\\current");
-
-    if(M_ReadFile(temppath, &buffer) < 4) // [SVE]: ensure 4 bytes at least.
+    // [SVE]: ensure 4 bytes at least.
+    if(M_ReadSaveFile(path, "current", &buffer) < 4)
+    {
+        if(buffer)
+            Z_Free(buffer);
         gameaction = ga_newgame;
+    }
     else
     {
         // haleyjd 20110211: do endian-correct read
@@ -2052,8 +2096,6 @@ void G_ReadCurrent(const char *path)
         Z_Free(buffer);
     }
 
-    Z_Free(temppath);
-    
     G_LoadPath(gamemap);
 }
 
@@ -2086,16 +2128,10 @@ void G_LoadGame (char* name)
 static boolean G_HasVisitedMap(int mapnum)
 {
     char mapbuf[33];
-    char *temppath;
-    boolean res;
 
     M_Itoa(mapnum, mapbuf, 10);
 
-    temppath = M_SafeFilePath(savepathtemp, mapbuf);
-    res = M_FileExists(temppath);
-    Z_Free(temppath);
-
-    return res;
+    return M_SaveFileExists(savepathtemp, mapbuf);
 }
 
 //
@@ -2334,10 +2370,9 @@ static void G_SpecialReborn(void)
 //
 // haleyjd 20141122: [SVE] Handle load game errors gracefully
 //
-static void G_HandleLoadError(FILE *save_stream, boolean userload)
+static void G_HandleLoadError(boolean userload)
 {
-    if(save_stream)
-        fclose(save_stream);
+    P_CloseSaveBuffer();
 
     if(userload)
     {
@@ -2355,28 +2390,27 @@ void G_DoLoadGame(boolean userload)
     int savedleveltime;
     skill_t savedcurskill; // haleyjd: [SVE] fix skill level issue with saves
     skill_t newskill;
+    byte *savebuffer = NULL;
+    int savelength;
 
     gameaction = ga_nothing;
 
-    save_stream = fopen(loadpath, "rb");
+    // [SVE] hub saves are held in memory
+    savelength = M_ReadSaveFile(savepathtemp, loadpath, &savebuffer);
 
     // [STRIFE] If the file does not exist, G_DoLoadLevel is called.
-    if(save_stream == NULL)
+    if(savelength < 0)
     {
         G_DoLoadLevel();
         return;
     }
 
-    // edward [SVE]: vastly reduce the number of reads performed on flash storage
-    static char readBuffer[256 * 1024];
-    setvbuf(save_stream, readBuffer, _IOFBF, sizeof(readBuffer));
-
-    savegame_error = false;
+    // [SVE] the save buffer takes ownership of the file data
     savedcurskill  = gameskill;
 
-    if(!P_ReadSaveGameHeader())
+    if(!P_OpenLoadBuffer(savebuffer, savelength) || !P_ReadSaveGameHeader())
     {
-        G_HandleLoadError(save_stream, userload);
+        G_HandleLoadError(userload);
         return;
     }
 
@@ -2408,7 +2442,7 @@ void G_DoLoadGame(boolean userload)
     // [SVE]: error check
     if(savegame_error)
     {
-        G_HandleLoadError(save_stream, userload);
+        G_HandleLoadError(userload);
         return;
     }
 
@@ -2417,7 +2451,7 @@ void G_DoLoadGame(boolean userload)
     // [SVE]: error check
     if(savegame_error)
     {
-        G_HandleLoadError(save_stream, userload);
+        G_HandleLoadError(userload);
         return;
     }
 
@@ -2426,18 +2460,18 @@ void G_DoLoadGame(boolean userload)
     // [SVE]: error check
     if(savegame_error)
     {
-        G_HandleLoadError(save_stream, userload);
+        G_HandleLoadError(userload);
         return;
     }
  
     if(!P_ReadSaveGameEOF())
     {
         // [SVE]
-        G_HandleLoadError(save_stream, userload);
+        G_HandleLoadError(userload);
         return;
     }
 
-    fclose(save_stream);
+    P_CloseSaveBuffer();
     
     if (setsizeneeded)
         R_ExecuteSetViewSize ();
@@ -2460,7 +2494,6 @@ void G_DoLoadGame(boolean userload)
 boolean G_WriteSaveName(int slot, const char *charname)
 {
     //char savedir[16];
-    char *tmpname;
     boolean retval;
 
     savegameslot = slot;
@@ -2483,16 +2516,9 @@ boolean G_WriteSaveName(int slot, const char *charname)
     memset(character_name, 0, CHARACTER_NAME_LEN);
     M_StringCopy(character_name, charname, sizeof(character_name));
 
-    // haleyjd: use M_SafeFilePath
-    tmpname = M_SafeFilePath(savepathtemp, "name");
-
     // Write the "name" file under the directory
-    retval = M_WriteFile(tmpname, character_name, 32);
-
-    // dimitrisg 20200629 : commit save data to NX
-    I_FlushSaves();
-
-    Z_Free(tmpname);
+    // [SVE] which is held in memory until the game is saved
+    retval = M_WriteSaveFile(savepathtemp, "name", character_name, 32);
 
     return retval;
 }
@@ -2516,49 +2542,32 @@ G_SaveGame
 }
 */
 
-void G_DoSaveGame (char *path, char *tempPath)
+void G_DoSaveGame (char *path)
 { 
-    char *current_path;
-    char *savegame_file;
-    char *temp_savegame_file;
     byte gamemapbytes[4];
     char gamemapstr[33];
+    byte *savebuffer;
+    size_t savelength;
 
-    temp_savegame_file = P_TempSaveGameFile(tempPath);
-    
     // [STRIFE] custom save file path logic
     memset(gamemapstr, 0, sizeof(gamemapstr));
     M_snprintf(gamemapstr, sizeof(gamemapstr), "%d", gamemap);
-    savegame_file = M_SafeFilePath(path, gamemapstr);
 
     // [STRIFE] write the "current" file, which tells which hub map
     //   the save slot is currently on.
-    current_path = M_SafeFilePath(path, "current");
     // haleyjd: endian-agnostic IO
     gamemapbytes[0] = (byte)( gamemap        & 0xff);
     gamemapbytes[1] = (byte)((gamemap >>  8) & 0xff);
     gamemapbytes[2] = (byte)((gamemap >> 16) & 0xff);
     gamemapbytes[3] = (byte)((gamemap >> 24) & 0xff);
-    M_WriteFile(current_path, gamemapbytes, 4);
-    Z_Free(current_path);
+    M_WriteSaveFile(path, "current", gamemapbytes, 4);
 
-    // Open the savegame file for writing.  We write to a temporary file
-    // and then rename it at the end if it was successfully written.
-    // This prevents an existing savegame from being overwritten by 
-    // a corrupted one, or if a savegame buffer overrun occurs.
+    // [SVE] The savegame is built in memory and only replaces the old one
+    // once it has been written successfully. This prevents an existing
+    // savegame from being overwritten by a corrupted one, or if a
+    // savegame buffer overrun occurs.
 
-    save_stream = fopen(temp_savegame_file, "wb");
-
-    if (save_stream == NULL)
-    {
-        return;
-    }
-
-    // edward [SVE]: vastly reduce the number of writes performed on flash storage
-    static char writeBuffer[256 * 1024];
-    setvbuf(save_stream, writeBuffer, _IOFBF, sizeof(writeBuffer));
-
-    savegame_error = false;
+    P_OpenSaveBuffer();
 
     P_WriteSaveGameHeader(savedescription);
  
@@ -2573,23 +2582,20 @@ void G_DoSaveGame (char *path, char *tempPath)
     // except if the vanilla_savegame_limit setting is turned off.
     // [STRIFE]: Verified subject to same limit.
 
-    if (vanilla_savegame_limit && ftell(save_stream) > SAVEGAMESIZE)
+    if (vanilla_savegame_limit && P_SaveBufferLength() > SAVEGAMESIZE)
     {
         I_Error ("Savegame buffer overrun");
     }
     
-    // Finish up, close the savegame file.
-
-    fclose(save_stream);
+    // Now store the savegame, replacing the old savegame if there was
+    // one there.
 
-    // Now rename the temporary savegame file to the actual savegame
-    // file, overwriting the old savegame if there was one there.
-
-    remove(savegame_file);
-    rename(temp_savegame_file, savegame_file);
-    
-    // haleyjd: free the savegame_file path
-    Z_Free(savegame_file);
+    // [SVE] optionally LZ-compressed; hub saves stay in memory, so
+    // compressing them would only cost time
+    P_FinishSaveBuffer(compress_savegames && strcmp(path, savepathtemp),
+                       &savebuffer, &savelength);
+    M_WriteSaveFile(path, gamemapstr, savebuffer, savelength);
+    Z_Free(savebuffer);
 
     gameaction = ga_nothing; 
     //M_StringCopy(savedescription, "", sizeof(savedescription));
@@ -2928,6 +2934,136 @@ void G_WriteDemoTiccmd (ticcmd_t* cmd)
 
     G_ReadDemoTiccmd (cmd);         // make SURE it is exactly the same 
 } 
+
+//
+// G_DemoSeek
+//
+// [SVE] Move demo playback to the given tic, restoring the nearest
+// keyframe before it on the current level and running the rest without
+// drawing.  Seeks to other levels run every tic in between, or replay
+// the demo from the start if going back.
+//
+void G_DemoSeek(int tic)
+{
+    if (!demoplayback)
+        return;
+
+    // Stop short of the end, which would end playback.
+    if (tic >= demonumtics)
+        tic = demonumtics - 1;
+
+    demoseektic = tic > 0 ? tic : 0;
+}
+
+//
+// G_DemoSeeking
+//
+// [SVE] True while a seek is under way.
+//
+boolean G_DemoSeeking(void)
+{
+    return demoplayback && demoseektic >= 0;
+}
+
+//
+// G_DemoTicStart
+//
+// [SVE] Called at the start of each tic of a demo, before its ticcmds are
+// read: takes keyframes and carries out seeks. Returns false if the tic
+// is not to be run.
+//
+static boolean G_DemoTicStart(void)
+{
+    int keyframe;
+    int tic, offset;
+
+    if (gamestate == GS_LEVEL && gameaction == ga_nothing)
+    {
+        // Jump to the last keyframe before the tic sought, unless that
+        // would not get any closer.
+
+        if (demoplayback && demoseektic >= 0)
+        {
+            keyframe = G_FindDemoKeyframe(demoseektic, demolevelstart);
+
+            if (keyframe >= 0
+                && (demoseektic < demotic
+                    || keyframe != G_FindDemoKeyframe(demotic, demolevelstart))
+                && G_RestoreDemoKeyframe(keyframe, &tic, &offset))
+            {
+                demotic = tic;
+                demo_p = demobuffer + offset;
+            }
+        }
+
+        // Each keyframe is a full export, so playback only takes them
+        // where seeking can use them: not in the attract loop, and
+        // not inside a timed run.
+
+        if (demorecording || (singledemo && !timingdemo) || demoseektic >= 0)
+            G_DemoKeyframe(demotic, demo_p - demobuffer, demolevelstart);
+    }
+
+    if (demoplayback && demoseektic >= 0 && demoseektic < demotic)
+    {
+        // Nothing to go back to on this level: start again from the top.
+
+        demorestarting = true;
+        gameaction = ga_playdemo;
+        return false;
+    }
+
+    if (demoseektic == demotic)
+        demoseektic = -1;
+
+    return !demopaused || demoseektic >= 0;
+}
+
+//
+// G_DemoResponder
+//
+// [SVE] Keys for moving about in a demo: pause, step a tic either way,
+// and skip ten seconds either way.
+//
+static boolean G_DemoResponder(int key)
+{
+    int target;
+
+    if (key == key_pause)
+    {
+        demopaused = !demopaused;
+        return true;
+    }
+
+    // Step from the tic being sought, so that held keys keep going.
+
+    target = demoseektic >= 0 ? demoseektic : demotic;
+
+    if (key == key_demo_stepback)
+    {
+        demopaused = true;
+        G_DemoSeek(target - 1);
+    }
+    else if (key == key_demo_stepforward)
+    {
+        demopaused = true;
+        G_DemoSeek(target + 1);
+    }
+    else if (key == key_demo_rewind)
+    {
+        G_DemoSeek(target - 10 * TICRATE);
+    }
+    else if (key == key_demo_ffwd)
+    {
+        G_DemoSeek(target + 10 * TICRATE);
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
  
  
  
@@ -2987,6 +3123,12 @@ void G_BeginRecording (void)
 
     demo_p = demobuffer;
 
+    // [SVE] start a fresh index
+    G_ClearDemoIndex();
+    demotic = 0;
+    demolevelstart = 0;
+    G_StartStateHash();
+
     // Save the right version code for this demo
     *demo_p++ = STRIFE_VERSION;
 
@@ -3058,6 +3200,11 @@ void G_DoPlayDemo (void)
     int     demoversion;
 
     gameaction = ga_nothing; 
+
+    // [SVE] restarting to seek back: the lump is still cached
+    if (demorestarting)
+        W_ReleaseLumpName(defdemoname);
+
     demobuffer = demo_p = W_CacheLumpName (defdemoname, PU_STATIC); 
 
     demoversion = *demo_p++;
@@ -3099,6 +3246,52 @@ void G_DoPlayDemo (void)
     for (i=0 ; i<MAXPLAYERS ; i++) 
         playeringame[i] = *demo_p++; 
 
+    // [SVE] Read the keyframes stored after the end of the demo, if any.
+    // A restart keeps those already taken.
+    demotic = 0;
+    demolevelstart = 0;
+
+    if (!demorestarting)
+    {
+        int length = W_LumpLength(W_GetNumForName(defdemoname));
+        byte *marker = demo_p;
+        int numplayers = 0;
+
+        while (marker < demobuffer + length && *marker != DEMOMARKER)
+            marker += 6;
+
+        for (i=0 ; i<MAXPLAYERS ; i++)
+            numplayers += playeringame[i] != 0;
+
+        demonumtics = (marker - demo_p) / (6 * MAX(numplayers, 1));
+
+        if (marker >= demobuffer + length
+         || !G_ReadDemoIndex(demobuffer, length, marker - demobuffer))
+        {
+            G_ClearDemoIndex();
+        }
+
+        demoseektic = -1;
+        demopaused = false;
+
+        //!
+        // @arg <tic>
+        // @category demo
+        //
+        // Start demo playback at the given tic.
+        //
+
+        i = M_CheckParmWithArgs("-demoseek", 1);
+
+        if (i > 0)
+            demoseektic = MIN(atoi(myargv[i+1]), demonumtics - 1);
+
+        if (singledemo || timingdemo)
+            G_StartStateHash();
+    }
+
+    demorestarting = false;
+
     //!
     // @category demo
     // 
@@ -3162,6 +3355,8 @@ boolean G_CheckDemoStatus (void)
 { 
     int             endtime; 
 
+    G_FinishStateHash(demotic); // [SVE]
+
     if (timingdemo) 
     { 
         float fps;
@@ -3182,6 +3377,8 @@ boolean G_CheckDemoStatus (void)
     if (demoplayback) 
     { 
         W_ReleaseLumpName(defdemoname);
+        G_ClearDemoIndex(); // [SVE]
+        demoseektic = -1;
         demoplayback = false; 
         netdemo = false;
         netgame = false;
@@ -3202,8 +3399,20 @@ boolean G_CheckDemoStatus (void)
  
     if (demorecording) 
     { 
+        byte *demofile;
+        int demolength;
+
         *demo_p++ = DEMOMARKER; 
-        M_WriteFile (demoname, demobuffer, demo_p - demobuffer); 
+
+        // [SVE] keyframe index after the end marker
+        demolength = demo_p - demobuffer;
+        demofile = Z_Malloc(demolength + G_DemoIndexLength(), PU_STATIC, NULL);
+        memcpy(demofile, demobuffer, demolength);
+        G_WriteDemoIndex(demofile + demolength, demotic);
+
+        M_WriteFile (demoname, demofile,
+                     demolength + G_DemoIndexLength()); 
+        Z_Free (demofile);
         Z_Free (demobuffer); 
         demorecording = false; 
         I_Error ("Demo %s recorded", demoname); 
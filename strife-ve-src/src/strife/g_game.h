@@ -59,6 +59,10 @@ void G_PlayDemo (char* name);
 void G_TimeDemo (char* name);
 boolean G_CheckDemoStatus (void);
 
+// [SVE] Seeking in demo playback
+void G_DemoSeek(int tic);
+boolean G_DemoSeeking(void);
+
 void G_RiftExitLevel(int map, int spot, angle_t angle); // [STRIFE]
 void G_ExitLevel (int dest);
 //void G_SecretExitLevel (void);
@@ -85,5 +89,6 @@ boolean G_WriteSaveName(int slot, const char *charname);
 void    G_ReadCurrent(const char *path);
 
 extern int vanilla_savegame_limit;
+extern int compress_savegames;
 extern int vanilla_demo_limit;
 #endif
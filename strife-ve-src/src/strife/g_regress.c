@@ -0,0 +1,1140 @@
+//
+// Copyright(C) 2020 Night Dive Studios, LLC
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//    Demo regression testing.
+//
+//    While a demo plays with -statehash, a hash of the play simulation
+//    is taken every few tics and checked against a golden file made by
+//    an earlier run.  If there is no golden file, one is written:
+//
+//      'S' 'V' 'E' 'H'  magic
+//      version          1 byte
+//      interval         tics between checkpoints
+//      for each checkpoint:
+//        tic            demo tics run when it was taken
+//        gamemap
+//        leveltime
+//        prndindex      P_Random index
+//        sectorhash     heights, lights and specials of all sectors
+//        playerhash     health, armor, ammo and inventory of players
+//        rolling        hash of this and every earlier checkpoint
+//        nummobjs
+//        for each mobj, in thinker order: its hash and type
+//
+//    All numbers are 32-bit little-endian.  The first checkpoint that
+//    does not match is reported with the mobj or other state that went
+//    wrong; the desync happened at most one interval before it.
+//
+//    -regress plays a directory of demos this way, each in its own
+//    process of the same executable, several at once.
+//
+
+#if defined(_MSC_VER)
+#include <win_opendir.h>
+#elif defined(__GNUC__) || defined(POSIX)
+#include <dirent.h>
+#else
+#error Need an include for dirent.h!
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <process.h>
+#else
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "SDL.h"
+
+#include "doomdef.h"
+#include "doomstat.h"
+#include "g_regress.h"
+#include "i_system.h"
+#include "i_timer.h"
+#include "m_argv.h"
+#include "m_misc.h"
+#include "m_saves.h"
+#include "p_local.h"
+#include "r_state.h"
+#include "z_zone.h"
+
+#define STATEHASH_VERSION 1
+
+#define HASHHEADERSIZE     9
+#define CHECKPOINTSIZE     32
+#define MOBJHASHSIZE       8
+
+extern int prndindex;
+
+typedef struct
+{
+    unsigned int hash;
+    int          type;
+    mobj_t      *mo;
+    int          thinker;
+} mobjhash_t;
+
+static boolean hashing = false;
+static int hashinterval;
+static int hashstarttime;
+static int lastchecktic;
+static int numcheckpoints;
+static unsigned int rollinghash;
+
+static mobjhash_t *mobjhashes = NULL;
+static int nummobjhashesalloc = 0;
+
+// Golden file being written, and its final name.
+
+static FILE *goldenout = NULL;
+static char *goldenname = NULL;
+static char *goldentemp = NULL;
+
+// Golden file being compared against.
+
+static byte *golden = NULL;
+static byte *goldenp;
+static byte *goldenend;
+
+// First checkpoint that did not match.
+
+static int desynctic;
+static int desyncafter;
+static char desyncdetail[160];
+
+static int G_getInt(const byte *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+static byte *G_putInt(byte *p, int value)
+{
+    *p++ = value & 0xff;
+    *p++ = (value >> 8) & 0xff;
+    *p++ = (value >> 16) & 0xff;
+    *p++ = ((unsigned int) value >> 24) & 0xff;
+
+    return p;
+}
+
+//
+// G_hashInt
+//
+// FNV-1a, a byte at a time.
+//
+static unsigned int G_hashInt(unsigned int hash, int value)
+{
+    int i;
+
+    for (i = 0; i < 4; i++)
+    {
+        hash = (hash ^ (value & 0xff)) * 16777619U;
+        value >>= 8;
+    }
+
+    return hash;
+}
+
+#define HASHSEED 2166136261U
+
+static unsigned int G_hashMobj(mobj_t *mo)
+{
+    unsigned int hash = HASHSEED;
+
+    hash = G_hashInt(hash, mo->type);
+    hash = G_hashInt(hash, mo->x);
+    hash = G_hashInt(hash, mo->y);
+    hash = G_hashInt(hash, mo->z);
+    hash = G_hashInt(hash, mo->momx);
+    hash = G_hashInt(hash, mo->momy);
+    hash = G_hashInt(hash, mo->momz);
+    hash = G_hashInt(hash, mo->angle);
+    hash = G_hashInt(hash, mo->health);
+    hash = G_hashInt(hash, mo->flags);
+    hash = G_hashInt(hash, mo->state - states);
+    hash = G_hashInt(hash, mo->tics);
+
+    return hash;
+}
+
+static unsigned int G_hashSectors(void)
+{
+    unsigned int hash = HASHSEED;
+    int i;
+
+    for (i = 0; i < numsectors; i++)
+    {
+        hash = G_hashInt(hash, sectors[i].floorheight);
+        hash = G_hashInt(hash, sectors[i].ceilingheight);
+        hash = G_hashInt(hash, sectors[i].lightlevel);
+        hash = G_hashInt(hash, sectors[i].special);
+    }
+
+    return hash;
+}
+
+static unsigned int G_hashPlayers(void)
+{
+    unsigned int hash = HASHSEED;
+    player_t *player;
+    int i, j;
+
+    for (i = 0; i < MAXPLAYERS; i++)
+    {
+        if (!playeringame[i])
+        {
+            continue;
+        }
+
+        player = &players[i];
+
+        hash = G_hashInt(hash, player->playerstate);
+        hash = G_hashInt(hash, player->health);
+        hash = G_hashInt(hash, player->armorpoints);
+        hash = G_hashInt(hash, player->armortype);
+        hash = G_hashInt(hash, player->readyweapon);
+        hash = G_hashInt(hash, player->numinventory);
+
+        for (j = 0; j < NUMAMMO; j++)
+        {
+            hash = G_hashInt(hash, player->ammo[j]);
+        }
+
+        for (j = 0; j < player->numinventory; j++)
+        {
+            hash = G_hashInt(hash, player->inventory[j].type);
+            hash = G_hashInt(hash, player->inventory[j].amount);
+        }
+    }
+
+    return hash;
+}
+
+//
+// G_hashMobjs
+//
+// Hash every mobj, in thinker order. Returns how many there are.
+//
+static int G_hashMobjs(void)
+{
+    thinker_t *th;
+    int count = 0;
+    int index = 0;
+
+    for (th = thinkercap.next; th != &thinkercap; th = th->next, index++)
+    {
+        if (th->function.acp1 != (actionf_p1) P_MobjThinker)
+        {
+            continue;
+        }
+
+        if (count == nummobjhashesalloc)
+        {
+            nummobjhashesalloc = nummobjhashesalloc ? nummobjhashesalloc * 2
+                                                    : 1024;
+            mobjhashes = realloc(mobjhashes,
+                                 nummobjhashesalloc * sizeof(*mobjhashes));
+
+            if (mobjhashes == NULL)
+            {
+                I_Error("G_hashMobjs: Failed to allocate %d hashes",
+                        nummobjhashesalloc);
+            }
+        }
+
+        mobjhashes[count].mo = (mobj_t *) th;
+        mobjhashes[count].hash = G_hashMobj((mobj_t *) th);
+        mobjhashes[count].type = ((mobj_t *) th)->type;
+        mobjhashes[count].thinker = index;
+        ++count;
+    }
+
+    return count;
+}
+
+static void G_describeMobj(int i, char *buf, size_t buflen)
+{
+    mobj_t *mo = mobjhashes[i].mo;
+
+    M_snprintf(buf, buflen,
+               "mobj %i (thinker %i): type %i (%.4s) at (%i, %i, %i), "
+               "health %i", i, mobjhashes[i].thinker, mo->type,
+               sprnames[mo->sprite], mo->x >> FRACBITS, mo->y >> FRACBITS,
+               mo->z >> FRACBITS, mo->health);
+}
+
+static void G_desync(int tic, const char *detail)
+{
+    desynctic = tic;
+    desyncafter = lastchecktic;
+    M_StringCopy(desyncdetail, detail, sizeof(desyncdetail));
+}
+
+//
+// G_compareCheckpoint
+//
+// Check a checkpoint against the next one in the golden file, and
+// name what differs if they do not match.
+//
+static void G_compareCheckpoint(int tic, const int *values, int count)
+{
+    char detail[160];
+    const byte *p = goldenp;
+    int gvalues[8];
+    int i, gcount;
+
+    if (goldenend - p < CHECKPOINTSIZE)
+    {
+        G_desync(tic, "golden file ends before this tic");
+        return;
+    }
+
+    for (i = 0; i < 8; i++)
+    {
+        gvalues[i] = G_getInt(p + i * 4);
+    }
+
+    p += CHECKPOINTSIZE;
+    gcount = gvalues[7];
+
+    if (gcount < 0 || (goldenend - p) / MOBJHASHSIZE < gcount)
+    {
+        G_desync(tic, "golden file is damaged");
+        return;
+    }
+
+    goldenp = (byte *) p + gcount * MOBJHASHSIZE;
+
+    if (gvalues[0] != tic)
+    {
+        M_snprintf(detail, sizeof(detail),
+                   "golden file has a checkpoint at tic %i instead",
+                   gvalues[0]);
+        G_desync(tic, detail);
+        return;
+    }
+
+    if ((unsigned int) gvalues[6] == rollinghash)
+    {
+        return;
+    }
+
+    if (gvalues[1] != values[1])
+    {
+        M_snprintf(detail, sizeof(detail), "on map %i, should be map %i",
+                   values[1], gvalues[1]);
+    }
+    else if (gvalues[2] != values[2])
+    {
+        M_snprintf(detail, sizeof(detail), "leveltime %i, should be %i",
+                   values[2], gvalues[2]);
+    }
+    else
+    {
+        for (i = 0; i < count && i < gcount; i++)
+        {
+            if ((unsigned int) G_getInt(p + i * MOBJHASHSIZE)
+                != mobjhashes[i].hash)
+            {
+                break;
+            }
+        }
+
+        if (i < count && i < gcount)
+        {
+            G_describeMobj(i, detail, sizeof(detail));
+
+            if (G_getInt(p + i * MOBJHASHSIZE + 4) != mobjhashes[i].type)
+            {
+                M_StringConcat(detail, ", should be another type",
+                               sizeof(detail));
+            }
+        }
+        else if (count > gcount)
+        {
+            G_describeMobj(gcount, detail, sizeof(detail));
+            M_StringConcat(detail, ", should not exist", sizeof(detail));
+        }
+        else if (count < gcount)
+        {
+            M_snprintf(detail, sizeof(detail),
+                       "mobj %i: type %i is missing", count,
+                       G_getInt(p + count * MOBJHASHSIZE + 4));
+        }
+        else if (gvalues[3] != values[3])
+        {
+            M_snprintf(detail, sizeof(detail),
+                       "P_Random index %i, should be %i",
+                       values[3], gvalues[3]);
+        }
+        else if (gvalues[4] != values[4])
+        {
+            M_StringCopy(detail, "sector heights, lights or specials",
+                         sizeof(detail));
+        }
+        else if (gvalues[5] != values[5])
+        {
+            M_StringCopy(detail, "player health, armor, ammo or inventory",
+                         sizeof(detail));
+        }
+        else
+        {
+            // Only earlier checkpoints differ, which they cannot have.
+
+            M_StringCopy(detail, "golden file is damaged", sizeof(detail));
+        }
+    }
+
+    G_desync(tic, detail);
+}
+
+//
+// G_StartStateHash
+//
+void G_StartStateHash(void)
+{
+    byte header[HASHHEADERSIZE];
+    int length;
+    int p;
+
+    //!
+    // @arg <file>
+    // @category demo
+    //
+    // While playing back or recording a demo, check the play
+    // simulation against the given golden file, naming the first tic
+    // and thinker that differ.  If the file does not exist, or a demo
+    // is being recorded, write it instead.
+    //
+
+    p = M_CheckParmWithArgs("-statehash", 1);
+
+    if (p <= 0)
+    {
+        return;
+    }
+
+    G_FinishStateHash(0);
+
+    hashing = true;
+    hashstarttime = I_GetTimeMS();
+    lastchecktic = 0;
+    numcheckpoints = 0;
+    rollinghash = HASHSEED;
+    desynctic = -1;
+    desyncafter = 0;
+    desyncdetail[0] = '\0';
+
+    goldenname = M_Strdup(myargv[p + 1]);
+
+    if (!demorecording && M_FileExists(goldenname))
+    {
+        length = M_ReadFile(goldenname, &golden);
+
+        if (length < HASHHEADERSIZE || memcmp(golden, "SVEH", 4)
+         || golden[4] != STATEHASH_VERSION || G_getInt(golden + 5) <= 0)
+        {
+            I_Error("G_StartStateHash: %s is not a state hash file",
+                    goldenname);
+        }
+
+        hashinterval = G_getInt(golden + 5);
+        goldenp = golden + HASHHEADERSIZE;
+        goldenend = golden + length;
+
+        return;
+    }
+
+    //!
+    // @arg <tics>
+    // @category demo
+    //
+    // Tics between the checkpoints written to a -statehash golden file.
+    // The default is 35; 1 names the exact tic a desync happens at.
+    //
+
+    hashinterval = TICRATE;
+    p = M_CheckParmWithArgs("-statehashtics", 1);
+
+    if (p > 0)
+    {
+        hashinterval = MAX(atoi(myargv[p + 1]), 1);
+    }
+
+    // Write under another name until done, so that a run which does
+    // not finish leaves no golden file.
+
+    goldentemp = M_StringJoin(goldenname, ".tmp", NULL);
+    goldenout = fopen(goldentemp, "wb");
+
+    if (goldenout == NULL)
+    {
+        I_Error("G_StartStateHash: Couldn't write %s", goldentemp);
+    }
+
+    memcpy(header, "SVEH", 4);
+    header[4] = STATEHASH_VERSION;
+    G_putInt(header + 5, hashinterval);
+    fwrite(header, 1, sizeof(header), goldenout);
+}
+
+//
+// G_StateHashTic
+//
+void G_StateHashTic(int tic)
+{
+    byte buf[CHECKPOINTSIZE];
+    byte *p;
+    int values[8];
+    int count;
+    int i;
+
+    // Tics already checked are run again after a seek.
+
+    if (!hashing || tic <= lastchecktic || tic % hashinterval)
+    {
+        return;
+    }
+
+    count = G_hashMobjs();
+
+    values[0] = tic;
+    values[1] = gamemap;
+    values[2] = leveltime;
+    values[3] = prndindex;
+    values[4] = G_hashSectors();
+    values[5] = G_hashPlayers();
+    values[7] = count;
+
+    for (i = 1; i < 6; i++)
+    {
+        rollinghash = G_hashInt(rollinghash, values[i]);
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        rollinghash = G_hashInt(rollinghash, mobjhashes[i].hash);
+    }
+
+    values[6] = rollinghash;
+
+    if (goldenout != NULL)
+    {
+        for (i = 0, p = buf; i < 8; i++)
+        {
+            p = G_putInt(p, values[i]);
+        }
+
+        fwrite(buf, 1, CHECKPOINTSIZE, goldenout);
+
+        for (i = 0; i < count; i++)
+        {
+            G_putInt(buf, mobjhashes[i].hash);
+            G_putInt(buf + 4, mobjhashes[i].type);
+            fwrite(buf, 1, MOBJHASHSIZE, goldenout);
+        }
+    }
+    else if (desynctic < 0)
+    {
+        G_compareCheckpoint(tic, values, count);
+    }
+
+    lastchecktic = tic;
+    ++numcheckpoints;
+}
+
+//
+// G_FinishStateHash
+//
+void G_FinishStateHash(int numtics)
+{
+    const char *status;
+    char detail[160];
+    FILE *report;
+    int realtime;
+    int p;
+
+    if (!hashing)
+    {
+        return;
+    }
+
+    hashing = false;
+    realtime = I_GetTimeMS() - hashstarttime;
+
+    if (goldenout != NULL)
+    {
+        fclose(goldenout);
+        goldenout = NULL;
+
+        remove(goldenname);
+
+        if (rename(goldentemp, goldenname))
+        {
+            I_Error("G_FinishStateHash: Couldn't write %s", goldenname);
+        }
+
+        status = "recorded";
+        M_snprintf(detail, sizeof(detail), "%i checkpoints written to %s",
+                   numcheckpoints, goldenname);
+
+        free(goldentemp);
+        goldentemp = NULL;
+    }
+    else
+    {
+        if (desynctic < 0 && goldenend - goldenp >= CHECKPOINTSIZE)
+        {
+            M_snprintf(detail, sizeof(detail),
+                       "demo ended, golden file goes on to tic %i",
+                       G_getInt(goldenp));
+            G_desync(numtics, detail);
+        }
+
+        if (desynctic < 0)
+        {
+            status = "ok";
+            M_snprintf(detail, sizeof(detail), "%i checkpoints match",
+                       numcheckpoints);
+        }
+        else
+        {
+            status = "desync";
+            M_StringCopy(detail, desyncdetail, sizeof(detail));
+        }
+
+        Z_Free(golden);
+        golden = NULL;
+    }
+
+    if (desynctic < 0)
+    {
+        printf("State hash: %s, %s\n", status, detail);
+    }
+    else
+    {
+        printf("State hash: desync at tic %i (after %i): %s\n",
+               desynctic, desyncafter, detail);
+    }
+
+    // Undocumented:
+    // File the result is written to for the -regress runner.
+
+    p = M_CheckParmWithArgs("-statereport", 1);
+
+    if (p > 0 && (report = fopen(myargv[p + 1], "w")) != NULL)
+    {
+        fprintf(report, "%s %i %i %i %i %s\n", status, numtics, realtime,
+                desynctic, desyncafter, detail);
+        fclose(report);
+    }
+
+    free(goldenname);
+    goldenname = NULL;
+}
+
+//
+// Regression runner
+//
+
+#ifdef _WIN32
+typedef HANDLE childproc_t;
+#define MAXJOBS MAXIMUM_WAIT_OBJECTS
+#else
+typedef pid_t childproc_t;
+#define MAXJOBS 256
+#endif
+
+typedef struct
+{
+    char *demo;
+    char *name;
+    char *golden;
+    char *report;
+    char *log;
+
+    // Read back from the report.
+
+    char status[16];
+    int  numtics;
+    int  realtime;
+    int  desynctic;
+    int  desyncafter;
+    char detail[160];
+} regressjob_t;
+
+//
+// G_spawnChild
+//
+// Start another copy of this program with the given arguments.
+//
+static boolean G_spawnChild(char **argv, const char *log, childproc_t *proc)
+{
+#ifdef _WIN32
+    char exe[MAX_PATH];
+    char **quoted;
+    intptr_t handle;
+    int argc, i;
+
+    GetModuleFileNameA(NULL, exe, MAX_PATH);
+
+    // The arguments are joined into one command line, so any with
+    // spaces must be quoted.
+
+    for (argc = 0; argv[argc] != NULL; argc++);
+
+    quoted = calloc(argc + 1, sizeof(char *));
+
+    for (i = 0; i < argc; i++)
+    {
+        if (strchr(argv[i], ' ') != NULL)
+            quoted[i] = M_StringJoin("\"", argv[i], "\"", NULL);
+        else
+            quoted[i] = M_Strdup(argv[i]);
+    }
+
+    handle = _spawnv(_P_NOWAIT, exe, (const char * const *) quoted);
+
+    for (i = 0; i < argc; i++)
+    {
+        free(quoted[i]);
+    }
+
+    free(quoted);
+
+    *proc = (HANDLE) handle;
+
+    return handle != -1;
+#else
+    pid_t pid;
+
+    fflush(stdout);
+    fflush(stderr);
+
+    pid = fork();
+
+    if (pid == 0)
+    {
+        // Keep the worker's console output out of the report.
+
+        if (freopen(log, "w", stdout) != NULL)
+        {
+            dup2(fileno(stdout), fileno(stderr));
+        }
+
+        execvp(argv[0], argv);
+        _exit(0x80);
+    }
+
+    *proc = pid;
+
+    return pid > 0;
+#endif
+}
+
+//
+// G_waitChild
+//
+// Wait for one of the children to exit, and return its index.
+//
+static int G_waitChild(childproc_t *procs, int count)
+{
+#ifdef _WIN32
+    DWORD result;
+
+    result = WaitForMultipleObjects(count, procs, FALSE, INFINITE);
+
+    if (result >= WAIT_OBJECT_0 + count)
+    {
+        I_Error("G_waitChild: Failed to wait for workers");
+    }
+
+    CloseHandle(procs[result - WAIT_OBJECT_0]);
+
+    return result - WAIT_OBJECT_0;
+#else
+    pid_t pid;
+    int i;
+
+    for (;;)
+    {
+        pid = waitpid(-1, NULL, 0);
+
+        if (pid < 0)
+        {
+            I_Error("G_waitChild: Failed to wait for workers");
+        }
+
+        for (i = 0; i < count; i++)
+        {
+            if (procs[i] == pid)
+            {
+                return i;
+            }
+        }
+    }
+#endif
+}
+
+static boolean G_isDemoFile(const char *name)
+{
+    size_t len = strlen(name);
+
+    return len > 4 && !strcasecmp(name + len - 4, ".lmp");
+}
+
+static int G_compareNames(const void *a, const void *b)
+{
+    return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+//
+// G_findDemos
+//
+// List the demos in a directory, in order of name.
+//
+static char **G_findDemos(const char *dir, int *count)
+{
+    DIR *demodir;
+    struct dirent *f;
+    char **names = NULL;
+    int numnames = 0;
+    int numalloc = 0;
+
+    if (!(demodir = opendir(dir)))
+    {
+        I_Error("G_RunRegression: Couldn't open dir %s", dir);
+    }
+
+    while ((f = readdir(demodir)))
+    {
+        if (!G_isDemoFile(f->d_name))
+        {
+            continue;
+        }
+
+        if (numnames == numalloc)
+        {
+            numalloc = numalloc ? numalloc * 2 : 32;
+            names = realloc(names, numalloc * sizeof(char *));
+
+            if (names == NULL)
+            {
+                I_Error("G_findDemos: Failed to allocate %d names", numalloc);
+            }
+        }
+
+        names[numnames++] = M_Strdup(f->d_name);
+    }
+
+    closedir(demodir);
+
+    qsort(names, numnames, sizeof(char *), G_compareNames);
+
+    *count = numnames;
+
+    return names;
+}
+
+//
+// G_childArgs
+//
+// The command line for a worker: this one, less the arguments that
+// choose what to run, plus those that play one demo.
+//
+static char **G_childArgs(regressjob_t *job)
+{
+    static const char *skip[] =
+    {
+        "-regress", "-jobs", "-playdemo", "-timedemo", "-record",
+        "-statehash", "-statereport",
+    };
+    char **argv;
+    int argc = 0;
+    int i, j;
+
+    argv = calloc(myargc + 12, sizeof(char *));
+    argv[argc++] = myargv[0];
+
+    for (i = 1; i < myargc; i++)
+    {
+        for (j = 0; j < arrlen(skip); j++)
+        {
+            if (!strcasecmp(myargv[i], skip[j]))
+            {
+                break;
+            }
+        }
+
+        if (j < arrlen(skip))
+        {
+            ++i;
+            continue;
+        }
+
+        argv[argc++] = myargv[i];
+    }
+
+    argv[argc++] = "-timedemo";
+    argv[argc++] = job->demo;
+    argv[argc++] = "-nodraw";
+    argv[argc++] = "-nosound";
+    argv[argc++] = "-nogui";
+    argv[argc++] = "-statehash";
+    argv[argc++] = job->golden;
+    argv[argc++] = "-statereport";
+    argv[argc++] = job->report;
+    argv[argc] = NULL;
+
+    return argv;
+}
+
+static void G_readReport(regressjob_t *job)
+{
+    FILE *report;
+    char *detail;
+
+    M_StringCopy(job->status, "failed", sizeof(job->status));
+
+    if (M_FileExists(job->log))
+    {
+        M_snprintf(job->detail, sizeof(job->detail),
+                   "worker exited without a report, output in %s", job->log);
+    }
+    else
+    {
+        M_StringCopy(job->detail, "worker exited without a report",
+                     sizeof(job->detail));
+    }
+
+    report = fopen(job->report, "r");
+
+    if (report == NULL)
+    {
+        return;
+    }
+
+    if (fscanf(report, "%15s %d %d %d %d ", job->status, &job->numtics,
+               &job->realtime, &job->desynctic, &job->desyncafter) == 5
+     && fgets(job->detail, sizeof(job->detail), report) != NULL)
+    {
+        detail = job->detail;
+        detail[strcspn(detail, "\r\n")] = '\0';
+    }
+    else
+    {
+        M_StringCopy(job->status, "failed", sizeof(job->status));
+        M_StringCopy(job->detail, "worker wrote a damaged report",
+                     sizeof(job->detail));
+    }
+
+    fclose(report);
+    remove(job->report);
+
+    // Keep the output of workers that went wrong.
+
+    if (!strcmp(job->status, "ok") || !strcmp(job->status, "recorded"))
+    {
+        remove(job->log);
+    }
+}
+
+static void G_printJob(regressjob_t *job)
+{
+    float fps = 0;
+
+    if (job->realtime > 0)
+    {
+        fps = (float) job->numtics * 1000 / job->realtime;
+    }
+
+    if (!strcmp(job->status, "desync"))
+    {
+        printf("%-24s %8i %8.2f %9.1f  desync at tic %i (after %i): %s\n",
+               job->name, job->numtics, job->realtime / 1000.0f, fps,
+               job->desynctic, job->desyncafter, job->detail);
+    }
+    else
+    {
+        printf("%-24s %8i %8.2f %9.1f  %s: %s\n", job->name,
+               job->numtics, job->realtime / 1000.0f, fps, job->status,
+               job->detail);
+    }
+}
+
+//
+// G_RunRegression
+//
+void G_RunRegression(void)
+{
+    childproc_t procs[MAXJOBS];
+    int running[MAXJOBS];
+    regressjob_t *jobs;
+    char **names;
+    char *dir;
+    char tempname[32];
+    int numjobs, numrunning, next;
+    int numjobslots;
+    int starttime;
+    int numok = 0, numrecorded = 0, numdesync = 0, numfailed = 0;
+    int i, p;
+
+    //!
+    // @arg <dir>
+    // @category demo
+    //
+    // Play every .lmp demo in the directory as with -timedemo and
+    // -statehash, several at a time in separate processes, each
+    // checked against the golden file of the same name with the
+    // extension .sth.  Golden files that do not exist are written.
+    // Prints the speed of each demo and the first tic and thinker
+    // that desynced, and exits with an error if any did.
+    //
+
+    p = M_CheckParmWithArgs("-regress", 1);
+
+    if (p <= 0)
+    {
+        return;
+    }
+
+    dir = myargv[p + 1];
+
+    //!
+    // @arg <n>
+    // @category demo
+    //
+    // Number of demos -regress plays at once.  The default is the
+    // number of CPUs.
+    //
+
+    numjobslots = SDL_GetCPUCount();
+    p = M_CheckParmWithArgs("-jobs", 1);
+
+    if (p > 0)
+    {
+        numjobslots = atoi(myargv[p + 1]);
+    }
+
+    numjobslots = BETWEEN(1, MAXJOBS, numjobslots);
+
+    names = G_findDemos(dir, &numjobs);
+
+    if (numjobs == 0)
+    {
+        I_Error("G_RunRegression: No demos in %s", dir);
+    }
+
+    jobs = calloc(numjobs, sizeof(regressjob_t));
+
+    for (i = 0; i < numjobs; i++)
+    {
+        jobs[i].name = names[i];
+        jobs[i].demo = M_SafeFilePath(dir, names[i]);
+        jobs[i].golden = M_Strdup(jobs[i].demo);
+        M_StringCopy(jobs[i].golden + strlen(jobs[i].golden) - 4, ".sth", 5);
+
+#ifdef _WIN32
+        M_snprintf(tempname, sizeof(tempname), "sve%i_%i.txt",
+                   (int) GetCurrentProcessId(), i);
+#else
+        M_snprintf(tempname, sizeof(tempname), "sve%i_%i.txt",
+                   (int) getpid(), i);
+#endif
+        jobs[i].report = M_TempFile(tempname);
+        M_StringCopy(tempname + strlen(tempname) - 4, ".log", 5);
+        jobs[i].log = M_TempFile(tempname);
+    }
+
+    printf("G_RunRegression: %i demos in %s, %i at a time\n\n",
+           numjobs, dir, numjobslots);
+    printf("%-24s %8s %8s %9s  %s\n", "demo", "tics", "seconds", "fps",
+           "result");
+
+    starttime = I_GetTimeMS();
+    numrunning = 0;
+    next = 0;
+
+    while (next < numjobs || numrunning > 0)
+    {
+        while (next < numjobs && numrunning < numjobslots)
+        {
+            regressjob_t *job = &jobs[next];
+            char **argv = G_childArgs(job);
+
+            remove(job->report);
+
+            if (G_spawnChild(argv, job->log, &procs[numrunning]))
+            {
+                running[numrunning++] = next;
+            }
+            else
+            {
+                G_readReport(job);
+                G_printJob(job);
+                ++numfailed;
+            }
+
+            free(argv);
+            ++next;
+        }
+
+        if (numrunning == 0)
+        {
+            continue;
+        }
+
+        i = G_waitChild(procs, numrunning);
+
+        {
+            regressjob_t *job = &jobs[running[i]];
+
+            G_readReport(job);
+            G_printJob(job);
+
+            if (!strcmp(job->status, "ok"))
+                ++numok;
+            else if (!strcmp(job->status, "recorded"))
+                ++numrecorded;
+            else if (!strcmp(job->status, "desync"))
+                ++numdesync;
+            else
+                ++numfailed;
+        }
+
+        --numrunning;
+        procs[i] = procs[numrunning];
+        running[i] = running[numrunning];
+    }
+
+    printf("\n%i demos in %.2f seconds: %i ok, %i recorded, %i desynced, "
+           "%i failed\n", numjobs, (I_GetTimeMS() - starttime) / 1000.0f,
+           numok, numrecorded, numdesync, numfailed);
+    fflush(stdout);
+
+    if (numdesync > 0 || numfailed > 0)
+    {
+        I_Error("G_RunRegression: %i of %i demos did not match",
+                numdesync + numfailed, numjobs);
+    }
+
+    I_Quit();
+}
+
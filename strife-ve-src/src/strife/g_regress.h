@@ -0,0 +1,46 @@
+//
+// Copyright(C) 2020 Night Dive Studios, LLC
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//    Demo regression testing: hashes of the play simulation checked
+//    against golden files, and a runner that plays a directory of
+//    demos in parallel.
+//
+
+#ifndef __G_REGRESS__
+#define __G_REGRESS__
+
+#include "doomtype.h"
+
+// If -regress was given, play every demo in the directory in worker
+// processes, print a report and exit.  Otherwise returns at once.
+
+void G_RunRegression(void);
+
+// Start hashing the play simulation for a demo being played or
+// recorded, if -statehash was given.
+
+void G_StartStateHash(void);
+
+// Take a checkpoint, if one is due.  tic is the number of demo tics
+// run so far.
+
+void G_StateHashTic(int tic);
+
+// Finish hashing at the end of a demo of numtics tics: write the
+// golden file or report how it compared.
+
+void G_FinishStateHash(int numtics);
+
+#endif
+
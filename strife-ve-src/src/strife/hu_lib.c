@@ -326,11 +326,12 @@ void HUlib_eraseTextLine(hu_textline_t* l)
     if (!automapactive &&
         viewwindowx && l->needsupdate)
     {
-        lh = SHORT(l->f[0]->height) + 1;
-        for (y=l->y,yoffset=y*SCREENWIDTH ; y<l->y+lh ; y++,yoffset+=SCREENWIDTH)
+        // [SVE] rows of the render resolution
+        lh = (SHORT(l->f[0]->height) + 1) * hires;
+        for (y=l->y*hires,yoffset=y*renderwidth ; y<l->y*hires+lh ; y++,yoffset+=renderwidth)
         {
             if (y < viewwindowy || y >= viewwindowy + viewheight)
-                R_VideoErase(yoffset, SCREENWIDTH); // erase entire line
+                R_VideoErase(yoffset, renderwidth); // erase entire line
             else
             {
                 R_VideoErase(yoffset, viewwindowx); // erase left border
@@ -577,26 +577,28 @@ menu_t NameCharDef =
 //
 void M_ReadSaveStrings(void)
 {
-    FILE *handle;
-    int   i;
+    byte *name;
+    int   i, len;
     char *fname = NULL;
 
     for(i = 0; i < load_end; i++)
     {
         if(fname)
             Z_Free(fname);
-        fname = M_SafeFilePath(savegamedir, M_MakeStrifeSaveDir(i, "\\name"));
+        fname = M_SafeFilePath(savegamedir, M_MakeStrifeSaveDir(i, ""));
 
-        handle = fopen(fname, "rb");
-        if(handle == NULL)
+        // [SVE] read from the slot archive
+        len = M_ReadSlotFile(fname, "name", &name);
+        if(len < 0)
         {
             M_StringCopy(savegamestrings[i], EMPTYSTRING,
                          sizeof(savegamestrings[i]));
             LoadMenu[i].status = 0;
             continue;
         }
-        fread(savegamestrings[i], 1, SAVESTRINGSIZE, handle);
-        fclose(handle);
+        memcpy(savegamestrings[i], name,
+               len < SAVESTRINGSIZE ? len : SAVESTRINGSIZE);
+        Z_Free(name);
         LoadMenu[i].status = 1;
     }
 
@@ -655,6 +657,7 @@ void M_DoNameChar(int choice)
     SaveDef.lastOn = choice;
     ClearSlot();
     FromCurr();
+    M_FlushSlot(); // [SVE]
     
     if(menuepisode || isdemoversion) // [SVE]: allow demo episode select
         map = 33;
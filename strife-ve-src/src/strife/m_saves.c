@@ -33,7 +33,10 @@
 #include <string.h>
 #include <ctype.h>
 
+#include "SDL.h"
+
 #include "z_zone.h"
+#include "i_platsystem.h"
 #include "i_system.h"
 #include "d_player.h"
 #include "deh_str.h"
@@ -54,157 +57,589 @@ char *loadpath;     // Path used while loading the game
 char character_name[CHARACTER_NAME_LEN]; // Name of "character" for saveslot
 
 //
-// ClearTmp
+// Save Stores
 //
-// Clear the temporary save directory
+// [SVE] The hub state of the game in progress, which vanilla kept in the
+// temporary save directory, is held in memory as a set of named files,
+// as is the save slot being written. A slot only reaches the disk when
+// the game is saved, as a single archive file which is written by a
+// background thread. Level transitions never touch the disk.
 //
-void ClearTmp(void)
+
+#define SAVEFILE_NAME_LEN 16
+
+#define SLOT_ARCHIVE     "hubsave"
+#define SLOT_ARCHIVE_ID  "STRFHUB1"
+#define SLOT_ARCHIVE_IDLEN 8
+
+typedef struct savefile_s
 {
-    DIR *sp2dir = NULL;
-    struct dirent *f = NULL;
+    char name[SAVEFILE_NAME_LEN];
+    byte *data;       // always followed by a terminating zero byte
+    int   length;
+    struct savefile_s *next;
+} savefile_t;
 
-    if(savepathtemp == NULL)
-        I_Error("you fucked up savedir man!");
+typedef struct savestore_s
+{
+    savefile_t *files;
+} savestore_t;
 
-    if(!(sp2dir = opendir(savepathtemp)))
-        I_Error("ClearTmp: Couldn't open dir %s", savepathtemp);
+static savestore_t hubstore;  // contents of savepathtemp
+static savestore_t slotstore; // contents of savepath
 
-    while((f = readdir(sp2dir)))
-    {
-        char *filepath = NULL;
+// background archive write
+typedef struct slotwrite_s
+{
+    char *dir;    // slot directory
+    byte *data;   // archive contents
+    int   length;
+} slotwrite_t;
 
-        // haleyjd: skip "." and ".." without assuming they're the
-        // first two entries like the original code did.
-        if(!strcmp(f->d_name, ".") || !strcmp(f->d_name, ".."))
-            continue;
+static SDL_Thread *slotwrite_thread;
+static boolean     waitatexit;
 
-        // haleyjd: use M_SafeFilePath, not sprintf
-        filepath = M_SafeFilePath(savepathtemp, f->d_name);
-        remove(filepath);
+//
+// M_findSaveFile
+//
+static savefile_t *M_findSaveFile(savestore_t *store, const char *name)
+{
+    savefile_t *file;
 
-        Z_Free(filepath);
+    for(file = store->files; file; file = file->next)
+    {
+        if(!strcasecmp(file->name, name))
+            return file;
     }
 
-    closedir(sp2dir);
+    return NULL;
 }
 
 //
-// ClearSlot
+// M_storeFile
 //
-// Clear a single save slot folder
+// Add a file to a store, replacing any file of the same name.
 //
-void ClearSlot(void)
+static void M_storeFile(savestore_t *store, const char *name,
+                        const void *data, int length)
 {
-    DIR *spdir = NULL;
-    struct dirent *f = NULL;
+    savefile_t *file;
 
-    if(savepath == NULL)
-        I_Error("userdir is fucked up man!");
+    if(!(file = M_findSaveFile(store, name)))
+    {
+        file = Z_Calloc(1, sizeof(*file), PU_STATIC, NULL);
+        M_StringCopy(file->name, name, sizeof(file->name));
+        file->next = store->files;
+        store->files = file;
+    }
+    else
+        Z_Free(file->data);
 
-    if(!(spdir = opendir(savepath)))
-        I_Error("ClearSlot: Couldn't open dir %s", savepath);
+    file->data = Z_Malloc(length + 1, PU_STATIC, NULL);
+    file->length = length;
+    memcpy(file->data, data, length);
+    file->data[length] = 0;
+}
 
-    while((f = readdir(spdir)))
+//
+// M_removeFile
+//
+static void M_removeFile(savestore_t *store, const char *name)
+{
+    savefile_t **prev;
+    savefile_t *file;
+
+    for(prev = &store->files; (file = *prev); prev = &file->next)
     {
-        char *filepath = NULL;
+        if(!strcasecmp(file->name, name))
+        {
+            *prev = file->next;
+            Z_Free(file->data);
+            Z_Free(file);
+            return;
+        }
+    }
+}
 
-        if(!strcmp(f->d_name, ".") || !strcmp(f->d_name, ".."))
-            continue;
-        
-        // haleyjd: use M_SafeFilePath, not sprintf
-        filepath = M_SafeFilePath(savepath, f->d_name);
-        remove(filepath);
+//
+// M_clearStore
+//
+static void M_clearStore(savestore_t *store)
+{
+    savefile_t *file;
 
-        Z_Free(filepath);
+    while((file = store->files))
+    {
+        store->files = file->next;
+        Z_Free(file->data);
+        Z_Free(file);
     }
+}
 
-    closedir(spdir);
+//
+// M_copyStore
+//
+static void M_copyStore(savestore_t *dest, savestore_t *src)
+{
+    savefile_t *file;
+
+    M_clearStore(dest);
+
+    for(file = src->files; file; file = file->next)
+        M_storeFile(dest, file->name, file->data, file->length);
 }
 
 //
-// FromCurr
+// M_storeForPath
 //
-// Copying files from savepathtemp to savepath
+// Returns the store that stands in for a save directory, if any.
 //
-void FromCurr(void)
+static savestore_t *M_storeForPath(const char *path)
 {
-    DIR *sp2dir = NULL;
-    struct dirent *f = NULL;
+    if(savepathtemp && !strcmp(path, savepathtemp))
+        return &hubstore;
+    if(savepath && !strcmp(path, savepath))
+        return &slotstore;
+
+    return NULL;
+}
+
+static void M_writeArchive32(byte *p, int value)
+{
+    p[0] = (byte)( value        & 0xff);
+    p[1] = (byte)((value >>  8) & 0xff);
+    p[2] = (byte)((value >> 16) & 0xff);
+    p[3] = (byte)((value >> 24) & 0xff);
+}
+
+static int M_readArchive32(const byte *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24);
+}
+
+//
+// M_readArchiveFile
+//
+// Reads a slot archive from disk into a store, or only the one named file
+// if name is not NULL. Returns false if the archive is missing or broken.
+//
+static boolean M_readArchiveFile(const char *dir, savestore_t *store,
+                                 const char *name)
+{
+    char *path;
+    FILE *f;
+    byte header[SLOT_ARCHIVE_IDLEN + 4];
+    byte entry[SAVEFILE_NAME_LEN + 4];
+    byte *data;
+    int numfiles, length, i;
+    boolean result = false;
+
+    path = M_SafeFilePath(dir, SLOT_ARCHIVE);
+    f = fopen(path, "rb");
+    Z_Free(path);
+
+    if(!f)
+        return false;
+
+    if(fread(header, sizeof(header), 1, f) != 1 ||
+       memcmp(header, SLOT_ARCHIVE_ID, SLOT_ARCHIVE_IDLEN))
+    {
+        fclose(f);
+        return false;
+    }
 
-    if(!(sp2dir = opendir(savepathtemp)))
-        I_Error("FromCurr: Couldn't open dir %s", savepathtemp);
+    numfiles = M_readArchive32(header + SLOT_ARCHIVE_IDLEN);
 
-    while((f = readdir(sp2dir)))
+    for(i = 0; i < numfiles; i++)
     {
-        byte *filebuffer  = NULL;
-        int   filelen     = 0;
-        char *srcfilename = NULL;
-        char *dstfilename = NULL;
+        if(fread(entry, sizeof(entry), 1, f) != 1)
+            break;
 
-        // haleyjd: skip "." and ".." without assuming they're the
-        // first two entries like the original code did.
-        if(!strcmp(f->d_name, ".") || !strcmp(f->d_name, ".."))
+        entry[SAVEFILE_NAME_LEN - 1] = '\0';
+        length = M_readArchive32(entry + SAVEFILE_NAME_LEN);
+
+        if(length < 0)
+            break;
+
+        if(name && strcasecmp((char *)entry, name))
+        {
+            if(fseek(f, length, SEEK_CUR))
+                break;
             continue;
+        }
 
-        
+        data = Z_Malloc(length + 1, PU_STATIC, NULL);
 
-        // haleyjd: use M_SafeFilePath, NOT sprintf.
-        srcfilename = M_SafeFilePath(savepathtemp, f->d_name);
-        dstfilename = M_SafeFilePath(savepath,     f->d_name);
+        if(length > 0 && fread(data, length, 1, f) != 1)
+        {
+            Z_Free(data);
+            break;
+        }
 
-        filelen = M_ReadFile(srcfilename, &filebuffer);
-        M_WriteFile(dstfilename, filebuffer, filelen);
+        M_storeFile(store, (char *)entry, data, length);
+        Z_Free(data);
 
-        Z_Free(filebuffer);
-        Z_Free(srcfilename);
-        Z_Free(dstfilename);
+        if(name)
+        {
+            result = true;
+            break;
+        }
     }
 
-    closedir(sp2dir);
+    if(!name)
+        result = (i == numfiles);
+
+    fclose(f);
+    return result;
 }
 
 //
-// ToCurr
+// M_readLegacySlot
 //
-// Copying files from savepath to savepathtemp
+// Reads a slot saved as one file per entry, as vanilla did.
 //
-void ToCurr(void)
+static void M_readLegacySlot(const char *dir, savestore_t *store)
 {
     DIR *spdir = NULL;
     struct dirent *f = NULL;
 
-    ClearTmp();
-
     // BUG: Rogue copypasta'd this error message, which is why we don't know
-    // the real original name of this function.
-    if(!(spdir = opendir(savepath)))
-        I_Error("ClearSlot: Couldn't open dir %s", savepath);
+    // the real original name of ToCurr.
+    if(!(spdir = opendir(dir)))
+        I_Error("ClearSlot: Couldn't open dir %s", dir);
 
     while((f = readdir(spdir)))
     {
         byte *filebuffer  = NULL;
         int   filelen     = 0;
         char *srcfilename = NULL;
-        char *dstfilename = NULL;
 
         if(!strcmp(f->d_name, ".") || !strcmp(f->d_name, ".."))
             continue;
 
         // haleyjd: use M_SafeFilePath, NOT sprintf.
-        srcfilename = M_SafeFilePath(savepath,     f->d_name);
-        dstfilename = M_SafeFilePath(savepathtemp, f->d_name);
+        srcfilename = M_SafeFilePath(dir, f->d_name);
 
         filelen = M_ReadFile(srcfilename, &filebuffer);
-        M_WriteFile(dstfilename, filebuffer, filelen);
+        M_storeFile(store, f->d_name, filebuffer, filelen);
 
         Z_Free(filebuffer);
         Z_Free(srcfilename);
-        Z_Free(dstfilename);
     }
 
     closedir(spdir);
 }
 
+//
+// M_slotWriteThread
+//
+// Writes a slot archive under a temporary name and moves it into place,
+// then deletes the files of a slot in the old one-file-per-entry format.
+// Runs on its own thread, so must not touch the zone.
+//
+static int M_slotWriteThread(void *arg)
+{
+    slotwrite_t *write = arg;
+    char *archive, *temp;
+    DIR *spdir;
+    struct dirent *f;
+    FILE *out;
+    boolean ok = false;
+
+    archive = M_StringJoin(write->dir, DIR_SEPARATOR_S, SLOT_ARCHIVE, NULL);
+    temp    = M_StringJoin(archive, ".tmp", NULL);
+
+    if((out = fopen(temp, "wb")))
+    {
+        ok = (fwrite(write->data, write->length, 1, out) == 1);
+        ok = (fclose(out) == 0) && ok;
+    }
+
+    if(ok)
+    {
+        remove(archive);
+        ok = (rename(temp, archive) == 0);
+    }
+    else
+        remove(temp);
+
+    if(!ok)
+        fprintf(stderr, "M_slotWriteThread: failed to write %s\n", archive);
+    else if((spdir = opendir(write->dir)))
+    {
+        while((f = readdir(spdir)))
+        {
+            char *filepath;
+
+            if(!strcmp(f->d_name, ".") || !strcmp(f->d_name, "..") ||
+               !strcmp(f->d_name, SLOT_ARCHIVE))
+                continue;
+
+            filepath = M_StringJoin(write->dir, DIR_SEPARATOR_S, f->d_name,
+                                    NULL);
+            remove(filepath);
+            free(filepath);
+        }
+
+        closedir(spdir);
+    }
+
+    // dimitrisg 20200629 : commit save data to NX
+    I_FlushSaves();
+
+    free(archive);
+    free(temp);
+    free(write->dir);
+    free(write->data);
+    free(write);
+
+    return ok;
+}
+
+//
+// M_WaitSlotWrite
+//
+// Wait for a slot archive being written in the background to be done.
+//
+void M_WaitSlotWrite(void)
+{
+    if(slotwrite_thread)
+    {
+        SDL_WaitThread(slotwrite_thread, NULL);
+        slotwrite_thread = NULL;
+    }
+}
+
+//
+// M_FlushSlot
+//
+// Write the selected save slot to disk as a single archive file. The
+// archive is built here and written by a background thread.
+//
+void M_FlushSlot(void)
+{
+    slotwrite_t *write;
+    savefile_t *file;
+    byte *p;
+    int numfiles = 0;
+    int length = SLOT_ARCHIVE_IDLEN + 4;
+
+    if(savepath == NULL)
+        I_Error("userdir is fucked up man!");
+
+    for(file = slotstore.files; file; file = file->next)
+    {
+        ++numfiles;
+        length += SAVEFILE_NAME_LEN + 4 + file->length;
+    }
+
+    write = malloc(sizeof(*write));
+    write->dir    = M_StringJoin(savepath, NULL);
+    write->data   = malloc(length);
+    write->length = length;
+
+    if(!write->data)
+        I_Error("M_FlushSlot: failed to allocate %d bytes", length);
+
+    p = write->data;
+    memcpy(p, SLOT_ARCHIVE_ID, SLOT_ARCHIVE_IDLEN);
+    M_writeArchive32(p + SLOT_ARCHIVE_IDLEN, numfiles);
+    p += SLOT_ARCHIVE_IDLEN + 4;
+
+    for(file = slotstore.files; file; file = file->next)
+    {
+        memset(p, 0, SAVEFILE_NAME_LEN);
+        M_StringCopy((char *)p, file->name, SAVEFILE_NAME_LEN);
+        M_writeArchive32(p + SAVEFILE_NAME_LEN, file->length);
+        p += SAVEFILE_NAME_LEN + 4;
+        memcpy(p, file->data, file->length);
+        p += file->length;
+    }
+
+    // only one write at a time, in order
+    M_WaitSlotWrite();
+
+    if(!waitatexit)
+    {
+        I_AtExit(M_WaitSlotWrite, true);
+        waitatexit = true;
+    }
+
+    slotwrite_thread = SDL_CreateThread(M_slotWriteThread, "M_FlushSlot",
+                                        write);
+
+    // no thread? do it now.
+    if(!slotwrite_thread)
+        M_slotWriteThread(write);
+}
+
+//
+// M_ReadSlotFile
+//
+// Read a single file from a save slot on disk. The buffer is Z_Malloc'd
+// and zero-terminated. Returns -1 if there is no such file.
+//
+int M_ReadSlotFile(const char *dir, const char *name, byte **buffer)
+{
+    savestore_t store = { NULL };
+    char *path;
+    int length = -1;
+
+    M_WaitSlotWrite();
+
+    if(M_readArchiveFile(dir, &store, name))
+    {
+        *buffer = store.files->data;
+        length  = store.files->length;
+        Z_Free(store.files);
+        return length;
+    }
+
+    path = M_SafeFilePath(dir, name);
+
+    if(M_FileExists(path))
+    {
+        char *buf = NULL;
+
+        length = M_ReadFileAsString(path, &buf);
+
+        if(buf)
+            *buffer = (byte *)buf;
+        else
+            length = -1;
+    }
+
+    Z_Free(path);
+    return length;
+}
+
+//
+// M_ReadSaveFile
+//
+// Read a file from a save directory, which may be held in memory. The
+// buffer is Z_Malloc'd and zero-terminated. Returns -1 if there is no
+// such file.
+//
+int M_ReadSaveFile(const char *path, const char *name, byte **buffer)
+{
+    savestore_t *store;
+    savefile_t *file;
+
+    if(!(store = M_storeForPath(path)))
+        return M_ReadSlotFile(path, name, buffer);
+
+    if(!(file = M_findSaveFile(store, name)))
+        return -1;
+
+    *buffer = Z_Malloc(file->length + 1, PU_STATIC, NULL);
+    memcpy(*buffer, file->data, file->length + 1);
+
+    return file->length;
+}
+
+//
+// M_WriteSaveFile
+//
+// Write a file to a save directory, which may be held in memory.
+//
+boolean M_WriteSaveFile(const char *path, const char *name,
+                        const void *data, int length)
+{
+    savestore_t *store;
+    char *filepath;
+    boolean result;
+
+    if((store = M_storeForPath(path)))
+    {
+        M_storeFile(store, name, data, length);
+        return true;
+    }
+
+    filepath = M_SafeFilePath(path, name);
+    result = M_WriteFile(filepath, (void *)data, length);
+    Z_Free(filepath);
+
+    return result;
+}
+
+//
+// M_SaveFileExists
+//
+boolean M_SaveFileExists(const char *path, const char *name)
+{
+    savestore_t *store;
+    char *filepath;
+    boolean result;
+
+    if((store = M_storeForPath(path)))
+        return M_findSaveFile(store, name) != NULL;
+
+    filepath = M_SafeFilePath(path, name);
+    result = M_FileExists(filepath);
+    Z_Free(filepath);
+
+    return result;
+}
+
+//
+// ClearTmp
+//
+// Clear the temporary save directory
+//
+void ClearTmp(void)
+{
+    if(savepathtemp == NULL)
+        I_Error("you fucked up savedir man!");
+
+    M_clearStore(&hubstore);
+}
+
+//
+// ClearSlot
+//
+// Clear a single save slot folder
+// [SVE] The files on disk are replaced when the slot is next flushed.
+//
+void ClearSlot(void)
+{
+    if(savepath == NULL)
+        I_Error("userdir is fucked up man!");
+
+    M_clearStore(&slotstore);
+}
+
+//
+// FromCurr
+//
+// Copying files from savepathtemp to savepath
+//
+void FromCurr(void)
+{
+    M_copyStore(&slotstore, &hubstore);
+}
+
+//
+// ToCurr
+//
+// Copying files from savepath to savepathtemp
+//
+void ToCurr(void)
+{
+    ClearTmp();
+
+    // [SVE] load the slot's archive, or its files if it predates them
+    M_WaitSlotWrite();
+    M_clearStore(&slotstore);
+
+    if(!M_readArchiveFile(savepath, &slotstore, NULL))
+    {
+        M_clearStore(&slotstore);
+        M_readLegacySlot(savepath, &slotstore);
+    }
+
+    M_copyStore(&hubstore, &slotstore);
+}
+
 //
 // M_SaveMoveMapToHere
 //
@@ -212,26 +647,17 @@ void ToCurr(void)
 //
 void M_SaveMoveMapToHere(void)
 {
-    char *mapsave  = NULL;
-    char *heresave = NULL;
+    savefile_t *file;
     char tmpnum[33];
 
     // haleyjd: no itoa available...
     M_snprintf(tmpnum, sizeof(tmpnum), "%d", gamemap);
 
-    // haleyjd: use M_SafeFilePath, not sprintf
-    mapsave  = M_SafeFilePath(savepath, tmpnum);
-    heresave = M_SafeFilePath(savepath, "here");
-
-    // haleyjd: use M_FileExists, not access
-    if(M_FileExists(mapsave))
+    if((file = M_findSaveFile(&slotstore, tmpnum)))
     {
-        remove(heresave);
-        rename(mapsave, heresave);
+        M_removeFile(&slotstore, "here");
+        M_StringCopy(file->name, "here", sizeof(file->name));
     }
-
-    Z_Free(mapsave);
-    Z_Free(heresave);
 }
 
 //
@@ -241,24 +667,17 @@ void M_SaveMoveMapToHere(void)
 //
 void M_SaveMoveHereToMap(void)
 {
-    char *mapsave  = NULL;
-    char *heresave = NULL;
+    savefile_t *file;
     char tmpnum[33];
 
     // haleyjd: no itoa available...
     M_snprintf(tmpnum, sizeof(tmpnum), "%d", gamemap);
 
-    mapsave  = M_SafeFilePath(savepathtemp, tmpnum);
-    heresave = M_SafeFilePath(savepathtemp, "here");
-
-    if(M_FileExists(heresave))
+    if((file = M_findSaveFile(&hubstore, "here")))
     {
-        remove(mapsave);
-        rename(heresave, mapsave);
+        M_removeFile(&hubstore, tmpnum);
+        M_StringCopy(file->name, tmpnum, sizeof(file->name));
     }
-
-    Z_Free(mapsave);
-    Z_Free(heresave);
 }
 
 //
@@ -268,15 +687,7 @@ void M_SaveMoveHereToMap(void)
 //
 boolean M_SaveMisObj(const char *path)
 {
-    boolean result;
-    char *destpath = NULL;
-
-    // haleyjd 20110210: use M_SafeFilePath, not sprintf
-    destpath = M_SafeFilePath(path, "mis_obj");
-    result   = M_WriteFile(destpath, mission_objective, OBJECTIVE_LEN);
-
-    Z_Free(destpath);
-    return result;
+    return M_WriteSaveFile(path, "mis_obj", mission_objective, OBJECTIVE_LEN);
 }
 
 //
@@ -286,19 +697,15 @@ boolean M_SaveMisObj(const char *path)
 //
 void M_ReadMisObj(void)
 {
-    FILE *f = NULL;
-    char *srcpath = NULL;
-
-    // haleyjd: use M_SafeFilePath, not sprintf
-    srcpath = M_SafeFilePath(savepathtemp, "mis_obj");
+    byte *buffer = NULL;
+    int length;
 
-    if((f = fopen(srcpath, "rb")))
+    if((length = M_ReadSaveFile(savepathtemp, "mis_obj", &buffer)) >= 0)
     {
-        fread(mission_objective, 1, OBJECTIVE_LEN, f);
-        fclose(f);
+        memcpy(mission_objective, buffer,
+               length < OBJECTIVE_LEN ? length : OBJECTIVE_LEN);
+        Z_Free(buffer);
     }
-
-    Z_Free(srcpath);
 }
 
 //=============================================================================
@@ -40,6 +40,15 @@ void M_SaveMoveHereToMap(void);
 boolean M_SaveMisObj(const char *path);
 void    M_ReadMisObj(void);
 
+// [SVE] In-memory save directories
+int     M_ReadSaveFile(const char *path, const char *name, byte **buffer);
+boolean M_WriteSaveFile(const char *path, const char *name,
+                        const void *data, int length);
+boolean M_SaveFileExists(const char *path, const char *name);
+int     M_ReadSlotFile(const char *dir, const char *name, byte **buffer);
+void    M_FlushSlot(void);
+void    M_WaitSlotWrite(void);
+
 // Custom Utilities for Filepath Handling
 void *M_Calloc(size_t n1, size_t n2);
 void  M_NormalizeSlashes(char *str);
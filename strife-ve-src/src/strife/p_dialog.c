@@ -1827,6 +1827,95 @@ boolean P_CheckForBlockingItems(mobj_t *thing)
     return false;
 }
 
+//
+// P_GetDialogState
+//
+// [SVE] Capture the state of the dialog engine for a snapshot.
+//
+void P_GetDialogState(dialogstate_t *state)
+{
+    state->player       = dialogplayer;
+    state->talker       = dialogtalker;
+    state->talkerangle  = dialogtalkerangle;
+    state->dialog       = currentdialog;
+    state->talkerstates = dialogtalkerstates;
+}
+
+//
+// P_SetDialogState
+//
+// [SVE] Put back dialog engine state captured by P_GetDialogState.
+//
+void P_SetDialogState(const dialogstate_t *state)
+{
+    dialogplayer       = state->player;
+    dialogtalker       = state->talker;
+    dialogtalkerangle  = state->talkerangle;
+    currentdialog      = state->dialog;
+    dialogtalkerstates = state->talkerstates;
+}
+
+//
+// P_DialogNumber
+//
+// [SVE] Number a dialog for a snapshot written to disk: 0 for none,
+// positive for the level's dialogs and negative for SCRIPT00's.
+//
+int P_DialogNumber(const mapdialog_t *dialog)
+{
+    if(dialog == NULL)
+        return 0;
+
+    if(dialog >= leveldialogs && dialog < leveldialogs + numleveldialogs)
+        return (int)(dialog - leveldialogs) + 1;
+
+    return -(int)(dialog - script0dialogs) - 1;
+}
+
+//
+// P_DialogByNumber
+//
+// [SVE] Inverse of P_DialogNumber. Returns false if there is no such
+// dialog.
+//
+boolean P_DialogByNumber(int number, mapdialog_t **dialog)
+{
+    if(number == 0)
+        *dialog = NULL;
+    else if(number > 0 && number <= numleveldialogs)
+        *dialog = &leveldialogs[number - 1];
+    else if(number < 0 && -number <= numscript0dialogs)
+        *dialog = &script0dialogs[-number - 1];
+    else
+        return false;
+
+    return true;
+}
+
+//
+// P_DialogStatesNumber
+//
+// [SVE] Number a talker state set likewise: 0 for none, or its index
+// plus one.
+//
+int P_DialogStatesNumber(const void *talkerstates)
+{
+    if(talkerstates == NULL)
+        return 0;
+
+    return (int)((const dialogstateset_t *)talkerstates - dialogstatesets) + 1;
+}
+
+boolean P_DialogStatesByNumber(int number, void **talkerstates)
+{
+    if(number < 0 || number > numdialogstatesets)
+        return false;
+
+    *talkerstates = number ? &dialogstatesets[number - 1] : NULL;
+
+    return true;
+}
+
 // EOF
 
 
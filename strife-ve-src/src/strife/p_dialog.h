@@ -102,6 +102,25 @@ int          P_PlayerHasItem(player_t *player, mobjtype_t type);
 // haleyjd 20140827: [SVE] blocker checks
 boolean P_CheckForBlockingItems(mobj_t *thing);
 
+// [SVE] Dialog engine state, for play simulation snapshots.
+typedef struct dialogstate_s
+{
+    player_t    *player;
+    mobj_t      *talker;
+    angle_t      talkerangle;
+    mapdialog_t *dialog;
+    void        *talkerstates;
+} dialogstate_t;
+
+void P_GetDialogState(dialogstate_t *state);
+void P_SetDialogState(const dialogstate_t *state);
+
+// [SVE] Dialog state pointers as numbers, for snapshots written to disk.
+int     P_DialogNumber(const mapdialog_t *dialog);
+boolean P_DialogByNumber(int number, mapdialog_t **dialog);
+int     P_DialogStatesNumber(const void *talkerstates);
+boolean P_DialogStatesByNumber(int number, void **talkerstates);
+
 #endif
 
 // EOF
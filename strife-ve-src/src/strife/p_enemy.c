@@ -2754,9 +2754,10 @@ void A_SpawnSpectreE(mobj_t* actor)
 }
 
 // [STRIFE] New statics - Remember the Entity's spawning position.
-static fixed_t entity_pos_x = 0;
-static fixed_t entity_pos_y = 0;
-static fixed_t entity_pos_z = 0;
+// [SVE] No longer static; netgame snapshots save them.
+fixed_t entity_pos_x = 0;
+fixed_t entity_pos_y = 0;
+fixed_t entity_pos_z = 0;
 
 //
 // A_SpawnEntity
@@ -517,18 +517,6 @@ static char *P_loadLocScriptLump(char *logname)
     return buf;
 }
 
-//
-// P_loadLocScriptFile
-//
-// haleyjd 20140829: [SVE] Load a LOC script from a file.
-//
-static char *P_loadLocScriptFile(const char *filename)
-{
-    char *buf = NULL;
-
-    return M_ReadFileAsString(filename, &buf) ? buf : NULL;
-}
-
 //
 // P_parseLocScript
 //
@@ -587,16 +575,15 @@ void P_SetLocationsFromScript(char *logname)
 
 void P_SetLocationsFromFile(const char *filepath)
 {
-    char *srcfile = M_SafeFilePath(filepath, "mis_loc");
-    char *buf     = P_loadLocScriptFile(srcfile);
-    if(buf)
-        P_parseLocScript(buf);
+    byte *buf = NULL;
 
-    Z_Free(srcfile);
+    // [SVE] the save directory may be held in memory
+    if(M_ReadSaveFile(filepath, "mis_loc", &buf) >= 0)
+        P_parseLocScript((char *)buf);
 }
 
-// file handle for save output
-static FILE *saveout;
+// buffer for save output
+static qstring_t saveout;
 
 //
 // P_writeActiveLocation
@@ -605,7 +592,9 @@ static FILE *saveout;
 //
 static void P_writeActiveLocation(location_t *loc)
 {
-    fprintf(saveout, "+%s\n", QStrConstPtr(&loc->name));
+    QStrPutc(&saveout, '+');
+    QStrCat(&saveout, QStrConstPtr(&loc->name));
+    QStrPutc(&saveout, '\n');
 }
 
 //
@@ -615,22 +604,18 @@ static void P_writeActiveLocation(location_t *loc)
 //
 void P_WriteActiveLocations(const char *filepath)
 {
-    char *dstfile = M_SafeFilePath(filepath, "mis_loc");
+    QStrInitCreate(&saveout);
 
-    saveout = fopen(dstfile, "w");
-    if(saveout)
-    {
-       // first line always turns off all active locations
-       fputs("-ALL\n", saveout);
+    // first line always turns off all active locations
+    QStrCat(&saveout, "-ALL\n");
 
-       // write out all active locations
-       P_ActiveLocationIterator(P_writeActiveLocation);
+    // write out all active locations
+    P_ActiveLocationIterator(P_writeActiveLocation);
 
-       fclose(saveout);
-       saveout = NULL;
-    }
+    M_WriteSaveFile(filepath, "mis_loc", QStrConstPtr(&saveout),
+                    QStrLen(&saveout));
 
-    Z_Free(dstfile);
+    QStrFree(&saveout);
 }
 
 // EOF
@@ -20,11 +20,13 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "dstrings.h"
 #include "deh_main.h"
 #include "i_system.h"
 #include "z_zone.h"
+#include "m_lz.h"
 #include "m_misc.h"
 #include "p_local.h"
 #include "p_saveg.h"
@@ -39,28 +41,9 @@
 // haleyjd 09/28/10: [STRIFE] VERSIONSIZE == 8
 #define VERSIONSIZE 8 
 
-FILE *save_stream;
 int savegamelength;
 boolean savegame_error;
 
-// Get the filename of a temporary file to write the savegame to.  After
-// the file has been successfully saved, it will be renamed to the 
-// real file.
-
-char *P_TempSaveGameFile(const char* dir)
-{
-    static char *filename = NULL;
-
-    if (filename != NULL)
-    {
-        free(filename);
-        filename = NULL;
-    }
-    filename = M_StringJoin(dir, "temp.dsg", NULL);
-
-    return filename;
-}
-
 // Get the filename of the save game file to use for the specified slot.
 
 char *P_SaveGameFile(int slot)
@@ -82,102 +65,223 @@ char *P_SaveGameFile(int slot)
     return filename;
 }
 
-// Endian-safe integer read/write functions
+// [SVE] saves are serialized into a growable memory
+// buffer and written out in one go; loads decode straight from memory.
 
-static byte saveg_read8(void)
+static byte *save_buffer;
+static size_t save_length;
+static size_t save_alloced;
+static size_t save_pos;
+
+// Header for compressed saves; followed by the uncompressed length as
+// a little-endian 32-bit value and the LZ-compressed payload.
+
+#define SAVEZ_MAGIC "SVEZ"
+#define SAVEZ_HEADERSIZE 8
+
+// Most an LZ4 block can expand by: each byte of a match length adds at
+// most 255 bytes of output.
+
+#define SAVEZ_MAXRATIO 255
+
+static void saveg_grow(size_t needed)
 {
-    byte result;
+    size_t newsize;
 
-    if (fread(&result, 1, 1, save_stream) < 1)
+    newsize = save_alloced ? save_alloced : 64 * 1024;
+
+    while (newsize < save_length + needed)
     {
-        if (!savegame_error)
-        {
-            fprintf(stderr, "saveg_read8: Unexpected end of file while "
-                            "reading save game\n");
+        newsize *= 2;
+    }
 
-            savegame_error = true;
-        }
+    save_buffer = realloc(save_buffer, newsize);
+
+    if (save_buffer == NULL)
+    {
+        I_Error("saveg_grow: Failed to grow save buffer to %lu bytes",
+                (unsigned long) newsize);
     }
 
-    return result;
+    save_alloced = newsize;
 }
 
-static void saveg_write8(byte value)
+static void saveg_readerror(void)
 {
-    if (fwrite(&value, 1, 1, save_stream) < 1)
+    if (!savegame_error)
     {
-        if (!savegame_error)
-        {
-            fprintf(stderr, "saveg_write8: Error while writing save game\n");
+        fprintf(stderr, "saveg_read8: Unexpected end of file while "
+                        "reading save game\n");
 
-            savegame_error = true;
-        }
+        savegame_error = true;
+    }
+}
+
+// Endian-safe integer read/write functions
+
+static byte saveg_read8(void)
+{
+    if (save_pos >= save_length)
+    {
+        saveg_readerror();
+        return 0;
     }
+
+    return save_buffer[save_pos++];
+}
+
+static void saveg_write8(byte value)
+{
+    if (save_length + 1 > save_alloced)
+    {
+        saveg_grow(1);
+    }
+
+    save_buffer[save_length++] = value;
 }
 
 static short saveg_read16(void)
 {
     int result;
 
-    result = saveg_read8();
-    result |= saveg_read8() << 8;
+    if (save_pos + 2 > save_length)
+    {
+        save_pos = save_length;
+        saveg_readerror();
+        return 0;
+    }
+
+    result = save_buffer[save_pos] | (save_buffer[save_pos + 1] << 8);
+    save_pos += 2;
 
     return result;
 }
 
 static void saveg_write16(short value)
 {
-    saveg_write8(value & 0xff);
-    saveg_write8((value >> 8) & 0xff);
+    if (save_length + 2 > save_alloced)
+    {
+        saveg_grow(2);
+    }
+
+    save_buffer[save_length] = value & 0xff;
+    save_buffer[save_length + 1] = (value >> 8) & 0xff;
+    save_length += 2;
 }
 
 static int saveg_read32(void)
 {
-    int result;
+    const byte *p;
+
+    if (save_pos + 4 > save_length)
+    {
+        save_pos = save_length;
+        saveg_readerror();
+        return 0;
+    }
 
-    result = saveg_read8();
-    result |= saveg_read8() << 8;
-    result |= saveg_read8() << 16;
-    result |= saveg_read8() << 24;
+    p = save_buffer + save_pos;
+    save_pos += 4;
 
-    return result;
+    return (int) ((unsigned int) p[0]
+                | ((unsigned int) p[1] << 8)
+                | ((unsigned int) p[2] << 16)
+                | ((unsigned int) p[3] << 24));
 }
 
 static void saveg_write32(int value)
 {
-    saveg_write8(value & 0xff);
-    saveg_write8((value >> 8) & 0xff);
-    saveg_write8((value >> 16) & 0xff);
-    saveg_write8((value >> 24) & 0xff);
+    byte *p;
+
+    if (save_length + 4 > save_alloced)
+    {
+        saveg_grow(4);
+    }
+
+    p = save_buffer + save_length;
+    p[0] = value & 0xff;
+    p[1] = (value >> 8) & 0xff;
+    p[2] = (value >> 16) & 0xff;
+    p[3] = (value >> 24) & 0xff;
+    save_length += 4;
+}
+
+// Bulk read/write of arrays of 32-bit integers, with one bounds check
+// for the whole array.
+
+static void saveg_read32_array(int *values, int count)
+{
+    const byte *p;
+    int i;
+
+    if (save_pos + count * 4 > save_length)
+    {
+        save_pos = save_length;
+        saveg_readerror();
+        memset(values, 0, count * sizeof(*values));
+        return;
+    }
+
+    p = save_buffer + save_pos;
+
+    for (i=0; i<count; ++i, p += 4)
+    {
+        values[i] = (int) ((unsigned int) p[0]
+                         | ((unsigned int) p[1] << 8)
+                         | ((unsigned int) p[2] << 16)
+                         | ((unsigned int) p[3] << 24));
+    }
+
+    save_pos += count * 4;
+}
+
+static void saveg_write32_array(const int *values, int count)
+{
+    byte *p;
+    int i;
+
+    if (save_length + count * 4 > save_alloced)
+    {
+        saveg_grow(count * 4);
+    }
+
+    p = save_buffer + save_length;
+
+    for (i=0; i<count; ++i, p += 4)
+    {
+        p[0] = values[i] & 0xff;
+        p[1] = (values[i] >> 8) & 0xff;
+        p[2] = (values[i] >> 16) & 0xff;
+        p[3] = (values[i] >> 24) & 0xff;
+    }
+
+    save_length += count * 4;
 }
 
 // Pad to 4-byte boundaries
 
 static void saveg_read_pad(void)
 {
-    unsigned long pos;
     int padding;
-    int i;
-
-    pos = ftell(save_stream);
 
-    padding = (4 - (pos & 3)) & 3;
+    padding = (4 - (save_pos & 3)) & 3;
 
-    for (i=0; i<padding; ++i)
+    if (save_pos + padding > save_length)
     {
-        saveg_read8();
+        save_pos = save_length;
+        saveg_readerror();
+        return;
     }
+
+    save_pos += padding;
 }
 
 static void saveg_write_pad(void)
 {
-    unsigned long pos;
     int padding;
     int i;
 
-    pos = ftell(save_stream);
-
-    padding = (4 - (pos & 3)) & 3;
+    padding = (4 - (save_length & 3)) & 3;
 
     for (i=0; i<padding; ++i)
     {
@@ -185,6 +289,152 @@ static void saveg_write_pad(void)
     }
 }
 
+//
+// P_OpenSaveBuffer
+//
+// [SVE] Start serializing a new save into an empty buffer.
+//
+void P_OpenSaveBuffer(void)
+{
+    P_CloseSaveBuffer();
+    savegame_error = false;
+}
+
+//
+// P_SaveBufferLength
+//
+// [SVE] Number of bytes serialized so far.
+//
+size_t P_SaveBufferLength(void)
+{
+    return save_length;
+}
+
+//
+// P_FinishSaveBuffer
+//
+// [SVE] Hand back the serialized save, optionally compressed. The data
+// is Z_Malloc'd and owned by the caller; the save buffer is released.
+//
+void P_FinishSaveBuffer(boolean compress, byte **data, size_t *len)
+{
+    byte *out;
+    size_t outlen;
+
+    if (compress)
+    {
+        out = Z_Malloc(SAVEZ_HEADERSIZE + M_LZCompressBound(save_length),
+                       PU_STATIC, NULL);
+        memcpy(out, SAVEZ_MAGIC, 4);
+        out[4] = save_length & 0xff;
+        out[5] = (save_length >> 8) & 0xff;
+        out[6] = (save_length >> 16) & 0xff;
+        out[7] = (save_length >> 24) & 0xff;
+        outlen = SAVEZ_HEADERSIZE
+               + M_LZCompress(save_buffer, save_length,
+                              out + SAVEZ_HEADERSIZE);
+    }
+    else
+    {
+        out = Z_Malloc(save_length, PU_STATIC, NULL);
+        memcpy(out, save_buffer, save_length);
+        outlen = save_length;
+    }
+
+    P_CloseSaveBuffer();
+
+    *data = out;
+    *len = outlen;
+}
+
+//
+// P_OpenLoadBuffer
+//
+// [SVE] Start decoding a save from memory. Takes ownership of the
+// Z_Malloc'd data. Compressed saves are detected by their header and
+// expanded; plain saves are read as-is. Returns false if the data is
+// corrupt.
+//
+boolean P_OpenLoadBuffer(byte *data, size_t len)
+{
+    size_t rawlen;
+
+    P_CloseSaveBuffer();
+    savegame_error = false;
+
+    if (len >= SAVEZ_HEADERSIZE && !memcmp(data, SAVEZ_MAGIC, 4))
+    {
+        rawlen = (size_t) data[4]
+               | ((size_t) data[5] << 8)
+               | ((size_t) data[6] << 16)
+               | ((size_t) data[7] << 24);
+
+        // A length the payload cannot expand to is a corrupt header;
+        // do not try to allocate it.
+
+        if (rawlen > (len - SAVEZ_HEADERSIZE) * SAVEZ_MAXRATIO + 16)
+        {
+            fprintf(stderr, "P_OpenLoadBuffer: Corrupt compressed "
+                            "save game\n");
+            Z_Free(data);
+            return false;
+        }
+
+        save_buffer = malloc(rawlen ? rawlen : 1);
+
+        if (save_buffer == NULL)
+        {
+            I_Error("P_OpenLoadBuffer: Failed to allocate %lu bytes",
+                    (unsigned long) rawlen);
+        }
+
+        save_alloced = rawlen;
+
+        if (!M_LZDecompress(data + SAVEZ_HEADERSIZE, len - SAVEZ_HEADERSIZE,
+                            save_buffer, rawlen))
+        {
+            fprintf(stderr, "P_OpenLoadBuffer: Corrupt compressed "
+                            "save game\n");
+            Z_Free(data);
+            P_CloseSaveBuffer();
+            return false;
+        }
+
+        save_length = rawlen;
+        Z_Free(data);
+    }
+    else
+    {
+        save_buffer = malloc(len ? len : 1);
+
+        if (save_buffer == NULL)
+        {
+            I_Error("P_OpenLoadBuffer: Failed to allocate %lu bytes",
+                    (unsigned long) len);
+        }
+
+        memcpy(save_buffer, data, len);
+        save_alloced = save_length = len;
+        Z_Free(data);
+    }
+
+    return true;
+}
+
+//
+// P_CloseSaveBuffer
+//
+// [SVE] Release the save buffer.
+//
+void P_CloseSaveBuffer(void)
+{
+    free(save_buffer);
+    save_buffer = NULL;
+    save_length = 0;
+    save_alloced = 0;
+    save_pos = 0;
+}
+
 
 // Pointers
 
@@ -728,10 +978,7 @@ static void saveg_read_player_t(player_t *str)
     str->armortype = saveg_read16(); // [STRIFE] 32 -> 16
 
     // int powers[NUMPOWERS];
-    for (i=0; i<NUMPOWERS; ++i)
-    {
-        str->powers[i] = saveg_read32();
-    }
+    saveg_read32_array(str->powers, NUMPOWERS);
 
     // int sigiltype;
     str->sigiltype = saveg_read32(); // [STRIFE]
@@ -788,10 +1035,7 @@ static void saveg_read_player_t(player_t *str)
     str->inventorydown = saveg_read32(); // [STRIFE]
 
     // int frags[MAXPLAYERS];
-    for (i=0; i<MAXPLAYERS; ++i)
-    {
-        str->frags[i] = saveg_read32();
-    }
+    saveg_read32_array(str->frags, MAXPLAYERS);
 
     // weapontype_t readyweapon;
     str->readyweapon = saveg_read_enum();
@@ -806,16 +1050,10 @@ static void saveg_read_player_t(player_t *str)
     }
 
     // int ammo[NUMAMMO];
-    for (i=0; i<NUMAMMO; ++i)
-    {
-        str->ammo[i] = saveg_read32();
-    }
+    saveg_read32_array(str->ammo, NUMAMMO);
 
     // int maxammo[NUMAMMO];
-    for (i=0; i<NUMAMMO; ++i)
-    {
-        str->maxammo[i] = saveg_read32();
-    }
+    saveg_read32_array(str->maxammo, NUMAMMO);
 
     // int cheats;
     str->cheats = saveg_read32();
@@ -910,10 +1148,7 @@ static void saveg_write_player_t(player_t *str)
     saveg_write16(str->armortype); // [STRIFE] 32 -> 16
 
     // int powers[NUMPOWERS];
-    for (i=0; i<NUMPOWERS; ++i)
-    {
-        saveg_write32(str->powers[i]);
-    }
+    saveg_write32_array(str->powers, NUMPOWERS);
 
     // int sigiltype;
     saveg_write32(str->sigiltype); // [STRIFE]
@@ -970,10 +1205,7 @@ static void saveg_write_player_t(player_t *str)
     saveg_write32(str->inventorydown); // [STRIFE]
 
     // int frags[MAXPLAYERS];
-    for (i=0; i<MAXPLAYERS; ++i)
-    {
-        saveg_write32(str->frags[i]);
-    }
+    saveg_write32_array(str->frags, MAXPLAYERS);
 
     // weapontype_t readyweapon;
     saveg_write_enum(str->readyweapon);
@@ -988,16 +1220,10 @@ static void saveg_write_player_t(player_t *str)
     }
 
     // int ammo[NUMAMMO];
-    for (i=0; i<NUMAMMO; ++i)
-    {
-        saveg_write32(str->ammo[i]);
-    }
+    saveg_write32_array(str->ammo, NUMAMMO);
 
     // int maxammo[NUMAMMO];
-    for (i=0; i<NUMAMMO; ++i)
-    {
-        saveg_write32(str->maxammo[i]);
-    }
+    saveg_write32_array(str->maxammo, NUMAMMO);
 
 
     // int cheats;
@@ -22,14 +22,12 @@
 
 #include <stdio.h>
 
+#include "doomtype.h"
+
 // maximum size of a savegame description
 
 #define SAVESTRINGSIZE 24
 
-// temporary filename to use while saving.
-
-char *P_TempSaveGameFile(const char* dir);
-
 // filename to use for a savegame slot
 
 char *P_SaveGameFile(int slot);
@@ -55,7 +53,13 @@ void P_UnArchiveThinkers (void);
 void P_ArchiveSpecials (void);
 void P_UnArchiveSpecials (void);
 
-extern FILE *save_stream;
+// [SVE] In-memory save buffer.
+void P_OpenSaveBuffer(void);
+size_t P_SaveBufferLength(void);
+void P_FinishSaveBuffer(boolean compress, byte **data, size_t *len);
+boolean P_OpenLoadBuffer(byte *data, size_t len);
+void P_CloseSaveBuffer(void);
+
 extern boolean savegame_error;
 
 
@@ -31,6 +31,7 @@
 #include "rb_level.h"
 #include "rb_data.h"
 #include "rb_dynlights.h"
+#include "rb_automap.h"
 
 #include "z_zone.h"
 #include "deh_main.h"
@@ -1506,12 +1507,17 @@ void P_SetupLevel(int map, int playermask, skill_t skill)
     if(precache && !use3drenderer)
         R_PrecacheLevel ();
 
+    // [SVE] composite the level's wall textures
+    if(!use3drenderer)
+        R_PrecacheTextures ();
+
     // [SVE] svillarreal
     if(use3drenderer)
     {
         RB_PrecacheLevel();
         RB_InitLightMarks();
         DL_Init();
+        RB_InitAutomap();
     }
 
     //printf ("free memory: 0x%x\n", Z_FreeMemory());
@@ -0,0 +1,2108 @@
+//
+// Copyright(C) 2020 Night Dive Studios, LLC
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//    In-memory snapshots of the play simulation, used to roll netgames
+//    back when the input predicted for other players turns out wrong.
+//
+//    Unlike savegames, snapshots are exact.  Thinkers are copied whole,
+//    and pointers between thinkers are stored as indices, so a restored
+//    level runs on exactly as the original did.
+//
+//    A snapshot can also be stored as a delta against an earlier full
+//    one: only the words that differ from the base are kept, thinker by
+//    thinker, which keeps a long run of snapshots small.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomdef.h"
+#include "doomstat.h"
+#include "i_system.h"
+#include "p_dialog.h"
+#include "p_local.h"
+#include "p_snapshot.h"
+#include "p_spec.h"
+#include "p_tick.h"
+#include "r_state.h"
+#include "s_sound.h"
+#include "st_stuff.h"
+#include "z_zone.h"
+
+extern int prndindex;
+extern mobj_t *curignitemobj;
+extern int numignitechains;
+extern int numactiveceilingsalloc;
+extern int numactiveplatsalloc;
+extern fixed_t entity_pos_x;
+extern fixed_t entity_pos_y;
+extern fixed_t entity_pos_z;
+extern int destmap;
+extern int riftdest;
+
+typedef struct
+{
+    byte   *data;
+    size_t  length;
+    size_t  alloced;
+} snapbuf_t;
+
+struct snapshot_s
+{
+    snapbuf_t buf;
+
+    // Level the snapshot was taken on.
+    boolean valid;
+    int     gamemap;
+    int     levelstarttic;
+
+    // Bumped every time the snapshot is retaken, so deltas can tell
+    // whether their base is still the one they were made against.
+    unsigned int serial;
+
+    // Base of a delta snapshot, or NULL for a full one.
+    snapshot_t  *base;
+    unsigned int baseserial;
+};
+
+// Full image a delta is decoded into before it is restored.
+static snapbuf_t scratch;
+
+// Kinds of thinker, and the size of each.
+
+typedef enum
+{
+    st_mobj,
+    st_ceiling,
+    st_door,
+    st_slidingdoor,
+    st_floor,
+    st_plat,
+    st_flash,
+    st_strobe,
+    st_glow,
+    st_fireflicker,
+    st_removed,         // mobj removed, but still referenced
+    NUMSNAPTHINKERS
+} snapthinker_t;
+
+static const size_t thinkersizes[NUMSNAPTHINKERS] =
+{
+    sizeof(mobj_t),
+    sizeof(ceiling_t),
+    sizeof(vldoor_t),
+    sizeof(slidedoor_t),
+    sizeof(floormove_t),
+    sizeof(plat_t),
+    sizeof(lightflash_t),
+    sizeof(strobe_t),
+    sizeof(glow_t),
+    sizeof(fireflicker_t),
+    sizeof(mobj_t),
+};
+
+// Global play simulation state.
+
+typedef struct
+{
+    int     leveltime;
+    int     prndindex;
+    int     levelTimer;
+    int     levelTimeCount;
+    int     paused;
+    int     totalkills;
+    int     totalsecret;
+    int     iquehead;
+    int     iquetail;
+    int     numignitechains;
+    int     curignitemobj;
+    fixed_t entity_pos_x;
+    fixed_t entity_pos_y;
+    fixed_t entity_pos_z;
+    int     destmap;
+    int     riftdest;
+    int     playeringame[MAXPLAYERS];
+} snapglobals_t;
+
+// Dialog engine state, with the talker stored as an index.
+
+typedef struct
+{
+    int          player;
+    int          talker;
+    angle_t      talkerangle;
+    mapdialog_t *dialog;
+    void        *talkerstates;
+    char         mission_objective[OBJECTIVE_LEN];
+} snapdialog_t;
+
+// The parts of sectors, lines and sides the play simulation changes.
+// Thinker pointers are stored as indices.
+
+typedef struct
+{
+    fixed_t floorheight;
+    fixed_t ceilingheight;
+    short   floorpic;
+    short   ceilingpic;
+    short   lightlevel;
+    short   special;
+    short   tag;
+    int     soundtraversed;
+    int     soundtarget;
+    int     thinglist;
+    int     specialdata;
+} snapsector_t;
+
+typedef struct
+{
+    short   flags;
+    short   special;
+    short   tag;
+    int     specialdata;
+} snapline_t;
+
+typedef struct
+{
+    fixed_t textureoffset;
+    fixed_t rowoffset;
+    short   toptexture;
+    short   bottomtexture;
+    short   midtexture;
+} snapside_t;
+
+// Open-addressed table mapping thinker addresses to indices.
+
+typedef struct
+{
+    const void **keys;
+    int         *values;
+    int          size;
+} ptrtable_t;
+
+// Live thinkers, by address.
+static ptrtable_t thinkertable;
+
+// Thinkers in a snapshot being restored, by their address at the time
+// the snapshot was taken.
+static ptrtable_t snaptable;
+
+// Thinkers being restored, by index.
+static thinker_t **newthinkers;
+static byte *newtypes;
+static int newthinkersalloc;
+
+// Thinker records in the base of a delta, by their address at the time
+// the base was taken, and their offsets and kinds by index.
+static ptrtable_t basetable;
+static size_t *baseoffsets;
+static byte *basetypes;
+static int baserecordsalloc;
+
+static unsigned int PT_Hash(const void *key, int size)
+{
+    return (unsigned int) (((size_t) key >> 3) * 2654435761u) & (size - 1);
+}
+
+static void PT_Reset(ptrtable_t *table, int count)
+{
+    int size;
+
+    size = 64;
+
+    while (size < count * 2)
+    {
+        size *= 2;
+    }
+
+    if (size > table->size)
+    {
+        free(table->keys);
+        free(table->values);
+        table->keys = malloc(size * sizeof(*table->keys));
+        table->values = malloc(size * sizeof(*table->values));
+
+        if (table->keys == NULL || table->values == NULL)
+        {
+            I_Error("PT_Reset: Failed to allocate %d entries", size);
+        }
+
+        table->size = size;
+    }
+
+    memset(table->keys, 0, table->size * sizeof(*table->keys));
+}
+
+static void PT_Insert(ptrtable_t *table, const void *key, int value)
+{
+    unsigned int i;
+
+    i = PT_Hash(key, table->size);
+
+    while (table->keys[i] != NULL && table->keys[i] != key)
+    {
+        i = (i + 1) & (table->size - 1);
+    }
+
+    table->keys[i] = key;
+    table->values[i] = value;
+}
+
+static int PT_Lookup(ptrtable_t *table, const void *key)
+{
+    unsigned int i;
+
+    if (key == NULL)
+    {
+        return -1;
+    }
+
+    i = PT_Hash(key, table->size);
+
+    while (table->keys[i] != NULL)
+    {
+        if (table->keys[i] == key)
+        {
+            return table->values[i];
+        }
+
+        i = (i + 1) & (table->size - 1);
+    }
+
+    return -1;
+}
+
+//
+// Thinker classification
+//
+
+static boolean P_isActiveCeiling(thinker_t *th)
+{
+    int i;
+
+    for (i = 0; i < numactiveceilings; i++)
+    {
+        if (activeceilings[i] == (ceiling_t *) th)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static boolean P_isActivePlat(thinker_t *th)
+{
+    int i;
+
+    for (i = 0; i < numactiveplats; i++)
+    {
+        if (activeplats[i] == (plat_t *) th)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//
+// P_thinkerType
+//
+// Returns the kind of thinker, or -1 if it need not be kept: removed
+// thinkers nothing refers to any more are about to be freed anyway.
+//
+static int P_thinkerType(thinker_t *th)
+{
+    actionf_p1 func = th->function.acp1;
+
+    if (func == (actionf_p1) P_MobjThinker)
+        return st_mobj;
+    if (func == (actionf_p1) T_MoveCeiling)
+        return st_ceiling;
+    if (func == (actionf_p1) T_VerticalDoor)
+        return st_door;
+    if (func == (actionf_p1) T_SlidingDoor)
+        return st_slidingdoor;
+    if (func == (actionf_p1) T_MoveFloor)
+        return st_floor;
+    if (func == (actionf_p1) T_PlatRaise)
+        return st_plat;
+    if (func == (actionf_p1) T_LightFlash)
+        return st_flash;
+    if (func == (actionf_p1) T_StrobeFlash)
+        return st_strobe;
+    if (func == (actionf_p1) T_Glow)
+        return st_glow;
+    if (func == (actionf_p1) T_FireFlicker)
+        return st_fireflicker;
+
+    // Ceilings and platforms in stasis have no function.
+    if (func == NULL)
+    {
+        if (P_isActiveCeiling(th))
+            return st_ceiling;
+        if (P_isActivePlat(th))
+            return st_plat;
+        return -1;
+    }
+
+    // Only things are referenced by other thinkers.
+    if (func == (actionf_p1) P_RemoveThinkerDelayed && th->references > 0)
+        return st_removed;
+
+    return -1;
+}
+
+//
+// Snapshot buffer
+//
+
+#define SNAPALIGN(len) (((len) + 7) & ~(size_t) 7)
+
+static void P_snapEnsure(snapbuf_t *buf, size_t len)
+{
+    size_t newsize;
+
+    if (buf->length + len <= buf->alloced)
+    {
+        return;
+    }
+
+    newsize = buf->alloced ? buf->alloced : 256 * 1024;
+
+    while (newsize < buf->length + len)
+    {
+        newsize *= 2;
+    }
+
+    buf->data = realloc(buf->data, newsize);
+
+    if (buf->data == NULL)
+    {
+        I_Error("P_snapEnsure: Failed to grow snapshot to %lu bytes",
+                (unsigned long) newsize);
+    }
+
+    buf->alloced = newsize;
+}
+
+static void *P_snapReserve(snapbuf_t *buf, size_t len)
+{
+    void *result;
+
+    // Keep records aligned so they can be patched in place.
+    len = SNAPALIGN(len);
+
+    P_snapEnsure(buf, len);
+
+    result = buf->data + buf->length;
+    buf->length += len;
+
+    return result;
+}
+
+static void P_snapWrite(snapbuf_t *buf, const void *data, size_t len)
+{
+    memcpy(P_snapReserve(buf, len), data, len);
+}
+
+static void P_snapWriteInt(snapbuf_t *buf, int value)
+{
+    P_snapWrite(buf, &value, sizeof(value));
+}
+
+static const void *P_snapRead(const byte *data, size_t *pos, size_t len)
+{
+    const void *result = data + *pos;
+
+    *pos += SNAPALIGN(len);
+
+    return result;
+}
+
+static int P_snapReadInt(const byte *data, size_t *pos)
+{
+    int value;
+
+    memcpy(&value, P_snapRead(data, pos, sizeof(value)), sizeof(value));
+
+    return value;
+}
+
+//
+// P_snapEstimate
+//
+// Rough size of a full image of the current level, so the buffer is
+// grown once up front rather than record by record.
+//
+static size_t P_snapEstimate(int numthinkers)
+{
+    return sizeof(snapglobals_t)
+         + numthinkers * (sizeof(mobj_t) + 24)
+         + (numactiveceilings + numactiveplats + 4) * 8
+         + sizeof(buttonlist) + sizeof(itemrespawnque)
+         + sizeof(itemrespawntime)
+         + numsectors * sizeof(snapsector_t)
+         + numlines * sizeof(snapline_t)
+         + numsides * sizeof(snapside_t)
+         + sizeof(players) + sizeof(snapdialog_t) + 64;
+}
+
+// Thinker pointer <-> index, with 0 for NULL
+
+static int P_thinkerIndex(const void *th)
+{
+    return PT_Lookup(&thinkertable, th) + 1;
+}
+
+static void *P_thinkerPointer(intptr_t index)
+{
+    return index ? newthinkers[index - 1] : NULL;
+}
+
+#define ENCODE(p) ((void *) (intptr_t) P_thinkerIndex(p))
+#define DECODE(p) P_thinkerPointer((intptr_t) (p))
+
+snapshot_t *P_NewSnapshot(void)
+{
+    snapshot_t *snap;
+
+    snap = calloc(1, sizeof(*snap));
+
+    if (snap == NULL)
+    {
+        I_Error("P_NewSnapshot: Failed to allocate snapshot");
+    }
+
+    return snap;
+}
+
+void P_FreeSnapshot(snapshot_t *snap)
+{
+    if (snap != NULL)
+    {
+        free(snap->buf.data);
+        free(snap);
+    }
+}
+
+//
+// P_writeImage
+//
+// Writes a full image of the current level into the buffer.
+//
+static void P_writeImage(snapbuf_t *buf)
+{
+    thinker_t *th;
+    snapglobals_t *globals;
+    snapdialog_t *sdlg;
+    dialogstate_t dialog;
+    snapsector_t *ss;
+    snapline_t *sl;
+    snapside_t *sd;
+    player_t *pl;
+    int numthinkers;
+    int type;
+    int i;
+
+    // Number the thinkers.
+
+    numthinkers = 0;
+
+    for (th = thinkercap.next; th != &thinkercap; th = th->next)
+    {
+        ++numthinkers;
+    }
+
+    PT_Reset(&thinkertable, numthinkers);
+    numthinkers = 0;
+
+    for (th = thinkercap.next; th != &thinkercap; th = th->next)
+    {
+        if (P_thinkerType(th) >= 0)
+        {
+            PT_Insert(&thinkertable, th, numthinkers++);
+        }
+    }
+
+    buf->length = 0;
+    P_snapEnsure(buf, P_snapEstimate(numthinkers));
+
+    globals = P_snapReserve(buf, sizeof(*globals));
+    globals->leveltime = leveltime;
+    globals->prndindex = prndindex;
+    globals->levelTimer = levelTimer;
+    globals->levelTimeCount = levelTimeCount;
+    globals->paused = paused;
+    globals->totalkills = totalkills;
+    globals->totalsecret = totalsecret;
+    globals->iquehead = iquehead;
+    globals->iquetail = iquetail;
+    globals->numignitechains = numignitechains;
+    globals->curignitemobj = P_thinkerIndex(curignitemobj);
+    globals->entity_pos_x = entity_pos_x;
+    globals->entity_pos_y = entity_pos_y;
+    globals->entity_pos_z = entity_pos_z;
+    globals->destmap = destmap;
+    globals->riftdest = riftdest;
+
+    for (i = 0; i < MAXPLAYERS; i++)
+    {
+        globals->playeringame[i] = playeringame[i];
+    }
+
+    // Thinkers, in list order. The copy keeps the thinker's own address
+    // in its prev link, so sounds can follow it after a restore.
+
+    P_snapWriteInt(buf, numthinkers);
+
+    for (th = thinkercap.next; th != &thinkercap; th = th->next)
+    {
+        thinker_t *copy;
+
+        type = P_thinkerType(th);
+
+        if (type < 0)
+        {
+            continue;
+        }
+
+        P_snapWriteInt(buf, type);
+        copy = P_snapReserve(buf, thinkersizes[type]);
+        memcpy(copy, th, thinkersizes[type]);
+
+        copy->prev = th;
+        copy->next = NULL;
+
+        if (type == st_mobj || type == st_removed)
+        {
+            mobj_t *mo = (mobj_t *) copy;
+
+            mo->snext  = ENCODE(mo->snext);
+            mo->sprev  = ENCODE(mo->sprev);
+            mo->bnext  = ENCODE(mo->bnext);
+            mo->bprev  = ENCODE(mo->bprev);
+            mo->target = ENCODE(mo->target);
+            mo->tracer = ENCODE(mo->tracer);
+        }
+    }
+
+    P_snapWriteInt(buf, numactiveceilings);
+
+    for (i = 0; i < numactiveceilings; i++)
+    {
+        P_snapWriteInt(buf, P_thinkerIndex(activeceilings[i]));
+    }
+
+    P_snapWriteInt(buf, numactiveplats);
+
+    for (i = 0; i < numactiveplats; i++)
+    {
+        P_snapWriteInt(buf, P_thinkerIndex(activeplats[i]));
+    }
+
+    P_snapWrite(buf, buttonlist, sizeof(buttonlist));
+    P_snapWrite(buf, itemrespawnque, sizeof(itemrespawnque));
+    P_snapWrite(buf, itemrespawntime, sizeof(itemrespawntime));
+
+    // Level geometry
+
+    ss = P_snapReserve(buf, numsectors * sizeof(*ss));
+
+    for (i = 0; i < numsectors; i++, ss++)
+    {
+        sector_t *sec = &sectors[i];
+
+        ss->floorheight    = sec->floorheight;
+        ss->ceilingheight  = sec->ceilingheight;
+        ss->floorpic       = sec->floorpic;
+        ss->ceilingpic     = sec->ceilingpic;
+        ss->lightlevel     = sec->lightlevel;
+        ss->special        = sec->special;
+        ss->tag            = sec->tag;
+        ss->soundtraversed = sec->soundtraversed;
+        ss->soundtarget    = P_thinkerIndex(sec->soundtarget);
+        ss->thinglist      = P_thinkerIndex(sec->thinglist);
+        ss->specialdata    = P_thinkerIndex(sec->specialdata);
+    }
+
+    sl = P_snapReserve(buf, numlines * sizeof(*sl));
+
+    for (i = 0; i < numlines; i++, sl++)
+    {
+        sl->flags       = lines[i].flags;
+        sl->special     = lines[i].special;
+        sl->tag         = lines[i].tag;
+        sl->specialdata = P_thinkerIndex(lines[i].specialdata);
+    }
+
+    sd = P_snapReserve(buf, numsides * sizeof(*sd));
+
+    for (i = 0; i < numsides; i++, sd++)
+    {
+        sd->textureoffset = sides[i].textureoffset;
+        sd->rowoffset     = sides[i].rowoffset;
+        sd->toptexture    = sides[i].toptexture;
+        sd->bottomtexture = sides[i].bottomtexture;
+        sd->midtexture    = sides[i].midtexture;
+    }
+
+    // Heads of the blockmap chains, as (block, thing) pairs.
+
+    for (i = 0; i < bmapwidth * bmapheight; i++)
+    {
+        if (blocklinks[i] != NULL)
+        {
+            P_snapWriteInt(buf, i);
+            P_snapWriteInt(buf, P_thinkerIndex(blocklinks[i]));
+        }
+    }
+
+    P_snapWriteInt(buf, -1);
+
+    // Players
+
+    pl = P_snapReserve(buf, sizeof(players));
+    memcpy(pl, players, sizeof(players));
+
+    for (i = 0; i < MAXPLAYERS; i++, pl++)
+    {
+        pl->mo       = ENCODE(pl->mo);
+        pl->attacker = ENCODE(pl->attacker);
+    }
+
+    // Dialog
+
+    P_GetDialogState(&dialog);
+
+    sdlg = P_snapReserve(buf, sizeof(*sdlg));
+    sdlg->player       = dialog.player ? dialog.player - players : -1;
+    sdlg->talker       = P_thinkerIndex(dialog.talker);
+    sdlg->talkerangle  = dialog.talkerangle;
+    sdlg->dialog       = dialog.dialog;
+    sdlg->talkerstates = dialog.talkerstates;
+    memcpy(sdlg->mission_objective, mission_objective,
+           sizeof(sdlg->mission_objective));
+}
+
+//
+// P_SnapshotState
+//
+void P_SnapshotState(snapshot_t *snap)
+{
+    P_writeImage(&snap->buf);
+
+    snap->valid = true;
+    snap->gamemap = gamemap;
+    snap->levelstarttic = levelstarttic;
+    snap->base = NULL;
+    ++snap->serial;
+}
+
+//
+// P_relinkThing
+//
+// Maps a thing from before a restore to its copy from the snapshot, if
+// it has one. Anything that is not a thinker is passed through.
+//
+static mobj_t *P_relinkThing(mobj_t *mo)
+{
+    int index;
+
+    if (mo == NULL)
+    {
+        return NULL;
+    }
+
+    if (PT_Lookup(&thinkertable, mo) < 0)
+    {
+        return mo;
+    }
+
+    index = PT_Lookup(&snaptable, mo);
+
+    if (index < 0 || newtypes[index] != st_mobj)
+    {
+        return NULL;
+    }
+
+    return (mobj_t *) newthinkers[index];
+}
+
+//
+// P_restoreImage
+//
+// Puts the level back into the state held by a full image.
+//
+static void P_restoreImage(const byte *data)
+{
+    const snapglobals_t *globals;
+    const snapdialog_t *sdlg;
+    dialogstate_t dialog;
+    const snapsector_t *ss;
+    const snapline_t *sl;
+    const snapside_t *sd;
+    const player_t *pl;
+    thinker_t *th, *next;
+    size_t pos;
+    int numthinkers;
+    int count;
+    int type;
+    int block;
+    int i;
+
+    pos = 0;
+    globals = P_snapRead(data, &pos, sizeof(*globals));
+
+    // Make the snapshot's thinkers, while the current ones still exist
+    // for sounds and markers to be moved over from.
+
+    numthinkers = P_snapReadInt(data, &pos);
+
+    if (numthinkers > newthinkersalloc)
+    {
+        newthinkersalloc = numthinkers * 2;
+        newthinkers = realloc(newthinkers,
+                              newthinkersalloc * sizeof(*newthinkers));
+        newtypes = realloc(newtypes, newthinkersalloc * sizeof(*newtypes));
+
+        if (newthinkers == NULL || newtypes == NULL)
+        {
+            I_Error("P_restoreImage: Failed to allocate %d thinkers",
+                    newthinkersalloc);
+        }
+    }
+
+    PT_Reset(&snaptable, numthinkers);
+
+    for (i = 0; i < numthinkers; i++)
+    {
+        type = P_snapReadInt(data, &pos);
+
+        th = Z_Malloc(thinkersizes[type],
+                      type == st_mobj || type == st_removed ? PU_LEVEL
+                                                            : PU_LEVSPEC,
+                      NULL);
+        memcpy(th, P_snapRead(data, &pos, thinkersizes[type]),
+               thinkersizes[type]);
+
+        PT_Insert(&snaptable, th->prev, i);
+        newthinkers[i] = th;
+        newtypes[i] = type;
+    }
+
+    count = 0;
+
+    for (th = thinkercap.next; th != &thinkercap; th = th->next)
+    {
+        ++count;
+    }
+
+    PT_Reset(&thinkertable, count);
+
+    for (th = thinkercap.next; th != &thinkercap; th = th->next)
+    {
+        PT_Insert(&thinkertable, th, 0);
+    }
+
+    S_RelinkSounds(P_relinkThing);
+
+    // Out with the old.
+
+    for (th = thinkercap.next; th != &thinkercap; th = next)
+    {
+        next = th->next;
+        Z_Free(th);
+    }
+
+    P_InitThinkers();
+
+    for (i = 0; i < numthinkers; i++)
+    {
+        th = newthinkers[i];
+        P_AddThinker(th);
+
+        if (newtypes[i] == st_mobj || newtypes[i] == st_removed)
+        {
+            mobj_t *mo = (mobj_t *) th;
+
+            mo->snext  = DECODE(mo->snext);
+            mo->sprev  = DECODE(mo->sprev);
+            mo->bnext  = DECODE(mo->bnext);
+            mo->bprev  = DECODE(mo->bprev);
+            mo->target = DECODE(mo->target);
+            mo->tracer = DECODE(mo->tracer);
+        }
+    }
+
+    count = P_snapReadInt(data, &pos);
+
+    if (count > numactiveceilingsalloc)
+    {
+        numactiveceilingsalloc = count;
+        activeceilings = Z_Realloc(activeceilings,
+                                   numactiveceilingsalloc * sizeof(ceiling_t *),
+                                   PU_STATIC, NULL);
+    }
+
+    numactiveceilings = count;
+
+    for (i = 0; i < count; i++)
+    {
+        activeceilings[i] = P_thinkerPointer(P_snapReadInt(data, &pos));
+    }
+
+    count = P_snapReadInt(data, &pos);
+
+    if (count > numactiveplatsalloc)
+    {
+        numactiveplatsalloc = count;
+        activeplats = Z_Realloc(activeplats,
+                                numactiveplatsalloc * sizeof(plat_t *),
+                                PU_STATIC, NULL);
+    }
+
+    numactiveplats = count;
+
+    for (i = 0; i < count; i++)
+    {
+        activeplats[i] = P_thinkerPointer(P_snapReadInt(data, &pos));
+    }
+
+    memcpy(buttonlist, P_snapRead(data, &pos, sizeof(buttonlist)),
+           sizeof(buttonlist));
+    memcpy(itemrespawnque, P_snapRead(data, &pos, sizeof(itemrespawnque)),
+           sizeof(itemrespawnque));
+    memcpy(itemrespawntime, P_snapRead(data, &pos, sizeof(itemrespawntime)),
+           sizeof(itemrespawntime));
+
+    // Level geometry
+
+    ss = P_snapRead(data, &pos, numsectors * sizeof(*ss));
+
+    for (i = 0; i < numsectors; i++, ss++)
+    {
+        sector_t *sec = &sectors[i];
+
+        sec->floorheight    = ss->floorheight;
+        sec->ceilingheight  = ss->ceilingheight;
+        sec->floorpic       = ss->floorpic;
+        sec->ceilingpic     = ss->ceilingpic;
+        sec->lightlevel     = ss->lightlevel;
+        sec->special        = ss->special;
+        sec->tag            = ss->tag;
+        sec->soundtraversed = ss->soundtraversed;
+        sec->soundtarget    = P_thinkerPointer(ss->soundtarget);
+        sec->thinglist      = P_thinkerPointer(ss->thinglist);
+        sec->specialdata    = P_thinkerPointer(ss->specialdata);
+    }
+
+    sl = P_snapRead(data, &pos, numlines * sizeof(*sl));
+
+    for (i = 0; i < numlines; i++, sl++)
+    {
+        lines[i].flags       = sl->flags;
+        lines[i].special     = sl->special;
+        lines[i].tag         = sl->tag;
+        lines[i].specialdata = P_thinkerPointer(sl->specialdata);
+    }
+
+    sd = P_snapRead(data, &pos, numsides * sizeof(*sd));
+
+    for (i = 0; i < numsides; i++, sd++)
+    {
+        sides[i].textureoffset = sd->textureoffset;
+        sides[i].rowoffset     = sd->rowoffset;
+        sides[i].toptexture    = sd->toptexture;
+        sides[i].bottomtexture = sd->bottomtexture;
+        sides[i].midtexture    = sd->midtexture;
+    }
+
+    memset(blocklinks, 0, bmapwidth * bmapheight * sizeof(*blocklinks));
+
+    while ((block = P_snapReadInt(data, &pos)) >= 0)
+    {
+        blocklinks[block] = P_thinkerPointer(P_snapReadInt(data, &pos));
+    }
+
+    // Players
+
+    pl = P_snapRead(data, &pos, sizeof(players));
+    memcpy(players, pl, sizeof(players));
+
+    for (i = 0; i < MAXPLAYERS; i++)
+    {
+        players[i].mo       = DECODE(players[i].mo);
+        players[i].attacker = DECODE(players[i].attacker);
+    }
+
+    // Dialog
+
+    sdlg = P_snapRead(data, &pos, sizeof(*sdlg));
+
+    dialog.player       = sdlg->player >= 0 ? &players[sdlg->player] : NULL;
+    dialog.talker       = P_thinkerPointer(sdlg->talker);
+    dialog.talkerangle  = sdlg->talkerangle;
+    dialog.dialog       = sdlg->dialog;
+    dialog.talkerstates = sdlg->talkerstates;
+    P_SetDialogState(&dialog);
+
+    memcpy(mission_objective, sdlg->mission_objective,
+           sizeof(mission_objective));
+
+    leveltime       = globals->leveltime;
+    prndindex       = globals->prndindex;
+    levelTimer      = globals->levelTimer;
+    levelTimeCount  = globals->levelTimeCount;
+    paused          = globals->paused;
+    totalkills      = globals->totalkills;
+    totalsecret     = globals->totalsecret;
+    iquehead        = globals->iquehead;
+    iquetail        = globals->iquetail;
+    numignitechains = globals->numignitechains;
+    curignitemobj   = P_thinkerPointer(globals->curignitemobj);
+    entity_pos_x    = globals->entity_pos_x;
+    entity_pos_y    = globals->entity_pos_y;
+    entity_pos_z    = globals->entity_pos_z;
+    destmap         = globals->destmap;
+    riftdest        = globals->riftdest;
+
+    for (i = 0; i < MAXPLAYERS; i++)
+    {
+        playeringame[i] = globals->playeringame[i];
+    }
+
+    // Count references afresh, now everything holding one is back.
+
+    for (i = 0; i < numthinkers; i++)
+    {
+        if (newtypes[i] == st_mobj || newtypes[i] == st_removed)
+        {
+            mobj_t *mo = (mobj_t *) newthinkers[i];
+
+            if (mo->target)
+                mo->target->thinker.references++;
+            if (mo->tracer)
+                mo->tracer->thinker.references++;
+        }
+    }
+
+    for (i = 0; i < numsectors; i++)
+    {
+        if (sectors[i].soundtarget)
+            sectors[i].soundtarget->thinker.references++;
+    }
+
+    if (curignitemobj)
+        curignitemobj->thinker.references++;
+
+    ST_RelinkDamageMarkers(P_relinkThing);
+}
+
+//
+// Delta encoding
+//
+// A delta is a stream of unsigned varints.  Runs of 32-bit words are
+// coded against the same words of the base as alternating counts of
+// unchanged and changed words, each count of changed words followed by
+// the new words themselves.
+//
+
+static void P_deltaPut(snapbuf_t *buf, const void *data, size_t len)
+{
+    P_snapEnsure(buf, len);
+    memcpy(buf->data + buf->length, data, len);
+    buf->length += len;
+}
+
+static void P_deltaPutVarint(snapbuf_t *buf, unsigned int value)
+{
+    byte bytes[5];
+    int len = 0;
+
+    do
+    {
+        bytes[len] = value & 0x7f;
+        value >>= 7;
+
+        if (value != 0)
+        {
+            bytes[len] |= 0x80;
+        }
+
+        ++len;
+    } while (value != 0);
+
+    P_deltaPut(buf, bytes, len);
+}
+
+// Varint at *pos of a delta len bytes long.  Returns false if it runs
+// off the end or does not fit in 32 bits.
+
+static boolean P_deltaGetVarint(const byte *data, size_t len, size_t *pos,
+                                unsigned int *value)
+{
+    unsigned int result = 0;
+    int shift = 0;
+    byte b;
+
+    do
+    {
+        if (*pos >= len || shift > 28)
+        {
+            return false;
+        }
+
+        b = data[(*pos)++];
+        result |= (unsigned int) (b & 0x7f) << shift;
+        shift += 7;
+    } while (b & 0x80);
+
+    *value = result;
+
+    return true;
+}
+
+static void P_deltaPutWords(snapbuf_t *buf, const byte *cur,
+                            const byte *base, size_t numwords)
+{
+    size_t start;
+    size_t i;
+
+    i = 0;
+
+    while (i < numwords)
+    {
+        start = i;
+
+        while (i < numwords && !memcmp(cur + i * 4, base + i * 4, 4))
+        {
+            ++i;
+        }
+
+        P_deltaPutVarint(buf, i - start);
+
+        if (i == numwords)
+        {
+            break;
+        }
+
+        start = i;
+
+        while (i < numwords && memcmp(cur + i * 4, base + i * 4, 4))
+        {
+            ++i;
+        }
+
+        P_deltaPutVarint(buf, i - start);
+        P_deltaPut(buf, cur + start * 4, (i - start) * 4);
+    }
+}
+
+// Decodes numwords words against the base.  Returns false if a run
+// does not fit in what is left of the output or of the delta.
+
+static boolean P_deltaGetWords(byte *out, const byte *base, size_t numwords,
+                               const byte *delta, size_t len, size_t *pos)
+{
+    unsigned int run;
+    size_t i;
+
+    i = 0;
+
+    while (i < numwords)
+    {
+        if (!P_deltaGetVarint(delta, len, pos, &run) || run > numwords - i)
+        {
+            return false;
+        }
+
+        memcpy(out + i * 4, base + i * 4, run * 4);
+        i += run;
+
+        if (i >= numwords)
+        {
+            break;
+        }
+
+        if (!P_deltaGetVarint(delta, len, pos, &run) || run > numwords - i
+         || run > (len - *pos) / 4)
+        {
+            return false;
+        }
+
+        memcpy(out + i * 4, delta + *pos, run * 4);
+        *pos += run * 4;
+        i += run;
+    }
+
+    return true;
+}
+
+//
+// P_indexBase
+//
+// Finds the thinker records in a full image of len bytes. Returns the
+// number of records, and the offset of what follows them in *tail, or
+// -1 if the image is damaged.
+//
+static int P_indexBase(const byte *data, size_t len, size_t *tail)
+{
+    size_t pos;
+    int numrecords;
+    int type;
+    int i;
+
+    pos = SNAPALIGN(sizeof(snapglobals_t));
+
+    if (pos + SNAPALIGN(sizeof(int)) > len)
+    {
+        return -1;
+    }
+
+    numrecords = P_snapReadInt(data, &pos);
+
+    // Every record takes at least the word holding its type.
+
+    if (numrecords < 0
+     || (size_t) numrecords > (len - pos) / SNAPALIGN(sizeof(int)))
+    {
+        return -1;
+    }
+
+    if (numrecords > baserecordsalloc)
+    {
+        baserecordsalloc = numrecords * 2;
+        baseoffsets = realloc(baseoffsets,
+                              baserecordsalloc * sizeof(*baseoffsets));
+        basetypes = realloc(basetypes, baserecordsalloc * sizeof(*basetypes));
+
+        if (baseoffsets == NULL || basetypes == NULL)
+        {
+            I_Error("P_indexBase: Failed to allocate %d records",
+                    baserecordsalloc);
+        }
+    }
+
+    for (i = 0; i < numrecords; i++)
+    {
+        if (pos + SNAPALIGN(sizeof(int)) > len)
+        {
+            return -1;
+        }
+
+        type = P_snapReadInt(data, &pos);
+
+        if (type < 0 || type >= NUMSNAPTHINKERS
+         || pos + SNAPALIGN(thinkersizes[type]) > len)
+        {
+            return -1;
+        }
+
+        basetypes[i] = type;
+        baseoffsets[i] = pos;
+        pos += SNAPALIGN(thinkersizes[type]);
+    }
+
+    *tail = pos;
+
+    return numrecords;
+}
+
+//
+// P_deltaImage
+//
+// Appends a full image coded as a delta against a full base image.
+// Returns false, having appended nothing, if the base is damaged.
+//
+static boolean P_deltaImage(snapbuf_t *out, const byte *cur, size_t curlen,
+                            const byte *basedata, size_t baselen)
+{
+    const byte *record;
+    size_t basetail;
+    size_t taillen, basetaillen, overlap;
+    size_t size;
+    size_t pos;
+    int numbase;
+    int numthinkers;
+    int type;
+    int match;
+    int i;
+
+    numbase = P_indexBase(basedata, baselen, &basetail);
+
+    if (numbase < 0)
+    {
+        return false;
+    }
+
+    PT_Reset(&basetable, numbase);
+
+    for (i = 0; i < numbase; i++)
+    {
+        PT_Insert(&basetable,
+                  ((const thinker_t *) (basedata + baseoffsets[i]))->prev, i);
+    }
+
+    P_snapEnsure(out, curlen / 4);
+
+    size = SNAPALIGN(sizeof(snapglobals_t));
+    P_deltaPutWords(out, cur, basedata, size / 4);
+    pos = size;
+
+    // Each thinker against the record the base has for the same thinker,
+    // if it has one.
+
+    numthinkers = P_snapReadInt(cur, &pos);
+    P_deltaPutVarint(out, numthinkers);
+
+    for (i = 0; i < numthinkers; i++)
+    {
+        type = P_snapReadInt(cur, &pos);
+        size = SNAPALIGN(thinkersizes[type]);
+        record = cur + pos;
+        pos += size;
+
+        match = PT_Lookup(&basetable, ((const thinker_t *) record)->prev);
+
+        if (match >= 0 && basetypes[match] != type)
+        {
+            match = -1;
+        }
+
+        P_deltaPutVarint(out, type);
+        P_deltaPutVarint(out, match + 1);
+
+        if (match >= 0)
+        {
+            P_deltaPutWords(out, record, basedata + baseoffsets[match],
+                            size / 4);
+        }
+        else
+        {
+            P_deltaPut(out, record, size);
+        }
+    }
+
+    // Everything else is laid out alike from one snapshot to the next,
+    // give or take some blockmap links and specials.
+
+    taillen = curlen - pos;
+    basetaillen = baselen - basetail;
+    overlap = MIN(taillen, basetaillen);
+
+    P_deltaPutVarint(out, taillen);
+    P_deltaPutWords(out, cur + pos, basedata + basetail, overlap / 4);
+    P_deltaPut(out, cur + pos + overlap, taillen - overlap);
+
+    return true;
+}
+
+//
+// P_SnapshotDelta
+//
+void P_SnapshotDelta(snapshot_t *snap, snapshot_t *base)
+{
+    // Deltas are only made against full snapshots of this level.
+
+    if (base == NULL || base == snap || base->base != NULL || !base->valid
+     || base->gamemap != gamemap || base->levelstarttic != levelstarttic)
+    {
+        P_SnapshotState(snap);
+        return;
+    }
+
+    P_writeImage(&scratch);
+
+    snap->buf.length = 0;
+
+    if (!P_deltaImage(&snap->buf, scratch.data, scratch.length,
+                      base->buf.data, base->buf.length))
+    {
+        P_SnapshotState(snap);
+        return;
+    }
+
+    snap->valid = true;
+    snap->gamemap = gamemap;
+    snap->levelstarttic = levelstarttic;
+    snap->base = base;
+    snap->baseserial = base->serial;
+    ++snap->serial;
+}
+
+//
+// P_undeltaImage
+//
+// Rebuilds a full image from a delta of len bytes and its base.  The
+// delta may have come from a file, so everything in it is checked
+// before use, and false is returned if it does not decode against the
+// base.
+//
+static boolean P_undeltaImage(snapbuf_t *result, const byte *delta,
+                              size_t len, const byte *basedata,
+                              size_t baselen)
+{
+    size_t basetail;
+    size_t basetaillen, overlap;
+    size_t size;
+    size_t pos;
+    byte *out;
+    unsigned int numthinkers;
+    unsigned int taillen;
+    unsigned int type;
+    unsigned int match;
+    unsigned int i;
+    int numbase;
+
+    numbase = P_indexBase(basedata, baselen, &basetail);
+
+    if (numbase < 0)
+    {
+        return false;
+    }
+
+    result->length = 0;
+    P_snapEnsure(result, baselen);
+    pos = 0;
+
+    size = SNAPALIGN(sizeof(snapglobals_t));
+    out = P_snapReserve(result, size);
+
+    if (!P_deltaGetWords(out, basedata, size / 4, delta, len, &pos)
+     || !P_deltaGetVarint(delta, len, &pos, &numthinkers))
+    {
+        return false;
+    }
+
+    // Every thinker takes at least two bytes of the delta.
+
+    if (numthinkers > (len - pos) / 2)
+    {
+        return false;
+    }
+
+    P_snapWriteInt(result, numthinkers);
+
+    for (i = 0; i < numthinkers; i++)
+    {
+        if (!P_deltaGetVarint(delta, len, &pos, &type)
+         || !P_deltaGetVarint(delta, len, &pos, &match)
+         || type >= NUMSNAPTHINKERS)
+        {
+            return false;
+        }
+
+        size = SNAPALIGN(thinkersizes[type]);
+
+        P_snapWriteInt(result, type);
+        out = P_snapReserve(result, size);
+
+        if (match > 0)
+        {
+            // Coded against a base record of the same kind.
+
+            if (match > (unsigned int) numbase
+             || basetypes[match - 1] != type
+             || !P_deltaGetWords(out, basedata + baseoffsets[match - 1],
+                                 size / 4, delta, len, &pos))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            if (size > len - pos)
+            {
+                return false;
+            }
+
+            memcpy(out, delta + pos, size);
+            pos += size;
+        }
+    }
+
+    if (!P_deltaGetVarint(delta, len, &pos, &taillen))
+    {
+        return false;
+    }
+
+    basetaillen = baselen - basetail;
+    overlap = MIN(taillen, basetaillen);
+
+    // What the base does not cover comes from the delta.
+
+    if (taillen - overlap > len - pos)
+    {
+        return false;
+    }
+
+    out = P_snapReserve(result, taillen);
+
+    if (!P_deltaGetWords(out, basedata + basetail, overlap / 4,
+                         delta, len, &pos)
+     || taillen - overlap > len - pos)
+    {
+        return false;
+    }
+
+    memcpy(out + overlap, delta + pos, taillen - overlap);
+    pos += taillen - overlap;
+
+    return pos == len;
+}
+
+//
+// P_RestoreState
+//
+boolean P_RestoreState(snapshot_t *snap)
+{
+    if (!snap->valid || gamestate != GS_LEVEL
+     || snap->gamemap != gamemap || snap->levelstarttic != levelstarttic)
+    {
+        return false;
+    }
+
+    if (snap->base != NULL)
+    {
+        // The base must not have been retaken since.
+
+        if (!snap->base->valid || snap->base->serial != snap->baseserial)
+        {
+            return false;
+        }
+
+        if (!P_undeltaImage(&scratch, snap->buf.data, snap->buf.length,
+                            snap->base->buf.data, snap->base->buf.length))
+        {
+            I_Error("P_RestoreState: Snapshot does not match its base");
+        }
+
+        P_restoreImage(scratch.data);
+    }
+    else
+    {
+        P_restoreImage(snap->buf.data);
+    }
+
+    return true;
+}
+
+//
+// Portable images
+//
+// A portable image is a full image or a delta, as above, with every
+// pointer that is not to a thinker replaced by a number: an index into
+// the array it points into, plus one, or zero for NULL.  Thinker links
+// are already indices.  The thinkers' own addresses are kept only as
+// keys for matching records between a delta and its base.
+//
+// The layout of the records still follows the build's structures, so
+// the header carries a signature of their sizes, and an image is only
+// restored by a build that lays them out alike.
+//
+
+#define PORTABLE_MAGIC   0x50535653     // "SVSP"
+#define PORTABLE_VERSION 1
+
+typedef struct
+{
+    int          magic;
+    unsigned int signature;
+    int          delta;
+    int          gamemap;
+    int          numsectors;
+    int          numlines;
+    int          numsides;
+    unsigned int length;        // of the image once decoded
+    unsigned int checksum;      // of what follows the header
+} portheader_t;
+
+#define PORTHEADERSIZE SNAPALIGN(sizeof(portheader_t))
+
+// Function of each kind of thinker, when it has one.
+
+static const actionf_p1 thinkerfuncs[NUMSNAPTHINKERS] =
+{
+    (actionf_p1) P_MobjThinker,
+    (actionf_p1) T_MoveCeiling,
+    (actionf_p1) T_VerticalDoor,
+    (actionf_p1) T_SlidingDoor,
+    (actionf_p1) T_MoveFloor,
+    (actionf_p1) T_PlatRaise,
+    (actionf_p1) T_LightFlash,
+    (actionf_p1) T_StrobeFlash,
+    (actionf_p1) T_Glow,
+    (actionf_p1) T_FireFlicker,
+    (actionf_p1) P_RemoveThinkerDelayed,
+};
+
+// Image being exported.
+static snapbuf_t portbuf;
+
+static unsigned int P_portHash(unsigned int hash, const void *data,
+                               size_t len)
+{
+    const byte *p = data;
+
+    while (len-- > 0)
+    {
+        hash = (hash ^ *p++) * 16777619u;
+    }
+
+    return hash;
+}
+
+//
+// P_portSignature
+//
+// Hash of everything the layout of an image depends on.
+//
+static unsigned int P_portSignature(void)
+{
+    size_t sizes[] =
+    {
+        PORTABLE_VERSION,
+        sizeof(void *),
+        sizeof(snapglobals_t),
+        sizeof(buttonlist),
+        sizeof(itemrespawnque),
+        sizeof(itemrespawntime),
+        sizeof(snapsector_t),
+        sizeof(snapline_t),
+        sizeof(snapside_t),
+        sizeof(players),
+        sizeof(snapdialog_t),
+        NUMSTATES,
+        NUMMOBJTYPES,
+    };
+    unsigned int hash;
+
+    hash = P_portHash(2166136261u, sizes, sizeof(sizes));
+
+    return P_portHash(hash, thinkersizes, sizeof(thinkersizes));
+}
+
+// Pointer into an array <-> number
+
+static void *P_portOut(const void *ptr, const void *array, size_t size)
+{
+    if (ptr == NULL)
+    {
+        return NULL;
+    }
+
+    return (void *) (intptr_t)
+        (((const byte *) ptr - (const byte *) array) / size + 1);
+}
+
+static boolean P_portIn(void **ptr, void *array, size_t size, int count)
+{
+    intptr_t number = (intptr_t) *ptr;
+
+    if (number < 0 || number > count)
+    {
+        return false;
+    }
+
+    *ptr = number ? (byte *) array + (number - 1) * size : NULL;
+
+    return true;
+}
+
+#define PORT(out, field, array, count) \
+    ((out) ? ((field) = P_portOut((field), (array), sizeof(*(array))), true) \
+           : P_portIn((void **) &(field), (array), sizeof(*(array)), (count)))
+
+// Next record of an image, or NULL if the image is too short.
+
+static byte *P_portRecord(byte *data, size_t length, size_t *pos, size_t len)
+{
+    byte *result;
+
+    if (*pos + SNAPALIGN(len) > length)
+    {
+        return NULL;
+    }
+
+    result = data + *pos;
+    *pos += SNAPALIGN(len);
+
+    return result;
+}
+
+static boolean P_portInt(byte *data, size_t length, size_t *pos, int *value)
+{
+    byte *record = P_portRecord(data, length, pos, sizeof(int));
+
+    if (record == NULL)
+    {
+        return false;
+    }
+
+    memcpy(value, record, sizeof(int));
+
+    return true;
+}
+
+//
+// P_portSector
+//
+// Sector a sector special works on.
+//
+static sector_t **P_portSector(thinker_t *th, int type)
+{
+    switch (type)
+    {
+    case st_ceiling:      return &((ceiling_t *) th)->sector;
+    case st_door:         return &((vldoor_t *) th)->sector;
+    case st_slidingdoor:  return &((slidedoor_t *) th)->frontsector;
+    case st_floor:        return &((floormove_t *) th)->sector;
+    case st_plat:         return &((plat_t *) th)->sector;
+    case st_flash:        return &((lightflash_t *) th)->sector;
+    case st_strobe:       return &((strobe_t *) th)->sector;
+    case st_glow:         return &((glow_t *) th)->sector;
+    case st_fireflicker:  return &((fireflicker_t *) th)->sector;
+    default:              return NULL;
+    }
+}
+
+//
+// P_portImage
+//
+// Converts the pointers in a full image to numbers (out) or back
+// (!out).  Going back, every record, index and pointer number in the
+// image is checked against its length and the current level, and false
+// is returned if it does not fit.
+//
+static boolean P_portImage(byte *data, size_t length, boolean out)
+{
+    snapglobals_t *globals;
+    snapsector_t *ss;
+    snapline_t *sl;
+    snapdialog_t *sdlg;
+    button_t *button;
+    player_t *pl;
+    thinker_t *th;
+    sector_t **sector;
+    size_t pos;
+    int numthinkers;
+    int count;
+    int type;
+    int value;
+    int block;
+    int i, j;
+
+    pos = 0;
+    globals = (snapglobals_t *) P_portRecord(data, length, &pos,
+                                             sizeof(*globals));
+
+    if (globals == NULL || !P_portInt(data, length, &pos, &numthinkers)
+     || numthinkers < 0)
+    {
+        return false;
+    }
+
+    if (!out && (globals->curignitemobj < 0
+              || globals->curignitemobj > numthinkers))
+    {
+        return false;
+    }
+
+#define THINKERINDEX(x) ((intptr_t) (x) >= 0 && (intptr_t) (x) <= numthinkers)
+
+    for (i = 0; i < numthinkers; i++)
+    {
+        if (!P_portInt(data, length, &pos, &type)
+         || type < 0 || type >= NUMSNAPTHINKERS)
+        {
+            return false;
+        }
+
+        th = (thinker_t *) P_portRecord(data, length, &pos,
+                                        thinkersizes[type]);
+
+        if (th == NULL)
+        {
+            return false;
+        }
+
+        if (out)
+        {
+            th->function.acp1 = (actionf_p1) (intptr_t)
+                (th->function.acp1 != NULL);
+        }
+        else
+        {
+            th->function.acp1 = th->function.acp1 != NULL ? thinkerfuncs[type]
+                                                          : NULL;
+
+            // Keys no live thinker can have, for relinking sounds.
+
+            th->prev = (thinker_t *) (intptr_t) (i * 2 + 1);
+        }
+
+        if (type == st_mobj || type == st_removed)
+        {
+            mobj_t *mo = (mobj_t *) th;
+
+            if (!PORT(out, mo->subsector, subsectors, numsubsectors)
+             || !PORT(out, mo->info, mobjinfo, NUMMOBJTYPES)
+             || !PORT(out, mo->state, states, NUMSTATES)
+             || !PORT(out, mo->player, players, MAXPLAYERS))
+            {
+                return false;
+            }
+
+            if (!out && (!THINKERINDEX(mo->snext) || !THINKERINDEX(mo->sprev)
+                      || !THINKERINDEX(mo->bnext) || !THINKERINDEX(mo->bprev)
+                      || !THINKERINDEX(mo->target)
+                      || !THINKERINDEX(mo->tracer)))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            sector = P_portSector(th, type);
+
+            if (!PORT(out, *sector, sectors, numsectors))
+            {
+                return false;
+            }
+
+            if (type == st_slidingdoor)
+            {
+                slidedoor_t *door = (slidedoor_t *) th;
+
+                if (!PORT(out, door->line1, lines, numlines)
+                 || !PORT(out, door->line2, lines, numlines))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    // Active ceilings and platforms
+
+    for (j = 0; j < 2; j++)
+    {
+        if (!P_portInt(data, length, &pos, &count) || count < 0)
+        {
+            return false;
+        }
+
+        for (i = 0; i < count; i++)
+        {
+            if (!P_portInt(data, length, &pos, &value)
+             || !THINKERINDEX(value))
+            {
+                return false;
+            }
+        }
+    }
+
+    button = (button_t *) P_portRecord(data, length, &pos, sizeof(buttonlist));
+
+    if (button == NULL)
+    {
+        return false;
+    }
+
+    for (i = 0; i < MAXBUTTONS; i++, button++)
+    {
+        if (!PORT(out, button->line, lines, numlines))
+        {
+            return false;
+        }
+
+        // Sound origins are those of sectors.
+
+        if (out)
+        {
+            for (j = 0; j < numsectors; j++)
+            {
+                if (button->soundorg == &sectors[j].soundorg)
+                {
+                    break;
+                }
+            }
+
+            button->soundorg = (degenmobj_t *) (intptr_t)
+                (button->soundorg != NULL && j < numsectors ? j + 1 : 0);
+        }
+        else
+        {
+            value = (int) (intptr_t) button->soundorg;
+
+            if (value < 0 || value > numsectors)
+            {
+                return false;
+            }
+
+            button->soundorg = value ? &sectors[value - 1].soundorg : NULL;
+        }
+    }
+
+    if (P_portRecord(data, length, &pos, sizeof(itemrespawnque)) == NULL
+     || P_portRecord(data, length, &pos, sizeof(itemrespawntime)) == NULL)
+    {
+        return false;
+    }
+
+    // Level geometry holds only numbers already.
+
+    ss = (snapsector_t *) P_portRecord(data, length, &pos,
+                                       numsectors * sizeof(*ss));
+    sl = (snapline_t *) P_portRecord(data, length, &pos,
+                                     numlines * sizeof(*sl));
+
+    if (ss == NULL || sl == NULL
+     || P_portRecord(data, length, &pos, numsides * sizeof(snapside_t)) == NULL)
+    {
+        return false;
+    }
+
+    if (!out)
+    {
+        for (i = 0; i < numsectors; i++, ss++)
+        {
+            if (!THINKERINDEX(ss->soundtarget) || !THINKERINDEX(ss->thinglist)
+             || !THINKERINDEX(ss->specialdata))
+            {
+                return false;
+            }
+        }
+
+        for (i = 0; i < numlines; i++, sl++)
+        {
+            if (!THINKERINDEX(sl->specialdata))
+            {
+                return false;
+            }
+        }
+    }
+
+    do
+    {
+        if (!P_portInt(data, length, &pos, &block)
+         || block >= bmapwidth * bmapheight)
+        {
+            return false;
+        }
+
+        if (block >= 0 && (!P_portInt(data, length, &pos, &value)
+                        || !THINKERINDEX(value)))
+        {
+            return false;
+        }
+    } while (block >= 0);
+
+    // Players
+
+    pl = (player_t *) P_portRecord(data, length, &pos, sizeof(players));
+
+    if (pl == NULL)
+    {
+        return false;
+    }
+
+    for (i = 0; i < MAXPLAYERS; i++, pl++)
+    {
+        if (!out && (!THINKERINDEX(pl->mo) || !THINKERINDEX(pl->attacker)))
+        {
+            return false;
+        }
+
+        // Messages on screen are not part of the play simulation.
+
+        pl->message = NULL;
+
+        for (j = 0; j < NUMPSPRITES; j++)
+        {
+            if (!PORT(out, pl->psprites[j].state, states, NUMSTATES))
+            {
+                return false;
+            }
+        }
+    }
+
+    // Dialog
+
+    sdlg = (snapdialog_t *) P_portRecord(data, length, &pos, sizeof(*sdlg));
+
+    if (sdlg == NULL)
+    {
+        return false;
+    }
+
+    if (out)
+    {
+        sdlg->dialog = (mapdialog_t *) (intptr_t)
+            P_DialogNumber(sdlg->dialog);
+        sdlg->talkerstates = (void *) (intptr_t)
+            P_DialogStatesNumber(sdlg->talkerstates);
+    }
+    else if (sdlg->player < -1 || sdlg->player >= MAXPLAYERS
+          || !THINKERINDEX(sdlg->talker)
+          || !P_DialogByNumber((int) (intptr_t) sdlg->dialog, &sdlg->dialog)
+          || !P_DialogStatesByNumber((int) (intptr_t) sdlg->talkerstates,
+                                     &sdlg->talkerstates))
+    {
+        return false;
+    }
+
+#undef THINKERINDEX
+
+    return pos == length;
+}
+
+//
+// P_ExportState
+//
+byte *P_ExportState(const byte *base, size_t baselen, size_t *len)
+{
+    portheader_t *header;
+    portheader_t baseheader;
+    byte *result;
+
+    P_writeImage(&scratch);
+
+    if (!P_portImage(scratch.data, scratch.length, true))
+    {
+        I_Error("P_ExportState: Failed to convert the level");
+    }
+
+    portbuf.length = 0;
+    header = P_snapReserve(&portbuf, sizeof(*header));
+    memset(header, 0, sizeof(*header));
+
+    if (base != NULL && baselen > PORTHEADERSIZE)
+    {
+        memcpy(&baseheader, base, sizeof(baseheader));
+    }
+
+    if (base != NULL && baselen > PORTHEADERSIZE && !baseheader.delta
+     && baseheader.gamemap == gamemap
+     && P_deltaImage(&portbuf, scratch.data, scratch.length,
+                     base + PORTHEADERSIZE, baselen - PORTHEADERSIZE))
+    {
+        header = (portheader_t *) portbuf.data;
+        header->delta = true;
+    }
+    else
+    {
+        P_deltaPut(&portbuf, scratch.data, scratch.length);
+        header = (portheader_t *) portbuf.data;
+        header->delta = false;
+    }
+
+    header->magic = PORTABLE_MAGIC;
+    header->signature = P_portSignature();
+    header->gamemap = gamemap;
+    header->numsectors = numsectors;
+    header->numlines = numlines;
+    header->numsides = numsides;
+    header->length = scratch.length;
+    header->checksum = P_portHash(2166136261u, portbuf.data + PORTHEADERSIZE,
+                                  portbuf.length - PORTHEADERSIZE);
+
+    result = Z_Malloc(portbuf.length, PU_STATIC, NULL);
+    memcpy(result, portbuf.data, portbuf.length);
+    *len = portbuf.length;
+
+    return result;
+}
+
+//
+// P_portValid
+//
+// Checks the header and checksum of a portable image.
+//
+static boolean P_portValid(const byte *data, size_t len)
+{
+    portheader_t header;
+
+    if (data == NULL || len < PORTHEADERSIZE)
+    {
+        return false;
+    }
+
+    memcpy(&header, data, sizeof(header));
+
+    return header.magic == PORTABLE_MAGIC
+        && header.signature == P_portSignature()
+        && header.gamemap == gamemap
+        && header.numsectors == numsectors
+        && header.numlines == numlines
+        && header.numsides == numsides
+        && header.checksum == P_portHash(2166136261u, data + PORTHEADERSIZE,
+                                         len - PORTHEADERSIZE);
+}
+
+//
+// P_ImportState
+//
+boolean P_ImportState(const byte *data, size_t len,
+                      const byte *base, size_t baselen)
+{
+    portheader_t header;
+    portheader_t baseheader;
+
+    if (gamestate != GS_LEVEL || !P_portValid(data, len))
+    {
+        return false;
+    }
+
+    memcpy(&header, data, sizeof(header));
+
+    if (header.delta)
+    {
+        if (!P_portValid(base, baselen))
+        {
+            return false;
+        }
+
+        memcpy(&baseheader, base, sizeof(baseheader));
+
+        if (baseheader.delta)
+        {
+            return false;
+        }
+
+        if (!P_undeltaImage(&scratch, data + PORTHEADERSIZE,
+                            len - PORTHEADERSIZE, base + PORTHEADERSIZE,
+                            baselen - PORTHEADERSIZE))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        scratch.length = 0;
+        P_deltaPut(&scratch, data + PORTHEADERSIZE, len - PORTHEADERSIZE);
+    }
+
+    if (scratch.length != header.length
+     || !P_portImage(scratch.data, scratch.length, false))
+    {
+        return false;
+    }
+
+    P_restoreImage(scratch.data);
+
+    return true;
+}
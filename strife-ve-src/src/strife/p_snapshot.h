@@ -0,0 +1,65 @@
+//
+// Copyright(C) 2020 Night Dive Studios, LLC
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//    In-memory snapshots of the play simulation.
+//
+
+#ifndef __P_SNAPSHOT__
+#define __P_SNAPSHOT__
+
+#include "doomtype.h"
+
+typedef struct snapshot_s snapshot_t;
+
+// Allocate an empty snapshot.
+
+snapshot_t *P_NewSnapshot(void);
+
+// Free a snapshot.
+
+void P_FreeSnapshot(snapshot_t *snap);
+
+// Capture the state of the current level into the snapshot.
+
+void P_SnapshotState(snapshot_t *snap);
+
+// Capture the state of the current level as a delta against a full
+// snapshot of the same level, which must be kept until the delta is no
+// longer needed.  Falls back to a full snapshot if there is no usable
+// base.
+
+void P_SnapshotDelta(snapshot_t *snap, snapshot_t *base);
+
+// Put the level back into the state captured by the snapshot.  Returns
+// false if the snapshot is empty, was taken on a different level, or is
+// a delta whose base has since been retaken.
+
+boolean P_RestoreState(snapshot_t *snap);
+
+// Capture the state of the current level as a portable image, which can
+// be written to disk and restored by another run of the same build.  If
+// base is a full portable image of the same level, the result is coded
+// as a delta against it.  Returns a buffer allocated with Z_Malloc.
+
+byte *P_ExportState(const byte *base, size_t baselen, size_t *len);
+
+// Put the level back into the state held by a portable image, given the
+// image it is a delta against, if it is one.  Returns false if the image
+// was made by a different build or on a different level, or is damaged.
+
+boolean P_ImportState(const byte *data, size_t len,
+                      const byte *base, size_t baselen);
+
+#endif
+
@@ -278,6 +278,10 @@ typedef struct
 
 extern button_t	buttonlist[MAXBUTTONS]; 
 
+// [SVE] pairs of switch textures, ended by -1
+extern int	switchlist[MAXSWITCHES * 2];
+extern int	numswitches;
+
 void
 P_ChangeSwitchTexture
 ( line_t*	line,
@@ -103,6 +103,12 @@ short**			texturecolumnlump;
 unsigned short**	texturecolumnofs;
 byte**			texturecomposite;
 
+// [SVE] Fully composited textures for drawing walls: a column pointer
+// for each column, then the columns, each padded to a power of two of
+// at least 128 rows with the texture repeated down the padding, so the
+// drawers can wrap with &127.  NULL until built.
+byte***			texturecolumns;
+
 // for global animation
 int*		flattranslation;
 int*		texturetranslation;
@@ -146,13 +152,22 @@ R_DrawColumnInCache
 {
     int		count;
     int		position;
+    int		top = -1;
     byte*	source;
 
     while (patch->topdelta != 0xff)
     {
 	source = (byte *)patch + 3;
 	count = patch->length;
-	position = originy + patch->topdelta;
+
+	// [SVE] tall patches: a topdelta no greater than the last one
+	// is relative to it
+	if (patch->topdelta <= top)
+	    top += patch->topdelta;
+	else
+	    top = patch->topdelta;
+
+	position = originy + top;
 
 	if (position < 0)
 	{
@@ -331,11 +346,107 @@ void R_GenerateLookup (int texnum)
 
 
 
+//
+// R_CacheTexture
+//
+// [SVE] Composite every column of a texture into one block, which goes
+// with the level.  For the software renderer each column is 128 rows,
+// as its column drawers wrap at 128: rows below that are never read, and
+// a shorter texture is repeated down the column.  The OpenGL renderer
+// uploads whole textures, so gets columns of the texture's own height.
+//
+static void R_CacheTexture (int texnum)
+{
+    texture_t*		texture;
+    texpatch_t*		patch;
+    patch_t*		realpatch;
+    column_t*		patchcol;
+    byte**		columns;
+    byte*		pixels;
+    int			cacheheight;
+    int			x;
+    int			x1;
+    int			x2;
+    int			y;
+    int			i;
+
+    texture = textures[texnum];
+
+    cacheheight = use3drenderer ? texture->height : 128;
+
+    columns = Z_Malloc (texture->width * (sizeof(byte *) + cacheheight),
+			PU_LEVEL,
+			(void **)&texturecolumns[texnum]);
+    pixels = (byte *)(columns + texture->width);
+
+    memset (pixels, 0, texture->width * cacheheight);
+
+    for (x=0 ; x<texture->width ; x++)
+	columns[x] = pixels + x*cacheheight;
+
+    for (i=0 , patch = texture->patches;
+	 i<texture->patchcount;
+	 i++, patch++)
+    {
+	realpatch = W_CacheLumpNum (patch->patch, PU_CACHE);
+	x1 = patch->originx;
+	x2 = x1 + SHORT(realpatch->width);
+
+	if (x1<0)
+	    x = 0;
+	else
+	    x = x1;
+
+	if (x2 > texture->width)
+	    x2 = texture->width;
+
+	for ( ; x<x2 ; x++)
+	{
+	    patchcol = (column_t *)((byte *)realpatch
+				    + LONG(realpatch->columnofs[x-x1]));
+	    R_DrawColumnInCache (patchcol,
+				 columns[x],
+				 patch->originy,
+				 MIN(texture->height, cacheheight));
+	}
+    }
+
+    // repeat the texture down the padding
+    if (texture->height > 0)
+    {
+	for (x=0 ; x<texture->width ; x++)
+	{
+	    for (y=texture->height ; y<cacheheight ; y++)
+		columns[x][y] = columns[x][y - texture->height];
+	}
+    }
+}
+
+
 //
 // R_GetColumn
 //
 byte*
 R_GetColumn
+( int		tex,
+  int		col )
+{
+    // [SVE] textures not seen at level start are built on first use
+    if (!texturecolumns[tex])
+	R_CacheTexture (tex);
+
+    return texturecolumns[tex][col & texturewidthmask[tex]];
+}
+
+
+//
+// R_GetMaskedColumn
+//
+// [SVE] Masked textures are drawn post by post, so their columns still
+// come from the patches.
+//
+byte*
+R_GetMaskedColumn
 ( int		tex,
   int		col )
 {
@@ -478,6 +589,8 @@ void R_InitTextures (void)
     texturecolumnofs = Z_Malloc (numtextures * sizeof(*texturecolumnofs), PU_STATIC, 0);
     texturecomposite = Z_Malloc (numtextures * sizeof(*texturecomposite), PU_STATIC, 0);
     texturecompositesize = Z_Malloc (numtextures * sizeof(*texturecompositesize), PU_STATIC, 0);
+    texturecolumns = Z_Malloc (numtextures * sizeof(*texturecolumns), PU_STATIC, 0);
+    memset (texturecolumns, 0, numtextures * sizeof(*texturecolumns));
     texturewidthmask = Z_Malloc (numtextures * sizeof(*texturewidthmask), PU_STATIC, 0);
     textureheight = Z_Malloc (numtextures * sizeof(*textureheight), PU_STATIC, 0);
 
@@ -860,6 +973,69 @@ void R_SoundNumForDoor(vldoor_t* door)
 
 
 
+//
+// R_PrecacheTextures
+//
+// [SVE] Composite every wall texture the level can show up front, so
+// that none is built the first time it comes into view.  That includes
+// the other frames of animated textures and the other half of switches.
+//
+void R_PrecacheTextures (void)
+{
+    char*		texturepresent;
+    anim_t*		anim;
+    int			i;
+    int			j;
+
+    texturepresent = Z_Malloc(numtextures, PU_STATIC, NULL);
+    memset (texturepresent,0, numtextures);
+
+    for (i=0 ; i<numsides ; i++)
+    {
+	texturepresent[sides[i].toptexture] = 1;
+	texturepresent[sides[i].midtexture] = 1;
+	texturepresent[sides[i].bottomtexture] = 1;
+    }
+
+    texturepresent[skytexture] = 1;
+
+    for (anim = anims ; anim < lastanim ; anim++)
+    {
+	if (!anim->istexture)
+	    continue;
+
+	for (i=anim->basepic ; i<=anim->picnum ; i++)
+	{
+	    if (texturepresent[i])
+		break;
+	}
+
+	if (i > anim->picnum)
+	    continue;
+
+	for (i=anim->basepic ; i<=anim->picnum ; i++)
+	    texturepresent[i] = 1;
+    }
+
+    for (i=0 ; i<numswitches*2 ; i+=2)
+    {
+	if (texturepresent[switchlist[i]] || texturepresent[switchlist[i+1]])
+	    texturepresent[switchlist[i]] = texturepresent[switchlist[i+1]] = 1;
+    }
+
+    // texture 0 is never drawn
+    texturepresent[0] = 0;
+
+    for (j=0 ; j<numtextures ; j++)
+    {
+	if (texturepresent[j] && !texturecolumns[j])
+	    R_CacheTexture (j);
+    }
+
+    Z_Free(texturepresent);
+}
+
+
 //
 // R_PrecacheLevel
 // Preloads all relevant graphics for the level.
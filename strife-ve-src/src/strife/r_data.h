@@ -81,10 +81,17 @@ R_GetColumn
 ( int		tex,
   int		col );
 
+// [SVE] Retrieve a column as posts, for masked drawing.
+byte*
+R_GetMaskedColumn
+( int		tex,
+  int		col );
+
 
 // I/O, setting up the stuff.
 void R_InitData (void);
 void R_PrecacheLevel (void);
+void R_PrecacheTextures (void); // [SVE]
 
 
 // Retrieval.
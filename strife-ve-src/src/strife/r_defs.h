@@ -553,15 +553,16 @@ typedef struct visplane_s
   
   // leave pads for [minx-1]/[maxx+1]
   
-  byte      pad1;
+  // [SVE] shorts, for views taller than 255 pixels; 0xffff is unused
+  unsigned short pad1;
   // Here lies the rub for all
   //  dynamic resize/change of resolution.
-  byte      top[SCREENWIDTH];
-  byte      pad2;
-  byte      pad3;
+  unsigned short top[MAXRENDERWIDTH];
+  unsigned short pad2;
+  unsigned short pad3;
   // See above.
-  byte      bottom[SCREENWIDTH];
-  byte      pad4;
+  unsigned short bottom[MAXRENDERWIDTH];
+  unsigned short pad4;
 
 } visplane_t;
 
@@ -21,10 +21,14 @@
 
 
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "doomdef.h"
 #include "deh_main.h"
 
 #include "i_system.h"
+#include "m_argv.h"
 #include "z_zone.h"
 #include "w_wad.h"
 
@@ -38,8 +42,9 @@
 
 
 // ?
-#define MAXWIDTH			1120
-#define MAXHEIGHT			832
+// [SVE] sized for the largest render resolution
+#define MAXWIDTH			MAXRENDERWIDTH
+#define MAXHEIGHT			MAXRENDERHEIGHT
 
 // status bar height at bottom of screen
 // haleyjd 08/31/10: Verified unmodified.
@@ -118,9 +123,9 @@ void R_DrawColumn (void)
 	return; 
 				 
 #ifdef RANGECHECK 
-    if ((unsigned)dc_x >= SCREENWIDTH
+    if ((unsigned)dc_x >= renderwidth
 	|| dc_yl < 0
-	|| dc_yh >= SCREENHEIGHT) 
+	|| dc_yh >= renderheight) 
 	I_Error ("R_DrawColumn: %i to %i at %i", dc_yl, dc_yh, dc_x); 
 #endif 
 
@@ -143,72 +148,13 @@ void R_DrawColumn (void)
 	//  using a lighting/special effects LUT.
 	*dest = dc_colormap[dc_source[(frac>>FRACBITS)&127]];
 	
-	dest += SCREENWIDTH; 
+	dest += renderwidth; 
 	frac += fracstep;
 	
     } while (count--); 
 } 
 
 
-
-// UNUSED.
-// Loop unrolled.
-#if 0
-void R_DrawColumn (void) 
-{ 
-    int			count; 
-    byte*		source;
-    byte*		dest;
-    byte*		colormap;
-    
-    unsigned		frac;
-    unsigned		fracstep;
-    unsigned		fracstep2;
-    unsigned		fracstep3;
-    unsigned		fracstep4;	 
- 
-    count = dc_yh - dc_yl + 1; 
-
-    source = dc_source;
-    colormap = dc_colormap;		 
-    dest = ylookup[dc_yl] + columnofs[dc_x];  
-	 
-    fracstep = dc_iscale<<9; 
-    frac = (dc_texturemid + (dc_yl-centery)*dc_iscale)<<9; 
- 
-    fracstep2 = fracstep+fracstep;
-    fracstep3 = fracstep2+fracstep;
-    fracstep4 = fracstep3+fracstep;
-	
-    while (count >= 8) 
-    { 
-	dest[0] = colormap[source[frac>>25]]; 
-	dest[SCREENWIDTH] = colormap[source[(frac+fracstep)>>25]]; 
-	dest[SCREENWIDTH*2] = colormap[source[(frac+fracstep2)>>25]]; 
-	dest[SCREENWIDTH*3] = colormap[source[(frac+fracstep3)>>25]];
-	
-	frac += fracstep4; 
-
-	dest[SCREENWIDTH*4] = colormap[source[frac>>25]]; 
-	dest[SCREENWIDTH*5] = colormap[source[(frac+fracstep)>>25]]; 
-	dest[SCREENWIDTH*6] = colormap[source[(frac+fracstep2)>>25]]; 
-	dest[SCREENWIDTH*7] = colormap[source[(frac+fracstep3)>>25]]; 
-
-	frac += fracstep4; 
-	dest += SCREENWIDTH*8; 
-	count -= 8;
-    } 
-	
-    while (count > 0)
-    { 
-	*dest = colormap[source[frac>>25]]; 
-	dest += SCREENWIDTH; 
-	frac += fracstep; 
-	count--;
-    } 
-}
-#endif
-
 // haleyjd 09/06/10 [STRIFE] Removed low detail
 
 //
@@ -245,8 +191,8 @@ void R_DrawMVisTLColumn(void)
         return; 
 
 #ifdef RANGECHECK 
-    if ((unsigned)dc_x >= SCREENWIDTH
-        || dc_yl < 0 || dc_yh >= SCREENHEIGHT)
+    if ((unsigned)dc_x >= renderwidth
+        || dc_yl < 0 || dc_yh >= renderheight)
     {
         I_Error ("R_DrawFuzzColumn: %i to %i at %i",
                  dc_yl, dc_yh, dc_x);
@@ -264,7 +210,7 @@ void R_DrawMVisTLColumn(void)
         byte src = dc_colormap[dc_source[(frac>>FRACBITS)&127]];
         byte col = xlatab[*dest + (src << 8)];
         *dest = col;
-        dest += SCREENWIDTH;
+        dest += renderwidth;
         frac += fracstep;
     } while(count--);
 }
@@ -298,8 +244,8 @@ void R_DrawTLColumn(void)
         return; 
 
 #ifdef RANGECHECK 
-    if ((unsigned)dc_x >= SCREENWIDTH
-        || dc_yl < 0 || dc_yh >= SCREENHEIGHT)
+    if ((unsigned)dc_x >= renderwidth
+        || dc_yl < 0 || dc_yh >= renderheight)
     {
         I_Error ("R_DrawFuzzColumn2: %i to %i at %i",
                  dc_yl, dc_yh, dc_x);
@@ -317,7 +263,7 @@ void R_DrawTLColumn(void)
         byte src = dc_colormap[dc_source[(frac>>FRACBITS)&127]];
         byte col = xlatab[(*dest << 8) + src];
         *dest = col;
-        dest += SCREENWIDTH;
+        dest += renderwidth;
         frac += fracstep;
     } while(count--);
 }
@@ -348,9 +294,9 @@ void R_DrawTranslatedColumn (void)
         return; 
 
 #ifdef RANGECHECK 
-    if ((unsigned)dc_x >= SCREENWIDTH
+    if ((unsigned)dc_x >= renderwidth
         || dc_yl < 0
-        || dc_yh >= SCREENHEIGHT)
+        || dc_yh >= renderheight)
     {
         I_Error ( "R_DrawColumn: %i to %i at %i",
                  dc_yl, dc_yh, dc_x);
@@ -373,7 +319,7 @@ void R_DrawTranslatedColumn (void)
         // Thus the "green" ramp of the player 0 sprite
         //  is mapped to gray, red, black/indigo. 
         *dest = dc_colormap[dc_translation[dc_source[frac>>FRACBITS]]];
-        dest += SCREENWIDTH;
+        dest += renderwidth;
         frac += fracstep; 
     } while (count--); 
 } 
@@ -398,9 +344,9 @@ void R_DrawTRTLColumn(void)
         return; 
 
 #ifdef RANGECHECK 
-    if ((unsigned)dc_x >= SCREENWIDTH
+    if ((unsigned)dc_x >= renderwidth
         || dc_yl < 0
-        || dc_yh >= SCREENHEIGHT)
+        || dc_yh >= renderheight)
     {
         I_Error ( "R_DrawColumn: %i to %i at %i",
                  dc_yl, dc_yh, dc_x);
@@ -419,7 +365,7 @@ void R_DrawTRTLColumn(void)
         byte src = dc_colormap[dc_translation[dc_source[frac>>FRACBITS&127]]];
         byte col = xlatab[(*dest << 8) + src];
         *dest = col;
-        dest += SCREENWIDTH;
+        dest += renderwidth;
         frac += fracstep; 
     } while (count--); 
 }
@@ -597,8 +543,8 @@ void R_DrawSpan (void)
 #ifdef RANGECHECK
     if (ds_x2 < ds_x1
 	|| ds_x1<0
-	|| ds_x2>=SCREENWIDTH
-	|| (unsigned)ds_y>SCREENHEIGHT)
+	|| ds_x2>=renderwidth
+	|| (unsigned)ds_y>renderheight)
     {
 	I_Error( "R_DrawSpan: %i to %i at %i",
 		 ds_x1,ds_x2,ds_y);
@@ -639,79 +585,6 @@ void R_DrawSpan (void)
 
 
 
-// UNUSED.
-// Loop unrolled by 4.
-#if 0
-void R_DrawSpan (void) 
-{ 
-    unsigned	position, step;
-
-    byte*	source;
-    byte*	colormap;
-    byte*	dest;
-    
-    unsigned	count;
-    usingned	spot; 
-    unsigned	value;
-    unsigned	temp;
-    unsigned	xtemp;
-    unsigned	ytemp;
-		
-    position = ((ds_xfrac<<10)&0xffff0000) | ((ds_yfrac>>6)&0xffff);
-    step = ((ds_xstep<<10)&0xffff0000) | ((ds_ystep>>6)&0xffff);
-		
-    source = ds_source;
-    colormap = ds_colormap;
-    dest = ylookup[ds_y] + columnofs[ds_x1];	 
-    count = ds_x2 - ds_x1 + 1; 
-	
-    while (count >= 4) 
-    { 
-	ytemp = position>>4;
-	ytemp = ytemp & 4032;
-	xtemp = position>>26;
-	spot = xtemp | ytemp;
-	position += step;
-	dest[0] = colormap[source[spot]]; 
-
-	ytemp = position>>4;
-	ytemp = ytemp & 4032;
-	xtemp = position>>26;
-	spot = xtemp | ytemp;
-	position += step;
-	dest[1] = colormap[source[spot]];
-	
-	ytemp = position>>4;
-	ytemp = ytemp & 4032;
-	xtemp = position>>26;
-	spot = xtemp | ytemp;
-	position += step;
-	dest[2] = colormap[source[spot]];
-	
-	ytemp = position>>4;
-	ytemp = ytemp & 4032;
-	xtemp = position>>26;
-	spot = xtemp | ytemp;
-	position += step;
-	dest[3] = colormap[source[spot]]; 
-		
-	count -= 4;
-	dest += 4;
-    } 
-    while (count > 0) 
-    { 
-	ytemp = position>>4;
-	ytemp = ytemp & 4032;
-	xtemp = position>>26;
-	spot = xtemp | ytemp;
-	position += step;
-	*dest++ = colormap[source[spot]]; 
-	count--;
-    } 
-} 
-#endif
-
-
 //
 // Again..
 //
@@ -726,8 +599,8 @@ void R_DrawSpanLow (void)
 #ifdef RANGECHECK
     if (ds_x2 < ds_x1
 	|| ds_x1<0
-	|| ds_x2>=SCREENWIDTH
-	|| (unsigned)ds_y>SCREENHEIGHT)
+	|| ds_x2>=renderwidth
+	|| (unsigned)ds_y>renderheight)
     {
 	I_Error( "R_DrawSpan: %i to %i at %i",
 		 ds_x1,ds_x2,ds_y);
@@ -765,6 +638,663 @@ void R_DrawSpanLow (void)
     } while (count--);
 }
 
+//
+// Unrolled drawers
+//
+// [SVE] The same drawers with the inner loop unrolled four times, so
+// that the texel fetches and colormap lookups of neighbouring pixels
+// can be in flight together.  They must stay pixel-exact with the
+// generic ones above; run with -testdrawers to check.
+//
+
+static void R_DrawColumnUnrolled(void)
+{
+    int                 count;
+    int                 pitch;
+    byte*               dest;
+    byte*               source;
+    lighttable_t*       colormap;
+    fixed_t             frac;
+    fixed_t             fracstep;
+
+    count = dc_yh - dc_yl + 1;
+
+    if (count <= 0)
+        return;
+
+#ifdef RANGECHECK
+    if ((unsigned)dc_x >= renderwidth
+        || dc_yl < 0
+        || dc_yh >= renderheight)
+        I_Error ("R_DrawColumn: %i to %i at %i", dc_yl, dc_yh, dc_x);
+#endif
+
+    dest = ylookup[dc_yl] + columnofs[dc_x];
+    source = dc_source;
+    colormap = dc_colormap;
+    pitch = renderwidth;
+
+    fracstep = dc_iscale;
+    frac = dc_texturemid + (dc_yl-centery)*fracstep;
+
+    while (count >= 4)
+    {
+        dest[0] = colormap[source[(frac>>FRACBITS)&127]];
+        frac += fracstep;
+        dest[pitch] = colormap[source[(frac>>FRACBITS)&127]];
+        frac += fracstep;
+        dest[pitch*2] = colormap[source[(frac>>FRACBITS)&127]];
+        frac += fracstep;
+        dest[pitch*3] = colormap[source[(frac>>FRACBITS)&127]];
+        frac += fracstep;
+
+        dest += pitch*4;
+        count -= 4;
+    }
+
+    while (count--)
+    {
+        *dest = colormap[source[(frac>>FRACBITS)&127]];
+        dest += pitch;
+        frac += fracstep;
+    }
+}
+
+static void R_DrawMVisTLColumnUnrolled(void)
+{
+    int                 count;
+    int                 pitch;
+    byte*               dest;
+    byte*               source;
+    lighttable_t*       colormap;
+    fixed_t             frac;
+    fixed_t             fracstep;
+
+    if (!dc_yl)
+        dc_yl = 1;
+
+    if (dc_yh == viewheight-1)
+        dc_yh = viewheight - 2;
+
+    count = dc_yh - dc_yl + 1;
+
+    if (count <= 0)
+        return;
+
+#ifdef RANGECHECK
+    if ((unsigned)dc_x >= renderwidth
+        || dc_yl < 0 || dc_yh >= renderheight)
+    {
+        I_Error ("R_DrawFuzzColumn: %i to %i at %i",
+                 dc_yl, dc_yh, dc_x);
+    }
+#endif
+
+    dest = ylookup[dc_yl] + columnofs[dc_x];
+    source = dc_source;
+    colormap = dc_colormap;
+    pitch = renderwidth;
+
+    fracstep = dc_iscale;
+    frac = dc_texturemid + (dc_yl-centery)*fracstep;
+
+    while (count >= 4)
+    {
+        dest[0] = xlatab[dest[0] + (colormap[source[(frac>>FRACBITS)&127]] << 8)];
+        frac += fracstep;
+        dest[pitch] = xlatab[dest[pitch] + (colormap[source[(frac>>FRACBITS)&127]] << 8)];
+        frac += fracstep;
+        dest[pitch*2] = xlatab[dest[pitch*2] + (colormap[source[(frac>>FRACBITS)&127]] << 8)];
+        frac += fracstep;
+        dest[pitch*3] = xlatab[dest[pitch*3] + (colormap[source[(frac>>FRACBITS)&127]] << 8)];
+        frac += fracstep;
+
+        dest += pitch*4;
+        count -= 4;
+    }
+
+    while (count--)
+    {
+        *dest = xlatab[*dest + (colormap[source[(frac>>FRACBITS)&127]] << 8)];
+        dest += pitch;
+        frac += fracstep;
+    }
+}
+
+static void R_DrawTLColumnUnrolled(void)
+{
+    int                 count;
+    int                 pitch;
+    byte*               dest;
+    byte*               source;
+    lighttable_t*       colormap;
+    fixed_t             frac;
+    fixed_t             fracstep;
+
+    if (!dc_yl)
+        dc_yl = 1;
+
+    if (dc_yh == viewheight-1)
+        dc_yh = viewheight - 2;
+
+    count = dc_yh - dc_yl + 1;
+
+    if (count <= 0)
+        return;
+
+#ifdef RANGECHECK
+    if ((unsigned)dc_x >= renderwidth
+        || dc_yl < 0 || dc_yh >= renderheight)
+    {
+        I_Error ("R_DrawFuzzColumn2: %i to %i at %i",
+                 dc_yl, dc_yh, dc_x);
+    }
+#endif
+
+    dest = ylookup[dc_yl] + columnofs[dc_x];
+    source = dc_source;
+    colormap = dc_colormap;
+    pitch = renderwidth;
+
+    fracstep = dc_iscale;
+    frac = dc_texturemid + (dc_yl-centery)*fracstep;
+
+    while (count >= 4)
+    {
+        dest[0] = xlatab[(dest[0] << 8) + colormap[source[(frac>>FRACBITS)&127]]];
+        frac += fracstep;
+        dest[pitch] = xlatab[(dest[pitch] << 8) + colormap[source[(frac>>FRACBITS)&127]]];
+        frac += fracstep;
+        dest[pitch*2] = xlatab[(dest[pitch*2] << 8) + colormap[source[(frac>>FRACBITS)&127]]];
+        frac += fracstep;
+        dest[pitch*3] = xlatab[(dest[pitch*3] << 8) + colormap[source[(frac>>FRACBITS)&127]]];
+        frac += fracstep;
+
+        dest += pitch*4;
+        count -= 4;
+    }
+
+    while (count--)
+    {
+        *dest = xlatab[(*dest << 8) + colormap[source[(frac>>FRACBITS)&127]]];
+        dest += pitch;
+        frac += fracstep;
+    }
+}
+
+static void R_DrawTranslatedColumnUnrolled(void)
+{
+    int                 count;
+    int                 pitch;
+    byte*               dest;
+    byte*               source;
+    byte*               translation;
+    lighttable_t*       colormap;
+    fixed_t             frac;
+    fixed_t             fracstep;
+
+    count = dc_yh - dc_yl + 1;
+
+    if (count <= 0)
+        return;
+
+#ifdef RANGECHECK
+    if ((unsigned)dc_x >= renderwidth
+        || dc_yl < 0
+        || dc_yh >= renderheight)
+    {
+        I_Error ( "R_DrawColumn: %i to %i at %i",
+                 dc_yl, dc_yh, dc_x);
+    }
+#endif
+
+    dest = ylookup[dc_yl] + columnofs[dc_x];
+    source = dc_source;
+    translation = dc_translation;
+    colormap = dc_colormap;
+    pitch = renderwidth;
+
+    fracstep = dc_iscale;
+    frac = dc_texturemid + (dc_yl-centery)*fracstep;
+
+    while (count >= 4)
+    {
+        dest[0] = colormap[translation[source[frac>>FRACBITS]]];
+        frac += fracstep;
+        dest[pitch] = colormap[translation[source[frac>>FRACBITS]]];
+        frac += fracstep;
+        dest[pitch*2] = colormap[translation[source[frac>>FRACBITS]]];
+        frac += fracstep;
+        dest[pitch*3] = colormap[translation[source[frac>>FRACBITS]]];
+        frac += fracstep;
+
+        dest += pitch*4;
+        count -= 4;
+    }
+
+    while (count--)
+    {
+        *dest = colormap[translation[source[frac>>FRACBITS]]];
+        dest += pitch;
+        frac += fracstep;
+    }
+}
+
+static void R_DrawTRTLColumnUnrolled(void)
+{
+    int                 count;
+    int                 pitch;
+    byte*               dest;
+    byte*               source;
+    byte*               translation;
+    lighttable_t*       colormap;
+    fixed_t             frac;
+    fixed_t             fracstep;
+
+    count = dc_yh - dc_yl + 1;
+
+    if (count <= 0)
+        return;
+
+#ifdef RANGECHECK
+    if ((unsigned)dc_x >= renderwidth
+        || dc_yl < 0
+        || dc_yh >= renderheight)
+    {
+        I_Error ( "R_DrawColumn: %i to %i at %i",
+                 dc_yl, dc_yh, dc_x);
+    }
+#endif
+
+    dest = ylookup[dc_yl] + columnofs[dc_x];
+    source = dc_source;
+    translation = dc_translation;
+    colormap = dc_colormap;
+    pitch = renderwidth;
+
+    fracstep = dc_iscale;
+    frac = dc_texturemid + (dc_yl-centery)*fracstep;
+
+    while (count >= 4)
+    {
+        dest[0] = xlatab[(dest[0] << 8) + colormap[translation[source[(frac>>FRACBITS)&127]]]];
+        frac += fracstep;
+        dest[pitch] = xlatab[(dest[pitch] << 8) + colormap[translation[source[(frac>>FRACBITS)&127]]]];
+        frac += fracstep;
+        dest[pitch*2] = xlatab[(dest[pitch*2] << 8) + colormap[translation[source[(frac>>FRACBITS)&127]]]];
+        frac += fracstep;
+        dest[pitch*3] = xlatab[(dest[pitch*3] << 8) + colormap[translation[source[(frac>>FRACBITS)&127]]]];
+        frac += fracstep;
+
+        dest += pitch*4;
+        count -= 4;
+    }
+
+    while (count--)
+    {
+        *dest = xlatab[(*dest << 8) + colormap[translation[source[(frac>>FRACBITS)&127]]]];
+        dest += pitch;
+        frac += fracstep;
+    }
+}
+
+static void R_DrawSpanUnrolled(void)
+{
+    unsigned int position, step;
+    unsigned int spot0, spot1, spot2, spot3;
+    byte *dest;
+    byte *source;
+    lighttable_t *colormap;
+    int count;
+
+#ifdef RANGECHECK
+    if (ds_x2 < ds_x1
+	|| ds_x1<0
+	|| ds_x2>=renderwidth
+	|| (unsigned)ds_y>renderheight)
+    {
+	I_Error( "R_DrawSpan: %i to %i at %i",
+		 ds_x1,ds_x2,ds_y);
+    }
+#endif
+
+    position = ((ds_xfrac << 10) & 0xffff0000)
+             | ((ds_yfrac >> 6)  & 0x0000ffff);
+    step = ((ds_xstep << 10) & 0xffff0000)
+         | ((ds_ystep >> 6)  & 0x0000ffff);
+
+    dest = ylookup[ds_y] + columnofs[ds_x1];
+    source = ds_source;
+    colormap = ds_colormap;
+    count = ds_x2 - ds_x1 + 1;
+
+    while (count >= 4)
+    {
+        // all four texels are found before any is looked up
+        spot0 = ((position >> 4) & 0x0fc0) | (position >> 26);
+        position += step;
+        spot1 = ((position >> 4) & 0x0fc0) | (position >> 26);
+        position += step;
+        spot2 = ((position >> 4) & 0x0fc0) | (position >> 26);
+        position += step;
+        spot3 = ((position >> 4) & 0x0fc0) | (position >> 26);
+        position += step;
+
+        dest[0] = colormap[source[spot0]];
+        dest[1] = colormap[source[spot1]];
+        dest[2] = colormap[source[spot2]];
+        dest[3] = colormap[source[spot3]];
+
+        dest += 4;
+        count -= 4;
+    }
+
+    while (count-- > 0)
+    {
+        spot0 = ((position >> 4) & 0x0fc0) | (position >> 26);
+        position += step;
+        *dest++ = colormap[source[spot0]];
+    }
+}
+
+//
+// Drawer kernels
+//
+// [SVE] One set is picked at startup, and R_ExecuteSetViewSize and the
+// masked drawing code take their drawers from it.
+//
+
+static drawkernels_t drawkernelsets[] =
+{
+    {
+        "generic",
+        R_DrawColumn,
+        R_DrawTLColumn,
+        R_DrawMVisTLColumn,
+        R_DrawTranslatedColumn,
+        R_DrawTRTLColumn,
+        R_DrawSpan
+    },
+    {
+        "unrolled",
+        R_DrawColumnUnrolled,
+        R_DrawTLColumnUnrolled,
+        R_DrawMVisTLColumnUnrolled,
+        R_DrawTranslatedColumnUnrolled,
+        R_DrawTRTLColumnUnrolled,
+        R_DrawSpanUnrolled
+    },
+};
+
+#define NUMDRAWKERNELSETS arrlen(drawkernelsets)
+#define DEFAULTDRAWKERNELS 1
+
+drawkernels_t *drawkernels = &drawkernelsets[DEFAULTDRAWKERNELS];
+
+#define DRAWERTESTS     4096
+#define TESTSOURCESIZE  2048
+
+static byte *testsource;
+static byte *testcolormap;
+static byte *testtranslation;
+
+//
+// R_RandomTestValue
+//
+
+static unsigned int R_RandomTestValue(void)
+{
+    return ((unsigned int)rand() << 16) ^ (unsigned int)rand();
+}
+
+//
+// R_SetupTestColumn
+//
+// Random column that stays within the screen and, for the drawers
+// that don't wrap the texture, within the test source.
+//
+
+static void R_SetupTestColumn(void)
+{
+    fixed_t start;
+
+    dc_x = R_RandomTestValue() % renderwidth;
+    dc_yl = R_RandomTestValue() % renderheight;
+    dc_yh = dc_yl - 1 + R_RandomTestValue() % (renderheight - dc_yl + 1);
+
+    centery = R_RandomTestValue() % renderheight;
+    dc_iscale = R_RandomTestValue() % (2 * FRACUNIT);
+    start = R_RandomTestValue() % (64 * FRACUNIT);
+    dc_texturemid = start - (dc_yl - centery) * dc_iscale;
+
+    dc_source = testsource;
+    dc_colormap = testcolormap;
+    dc_translation = testtranslation;
+}
+
+//
+// R_SetupTestSpan
+//
+
+static void R_SetupTestSpan(void)
+{
+    ds_y = R_RandomTestValue() % renderheight;
+    ds_x1 = R_RandomTestValue() % renderwidth;
+    ds_x2 = ds_x1 + R_RandomTestValue() % (renderwidth - ds_x1);
+
+    ds_xfrac = R_RandomTestValue();
+    ds_yfrac = R_RandomTestValue();
+    ds_xstep = R_RandomTestValue();
+    ds_ystep = R_RandomTestValue();
+
+    ds_source = testsource;
+    ds_colormap = testcolormap;
+}
+
+//
+// R_TestDrawer
+//
+// Draws the same random columns or spans with the generic drawer and
+// another one, onto two copies of a random screen, and checks the
+// copies stay the same.
+//
+
+static boolean R_TestDrawer(void (*generic)(void), void (*drawer)(void),
+                            boolean span, byte *screen1, byte *screen2)
+{
+    int screensize = renderwidth * renderheight;
+    int test;
+    int i;
+
+    for (i = 0; i < screensize; ++i)
+        screen1[i] = rand() & 0xff;
+
+    memcpy(screen2, screen1, screensize);
+
+    for (test = 0; test < DRAWERTESTS; ++test)
+    {
+        int yl;
+        int yh;
+
+        if (span)
+            R_SetupTestSpan();
+        else
+            R_SetupTestColumn();
+
+        // the translucent drawers clip dc_yl and dc_yh in place
+        yl = dc_yl;
+        yh = dc_yh;
+
+        for (i = 0; i < renderheight; ++i)
+            ylookup[i] = screen1 + i * renderwidth;
+        generic();
+
+        dc_yl = yl;
+        dc_yh = yh;
+
+        for (i = 0; i < renderheight; ++i)
+            ylookup[i] = screen2 + i * renderwidth;
+        drawer();
+
+        // only the drawn row or column can differ
+        if (span)
+        {
+            if (memcmp(screen1 + ds_y * renderwidth,
+                       screen2 + ds_y * renderwidth, renderwidth))
+                return false;
+        }
+        else
+        {
+            for (i = dc_x; i < screensize; i += renderwidth)
+            {
+                if (screen1[i] != screen2[i])
+                    return false;
+            }
+        }
+    }
+
+    // and nothing was drawn anywhere else
+    return !memcmp(screen1, screen2, screensize);
+}
+
+//
+// R_TestDrawers
+//
+// Checks every set of drawers against the generic one.
+//
+
+static void R_TestDrawers(void)
+{
+    byte *savedylookup[MAXHEIGHT];
+    int savedcolumnofs[MAXWIDTH];
+    int savedviewheight;
+    int savedcentery;
+    drawkernels_t *generic;
+    drawkernels_t *kernels;
+    byte *screen1;
+    byte *screen2;
+    int set;
+    int i;
+
+    memcpy(savedylookup, ylookup, sizeof(ylookup));
+    memcpy(savedcolumnofs, columnofs, sizeof(columnofs));
+    savedviewheight = viewheight;
+    savedcentery = centery;
+
+    screen1 = Z_Malloc(renderwidth * renderheight, PU_STATIC, NULL);
+    screen2 = Z_Malloc(renderwidth * renderheight, PU_STATIC, NULL);
+    testsource = Z_Malloc(TESTSOURCESIZE, PU_STATIC, NULL);
+    testcolormap = Z_Malloc(256, PU_STATIC, NULL);
+    testtranslation = Z_Malloc(256, PU_STATIC, NULL);
+
+    for (i = 0; i < TESTSOURCESIZE; ++i)
+        testsource[i] = rand() & 0xff;
+
+    for (i = 0; i < 256; ++i)
+    {
+        testcolormap[i] = rand() & 0xff;
+        testtranslation[i] = rand() & 0xff;
+    }
+
+    for (i = 0; i < renderwidth; ++i)
+        columnofs[i] = i;
+
+    viewheight = renderheight;
+    generic = &drawkernelsets[0];
+
+    for (set = 1; set < NUMDRAWKERNELSETS; ++set)
+    {
+        const char *failed = NULL;
+
+        kernels = &drawkernelsets[set];
+
+        if (!R_TestDrawer(generic->column, kernels->column,
+                          false, screen1, screen2))
+            failed = "column";
+        else if (!R_TestDrawer(generic->tlcolumn, kernels->tlcolumn,
+                               false, screen1, screen2))
+            failed = "TL column";
+        else if (!R_TestDrawer(generic->mvistlcolumn, kernels->mvistlcolumn,
+                               false, screen1, screen2))
+            failed = "MVis TL column";
+        else if (!R_TestDrawer(generic->translatedcolumn,
+                               kernels->translatedcolumn,
+                               false, screen1, screen2))
+            failed = "translated column";
+        else if (!R_TestDrawer(generic->trtlcolumn, kernels->trtlcolumn,
+                               false, screen1, screen2))
+            failed = "TRTL column";
+        else if (!R_TestDrawer(generic->span, kernels->span,
+                               true, screen1, screen2))
+            failed = "span";
+
+        if (failed)
+        {
+            I_Error("R_TestDrawers: %s %s drawer differs from generic",
+                    kernels->name, failed);
+        }
+
+        printf("R_TestDrawers: %s drawers match generic\n", kernels->name);
+    }
+
+    Z_Free(screen1);
+    Z_Free(screen2);
+    Z_Free(testsource);
+    Z_Free(testcolormap);
+    Z_Free(testtranslation);
+
+    memcpy(ylookup, savedylookup, sizeof(ylookup));
+    memcpy(columnofs, savedcolumnofs, sizeof(columnofs));
+    viewheight = savedviewheight;
+    centery = savedcentery;
+}
+
+//
+// R_InitDrawers
+//
+// Picks the drawers to render with, and tests them if asked to.
+//
+
+void R_InitDrawers(void)
+{
+    int p;
+    int i;
+
+    //!
+    // @arg <name>
+    // @category video
+    //
+    // Draw columns and spans with the given set of drawers: "generic"
+    // or "unrolled" (the default).
+    //
+
+    p = M_CheckParmWithArgs("-drawers", 1);
+
+    if (p)
+    {
+        for (i = 0; i < NUMDRAWKERNELSETS; ++i)
+        {
+            if (!strcasecmp(myargv[p + 1], drawkernelsets[i].name))
+                break;
+        }
+
+        if (i == NUMDRAWKERNELSETS)
+            I_Error("R_InitDrawers: Unknown drawers '%s'", myargv[p + 1]);
+
+        drawkernels = &drawkernelsets[i];
+    }
+
+    //!
+    // @category video
+    //
+    // Check at startup that every set of drawers draws exactly the same
+    // pixels as the generic one.
+    //
+
+    if (M_CheckParm("-testdrawers"))
+        R_TestDrawers();
+}
+
 //
 // R_InitBuffer 
 // Creats lookup tables that avoid
@@ -782,21 +1312,21 @@ R_InitBuffer
     // Handle resize,
     //  e.g. smaller view windows
     //  with border and/or status bar.
-    viewwindowx = (SCREENWIDTH-width) >> 1; 
+    viewwindowx = (renderwidth-width) >> 1; 
 
     // Column offset. For windows.
     for (i=0 ; i<width ; i++) 
 	columnofs[i] = viewwindowx + i;
 
     // Samw with base row offset.
-    if (width == SCREENWIDTH) 
+    if (width == renderwidth) 
 	viewwindowy = 0; 
     else 
-	viewwindowy = (SCREENHEIGHT-SBARHEIGHT-height) >> 1; 
+	viewwindowy = (renderheight-SBARHEIGHT*hires-height) >> 1; 
 
     // Preclaculate all row offsets.
     for (i=0 ; i<height ; i++) 
-	ylookup[i] = I_VideoBuffer + (i+viewwindowy)*SCREENWIDTH; 
+	ylookup[i] = I_VideoBuffer + (i+viewwindowy)*renderwidth; 
 } 
  
  
@@ -813,9 +1343,10 @@ R_InitBuffer
 void R_FillBackScreen (void) 
 { 
     byte*	src;
-    byte*	dest; 
+    byte	dest[SCREENWIDTH]; 
     int		x;
     int		y; 
+    int		wx, wy, ww, wh; // [SVE] view window on the 320x200 screen
     patch_t*	patch;
 
     char *name;
@@ -827,7 +1358,7 @@ void R_FillBackScreen (void)
     // If we are running full screen, there is no need to do any of this,
     // and the background buffer can be freed if it was previously in use.
 
-    if (scaledviewwidth == SCREENWIDTH)
+    if (scaledviewwidth == renderwidth)
     {
         if (background_buffer != NULL)
         {
@@ -842,7 +1373,7 @@ void R_FillBackScreen (void)
 	
     if (background_buffer == NULL)
     {
-        background_buffer = Z_Malloc(SCREENWIDTH * (SCREENHEIGHT - SBARHEIGHT),
+        background_buffer = Z_Malloc(renderwidth * (renderheight - SBARHEIGHT*hires),
                                      PU_STATIC, NULL);
     }
 
@@ -850,59 +1381,64 @@ void R_FillBackScreen (void)
     name = back_flat;
     
     src = W_CacheLumpName(name, PU_CACHE); 
-    dest = background_buffer;
-	 
+
+    // Draw screen and bezel; this is done to a separate screen buffer.
+
+    V_UseBuffer(background_buffer);
+
+    // [SVE] the flat is tiled a row at a time on the 320x200 screen
     for (y=0 ; y<SCREENHEIGHT-SBARHEIGHT ; y++) 
     { 
 	for (x=0 ; x<SCREENWIDTH/64 ; x++) 
 	{ 
-	    memcpy (dest, src+((y&63)<<6), 64); 
-	    dest += 64; 
+	    memcpy (dest + x*64, src+((y&63)<<6), 64); 
 	} 
 
 	if (SCREENWIDTH&63) 
 	{ 
-	    memcpy (dest, src+((y&63)<<6), SCREENWIDTH&63); 
-	    dest += (SCREENWIDTH&63); 
+	    memcpy (dest + x*64, src+((y&63)<<6), SCREENWIDTH&63); 
 	} 
+
+	V_DrawBlock (0, y, SCREENWIDTH, 1, dest);
     } 
-     
-    // Draw screen and bezel; this is done to a separate screen buffer.
 
-    V_UseBuffer(background_buffer);
+    wx = viewwindowx / hires;
+    wy = viewwindowy / hires;
+    ww = scaledviewwidth / hires;
+    wh = viewheight / hires;
 
     patch = W_CacheLumpName(DEH_String("brdr_t"),PU_CACHE);
 
-    for (x=0 ; x<scaledviewwidth ; x+=8)
-	V_DrawPatch(viewwindowx+x, viewwindowy-8, patch);
+    for (x=0 ; x<ww ; x+=8)
+	V_DrawPatch(wx+x, wy-8, patch);
     patch = W_CacheLumpName(DEH_String("brdr_b"),PU_CACHE);
 
-    for (x=0 ; x<scaledviewwidth ; x+=8)
-	V_DrawPatch(viewwindowx+x, viewwindowy+viewheight, patch);
+    for (x=0 ; x<ww ; x+=8)
+	V_DrawPatch(wx+x, wy+wh, patch);
     patch = W_CacheLumpName(DEH_String("brdr_l"),PU_CACHE);
 
-    for (y=0 ; y<viewheight ; y+=8)
-	V_DrawPatch(viewwindowx-8, viewwindowy+y, patch);
+    for (y=0 ; y<wh ; y+=8)
+	V_DrawPatch(wx-8, wy+y, patch);
     patch = W_CacheLumpName(DEH_String("brdr_r"),PU_CACHE);
 
-    for (y=0 ; y<viewheight ; y+=8)
-	V_DrawPatch(viewwindowx+scaledviewwidth, viewwindowy+y, patch);
+    for (y=0 ; y<wh ; y+=8)
+	V_DrawPatch(wx+ww, wy+y, patch);
 
     // Draw beveled edge. 
-    V_DrawPatch(viewwindowx-8,
-                viewwindowy-8,
+    V_DrawPatch(wx-8,
+                wy-8,
                 W_CacheLumpName(DEH_String("brdr_tl"),PU_CACHE));
     
-    V_DrawPatch(viewwindowx+scaledviewwidth,
-                viewwindowy-8,
+    V_DrawPatch(wx+ww,
+                wy-8,
                 W_CacheLumpName(DEH_String("brdr_tr"),PU_CACHE));
     
-    V_DrawPatch(viewwindowx-8,
-                viewwindowy+viewheight,
+    V_DrawPatch(wx-8,
+                wy+wh,
                 W_CacheLumpName(DEH_String("brdr_bl"),PU_CACHE));
     
-    V_DrawPatch(viewwindowx+scaledviewwidth,
-                viewwindowy+viewheight,
+    V_DrawPatch(wx+ww,
+                wy+wh,
                 W_CacheLumpName(DEH_String("brdr_br"),PU_CACHE));
 
     V_RestoreBuffer();
@@ -926,6 +1462,15 @@ R_VideoErase
     if (background_buffer != NULL)
     {
         memcpy(I_VideoBuffer + ofs, background_buffer + ofs, count); 
+
+        // [SVE] mark the rows touched, for I_FinishUpdate
+        if (count > 0)
+        {
+            int y1 = ofs / renderwidth / hires;
+            int y2 = (ofs + count - 1) / renderwidth / hires;
+
+            V_MarkRect(0, y1, SCREENWIDTH, y2 - y1 + 1);
+        }
     }
 } 
 
@@ -942,27 +1487,27 @@ void R_DrawViewBorder (void)
     int		ofs;
     int		i; 
  
-    if (scaledviewwidth == SCREENWIDTH) 
+    if (scaledviewwidth == renderwidth) 
 	return; 
   
-    top = ((SCREENHEIGHT-SBARHEIGHT)-viewheight)/2; 
-    side = (SCREENWIDTH-scaledviewwidth)/2; 
+    top = ((renderheight-SBARHEIGHT*hires)-viewheight)/2; 
+    side = (renderwidth-scaledviewwidth)/2; 
  
     // copy top and one line of left side 
-    R_VideoErase (0, top*SCREENWIDTH+side); 
+    R_VideoErase (0, top*renderwidth+side); 
  
     // copy one line of right side and bottom 
-    ofs = (viewheight+top)*SCREENWIDTH-side; 
-    R_VideoErase (ofs, top*SCREENWIDTH+side); 
+    ofs = (viewheight+top)*renderwidth-side; 
+    R_VideoErase (ofs, top*renderwidth+side); 
  
     // copy sides using wraparound 
-    ofs = top*SCREENWIDTH + SCREENWIDTH-side; 
+    ofs = top*renderwidth + renderwidth-side; 
     side <<= 1;
     
     for (i=1 ; i<viewheight ; i++) 
     { 
 	R_VideoErase (ofs, side); 
-	ofs += SCREENWIDTH; 
+	ofs += renderwidth; 
     } 
 
     // ? 
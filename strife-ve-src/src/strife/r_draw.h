@@ -55,6 +55,22 @@ void    R_DrawTLColumn (void);
 void    R_DrawMVisTLColumn (void);
 void    R_DrawTRTLColumn (void);
 
+// [SVE] A set of drawers, picked at startup by R_InitDrawers.
+typedef struct
+{
+    char *name;
+    void (*column) (void);
+    void (*tlcolumn) (void);
+    void (*mvistlcolumn) (void);
+    void (*translatedcolumn) (void);
+    void (*trtlcolumn) (void);
+    void (*span) (void);
+} drawkernels_t;
+
+extern drawkernels_t *drawkernels;
+
+void    R_InitDrawers (void);
+
 void
 R_VideoErase
 ( unsigned	ofs,
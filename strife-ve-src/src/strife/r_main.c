@@ -105,10 +105,11 @@ int			viewangletox[FINEANGLES/2];
 // The xtoviewangleangle[] table maps a screen pixel
 // to the lowest viewangle that maps back to x ranges
 // from clipangle to -clipangle.
-angle_t			xtoviewangle[SCREENWIDTH+1];
+angle_t			xtoviewangle[MAXRENDERWIDTH+1];
 
-lighttable_t*		scalelight[LIGHTLEVELS][MAXLIGHTSCALE];
-lighttable_t*		scalelightfixed[MAXLIGHTSCALE];
+lighttable_t*		scalelight[LIGHTLEVELS][MAXLIGHTSCALEINDEX];
+lighttable_t*		scalelightfixed[MAXLIGHTSCALEINDEX];
+int			numlightscales = MAXLIGHTSCALE; // [SVE]
 lighttable_t*		zlight[LIGHTLEVELS][MAXLIGHTZ];
 
 // bumped light from gun blasts
@@ -685,15 +686,16 @@ void R_ExecuteSetViewSize (void)
 
     setsizeneeded = false;
 
+    // [SVE] sizes are in pixels of the render resolution
     if (setblocks == 11)
     {
-	scaledviewwidth = SCREENWIDTH;
-	viewheight = SCREENHEIGHT;
+	scaledviewwidth = renderwidth;
+	viewheight = renderheight;
     }
     else
     {
-	scaledviewwidth = setblocks*32;
-	viewheight = (setblocks*168/10)&~7;
+	scaledviewwidth = setblocks*32*hires;
+	viewheight = ((setblocks*168/10)&~7)*hires;
     }
     
     detailshift = setdetail;
@@ -701,7 +703,7 @@ void R_ExecuteSetViewSize (void)
 	
     // villsa [STRIFE] calculate centery from player's pitch
     centery = (setblocks*(players[consoleplayer].pitch>>FRACBITS));
-    centery = (unsigned int)(centery/10)+viewheight/2;
+    centery = (unsigned int)(centery/10)*hires+viewheight/2;
 
     centerx = viewwidth/2;
     centerxfrac = centerx<<FRACBITS;
@@ -710,10 +712,11 @@ void R_ExecuteSetViewSize (void)
 
     //if (!detailshift) // villsa [STRIFE]
     {
-	colfunc = basecolfunc = R_DrawColumn;
-	fuzzcolfunc = R_DrawTLColumn;   // villsa [STRIFE]
-	transcolfunc = R_DrawTranslatedColumn;
-	spanfunc = R_DrawSpan;
+	// [SVE] drawers as picked by R_InitDrawers
+	colfunc = basecolfunc = drawkernels->column;
+	fuzzcolfunc = drawkernels->tlcolumn;   // villsa [STRIFE]
+	transcolfunc = drawkernels->translatedcolumn;
+	spanfunc = drawkernels->span;
     }
     // villsa [STRIFE] unused detail stuff
     /*else
@@ -751,14 +754,18 @@ void R_ExecuteSetViewSize (void)
 	distscale[i] = FixedDiv (FRACUNIT,cosadj);
     }
     
+    R_ClearPlaneCache (); // [SVE] yslope changed
+
     // Calculate the light levels to use
     //  for each level / scale combination.
+    numlightscales = MAXLIGHTSCALE*hires; // [SVE]
     for (i=0 ; i< LIGHTLEVELS ; i++)
     {
 	startmap = ((LIGHTLEVELS-1-i)*2)*NUMCOLORMAPS/LIGHTLEVELS;
-	for (j=0 ; j<MAXLIGHTSCALE ; j++)
+	for (j=0 ; j<numlightscales ; j++)
 	{
-	    level = startmap - j*SCREENWIDTH/(viewwidth<<detailshift)/DISTMAP;
+	    // [SVE] each entry repeats hires times
+	    level = startmap - (j/hires)*renderwidth/(viewwidth<<detailshift)/DISTMAP;
 	    
 	    if (level < 0)
 		level = 0;
@@ -818,6 +825,9 @@ void R_Init (void)
     else
         D_IntroTick();
 
+    // [SVE] needs xlatab for the drawer self-test
+    R_InitDrawers ();
+
     framecount = 0;
 }
 
@@ -875,7 +885,7 @@ void R_SetupPitch(player_t* player)
                 viewpitch = -110*FRACUNIT;
         }
         
-        pitchfrac   = (setblocks * (viewpitch>>FRACBITS)) / 10;
+        pitchfrac   = (setblocks * (viewpitch>>FRACBITS)) / 10 * hires;
         centery     = pitchfrac + viewheight / 2;
         centeryfrac = centery << FRACBITS;
 
@@ -884,6 +894,8 @@ void R_SetupPitch(player_t* player)
             yslope[i] = FixedDiv(viewwidth / 2 * FRACUNIT,
                                  abs(((i - centery) << FRACBITS) + (FRACUNIT/2)));
         }
+
+        R_ClearPlaneCache ();
     }
 }
 
@@ -1051,7 +1063,7 @@ void R_SetupFrame (player_t* player)
 	
 	walllights = scalelightfixed;
 
-	for (i=0 ; i<MAXLIGHTSCALE ; i++)
+	for (i=0 ; i<numlightscales ; i++)
 	    scalelightfixed[i] = fixedcolormap;
     }
     else
@@ -67,8 +67,15 @@ extern int		loopcount;
 #define MAXLIGHTZ	       128
 #define LIGHTZSHIFT		20
 
-extern lighttable_t*	scalelight[LIGHTLEVELS][MAXLIGHTSCALE];
-extern lighttable_t*	scalelightfixed[MAXLIGHTSCALE];
+// [SVE] At high resolution scales are hires times larger, so the scale
+// light tables repeat each entry hires times instead of the scales
+// being divided per column.  numlightscales entries are in use.
+#define MAXLIGHTSCALEINDEX	(MAXLIGHTSCALE*MAXHIRES)
+
+extern int		numlightscales;
+
+extern lighttable_t*	scalelight[LIGHTLEVELS][MAXLIGHTSCALEINDEX];
+extern lighttable_t*	scalelightfixed[MAXLIGHTSCALEINDEX];
 extern lighttable_t*	zlight[LIGHTLEVELS][MAXLIGHTZ];
 
 extern int		extralight;
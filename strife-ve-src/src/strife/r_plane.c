@@ -62,8 +62,19 @@ visplane_t *ceilingplane;
 
 // ?
 // haleyjd 20140831: [SVE] MAXOPENINGS raised to proper limit
+// [SVE] openings are kept in a chain of blocks which is extended when a
+// frame needs more; blocks never move, as drawsegs point into them.
 #define MAXOPENINGS	SCREENWIDTH*SCREENHEIGHT
-short			openings[MAXOPENINGS];
+
+typedef struct openingblock_s
+{
+    struct openingblock_s *next;
+    short openings[MAXOPENINGS];
+} openingblock_t;
+
+static openingblock_t	firstopenings;
+static openingblock_t*	curopenings;
+static short*		openingsend;
 short*			lastopening;
 
 
@@ -72,31 +83,60 @@ short*			lastopening;
 //  floorclip starts out SCREENHEIGHT
 //  ceilingclip starts out -1
 //
-short			floorclip[SCREENWIDTH];
-short			ceilingclip[SCREENWIDTH];
+short			floorclip[MAXRENDERWIDTH];
+short			ceilingclip[MAXRENDERWIDTH];
 
 //
 // spanstart holds the start of a plane span
 // initialized to 0 at start
 //
-int			spanstart[SCREENHEIGHT];
-int			spanstop[SCREENHEIGHT];
+int			spanstart[MAXRENDERHEIGHT];
+int			spanstop[MAXRENDERHEIGHT];
 
 //
 // texture mapping
 //
 lighttable_t**		planezlight;
 fixed_t			planeheight;
+static byte*		planesource; // [SVE]
 
-fixed_t			yslope[SCREENHEIGHT];
-fixed_t			distscale[SCREENWIDTH];
+fixed_t			yslope[MAXRENDERHEIGHT];
+fixed_t			distscale[MAXRENDERWIDTH];
 fixed_t			basexscale;
 fixed_t			baseyscale;
 
-fixed_t			cachedheight[SCREENHEIGHT];
-fixed_t			cacheddistance[SCREENHEIGHT];
-fixed_t			cachedxstep[SCREENHEIGHT];
-fixed_t			cachedystep[SCREENHEIGHT];
+// [SVE] the row cache is kept from frame to frame for as long as the
+// view angle and pitch don't change; cachedzlight is the zlight index
+fixed_t			cachedheight[MAXRENDERHEIGHT];
+fixed_t			cacheddistance[MAXRENDERHEIGHT];
+fixed_t			cachedxstep[MAXRENDERHEIGHT];
+fixed_t			cachedystep[MAXRENDERHEIGHT];
+unsigned		cachedzlight[MAXRENDERHEIGHT];
+
+static fixed_t		cachedbasexscale;
+static fixed_t		cachedbaseyscale;
+
+//
+// [SVE] Spans are held back a row at a time, so that a span carrying on
+// where the last one on its row stopped, with the same flat, height and
+// colormap, goes to spanfunc as one.  That joins up the rows of planes
+// that had to be split, and of planes whose light levels differ but
+// come out at the same colormap.
+//
+typedef struct
+{
+    int			x1;
+    int			x2;
+    byte*		source;		// NULL when no span is held
+    lighttable_t*	colormap;
+    fixed_t		height;
+    fixed_t		xfrac;
+    fixed_t		yfrac;
+    fixed_t		xstep;
+    fixed_t		ystep;
+} heldspan_t;
+
+static heldspan_t	heldspans[MAXRENDERHEIGHT];
 
 
 
@@ -118,12 +158,41 @@ void R_InitPlanes(void)
 }
 
 
+//
+// R_FlushSpan
+//
+// [SVE] Draws the span held back for a row.
+//
+static void R_FlushSpan(int y)
+{
+    heldspan_t*	span = &heldspans[y];
+
+    if (!span->source)
+        return;
+
+    ds_y = y;
+    ds_x1 = span->x1;
+    ds_x2 = span->x2;
+    ds_source = span->source;
+    ds_colormap = span->colormap;
+    ds_xfrac = span->xfrac;
+    ds_yfrac = span->yfrac;
+    ds_xstep = span->xstep;
+    ds_ystep = span->ystep;
+
+    // high or low detail
+    spanfunc ();
+
+    span->source = NULL;
+}
+
+
 //
 // R_MapPlane
 //
 // Uses global vars:
 //  planeheight
-//  ds_source
+//  planesource
 //  basexscale
 //  baseyscale
 //  viewx
@@ -140,7 +209,11 @@ R_MapPlane
     angle_t	angle;
     fixed_t	distance;
     fixed_t	length;
+    fixed_t	xstep;
+    fixed_t	ystep;
     unsigned	index;
+    lighttable_t* colormap;
+    heldspan_t*	span;
 
 #ifdef RANGECHECK
     if (x2 < x1 || x1 < 0 || x2 >= viewwidth || y > viewheight)
@@ -153,39 +226,67 @@ R_MapPlane
     {
         cachedheight[y] = planeheight;
         distance = cacheddistance[y] = FixedMul (planeheight, yslope[y]);
-        ds_xstep = cachedxstep[y] = FixedMul (distance,basexscale);
-        ds_ystep = cachedystep[y] = FixedMul (distance,baseyscale);
+        xstep = cachedxstep[y] = FixedMul (distance,basexscale);
+        ystep = cachedystep[y] = FixedMul (distance,baseyscale);
+
+        // [SVE] the light index only depends on the distance
+        index = distance >> LIGHTZSHIFT;
+
+        if (index >= MAXLIGHTZ )
+            index = MAXLIGHTZ-1;
+
+        cachedzlight[y] = index;
     }
     else
     {
         distance = cacheddistance[y];
-        ds_xstep = cachedxstep[y];
-        ds_ystep = cachedystep[y];
+        xstep = cachedxstep[y];
+        ystep = cachedystep[y];
     }
 
-    length = FixedMul (distance,distscale[x1]);
-    angle = (viewangle + xtoviewangle[x1])>>ANGLETOFINESHIFT;
-    ds_xfrac = viewx + FixedMul(finecosine[angle], length);
-    ds_yfrac = -viewy - FixedMul(finesine[angle], length);
-
     if (fixedcolormap)
-        ds_colormap = fixedcolormap;
+        colormap = fixedcolormap;
     else
-    {
-        index = distance >> LIGHTZSHIFT;
+        colormap = planezlight[cachedzlight[y]];
 
-        if (index >= MAXLIGHTZ )
-            index = MAXLIGHTZ-1;
+    // [SVE] join on to the span held for this row if it carries on from it
+    span = &heldspans[y];
 
-        ds_colormap = planezlight[index];
+    if (span->source == planesource
+     && span->height == planeheight
+     && span->colormap == colormap
+     && span->x2 + 1 == x1)
+    {
+        span->x2 = x2;
+        return;
     }
 
-    ds_y = y;
-    ds_x1 = x1;
-    ds_x2 = x2;
+    length = FixedMul (distance,distscale[x1]);
+    angle = (viewangle + xtoviewangle[x1])>>ANGLETOFINESHIFT;
 
-    // high or low detail
-    spanfunc ();	
+    // or have it carry on from this one
+    if (span->source == planesource
+     && span->height == planeheight
+     && span->colormap == colormap
+     && x2 + 1 == span->x1)
+    {
+        span->x1 = x1;
+        span->xfrac = viewx + FixedMul(finecosine[angle], length);
+        span->yfrac = -viewy - FixedMul(finesine[angle], length);
+        return;
+    }
+
+    R_FlushSpan(y);
+
+    span->x1 = x1;
+    span->x2 = x2;
+    span->source = planesource;
+    span->colormap = colormap;
+    span->height = planeheight;
+    span->xfrac = viewx + FixedMul(finecosine[angle], length);
+    span->yfrac = -viewy - FixedMul(finesine[angle], length);
+    span->xstep = xstep;
+    span->ystep = ystep;
 }
 
 
@@ -212,10 +313,9 @@ void R_ClearPlanes (void)
             freehead = &(*freehead)->next;
     }
 
-    lastopening = openings;
-
-    // texture calculation
-    memset (cachedheight, 0, sizeof(cachedheight));
+    curopenings = &firstopenings;
+    lastopening = curopenings->openings;
+    openingsend = lastopening + MAXOPENINGS;
 
     // left to right mapping
     angle = (viewangle-ANG90)>>ANGLETOFINESHIFT;
@@ -223,6 +323,52 @@ void R_ClearPlanes (void)
     // scale will be unit scale at SCREENWIDTH/2 distance
     basexscale = FixedDiv (finecosine[angle],centerxfrac);
     baseyscale = -FixedDiv (finesine[angle],centerxfrac);
+
+    // texture calculation
+    // [SVE] only start over when the view has turned
+    if (basexscale != cachedbasexscale || baseyscale != cachedbaseyscale)
+    {
+        R_ClearPlaneCache ();
+        cachedbasexscale = basexscale;
+        cachedbaseyscale = baseyscale;
+    }
+}
+
+//
+// R_ClearPlaneCache
+//
+// [SVE] Forget the row distances, when the view turns or yslope changes.
+// Everything is zeroed so that rows of height 0 read back consistently.
+//
+void R_ClearPlaneCache(void)
+{
+    memset (cachedheight, 0, sizeof(cachedheight));
+    memset (cacheddistance, 0, sizeof(cacheddistance));
+    memset (cachedxstep, 0, sizeof(cachedxstep));
+    memset (cachedystep, 0, sizeof(cachedystep));
+    memset (cachedzlight, 0, sizeof(cachedzlight));
+}
+
+//
+// R_CheckOpenings
+//
+// [SVE] Make room for count openings at lastopening, moving on to the
+// next block if this one is full.
+//
+void R_CheckOpenings(int count)
+{
+    if(lastopening + count <= openingsend)
+        return;
+
+    if(!curopenings->next)
+    {
+        curopenings->next = Z_Malloc(sizeof(openingblock_t), PU_STATIC, NULL);
+        curopenings->next->next = NULL;
+    }
+
+    curopenings = curopenings->next;
+    lastopening = curopenings->openings;
+    openingsend = lastopening + MAXOPENINGS;
 }
 
 static visplane_t *R_newVisplane(unsigned int hash)
@@ -255,6 +401,10 @@ R_FindPlane
         lightlevel = 0;
     }
 
+    // [SVE] only the light step is drawn, so map light levels within a
+    // step together
+    lightlevel &= ~((1 << LIGHTSEGSHIFT) - 1);
+
     hash = planehash(picnum, lightlevel, height);
 
     // haleyjd 20140831: [SVE] remove limit
@@ -273,7 +423,7 @@ R_FindPlane
     check->height = height;
     check->picnum = picnum;
     check->lightlevel = lightlevel;
-    check->minx = SCREENWIDTH;
+    check->minx = renderwidth;
     check->maxx = -1;
 
     memset (check->top,0xff,sizeof(check->top));
@@ -321,7 +471,7 @@ R_CheckPlane
 
     for (x=intrl ; x<= intrh ; x++)
     {
-        if (pl->top[x] != 0xff)
+        if (pl->top[x] != 0xffff)
             break;
     }
 
@@ -387,6 +537,69 @@ R_MakeSpans
 
 
 
+//
+// R_MergePlanes
+//
+// [SVE] A plane has to be split when it runs into a column it already
+// covers, but the two halves often end up covering different columns
+// after all.  Fold such planes back together before drawing them.
+//
+static void R_MergePlanes (void)
+{
+    visplane_t*		pl;
+    visplane_t*		other;
+    int                 i;
+    int			x;
+    int			left;
+    int			right;
+
+    for(i = 0; i < MAXVISPLANES; i++)
+    {
+        for(pl = visplanes[i]; pl; pl = pl->next)
+        {
+            if (pl->minx > pl->maxx)
+                continue;
+
+            for(other = pl->next; other; other = other->next)
+            {
+                if (other->minx > other->maxx
+                 || other->height != pl->height
+                 || other->picnum != pl->picnum
+                 || other->lightlevel != pl->lightlevel)
+                    continue;
+
+                left = MAX(pl->minx, other->minx);
+                right = MIN(pl->maxx, other->maxx);
+
+                for (x = left; x <= right; x++)
+                {
+                    if (pl->top[x] != 0xffff && other->top[x] != 0xffff)
+                        break;
+                }
+
+                if (x <= right)
+                    continue;
+
+                for (x = other->minx; x <= other->maxx; x++)
+                {
+                    if (other->top[x] != 0xffff)
+                    {
+                        pl->top[x] = other->top[x];
+                        pl->bottom[x] = other->bottom[x];
+                    }
+                }
+
+                pl->minx = MIN(pl->minx, other->minx);
+                pl->maxx = MAX(pl->maxx, other->maxx);
+
+                other->minx = renderwidth;
+                other->maxx = -1;
+            }
+        }
+    }
+}
+
+
 //
 // R_DrawPlanes
 // At the end of each frame.
@@ -401,6 +614,8 @@ void R_DrawPlanes (void)
     int			angle;
     int                 lumpnum;
 
+    R_MergePlanes ();
+
     for(i = 0; i < MAXVISPLANES; i++)
     {
         for(pl = visplanes[i]; pl; pl = pl->next)
@@ -437,7 +652,7 @@ void R_DrawPlanes (void)
 	
             // regular flat
             lumpnum = firstflat + flattranslation[pl->picnum];
-            ds_source = W_CacheLumpNum(lumpnum, PU_STATIC);
+            planesource = W_CacheLumpNum(lumpnum, PU_STATIC);
 
             planeheight = abs(pl->height-viewz);
             light = (pl->lightlevel >> LIGHTSEGSHIFT)+extralight;
@@ -450,8 +665,8 @@ void R_DrawPlanes (void)
 
             planezlight = zlight[light];
 
-            pl->top[pl->maxx+1] = 0xff;
-            pl->top[pl->minx-1] = 0xff;
+            pl->top[pl->maxx+1] = 0xffff;
+            pl->top[pl->minx-1] = 0xffff;
 
             stop = pl->maxx + 1;
 
@@ -462,8 +677,20 @@ void R_DrawPlanes (void)
                             pl->top[x],
                             pl->bottom[x]);
             }
+        }
+    }
+
+    // [SVE] draw what is still held back, and only then let go of the
+    // flats it was drawn from
+    for (i = 0; i < viewheight; i++)
+        R_FlushSpan(i);
 
-            W_ReleaseLumpNum(lumpnum);
+    for(i = 0; i < MAXVISPLANES; i++)
+    {
+        for(pl = visplanes[i]; pl; pl = pl->next)
+        {
+            if (pl->minx <= pl->maxx && pl->picnum != skyflatnum)
+                W_ReleaseLumpNum(firstflat + flattranslation[pl->picnum]);
         }
     }
 }
@@ -159,7 +159,7 @@ R_RenderMaskedSegRange
 
     // villsa [STRIFE] render as transparent (25% or 75%?)
     if(curline->linedef->flags & ML_TRANSPARENT2)
-        colfunc = R_DrawMVisTLColumn;
+        colfunc = drawkernels->mvistlcolumn; // [SVE]
     
     // draw the columns
     for (dc_x = x1 ; dc_x <= x2 ; dc_x++)
@@ -171,8 +171,8 @@ R_RenderMaskedSegRange
 	    {
 		index = spryscale>>LIGHTSCALESHIFT;
 
-		if (index >=  MAXLIGHTSCALE )
-		    index = MAXLIGHTSCALE-1;
+		if (index >=  numlightscales ) // [SVE]
+		    index = numlightscales-1;
 
 		dc_colormap = walllights[index];
 	    }
@@ -182,7 +182,7 @@ R_RenderMaskedSegRange
 	    
 	    // draw the texture
 	    col = (column_t *)( 
-		(byte *)R_GetColumn(texnum,maskedtexturecol[dc_x]) -3);
+		(byte *)R_GetMaskedColumn(texnum,maskedtexturecol[dc_x]) -3);
 			
             // villsa [STRIFE] added 0 argument
 	    R_DrawMaskedColumn (col, 0);
@@ -272,8 +272,8 @@ void R_RenderSegLoop (void)
 	    // calculate lighting
 	    index = rw_scale>>LIGHTSCALESHIFT;
 
-	    if (index >=  MAXLIGHTSCALE )
-		index = MAXLIGHTSCALE-1;
+	    if (index >=  numlightscales ) // [SVE]
+		index = numlightscales-1;
 
 	    dc_colormap = walllights[index];
 	    dc_x = rw_x;
@@ -627,6 +627,7 @@ R_StoreWallRange
 	{
 	    // masked midtexture
 	    maskedtexture = true;
+	    R_CheckOpenings(rw_stopx - rw_x); // [SVE]
 	    ds_p->maskedtexturecol = maskedtexturecol = lastopening - rw_x;
 	    lastopening += rw_stopx - rw_x;
 	}
@@ -737,6 +738,7 @@ R_StoreWallRange
     if ( ((ds_p->silhouette & SIL_TOP) || maskedtexture)
 	 && !ds_p->sprtopclip)
     {
+	R_CheckOpenings(rw_stopx - start); // [SVE]
 	memcpy (lastopening, ceilingclip+start, 2*(rw_stopx-start));
 	ds_p->sprtopclip = lastopening - start;
 	lastopening += rw_stopx - start;
@@ -745,6 +747,7 @@ R_StoreWallRange
     if ( ((ds_p->silhouette & SIL_BOTTOM) || maskedtexture)
 	 && !ds_p->sprbottomclip)
     {
+	R_CheckOpenings(rw_stopx - start); // [SVE]
 	memcpy (lastopening, floorclip+start, 2*(rw_stopx-start));
 	ds_p->sprbottomclip = lastopening - start;
 	lastopening += rw_stopx - start;	
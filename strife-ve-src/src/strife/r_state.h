@@ -116,7 +116,7 @@ extern fixed_t viewlerp; // haleyjd [SVE]
 extern angle_t      clipangle;
 
 extern int      viewangletox[FINEANGLES/2];
-extern angle_t      xtoviewangle[SCREENWIDTH+1];
+extern angle_t      xtoviewangle[MAXRENDERWIDTH+1];
 //extern fixed_t        finetangent[FINEANGLES/2];
 
 extern fixed_t      rw_distance;
@@ -77,8 +77,8 @@ lighttable_t**	spritelights;
 
 // constant arrays
 //  used for psprite clipping and initializing clipping
-short		negonearray[SCREENWIDTH];
-short		screenheightarray[SCREENWIDTH];
+short		negonearray[MAXRENDERWIDTH];       // [SVE]
+short		screenheightarray[MAXRENDERWIDTH];
 
 
 //
@@ -283,8 +283,9 @@ void R_InitSpriteDefs (char** namelist)
 //
 // GAME FUNCTIONS
 //
-vissprite_t	vissprites[MAXVISSPRITES];
+vissprite_t*	vissprites;
 vissprite_t*	vissprite_p;
+static unsigned int maxvissprites;
 int		newvissprite;
 int             sprbotscreen;       // villsa [STRIFE]
 
@@ -298,7 +299,7 @@ void R_InitSprites (char** namelist)
 {
     int		i;
 	
-    for (i=0 ; i<SCREENWIDTH ; i++)
+    for (i=0 ; i<MAXRENDERWIDTH ; i++)
     {
 	negonearray[i] = -1;
     }
@@ -321,12 +322,16 @@ void R_ClearSprites (void)
 //
 // R_NewVisSprite
 //
-vissprite_t	overflowsprite;
-
 vissprite_t* R_NewVisSprite (void)
 {
-    if (vissprite_p == &vissprites[MAXVISSPRITES])
-	return &overflowsprite;
+    // [SVE] remove vissprites limit
+    if (vissprite_p == vissprites + maxvissprites)
+    {
+        unsigned int newmax = maxvissprites ? maxvissprites*2 : MAXVISSPRITES;
+        vissprites = Z_Realloc(vissprites, newmax * sizeof(*vissprites), PU_STATIC, NULL);
+        vissprite_p = vissprites + maxvissprites;
+        maxvissprites = newmax;
+    }
     
     vissprite_p++;
     return vissprite_p-1;
@@ -437,13 +442,13 @@ R_DrawVisSprite
         if(!translation)
         {
             if(vis->mobjflags & MF_MVIS)
-                colfunc = R_DrawMVisTLColumn;
+                colfunc = drawkernels->mvistlcolumn; // [SVE]
             else
                 colfunc = fuzzcolfunc;
         }
         else
         {
-            colfunc = R_DrawTRTLColumn;
+            colfunc = drawkernels->trtlcolumn; // [SVE]
             dc_translation = translationtables - 256 + (translation >> (MF_TRANSSHIFT - 8));
         }
     }
@@ -669,8 +674,8 @@ void R_ProjectSprite (mobj_t* thing)
 	// diminished light
 	index = xscale>>(LIGHTSCALESHIFT-detailshift);
 
-	if (index >= MAXLIGHTSCALE) 
-	    index = MAXLIGHTSCALE-1;
+	if (index >= numlightscales) // [SVE]
+	    index = numlightscales-1;
 
 	vis->colormap = spritelights[index];
     }	
@@ -795,7 +800,7 @@ void R_DrawPSprite (pspdef_t* psp)
         || (viewplayer->powers[pw_invisibility] & 8))
     {
         // shadow draw
-        vis->colormap   = spritelights[MAXLIGHTSCALE-1];
+        vis->colormap   = spritelights[numlightscales-1]; // [SVE]
         vis->mobjflags |= MF_SHADOW;
     }
     else if(viewplayer->powers[pw_invisibility] & 4)
@@ -819,7 +824,7 @@ void R_DrawPSprite (pspdef_t* psp)
         else
         {
             // local light
-            vis->colormap = spritelights[MAXLIGHTSCALE-1];
+            vis->colormap = spritelights[numlightscales-1]; // [SVE]
         }
     }
     else
@@ -876,55 +881,60 @@ void R_DrawPlayerSprites (void)
 //
 vissprite_t	vsprsortedhead;
 
+// [SVE] sprites sorted through an array of pointers
+static vissprite_t**	vsprsort;
+static unsigned int	maxvsprsort;
+
+//
+// R_CompareVisSprites
+//
+// Farthest first; sprites at the same scale keep the order they were
+// added in, as the old selection sort left them.
+//
+static int R_CompareVisSprites(const void *a, const void *b)
+{
+    const vissprite_t *va = *(const vissprite_t *const *)a;
+    const vissprite_t *vb = *(const vissprite_t *const *)b;
+
+    if (va->scale != vb->scale)
+        return va->scale < vb->scale ? -1 : 1;
+
+    return va < vb ? -1 : va > vb;
+}
 
 void R_SortVisSprites (void)
 {
     int			i;
     int			count;
     vissprite_t*	ds;
-    vissprite_t*	best;
-    vissprite_t		unsorted;
-    fixed_t		bestscale;
 
     count = vissprite_p - vissprites;
-	
-    unsorted.next = unsorted.prev = &unsorted;
+
+    vsprsortedhead.next = vsprsortedhead.prev = &vsprsortedhead;
 
     if (!count)
 	return;
-		
-    for (ds=vissprites ; ds<vissprite_p ; ds++)
+
+    // [SVE] sort in O(n log n) rather than by repeated selection
+    if ((unsigned int)count > maxvsprsort)
     {
-	ds->next = ds+1;
-	ds->prev = ds-1;
+        maxvsprsort = maxvissprites;
+        vsprsort = Z_Realloc(vsprsort, maxvsprsort * sizeof(*vsprsort), PU_STATIC, NULL);
     }
-    
-    vissprites[0].prev = &unsorted;
-    unsorted.next = &vissprites[0];
-    (vissprite_p-1)->next = &unsorted;
-    unsorted.prev = vissprite_p-1;
-    
-    // pull the vissprites out by scale
 
-    vsprsortedhead.next = vsprsortedhead.prev = &vsprsortedhead;
+    for (i=0 ; i<count ; i++)
+	vsprsort[i] = &vissprites[i];
+
+    qsort(vsprsort, count, sizeof(*vsprsort), R_CompareVisSprites);
+
+    // link them up back to front
     for (i=0 ; i<count ; i++)
     {
-	bestscale = INT_MAX;
-        best = unsorted.next;
-	for (ds=unsorted.next ; ds!= &unsorted ; ds=ds->next)
-	{
-	    if (ds->scale < bestscale)
-	    {
-		bestscale = ds->scale;
-		best = ds;
-	    }
-	}
-	best->next->prev = best->prev;
-	best->prev->next = best->next;
-	best->next = &vsprsortedhead;
-	best->prev = vsprsortedhead.prev;
-	vsprsortedhead.prev->next = best;
-	vsprsortedhead.prev = best;
+	ds = vsprsort[i];
+	ds->next = &vsprsortedhead;
+	ds->prev = vsprsortedhead.prev;
+	vsprsortedhead.prev->next = ds;
+	vsprsortedhead.prev = ds;
     }
 }
 
@@ -936,8 +946,8 @@ void R_SortVisSprites (void)
 void R_DrawSprite (vissprite_t* spr)
 {
     drawseg_t*		ds;
-    short		clipbot[SCREENWIDTH];
-    short		cliptop[SCREENWIDTH];
+    short		clipbot[MAXRENDERWIDTH];
+    short		cliptop[MAXRENDERWIDTH];
     int			x;
     int			r1;
     int			r2;
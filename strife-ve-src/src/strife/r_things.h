@@ -24,14 +24,15 @@
 
 #define MAXVISSPRITES  	128
 
-extern vissprite_t	vissprites[MAXVISSPRITES];
+// [SVE] grows as needed
+extern vissprite_t*	vissprites;
 extern vissprite_t*	vissprite_p;
 extern vissprite_t	vsprsortedhead;
 
 // Constant arrays used for psprite clipping
 //  and initializing clipping.
-extern short		negonearray[SCREENWIDTH];
-extern short		screenheightarray[SCREENWIDTH];
+extern short		negonearray[MAXRENDERWIDTH];
+extern short		screenheightarray[MAXRENDERWIDTH];
 
 // vars for R_DrawMaskedColumn
 extern short*		mfloorclip;
@@ -29,7 +29,9 @@
 #include "doomstat.h"
 #include "doomtype.h"
 
+#include "d_loop.h"
 #include "d_main.h"
+#include "g_game.h"
 
 #include "sounds.h"
 #include "s_sound.h"
@@ -77,6 +79,20 @@ typedef struct
 
     // handle of the sound being played
     int handle;
+
+    // [SVE] slot in the eviction heap, or -1 if not in it
+    int heapslot;
+
+    // [SVE] order in which the channel was started
+    unsigned int serial;
+
+    // [SVE] source position the parameters were last computed at,
+    // and the parameters last sent to the sound module
+    boolean cached;
+    fixed_t srcx;
+    fixed_t srcy;
+    int volume;
+    int sep;
     
 } channel_t;
 
@@ -84,6 +100,24 @@ typedef struct
 
 static channel_t *channels;
 
+// [SVE] Heap of the channels playing ordinary sound effects, with the
+// first one to be kicked out for a more important sound at the top.
+
+static int *evictheap;
+static int numevict;
+static unsigned int channelserial;
+
+// [SVE] Listener state at the last call to S_UpdateSounds; if none of
+// it has changed, channels whose source hasn't moved keep their
+// current volume and separation.
+
+static mobj_t *lastlistener;
+static fixed_t lastlistenerx;
+static fixed_t lastlistenery;
+static angle_t lastlistenerangle;
+static int lastsfxvolume = -1;
+static boolean lastvoiceplaying;
+
 // Maximum volume of a sound effect.
 // Internal default is max out of 0-15.
 
@@ -158,11 +192,14 @@ void S_Init(int sfxVolume, int musicVolume, int voiceVolume)
     // (the maximum numer of sounds rendered
     // simultaneously) within zone memory.
     channels = Z_Malloc(snd_channels*sizeof(channel_t), PU_STATIC, 0);
+    evictheap = Z_Malloc(snd_channels*sizeof(int), PU_STATIC, 0);
+    numevict = 0;
 
     // Free all channels for use
     for (i=0 ; i<snd_channels ; i++)
     {
         channels[i].sfxinfo = 0;
+        channels[i].heapslot = -1;
     }
 
     // no sounds are playing, and they are not mus_paused
@@ -184,6 +221,97 @@ void S_Shutdown(void)
     I_ShutdownMusic();
 }
 
+//
+// [SVE] Eviction heap. A channel is evicted before another if its sound
+// has a lower priority (higher number), or the same priority and was
+// started earlier.
+//
+
+static boolean S_EvictsBefore(int a, int b)
+{
+    channel_t *ca = &channels[a];
+    channel_t *cb = &channels[b];
+
+    if (ca->sfxinfo->priority != cb->sfxinfo->priority)
+        return ca->sfxinfo->priority > cb->sfxinfo->priority;
+
+    return (int)(ca->serial - cb->serial) < 0;
+}
+
+static void S_HeapSet(int slot, int cnum)
+{
+    evictheap[slot] = cnum;
+    channels[cnum].heapslot = slot;
+}
+
+static void S_HeapSiftUp(int slot)
+{
+    int cnum = evictheap[slot];
+    int parent;
+
+    while (slot > 0)
+    {
+        parent = (slot - 1) / 2;
+
+        if (!S_EvictsBefore(cnum, evictheap[parent]))
+            break;
+
+        S_HeapSet(slot, evictheap[parent]);
+        slot = parent;
+    }
+
+    S_HeapSet(slot, cnum);
+}
+
+static void S_HeapSiftDown(int slot)
+{
+    int cnum = evictheap[slot];
+    int child;
+
+    for (;;)
+    {
+        child = slot * 2 + 1;
+
+        if (child >= numevict)
+            break;
+
+        if (child + 1 < numevict
+         && S_EvictsBefore(evictheap[child + 1], evictheap[child]))
+            ++child;
+
+        if (!S_EvictsBefore(evictheap[child], cnum))
+            break;
+
+        S_HeapSet(slot, evictheap[child]);
+        slot = child;
+    }
+
+    S_HeapSet(slot, cnum);
+}
+
+static void S_HeapInsert(int cnum)
+{
+    S_HeapSet(numevict, cnum);
+    S_HeapSiftUp(numevict++);
+}
+
+static void S_HeapRemove(int cnum)
+{
+    int slot = channels[cnum].heapslot;
+    int moved;
+
+    channels[cnum].heapslot = -1;
+
+    if (--numevict == slot)
+        return;
+
+    // move the last channel into the hole and restore the heap order
+    moved = evictheap[numevict];
+    S_HeapSet(slot, moved);
+    S_HeapSiftUp(slot);
+    S_HeapSiftDown(channels[moved].heapslot);
+}
+
 static void S_StopChannel(int cnum)
 {
     int i;
@@ -195,6 +323,9 @@ static void S_StopChannel(int cnum)
     if (cnum == i_voicehandle)
         i_voicehandle = -1;
 
+    if (c->heapslot >= 0)
+        S_HeapRemove(cnum);
+
     if (c->sfxinfo)
     {
         // stop the sound playing
@@ -298,6 +429,40 @@ void S_StopSound(mobj_t *origin)
     }
 }
 
+//
+// S_RelinkSounds
+//
+// [SVE] Called when the things in the level have been replaced by copies
+// (netgame rollback). Sounds playing from a thing follow its copy, or
+// are stopped if it has none. The relink function returns the origin
+// unchanged for anything that was not replaced.
+//
+void S_RelinkSounds(mobj_t *(*relink)(mobj_t *origin))
+{
+    int cnum;
+    mobj_t *origin;
+
+    for (cnum=0 ; cnum<snd_channels ; cnum++)
+    {
+        if(cnum == i_voicehandle)
+            continue;
+
+        if (channels[cnum].sfxinfo && channels[cnum].origin)
+        {
+            origin = relink(channels[cnum].origin);
+
+            if (origin == NULL)
+            {
+                S_StopChannel(cnum);
+            }
+            else
+            {
+                channels[cnum].origin = origin;
+            }
+        }
+    }
+}
+
 //
 // S_GetChannel :
 //   If none available, return -1.  Otherwise channel #.
@@ -336,26 +501,19 @@ static int S_GetChannel(mobj_t *origin, sfxinfo_t *sfxinfo, boolean isvoice)
     if (cnum == snd_channels)
     {
         // Look for lower priority
-        for (cnum=0 ; cnum<snd_channels ; cnum++)
-        {
-            if (channels[cnum].sfxinfo->priority >= sfxinfo->priority)
-            {
-                // haleyjd 09/11/10: [STRIFE] voice has absolute priority
-                if (isvoice || cnum != i_voicehandle)
-                    break;
-            }
-        }
-
-        if (cnum == snd_channels)
+        // [SVE] take the least important sound from the eviction heap.
+        // haleyjd 09/11/10: [STRIFE] voice has absolute priority, so the
+        // voice channel is never in the heap.
+        if (numevict == 0
+         || channels[evictheap[0]].sfxinfo->priority < sfxinfo->priority)
         {
             // FUCK!  No lower priority.  Sorry, Charlie.    
             return -1;
         }
-        else
-        {
-            // Otherwise, kick out lower priority.
-            S_StopChannel(cnum);
-        }
+
+        // Otherwise, kick out lower priority.
+        cnum = evictheap[0];
+        S_StopChannel(cnum);
     }
 
     c = &channels[cnum];
@@ -363,6 +521,11 @@ static int S_GetChannel(mobj_t *origin, sfxinfo_t *sfxinfo, boolean isvoice)
     // channel is decided to be cnum.
     c->sfxinfo = sfxinfo;
     c->origin = origin;
+    c->serial = channelserial++;
+    c->cached = false;
+
+    if (!isvoice)
+        S_HeapInsert(cnum);
 
     return cnum;
 }
@@ -450,6 +613,14 @@ void S_StartSound(void *origin_p, int sfx_id)
     int cnum;
     int volume;
 
+    // [SVE] tics being run again after a netgame misprediction have
+    // already been heard once, and tics skipped over by a demo seek are
+    // not heard at all
+    if (resimulating || G_DemoSeeking())
+    {
+        return;
+    }
+
     origin = (mobj_t *) origin_p;
     volume = snd_SfxVolume;
 
@@ -530,6 +701,8 @@ void S_StartSound(void *origin_p, int sfx_id)
     }
 
     channels[cnum].handle = I_StartSound(sfx, cnum, volume, sep);
+    channels[cnum].volume = volume;
+    channels[cnum].sep = sep;
 }
 
 
@@ -661,6 +834,11 @@ void I_StartVoice(const char *lumpname)
     if(netgame)
         return;
 
+    // [SVE] as with S_StartSound, replayed and skipped tics stay silent;
+    // that includes not stopping a voice started the first time round
+    if(resimulating || G_DemoSeeking())
+        return;
+
     // STRIFE-TODO: checks if snd_SfxDevice == 83
     // This is probably turning off voice if using PC speaker...
 
@@ -731,11 +909,35 @@ void S_UpdateSounds(mobj_t *listener)
     int                cnum;
     int                volume;
     int                sep;
+    boolean            listenermoved;
+    boolean            voiceplaying;
     sfxinfo_t*        sfx;
     channel_t*        c;
 
     I_UpdateSound();
 
+    // [SVE] Positional parameters only need recomputing for sources that
+    // have moved, unless the listener or the volume settings changed.
+    voiceplaying = (i_voicehandle >= 0);
+    listenermoved = true;
+
+    if (listener)
+    {
+        listenermoved = listener != lastlistener
+                     || listener->x != lastlistenerx
+                     || listener->y != lastlistenery
+                     || listener->angle != lastlistenerangle
+                     || snd_SfxVolume != lastsfxvolume
+                     || voiceplaying != lastvoiceplaying;
+
+        lastlistener = listener;
+        lastlistenerx = listener->x;
+        lastlistenery = listener->y;
+        lastlistenerangle = listener->angle;
+        lastsfxvolume = snd_SfxVolume;
+        lastvoiceplaying = voiceplaying;
+    }
+
     for (cnum=0; cnum<snd_channels; cnum++)
     {
         c = &channels[cnum];
@@ -765,21 +967,38 @@ void S_UpdateSounds(mobj_t *listener)
 
                 // check non-local sounds for distance clipping
                 //  or modify their params
-                if (c->origin && listener != c->origin)
+                if (!c->origin || listener == c->origin)
                 {
-                    audible = S_AdjustSoundParams(listener,
-                                                  c->origin,
-                                                  &volume,
-                                                  &sep);
-                    
-                    if (!audible)
-                    {
-                        S_StopChannel(cnum);
-                    }
-                    else
-                    {
-                        I_UpdateSoundParams(c->handle, volume, sep);
-                    }
+                    continue;
+                }
+
+                // [SVE] nothing has moved since the last update
+                if (!listenermoved && c->cached
+                 && c->origin->x == c->srcx && c->origin->y == c->srcy)
+                {
+                    continue;
+                }
+
+                audible = S_AdjustSoundParams(listener,
+                                              c->origin,
+                                              &volume,
+                                              &sep);
+
+                if (!audible)
+                {
+                    S_StopChannel(cnum);
+                    continue;
+                }
+
+                c->cached = true;
+                c->srcx = c->origin->x;
+                c->srcy = c->origin->y;
+
+                if (volume != c->volume || sep != c->sep)
+                {
+                    c->volume = volume;
+                    c->sep = sep;
+                    I_UpdateSoundParams(c->handle, volume, sep);
                 }
             }
             else
@@ -875,7 +1094,8 @@ void S_ChangeMusic(int musicnum, int looping)
 
     music->data = W_CacheLumpNum(music->lumpnum, PU_STATIC);
 
-    handle = I_RegisterSong(music->data, W_LumpLength(music->lumpnum));
+    handle = I_RegisterSongLump(music->lumpnum, music->data,
+                                W_LumpLength(music->lumpnum));
     music->handle = handle;
     I_PlaySong(handle, looping);
 
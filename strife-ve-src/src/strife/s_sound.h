@@ -60,6 +60,9 @@ void I_StartVoice(const char *lumpname);
 // Stop sound for thing at <origin>
 void S_StopSound(mobj_t *origin);
 
+// [SVE] Move sounds over to replacement things after a rollback
+void S_RelinkSounds(mobj_t *(*relink)(mobj_t *origin));
+
 
 // Start music using <music_id> from sounds.h
 void S_StartMusic(int music_id);
@@ -333,6 +333,40 @@ void ST_ClearDamageMarkers(void)
     dmgmarkers.next = dmgmarkers.prev = &dmgmarkers;
 }
 
+//
+// ST_RelinkDamageMarkers
+//
+// [SVE] The things in the level have been replaced by copies (netgame
+// rollback); point the markers at the copies, and drop markers whose
+// source has none. The old sources are gone, so their references are
+// not released.
+//
+
+void ST_RelinkDamageMarkers(mobj_t *(*relink)(mobj_t *source))
+{
+    damagemarker_t *dmgmarker, *next;
+    mobj_t *source;
+
+    for(dmgmarker = dmgmarkers.next; dmgmarker != &dmgmarkers; dmgmarker = next)
+    {
+        next = dmgmarker->next;
+        source = relink(dmgmarker->source);
+        dmgmarker->source = NULL;
+
+        if(source)
+        {
+            P_SetTarget(&dmgmarker->source, source);
+        }
+        else
+        {
+            damagemarker_t* marker = dmgmarker;
+
+            (next->prev = dmgmarker = marker->prev)->next = next;
+            Z_Free(marker);
+        }
+    }
+}
+
 //
 // ST_AddDamageMarker
 //
@@ -73,6 +73,7 @@ typedef struct damagemarker_s
 extern damagemarker_t dmgmarkers;
 
 void ST_ClearDamageMarkers(void);
+void ST_RelinkDamageMarkers(mobj_t *(*relink)(mobj_t *source));
 void ST_AddDamageMarker(mobj_t *source);
 
 
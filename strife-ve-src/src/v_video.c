@@ -92,8 +92,36 @@ void V_MarkRect(int x, int y, int width, int height)
 
     if (dest_screen == I_VideoBuffer)
     {
-        M_AddToBox (dirtybox, x, y); 
-        M_AddToBox (dirtybox, x + width-1, y + height-1); 
+        // [SVE] I_FinishUpdate uploads only this box, so clip it to the
+        // screen.  Each edge is widened on its own: M_AddToBox leaves the
+        // right and top edges alone when the first point added to an
+        // empty box is also the last.
+        if (x < 0)
+        {
+            width += x;
+            x = 0;
+        }
+        if (y < 0)
+        {
+            height += y;
+            y = 0;
+        }
+        if (x + width > SCREENWIDTH)
+            width = SCREENWIDTH - x;
+        if (y + height > SCREENHEIGHT)
+            height = SCREENHEIGHT - y;
+
+        if (width <= 0 || height <= 0)
+            return;
+
+        if (x < dirtybox[BOXLEFT])
+            dirtybox[BOXLEFT] = x;
+        if (x + width - 1 > dirtybox[BOXRIGHT])
+            dirtybox[BOXRIGHT] = x + width - 1;
+        if (y < dirtybox[BOXBOTTOM])
+            dirtybox[BOXBOTTOM] = y;
+        if (y + height - 1 > dirtybox[BOXTOP])
+            dirtybox[BOXTOP] = y + height - 1;
     }
 } 
  
@@ -130,14 +158,15 @@ void V_CopyRect(int srcx, int srcy, byte *source,
 
     V_MarkRect(destx, desty, width, height); 
  
-    src = source + SCREENWIDTH * srcy + srcx; 
-    dest = dest_screen + SCREENWIDTH * desty + destx; 
+    // [SVE] both screens are renderwidth x renderheight
+    src = source + renderwidth * srcy * hires + srcx * hires; 
+    dest = dest_screen + renderwidth * desty * hires + destx * hires; 
 
-    for ( ; height>0 ; height--) 
+    for (height *= hires ; height>0 ; height--) 
     { 
-        memcpy(dest, src, width); 
-        src += SCREENWIDTH; 
-        dest += SCREENWIDTH; 
+        memcpy(dest, src, width * hires); 
+        src += renderwidth; 
+        dest += renderwidth; 
     } 
 } 
  
@@ -156,21 +185,105 @@ void V_SetPatchClipCallback(vpatchclipfunc_t func)
     patchclip_callback = func;
 }
 
+// [SVE] How the pixels of a patch are combined with the screen.
+typedef enum
+{
+    PATCH_COPY,         // opaque
+    PATCH_TINT,         // through tinttable
+    PATCH_XLA,          // villsa [STRIFE] through xlatab
+    PATCH_XLAMORE,      // edward [SVE] through xlatab, against itself
+    PATCH_SHADOW        // darken through tinttable
+} patchblend_t;
+
 //
-// V_DrawPatch
-// Masks a column based masked pic to the screen. 
+// V_BlendPixel
 //
 
-void V_DrawPatch(int x, int y, patch_t *patch)
-{ 
+static inline byte V_BlendPixel(byte dest, byte source, patchblend_t blend)
+{
+    switch(blend)
+    {
+    case PATCH_TINT:
+        return tinttable[(dest << 8) + source];
+    case PATCH_XLA:
+        return xlatab[dest + (source << 8)];
+    case PATCH_XLAMORE:
+        // the original drawer stored the source before blending, so the
+        // patch is blended with itself rather than with the screen
+        return xlatab[(source << 8) + source];
+    case PATCH_SHADOW:
+        return tinttable[dest << 8];
+    default:
+        return source;
+    }
+}
+
+//
+// V_DrawPatchColumns
+//
+// [SVE] Draw a patch at x, y on the 320x200 screen, each of its pixels
+// covering a hires x hires square of the screen buffer.  Clips to the
+// screen.
+//
+
+static void V_DrawPatchColumns(int x, int y, patch_t *patch,
+                               boolean flipped, patchblend_t blend)
+{
     int count;
     int col;
     column_t *column;
-    byte *desttop;
     byte *dest;
     byte *source;
     int w;
+    int sx, sy;
+    int i, j;
+
+    w = SHORT(patch->width);
+
+    for (col = 0 ; col<w ; col++)
+    {
+        // skip pixels off the sides
+        if (x + col < 0 || x + col >= SCREENWIDTH)
+            continue;
+
+        column = (column_t *)((byte *)patch
+                + LONG(patch->columnofs[flipped ? w-1-col : col]));
+        sx = (x + col) * hires;
 
+        // step through the posts in a column
+        while (column->topdelta != 0xff)
+        {
+            source = (byte *)column + 3;
+            sy = y + column->topdelta;
+            count = column->length;
+
+            for ( ; count-- ; source++, sy++)
+            {
+                if (sy < 0)
+                    continue;
+                if (sy >= SCREENHEIGHT)
+                    break; // we're not drawing anything else
+
+                dest = dest_screen + sy * hires * renderwidth + sx;
+
+                for (j = 0; j < hires; j++, dest += renderwidth - hires)
+                {
+                    for (i = 0; i < hires; i++, dest++)
+                        *dest = V_BlendPixel(*dest, *source, blend);
+                }
+            }
+            column = (column_t *)((byte *)column + column->length + 4);
+        }
+    }
+}
+
+//
+// V_DrawPatch
+// Masks a column based masked pic to the screen. 
+//
+
+void V_DrawPatch(int x, int y, patch_t *patch)
+{ 
     y -= SHORT(patch->topoffset);
     x -= SHORT(patch->leftoffset);
 
@@ -200,60 +313,7 @@ void V_DrawPatch(int x, int y, patch_t *patch)
 
     V_MarkRect(x, y, SHORT(patch->width), SHORT(patch->height));
 
-    col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
-
-    w = SHORT(patch->width);
-
-    // If the image is wider than the display area on both sides
-    if (x < 0 && x + w > SCREENWIDTH)
-    {
-        const int overhang = x + w - SCREENWIDTH;
-        col -= x;
-        w -= overhang;
-
-        desttop = dest_screen + y * SCREENWIDTH;
-    }
-    else
-    {
-        if (x < 0)
-        {
-            // skip leftmost pixels
-            col -= x;
-            desttop -= x;
-        }
-        if (x + w > SCREENWIDTH)
-        {
-            // skip rightmost pixels
-            const int overhang = x + w - SCREENWIDTH;
-            w -= overhang;
-            desttop -= overhang;
-        }
-    }
-
-    for ( ; col<w ; x++, col++, desttop++)
-    {
-        column = (column_t *)((byte *)patch + LONG(patch->columnofs[col]));
-
-        // step through the posts in a column
-        while (column->topdelta != 0xff)
-        {
-            source = (byte *)column + 3;
-            dest = desttop + column->topdelta*SCREENWIDTH;
-            count = column->length;
-
-            while (count--)
-            {
-				if(dest >= dest_screen + SCREENWIDTH * SCREENHEIGHT)
-					break; // we're not drawing anything else
-				else if(dest >= dest_screen)
-					*dest = *source;
-				source++;
-                dest += SCREENWIDTH;
-            }
-            column = (column_t *)((byte *)column + column->length + 4);
-        }
-    }
+    V_DrawPatchColumns(x, y, patch, false, PATCH_COPY);
 }
 
 //
@@ -264,14 +324,6 @@ void V_DrawPatch(int x, int y, patch_t *patch)
 
 void V_DrawPatchFlipped(int x, int y, patch_t *patch)
 {
-    int count;
-    int col; 
-    column_t *column; 
-    byte *desttop;
-    byte *dest;
-    byte *source; 
-    int w; 
- 
     y -= SHORT(patch->topoffset); 
     x -= SHORT(patch->leftoffset); 
 
@@ -294,30 +346,7 @@ void V_DrawPatchFlipped(int x, int y, patch_t *patch)
 
     V_MarkRect (x, y, SHORT(patch->width), SHORT(patch->height));
 
-    col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
-
-    w = SHORT(patch->width);
-
-    for ( ; col<w ; x++, col++, desttop++)
-    {
-        column = (column_t *)((byte *)patch + LONG(patch->columnofs[w-1-col]));
-
-        // step through the posts in a column
-        while (column->topdelta != 0xff )
-        {
-            source = (byte *)column + 3;
-            dest = desttop + column->topdelta*SCREENWIDTH;
-            count = column->length;
-
-            while (count--)
-            {
-                *dest = *source++;
-                dest += SCREENWIDTH;
-            }
-            column = (column_t *)((byte *)column + column->length + 4);
-        }
-    }
+    V_DrawPatchColumns(x, y, patch, true, PATCH_COPY);
 }
 
 
@@ -340,11 +369,6 @@ void V_DrawPatchDirect(int x, int y, patch_t *patch)
 
 void V_DrawTLPatch(int x, int y, patch_t * patch)
 {
-    int count, col;
-    column_t *column;
-    byte *desttop, *dest, *source;
-    int w;
-
     y -= SHORT(patch->topoffset);
     x -= SHORT(patch->leftoffset);
 
@@ -356,30 +380,9 @@ void V_DrawTLPatch(int x, int y, patch_t * patch)
         I_Error("Bad V_DrawTLPatch");
     }
 
-    col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
-
-    w = SHORT(patch->width);
-    for (; col < w; x++, col++, desttop++)
-    {
-        column = (column_t *) ((byte *) patch + LONG(patch->columnofs[col]));
-
-        // step through the posts in a column
-
-        while (column->topdelta != 0xff)
-        {
-            source = (byte *) column + 3;
-            dest = desttop + column->topdelta * SCREENWIDTH;
-            count = column->length;
+    V_MarkRect(x, y, SHORT(patch->width), SHORT(patch->height)); // [SVE]
 
-            while (count--)
-            {
-                *dest = tinttable[((*dest) << 8) + *source++];
-                dest += SCREENWIDTH;
-            }
-            column = (column_t *) ((byte *) column + column->length + 4);
-        }
-    }
+    V_DrawPatchColumns(x, y, patch, false, PATCH_TINT);
 }
 
 //
@@ -390,11 +393,6 @@ void V_DrawTLPatch(int x, int y, patch_t * patch)
 
 void V_DrawXlaPatch(int x, int y, patch_t * patch)
 {
-    int count, col;
-    column_t *column;
-    byte *desttop, *dest, *source;
-    int w;
-
     y -= SHORT(patch->topoffset);
     x -= SHORT(patch->leftoffset);
 
@@ -411,31 +409,9 @@ void V_DrawXlaPatch(int x, int y, patch_t * patch)
         return;
     }
 
-    col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
-
-    w = SHORT(patch->width);
-    for(; col < w; x++, col++, desttop++)
-    {
-        column = (column_t *) ((byte *) patch + LONG(patch->columnofs[col]));
-
-        // step through the posts in a column
-
-        while(column->topdelta != 0xff)
-        {
-            source = (byte *) column + 3;
-            dest = desttop + column->topdelta * SCREENWIDTH;
-            count = column->length;
+    V_MarkRect(x, y, SHORT(patch->width), SHORT(patch->height)); // [SVE]
 
-            while(count--)
-            {
-                *dest = xlatab[*dest + ((*source) << 8)];
-                source++;
-                dest += SCREENWIDTH;
-            }
-            column = (column_t *) ((byte *) column + column->length + 4);
-        }
-    }
+    V_DrawPatchColumns(x, y, patch, false, PATCH_XLA);
 }
 
 //
@@ -446,11 +422,6 @@ void V_DrawXlaPatch(int x, int y, patch_t * patch)
 
 void V_DrawXlaPatchMore(int x, int y, patch_t * patch)
 {
-    int count, col;
-    column_t *column;
-    byte *desttop, *dest, *source;
-    int w;
-
     y -= SHORT(patch->topoffset);
     x -= SHORT(patch->leftoffset);
 
@@ -467,36 +438,9 @@ void V_DrawXlaPatchMore(int x, int y, patch_t * patch)
         return;
     }
 
-    col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
-
-    w = SHORT(patch->width);
-    for (; col < w; x++, col++, desttop++)
-    {
-        column = (column_t *)((byte *)patch + LONG(patch->columnofs[col]));
-
-        // step through the posts in a column
-
-        while (column->topdelta != 0xff)
-        {
-            source = (byte *)column + 3;
-            dest = desttop + column->topdelta * SCREENWIDTH;
-            count = column->length;
+    V_MarkRect(x, y, SHORT(patch->width), SHORT(patch->height)); // [SVE]
 
-            while (count--)
-            {
-                if (dest >= dest_screen + SCREENWIDTH * SCREENHEIGHT)
-                    break; // we're not drawing anything else
-                else if (dest >= dest_screen)
-                    *dest = *source;
-
-                *dest = xlatab[(*dest << 8) + *source];
-                source++;
-                dest += SCREENWIDTH;
-            }
-            column = (column_t *)((byte *)column + column->length + 4);
-        }
-    }
+    V_DrawPatchColumns(x, y, patch, false, PATCH_XLAMORE);
 }
 
 //
@@ -507,11 +451,6 @@ void V_DrawXlaPatchMore(int x, int y, patch_t * patch)
 
 void V_DrawAltTLPatch(int x, int y, patch_t * patch)
 {
-    int count, col;
-    column_t *column;
-    byte *desttop, *dest, *source;
-    int w;
-
     y -= SHORT(patch->topoffset);
     x -= SHORT(patch->leftoffset);
 
@@ -523,30 +462,9 @@ void V_DrawAltTLPatch(int x, int y, patch_t * patch)
         I_Error("Bad V_DrawAltTLPatch");
     }
 
-    col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
-
-    w = SHORT(patch->width);
-    for (; col < w; x++, col++, desttop++)
-    {
-        column = (column_t *) ((byte *) patch + LONG(patch->columnofs[col]));
-
-        // step through the posts in a column
+    V_MarkRect(x, y, SHORT(patch->width), SHORT(patch->height)); // [SVE]
 
-        while (column->topdelta != 0xff)
-        {
-            source = (byte *) column + 3;
-            dest = desttop + column->topdelta * SCREENWIDTH;
-            count = column->length;
-
-            while (count--)
-            {
-                *dest = tinttable[((*dest) << 8) + *source++];
-                dest += SCREENWIDTH;
-            }
-            column = (column_t *) ((byte *) column + column->length + 4);
-        }
-    }
+    V_DrawPatchColumns(x, y, patch, false, PATCH_TINT);
 }
 
 //
@@ -557,12 +475,6 @@ void V_DrawAltTLPatch(int x, int y, patch_t * patch)
 
 void V_DrawShadowedPatch(int x, int y, patch_t *patch)
 {
-    int count, col;
-    column_t *column;
-    byte *desttop, *dest, *source;
-    byte *desttop2, *dest2;
-    int w;
-
     y -= SHORT(patch->topoffset);
     x -= SHORT(patch->leftoffset);
 
@@ -574,35 +486,12 @@ void V_DrawShadowedPatch(int x, int y, patch_t *patch)
         I_Error("Bad V_DrawShadowedPatch");
     }
 
-    col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
-    desttop2 = dest_screen + (y + 2) * SCREENWIDTH + x + 2;
-
-    w = SHORT(patch->width);
-    for (; col < w; x++, col++, desttop++, desttop2++)
-    {
-        column = (column_t *) ((byte *) patch + LONG(patch->columnofs[col]));
-
-        // step through the posts in a column
-
-        while (column->topdelta != 0xff)
-        {
-            source = (byte *) column + 3;
-            dest = desttop + column->topdelta * SCREENWIDTH;
-            dest2 = desttop2 + column->topdelta * SCREENWIDTH;
-            count = column->length;
-
-            while (count--)
-            {
-                *dest2 = tinttable[((*dest2) << 8)];
-                dest2 += SCREENWIDTH;
-                *dest = *source++;
-                dest += SCREENWIDTH;
+    V_MarkRect(x, y, SHORT(patch->width) + 2, SHORT(patch->height) + 2);
 
-            }
-            column = (column_t *) ((byte *) column + column->length + 4);
-        }
-    }
+    // The shadow is offset by two pixels, so every pixel of it is drawn
+    // before the patch pixel that may cover it.
+    V_DrawPatchColumns(x + 2, y + 2, patch, false, PATCH_SHADOW);
+    V_DrawPatchColumns(x, y, patch, false, PATCH_COPY);
 }
 
 //
@@ -626,6 +515,64 @@ void V_LoadXlaTable(void)
         xlatab = W_CacheLumpName("XLATAB", PU_STATIC);
 }
 
+//
+// V_ScaleBlock
+//
+// [SVE] Copy a linear block of pixels on the 320x200 screen into a
+// screen buffer, each pixel covering a hires x hires square.
+//
+
+static void V_ScaleBlock(byte *dest, int width, int height, byte *src)
+{
+    byte *row;
+    int x, i, j;
+
+    while (height--) 
+    { 
+        if (hires == 1)
+        {
+            memcpy (dest, src, width); 
+        }
+        else
+        {
+            for (row = dest, x = 0; x < width; x++)
+            {
+                for (i = 0; i < hires; i++)
+                    *row++ = src[x];
+            }
+
+            for (j = 1; j < hires; j++)
+            {
+                memcpy (dest + j * renderwidth, dest, width * hires);
+            }
+        }
+
+        src += width; 
+        dest += renderwidth * hires; 
+    } 
+}
+
+//
+// V_FillBlock
+//
+// [SVE] Fill a block on the 320x200 screen in the video buffer.
+//
+
+static void V_FillBlock(int x, int y, int w, int h, int c)
+{
+    byte *dest;
+
+    V_MarkRect(x, y, w, h);
+
+    dest = I_VideoBuffer + renderwidth * y * hires + x * hires;
+
+    for (h *= hires; h > 0; h--)
+    {
+        memset(dest, c, w * hires);
+        dest += renderwidth;
+    }
+}
+
 //
 // V_DrawBlock
 // Draw a linear block of pixels into the view buffer.
@@ -633,8 +580,6 @@ void V_LoadXlaTable(void)
 
 void V_DrawBlock(int x, int y, int width, int height, byte *src) 
 { 
-    byte *dest; 
- 
 #ifdef RANGECHECK 
     if (x < 0
      || x + width >SCREENWIDTH
@@ -654,83 +599,42 @@ void V_DrawBlock(int x, int y, int width, int height, byte *src)
  
     V_MarkRect (x, y, width, height); 
  
-    dest = dest_screen + y * SCREENWIDTH + x; 
-
-    while (height--) 
-    { 
-	memcpy (dest, src, width); 
-	src += width; 
-	dest += SCREENWIDTH; 
-    } 
+    V_ScaleBlock(dest_screen + renderwidth * y * hires + x * hires,
+                 width, height, src);
 } 
 
 void V_DrawFilledBox(int x, int y, int w, int h, int c)
 {
-    uint8_t *buf, *buf1, *data;
-    int x1, y1;
-
-    data = I_VideoBuffer + SCREENWIDTH * y + x;
-    buf = data;
-
-    for (y1 = 0; y1 < h; ++y1)
-    {
-        buf1 = buf;
-
-        for (x1 = 0; x1 < w; ++x1)
-        {
-            *buf1++ = c;
-        }
-
-        buf += SCREENWIDTH;
-    }
+    V_FillBlock(x, y, w, h, c);
 
     // [SVE] svillarreal
     if(use3drenderer)
     {
-        RB_BlitBlock(x, y, w, h, data, 0xff);
+        RB_BlitFill(x, y, w, h, c, 0xff);
         return;
     }
 }
 
 void V_DrawHorizLine(int x, int y, int w, int c)
 {
-    uint8_t *buf, *data;
-    int x1;
-
-    data = I_VideoBuffer + SCREENWIDTH * y + x;
-    buf = data;
-
-    for (x1 = 0; x1 < w; ++x1)
-    {
-        *buf++ = c;
-    }
+    V_FillBlock(x, y, w, 1, c);
 
     // [SVE] svillarreal
     if(use3drenderer)
     {
-        RB_BlitBlock(x, y, w, 1, data, 0xff);
+        RB_BlitFill(x, y, w, 1, c, 0xff);
         return;
     }
 }
 
 void V_DrawVertLine(int x, int y, int h, int c)
 {
-    uint8_t *buf, *data;
-    int y1;
-
-    data = I_VideoBuffer + SCREENWIDTH * y + x;
-    buf = data;
-
-    for (y1 = 0; y1 < h; ++y1)
-    {
-        *buf = c;
-        buf += SCREENWIDTH;
-    }
+    V_FillBlock(x, y, 1, h, c);
 
     // [SVE] svillarreal
     if(use3drenderer)
     {
-        RB_BlitBlock(x, y, 1, h, data, 0xff);
+        RB_BlitFill(x, y, 1, h, c, 0xff);
         return;
     }
 }
@@ -750,7 +654,8 @@ void V_DrawBox(int x, int y, int w, int h, int c)
  
 void V_DrawRawScreen(byte *raw)
 {
-    memcpy(dest_screen, raw, SCREENWIDTH * SCREENHEIGHT);
+    V_MarkRect(0, 0, SCREENWIDTH, SCREENHEIGHT); // [SVE]
+    V_ScaleBlock(dest_screen, SCREENWIDTH, SCREENHEIGHT, raw);
 }
 
 //
@@ -1061,7 +966,7 @@ void V_ScreenShot(char *format)
         if(png_screenshots)
         {
             WritePNGfile(lbmname, I_VideoBuffer,
-                SCREENWIDTH, SCREENHEIGHT,
+                renderwidth, renderheight,
                 W_CacheLumpName (DEH_String("PLAYPAL"), PU_CACHE));
         }
         else
@@ -1069,7 +974,7 @@ void V_ScreenShot(char *format)
         {
             // save the pcx file
             WritePCXfile(lbmname, I_VideoBuffer,
-                SCREENWIDTH, SCREENHEIGHT,
+                renderwidth, renderheight,
                 W_CacheLumpName (DEH_String("PLAYPAL"), PU_CACHE));
         }
     }
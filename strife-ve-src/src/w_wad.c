@@ -66,6 +66,17 @@ unsigned int numlumps = 0;
 
 static lumpinfo_t **lumphash;
 
+// [SVE] Lumps by the address of their data, so that a pointer returned
+// by W_CacheLumpNum can be traced back to its lump.  Each lump is in
+// the chain for the address it was last found at.
+
+static int *lumpdatahash;
+static int *lumpdatanext;
+static void **lumpdataptr;
+static unsigned int numlumpdata;
+
+#define LUMPDATAHASH(p) ((unsigned int) (((size_t) (p) >> 4) % numlumpdata))
+
 // Hash function used for lump names.
 
 unsigned int W_LumpNameHash(const char *s)
@@ -197,6 +208,17 @@ wad_file_t *W_AddFile (const char *filename)
         lumphash = NULL;
     }
 
+    // [SVE] Sized by the number of lumps, so rebuilt along with lumphash.
+
+    if (lumpdatahash != NULL)
+    {
+        Z_Free(lumpdatahash);
+        Z_Free(lumpdatanext);
+        Z_Free(lumpdataptr);
+        lumpdatahash = NULL;
+        numlumpdata = 0;
+    }
+
     return wad_file;
 }
 
@@ -331,6 +353,61 @@ void W_ReadLump(unsigned int lump, void *dest)
 
 
 
+//
+// W_LumpData
+//
+// [SVE] Where the lump's data is, or NULL if it is not loaded.
+//
+
+static void *W_LumpData(int lumpnum)
+{
+    lumpinfo_t *lump = &lumpinfo[lumpnum];
+
+    if (lump->wad_file->mapped != NULL)
+    {
+        return lump->wad_file->mapped + lump->position;
+    }
+
+    return lump->cache;
+}
+
+//
+// W_HashLumpData
+//
+// [SVE] Put the lump in the chain for the address of its data.
+//
+
+static void W_HashLumpData(int lumpnum, void *data)
+{
+    int *link;
+
+    if ((unsigned int) lumpnum >= numlumpdata
+     || lumpdataptr[lumpnum] == data)
+    {
+        return;
+    }
+
+    if (lumpdataptr[lumpnum] != NULL)
+    {
+        link = &lumpdatahash[LUMPDATAHASH(lumpdataptr[lumpnum])];
+
+        while (*link != lumpnum)
+        {
+            link = &lumpdatanext[*link];
+        }
+
+        *link = lumpdatanext[lumpnum];
+    }
+
+    lumpdataptr[lumpnum] = data;
+
+    if (data != NULL)
+    {
+        lumpdatanext[lumpnum] = lumpdatahash[LUMPDATAHASH(data)];
+        lumpdatahash[LUMPDATAHASH(data)] = lumpnum;
+    }
+}
+
 //
 // W_CacheLumpNum
 //
@@ -380,6 +457,8 @@ void *W_CacheLumpNum(int lumpnum, int tag)
         lump->cache = Z_Malloc(W_LumpLength(lumpnum), tag, &lump->cache);
 	W_ReadLump (lumpnum, lump->cache);
         result = lump->cache;
+
+        W_HashLumpData(lumpnum, result); // [SVE]
     }
 	
     return result;
@@ -527,6 +606,27 @@ void W_GenerateHashTable(void)
             lumpinfo[i].next = lumphash[hash];
             lumphash[hash] = &lumpinfo[i];
         }
+
+        // [SVE] and by the address of any data already loaded
+
+        if (lumpdatahash != NULL)
+        {
+            Z_Free(lumpdatahash);
+            Z_Free(lumpdatanext);
+            Z_Free(lumpdataptr);
+        }
+
+        numlumpdata = numlumps;
+        lumpdatahash = Z_Malloc(sizeof(int) * numlumps, PU_STATIC, NULL);
+        lumpdatanext = Z_Malloc(sizeof(int) * numlumps, PU_STATIC, NULL);
+        lumpdataptr = Z_Malloc(sizeof(void *) * numlumps, PU_STATIC, NULL);
+        memset(lumpdatahash, 0xff, sizeof(int) * numlumps);
+        memset(lumpdataptr, 0, sizeof(void *) * numlumps);
+
+        for (i=0; i<numlumps; ++i)
+        {
+            W_HashLumpData(i, W_LumpData(i));
+        }
     }
 
     // All done!
@@ -588,6 +688,29 @@ wad_file_t *W_WadFileForLumpName(const char *name)
     return lumpinfo[lumpnum].wad_file;
 }
 
+//
+// [SVE]
+// Find the lump whose data is at the given address, as returned by
+// W_CacheLumpNum.  Returns -1 if it is not the data of a loaded lump.
+//
+int W_LumpNumForData(const void *data)
+{
+    int i;
+
+    if (numlumpdata == 0 || data == NULL)
+        return -1;
+
+    for (i = lumpdatahash[LUMPDATAHASH(data)]; i >= 0; i = lumpdatanext[i])
+    {
+        // Empty marker lumps can share an address with the next lump.
+        if (lumpdataptr[i] == data && W_LumpData(i) == data
+         && lumpinfo[i].size > 0)
+            return i;
+    }
+
+    return -1;
+}
+
 //
 // [SVE]
 // Get the wad_file_t for a lump by number.
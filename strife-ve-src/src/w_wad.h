@@ -79,5 +79,6 @@ void W_CheckCorrectIWAD(GameMission_t mission);
 // [SVE]
 wad_file_t *W_WadFileForLumpName(const char *name);
 wad_file_t *W_WadFileForLumpNum(int lumpnum);
+int W_LumpNumForData(const void *data);
 
 #endif